@@ -23,6 +23,7 @@ import { Range, TextDocument } from 'vscode-languageserver-textdocument';
 import {execFile, spawn} from "child_process";
 import * as url from "url";
 import { ast2ts,analyze } from "ast2ts";
+import { Src2JSONSession } from "./session";
 
 
 
@@ -160,6 +161,43 @@ function execSrc2JSON<T>(exe_path :string,command :Array<string>,text :string,is
     });
 }
 
+// long-lived `src2json --stdin-session` per src2json path.
+// falls back to spawning src2json per request if the session is not available
+const sessionArgs = ["--error-tolerant","--collect-comments","--no-color","--interpret-mode","utf16"];
+const sessions = new Map<string,Src2JSONSession|null>();
+
+const getSession = (exe_path :string) => {
+    let session = sessions.get(exe_path);
+    if(session === undefined || (session !== null && !session.alive)) {
+        session = new Src2JSONSession(exe_path,sessionArgs);
+        sessions.set(exe_path,session);
+    }
+    return session;
+}
+
+async function runSrc2JSON<T>(exe_path :string,method :"lex"|"parse",path :string,text :string,isT: (x :any) => x is T) {
+    const session = getSession(exe_path);
+    if(session !== null) {
+        try {
+            const res = await session.run(path,text,method);
+            if(res.timing !== null) {
+                console.log(`session ${method}: total ${res.timing.total_us}us phase ${res.timing.phase_us}us cached=${res.timing.cached} reused=${res.timing.reused_blocks} relexed=${res.timing.relexed_blocks} full_lex=${res.timing.full_lex} reused_parse=${res.timing.reused_parse_blocks} reparsed=${res.timing.reparsed_blocks} full_parse=${res.timing.full_parse}`);
+            }
+            const parsed = JSON.parse(res.json);
+            if(!isT(parsed)) {
+                throw new TypeError("not valid file");
+            }
+            return parsed;
+        } catch(e :any) {
+            console.log(`session error: ${e}; fallback to process per request`);
+            if(!session.alive) {
+                sessions.set(exe_path,null);
+            }
+        }
+    }
+    return execSrc2JSON(exe_path,method === "lex" ? lexerCommand(path) : parserCommand(path),text,isT);
+}
+
 const lexerCommand=(path :string) => ["--stdin","--stdin-name",path, "--lexer", "--no-color", "--print-on-error","--print-json","--interpret-mode","utf16","--detected-stdio-type"];
 const parserCommand = (path :string) => ["--error-tolerant","--collect-comments","--stdin","--stdin-name",path, "--no-color", "--print-on-error","--print-json","--interpret-mode","utf16","--detected-stdio-type"];
 
@@ -199,7 +237,7 @@ const tokenizeSourceImpl  = async (doc :TextDocument,docInfo :DocumentInfo) =>{
     console.time("tokenize")
     let tokens_ :ast2ts.TokenFile;
     try {
-        tokens_ =  await execSrc2JSON(settings.src2json,lexerCommand(path),text,ast2ts.isTokenFile);
+        tokens_ =  await runSrc2JSON(settings.src2json,"lex",path,text,ast2ts.isTokenFile);
     } catch(e :any) {
         console.timeEnd("tokenize")
         console.timeEnd("semanticColoring")
@@ -207,7 +245,7 @@ const tokenizeSourceImpl  = async (doc :TextDocument,docInfo :DocumentInfo) =>{
     }
     console.timeEnd("tokenize")
     const res =await analyze.analyzeSourceCode(docInfo.prevSemanticTokens,tokens_,async()=>{
-        let ast =await execSrc2JSON(settings.src2json,parserCommand(path),text,ast2ts.isAstFile);
+        let ast =await runSrc2JSON(settings.src2json,"parse",path,text,ast2ts.isAstFile);
         docInfo.prevFile = ast;
         if(ast.ast !== null) {
             docInfo.prevNode = ast2ts.parseAST(ast.ast);
@@ -243,7 +281,7 @@ const parseOnlyImpl = async (doc: TextDocument, docInfo: DocumentInfo) => {
     const path = url.fileURLToPath(doc.uri);
     const text = doc.getText();
     const settings = await getDocumentSettings(doc.uri);
-    const ast = await execSrc2JSON(settings.src2json, parserCommand(path), text, ast2ts.isAstFile);
+    const ast = await runSrc2JSON(settings.src2json, "parse", path, text, ast2ts.isAstFile);
     docInfo.prevFile = ast;
     if (ast.ast !== null) {
         docInfo.prevNode = ast2ts.parseAST(ast.ast);
@@ -432,6 +470,12 @@ documents.onDidOpen(e => {
 
 // Only keep settings for open documents
 documents.onDidClose(e => {
+    const path = url.fileURLToPath(e.document.uri);
+    for(const session of sessions.values()) {
+        if(session !== null && session.alive) {
+            session.close(path).catch(err => console.log(`session close error: ${err}`));
+        }
+    }
     documentSettings.delete(e.document.uri);
     documentInfos.delete(e.document.uri);
 });
@@ -0,0 +1,254 @@
+// client of `src2json --stdin-session`
+// requests/responses use generator protocol framing (see example/brgen_help/generator.bgn)
+import {spawn, ChildProcessWithoutNullStreams} from "child_process";
+
+export interface SessionChange {
+    start: {line: number, character: number};
+    end: {line: number, character: number};
+    text: string;
+}
+
+export interface SessionTiming {
+    method: string;
+    version: number;
+    cached: boolean;
+    phase_us: number;
+    total_us: number;
+    reused_blocks: number;
+    relexed_blocks: number;
+    full_lex: boolean;
+    reused_parse_blocks: number;
+    reparsed_blocks: number;
+    full_parse: boolean;
+}
+
+interface SourceCode {
+    status: number;
+    name: string;
+    error: string;
+    code: string;
+}
+
+interface Pending {
+    sources: SourceCode[];
+    resolve: (x: SourceCode[]) => void;
+    reject: (e: Error) => void;
+}
+
+const writeU64 = (buf: Buffer, value: number, offset: number) => {
+    buf.writeUInt32BE(Math.floor(value / 0x100000000), offset);
+    buf.writeUInt32BE(value >>> 0, offset + 4);
+};
+
+const readU64 = (buf: Buffer, offset: number) => {
+    return buf.readUInt32BE(offset) * 0x100000000 + buf.readUInt32BE(offset + 4);
+};
+
+export class Src2JSONSession {
+    private proc: ChildProcessWithoutNullStreams;
+    private nextId = 1;
+    private pending = new Map<number, Pending>();
+    private buffer = Buffer.alloc(0);
+    private headerRead = false;
+    private dead = false;
+    // document name -> last text session applied
+    private texts = new Map<string, string>();
+    // document name -> tail of requests for the document.
+    // requests of a document run one by one so that deltas are applied in order
+    private queues = new Map<string, Promise<unknown>>();
+
+    constructor(exe_path: string, args: string[]) {
+        this.proc = spawn(exe_path, ["--stdin-session", ...args]);
+        const header = Buffer.alloc(4);
+        header.writeUInt32BE(1, 0);
+        this.proc.stdin.write(header);
+        this.proc.stdout.on("data", (data: Buffer) => {
+            this.buffer = Buffer.concat([this.buffer, data]);
+            this.parseResponses();
+        });
+        this.proc.stderr.on("data", (data) => {
+            console.log(`src2json session stderr: ${data.toString()}`);
+        });
+        const fail = (e: Error) => {
+            this.dead = true;
+            for (const p of this.pending.values()) {
+                p.reject(e);
+            }
+            this.pending.clear();
+        };
+        this.proc.on("error", fail);
+        this.proc.on("exit", (code, signal) => fail(new Error(`session exited: code: ${code} signal: ${signal}`)));
+    }
+
+    get alive() {
+        return !this.dead;
+    }
+
+    private parseResponses() {
+        let offset = 0;
+        if (!this.headerRead) {
+            if (this.buffer.length < 4) {
+                return;
+            }
+            offset = 4;
+            this.headerRead = true;
+        }
+        for (;;) {
+            if (this.buffer.length < offset + 9) {
+                break;
+            }
+            const type = this.buffer.readUInt8(offset);
+            const id = readU64(this.buffer, offset + 1);
+            if (type === 1) { // END_OF_CODE
+                offset += 9;
+                const p = this.pending.get(id);
+                if (p !== undefined) {
+                    this.pending.delete(id);
+                    p.resolve(p.sources);
+                }
+                continue;
+            }
+            // CODE: id, status, name, error_message, code
+            let cur = offset + 9;
+            if (this.buffer.length < cur + 1) {
+                break;
+            }
+            const status = this.buffer.readUInt8(cur);
+            cur += 1;
+            const fields: string[] = [];
+            for (let i = 0; i < 3; i++) {
+                if (this.buffer.length < cur + 8) {
+                    break;
+                }
+                const len = readU64(this.buffer, cur);
+                if (this.buffer.length < cur + 8 + len) {
+                    break;
+                }
+                fields.push(this.buffer.toString("utf8", cur + 8, cur + 8 + len));
+                cur += 8 + len;
+            }
+            if (fields.length !== 3) {
+                break;
+            }
+            offset = cur;
+            this.pending.get(id)?.sources.push({status, name: fields[0], error: fields[1], code: fields[2]});
+        }
+        this.buffer = this.buffer.subarray(offset);
+    }
+
+    private request(name: string, payload: object) {
+        return new Promise<SourceCode[]>((resolve, reject) => {
+            if (this.dead) {
+                reject(new Error("session is not alive"));
+                return;
+            }
+            const id = this.nextId++;
+            const nameBuf = Buffer.from(name, "utf8");
+            const json = Buffer.from(JSON.stringify(payload), "utf8");
+            const buf = Buffer.alloc(24 + nameBuf.length + json.length);
+            writeU64(buf, id, 0);
+            writeU64(buf, nameBuf.length, 8);
+            nameBuf.copy(buf, 16);
+            writeU64(buf, json.length, 16 + nameBuf.length);
+            json.copy(buf, 24 + nameBuf.length);
+            this.pending.set(id, {sources: [], resolve, reject});
+            this.proc.stdin.write(buf);
+        });
+    }
+
+    // single delta from prev to text. split points never divide a surrogate pair
+    private diff(prev: string, text: string): SessionChange {
+        const isHigh = (c: number) => c >= 0xD800 && c <= 0xDBFF;
+        const isLow = (c: number) => c >= 0xDC00 && c <= 0xDFFF;
+        let prefix = 0;
+        const max = Math.min(prev.length, text.length);
+        while (prefix < max && prev.charCodeAt(prefix) === text.charCodeAt(prefix)) {
+            prefix++;
+        }
+        if (prefix > 0 && isHigh(prev.charCodeAt(prefix - 1))) {
+            prefix--;
+        }
+        let suffix = 0;
+        while (suffix < max - prefix && prev.charCodeAt(prev.length - 1 - suffix) === text.charCodeAt(text.length - 1 - suffix)) {
+            suffix++;
+        }
+        if (suffix > 0 && isLow(prev.charCodeAt(prev.length - suffix))) {
+            suffix--;
+        }
+        const positionAt = (s: string, offset: number) => {
+            const before = s.substring(0, offset);
+            const line = before.split("\n").length - 1;
+            return {line, character: offset - (before.lastIndexOf("\n") + 1)};
+        };
+        return {
+            start: positionAt(prev, prefix),
+            end: positionAt(prev, prev.length - suffix),
+            text: text.substring(prefix, text.length - suffix),
+        };
+    }
+
+    // runs fn after previous requests of the document settled
+    private enqueue<T>(name: string, fn: () => Promise<T>): Promise<T> {
+        const prev = this.queues.get(name) ?? Promise.resolve();
+        const next = prev.then(fn, fn);
+        const tail = next.catch(() => {});
+        this.queues.set(name, tail);
+        tail.then(() => {
+            if (this.queues.get(name) === tail) {
+                this.queues.delete(name);
+            }
+        });
+        return next;
+    }
+
+    // send text as single delta from text session applied last, or as open.
+    // if change fails, session state of document is unknown, so whole text is sent again by open.
+    // must be called in queue of the document
+    private async sync(name: string, text: string) {
+        const prev = this.texts.get(name);
+        if (prev === text) {
+            return;
+        }
+        // unknown until session answers
+        this.texts.delete(name);
+        const failed = (sources: SourceCode[]) => sources.find((x) => x.status !== 0);
+        if (prev !== undefined) {
+            const changed = await this.request(name, {method: "change", changes: [this.diff(prev, text)]})
+                .then((sources) => failed(sources) === undefined, () => false);
+            if (changed) {
+                this.texts.set(name, text);
+                return;
+            }
+        }
+        const error = failed(await this.request(name, {method: "open", text}));
+        if (error !== undefined) {
+            throw new Error(error.error);
+        }
+        this.texts.set(name, text);
+    }
+
+    close(name: string) {
+        return this.enqueue(name, async () => {
+            this.texts.delete(name);
+            await this.request(name, {method: "close"});
+        });
+    }
+
+    // returns json text same as src2json output and timing of request
+    run(name: string, text: string, method: "lex" | "parse") {
+        return this.enqueue(name, async () => {
+            await this.sync(name, text);
+            const sources = await this.request(name, {method});
+            const error = sources.find((x) => x.status !== 0);
+            if (error !== undefined) {
+                throw new Error(error.error);
+            }
+            const out = sources.find((x) => x.name === `${name}.json`);
+            const timing = sources.find((x) => x.name === `${name}.timing.json`);
+            if (out === undefined) {
+                throw new Error("no output from session");
+            }
+            return {json: out.code, timing: timing !== undefined ? JSON.parse(timing.code) as SessionTiming : null};
+        });
+    }
+}
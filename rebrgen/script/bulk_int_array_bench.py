@@ -0,0 +1,294 @@
+# throughput benchmark of BULK_INT_ARRAY lowering
+# generates a format with large u16/u32/u64 arrays, runs ebmgen and each backend,
+# builds a small driver per backend with optimization enabled and measures
+# decode/encode throughput (MB/s) over the same payload.
+# with --baseline, compares against previous result (e.g. one taken with
+# element-wise ARRAY_FOR_EACH lowering) and prints speedup of each metric
+#
+# usage:
+#   python script/bulk_int_array_bench.py --out bulk.json
+#   python script/bulk_int_array_bench.py --baseline bulk.json
+import argparse
+import json
+import os
+import pathlib as pl
+import random
+import shutil
+import struct
+import subprocess as sp
+import sys
+import tempfile
+
+EXE_SUFFIX = ".exe" if os.name == "nt" else ""
+
+FORMAT_NAME = "BulkBench"
+SOURCE = f"""
+format {FORMAT_NAME}:
+    count :u32
+    a16 :[count]u16
+    a32 :[count]u32
+    a64 :[count]u64
+"""
+
+CPP_DRIVER = """
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "generated.hpp"
+
+int main(int argc, char** argv) {
+    FILE* fp = fopen(argv[1], "rb");
+    size_t iterations = strtoull(argv[2], nullptr, 10);
+    std::vector<std::uint8_t> input;
+    std::uint8_t buf[65536];
+    for (size_t n; (n = fread(buf, 1, sizeof(buf), fp)) > 0;) {
+        input.insert(input.end(), buf, buf + n);
+    }
+    fclose(fp);
+    std::vector<std::uint8_t> output(input.size());
+    double decode_ns = 0, encode_ns = 0;
+    for (size_t i = 0; i < iterations; i++) {
+        BulkBench obj{};
+        ::futils::binary::reader r{::futils::view::rvec(input.data(), input.size())};
+        auto begin = std::chrono::steady_clock::now();
+        if (obj.decode(r)) {
+            fprintf(stderr, "decode failed\\n");
+            return 1;
+        }
+        auto mid = std::chrono::steady_clock::now();
+        ::futils::binary::writer w{::futils::view::wvec(output.data(), output.size())};
+        if (obj.encode(w)) {
+            fprintf(stderr, "encode failed\\n");
+            return 1;
+        }
+        auto end = std::chrono::steady_clock::now();
+        if (w.offset() != input.size()) {
+            fprintf(stderr, "round trip size mismatch\\n");
+            return 1;
+        }
+        decode_ns += std::chrono::duration<double, std::nano>(mid - begin).count();
+        encode_ns += std::chrono::duration<double, std::nano>(end - mid).count();
+    }
+    if (output != input) {
+        fprintf(stderr, "round trip mismatch\\n");
+        return 1;
+    }
+    printf("{\\"bytes\\": %zu, \\"decode_ns\\": %.0f, \\"encode_ns\\": %.0f}\\n", input.size(), decode_ns, encode_ns);
+    return 0;
+}
+"""
+
+C_DRIVER = """
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "generated.h"
+
+typedef struct {
+    void* data;
+    size_t size;
+    size_t capacity;
+} GenericVector;
+
+static int bench_append(struct DecoderInput* self, VECTOR_OF(void)* v, const void* elem, size_t elem_size, const char* type_str) {
+    GenericVector* vec = (GenericVector*)v;
+    (void)self;
+    (void)type_str;
+    if (vec->size >= vec->capacity) {
+        size_t cap = vec->capacity ? vec->capacity * 2 : 4;
+        void* p = realloc(vec->data, cap * elem_size);
+        if (!p) return -1;
+        vec->data = p;
+        vec->capacity = cap;
+    }
+    memcpy((char*)vec->data + vec->size * elem_size, elem, elem_size);
+    vec->size++;
+    return 0;
+}
+
+static int bench_reserve(struct DecoderInput* self, VECTOR_OF(void)* v, size_t size, size_t elem_size) {
+    GenericVector* vec = (GenericVector*)v;
+    (void)self;
+    if (size <= vec->capacity) return 0;
+    void* p = realloc(vec->data, size * elem_size);
+    if (!p) return -1;
+    vec->data = p;
+    vec->capacity = size;
+    return 0;
+}
+
+static void bench_free(struct FreeFunctionInput* self, VECTOR_OF(void)* v, size_t elem_size) {
+    GenericVector* vec = (GenericVector*)v;
+    (void)self;
+    (void)elem_size;
+    free(vec->data);
+    memset(vec, 0, sizeof(*vec));
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+int main(int argc, char** argv) {
+    FILE* fp = fopen(argv[1], "rb");
+    size_t iterations = strtoull(argv[2], NULL, 10);
+    fseek(fp, 0, SEEK_END);
+    size_t len = (size_t)ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    uint8_t* input = (uint8_t*)malloc(len);
+    uint8_t* output = (uint8_t*)malloc(len);
+    if (fread(input, 1, len, fp) != len) return 1;
+    fclose(fp);
+    double decode_ns = 0, encode_ns = 0;
+    for (size_t i = 0; i < iterations; i++) {
+        BulkBench obj;
+        memset(&obj, 0, sizeof(obj));
+        DecoderInput in;
+        memset(&in, 0, sizeof(in));
+        in.data = input;
+        in.data_end = input + len;
+        in.append = bench_append;
+        in.reserve = bench_reserve;
+        EncoderInput out;
+        memset(&out, 0, sizeof(out));
+        out.data = output;
+        out.data_end = output + len;
+        double begin = now_ns();
+        if (BulkBench_decode(&obj, &in) != 0) {
+            fprintf(stderr, "decode failed\\n");
+            return 1;
+        }
+        double mid = now_ns();
+        if (BulkBench_encode(&obj, &out) != 0 || out.offset != len) {
+            fprintf(stderr, "encode failed\\n");
+            return 1;
+        }
+        double end = now_ns();
+        decode_ns += mid - begin;
+        encode_ns += end - mid;
+        FreeFunctionInput f;
+        memset(&f, 0, sizeof(f));
+        f.free = bench_free;
+        BulkBench_free(&obj, &f);
+    }
+    if (memcmp(input, output, len) != 0) {
+        fprintf(stderr, "round trip mismatch\\n");
+        return 1;
+    }
+    printf("{\\"bytes\\": %zu, \\"decode_ns\\": %.0f, \\"encode_ns\\": %.0f}\\n", len, decode_ns, encode_ns);
+    free(input);
+    free(output);
+    return 0;
+}
+"""
+
+BACKENDS = {
+    "ebm2cpp": {"header": "generated.hpp", "driver": "main.cpp", "source": CPP_DRIVER},
+    "ebm2c": {"header": "generated.h", "driver": "main.c", "source": C_DRIVER},
+}
+
+
+def run(cmd: list, **kwargs):
+    print("running:", " ".join(str(c) for c in cmd), file=sys.stderr, flush=True)
+    return sp.check_output([str(c) for c in cmd], **kwargs)
+
+
+def make_payload(path: pl.Path, count: int, seed: int):
+    rng = random.Random(seed)
+    with open(path, "wb") as f:
+        f.write(struct.pack(">I", count))
+        for width in (2, 4, 8):
+            f.write(rng.randbytes(count * width))
+
+
+def build_driver(args, backend: str, work: pl.Path, ebm: pl.Path) -> pl.Path:
+    conf = BACKENDS[backend]
+    dir = work / backend
+    dir.mkdir(parents=True, exist_ok=True)
+    run([pl.Path(args.tool_dir) / (backend + EXE_SUFFIX), "-i", ebm, "-o", dir / conf["header"]])
+    (dir / conf["driver"]).write_text(conf["source"])
+    exe = dir / ("bench" + EXE_SUFFIX)
+    if backend == "ebm2cpp":
+        futils_include = pl.Path(args.futils_dir) / "src" / "include"
+        run([args.cxx, "-std=c++20", "-O2", "-I", dir, "-I", futils_include, dir / conf["driver"], "-o", exe])
+    else:
+        run([args.cc, "-std=c11", "-O2", "-I", dir, dir / conf["driver"], "-o", exe])
+    return exe
+
+
+def measure(exe: pl.Path, payload: pl.Path, iterations: int) -> dict:
+    r = json.loads(run([exe, payload, iterations]))
+    mb = r["bytes"] * iterations / 1e6
+    return {
+        "bytes": r["bytes"],
+        "iterations": iterations,
+        "decode_mb_s": mb / (r["decode_ns"] / 1e9) if r["decode_ns"] else 0,
+        "encode_mb_s": mb / (r["encode_ns"] / 1e9) if r["encode_ns"] else 0,
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description="measure throughput of bulk integer array decode/encode")
+    parser.add_argument("--tool-dir", default="./tool", help="directory containing ebmgen and ebm2* backends")
+    parser.add_argument("--futils-dir", default="../utils", help="futils checkout (for ebm2cpp generated code)")
+    parser.add_argument("--backends", default="ebm2cpp,ebm2c", help="comma separated backend names")
+    parser.add_argument("--elements", type=int, default=1 << 20, help="number of elements of each array")
+    parser.add_argument("--iterations", type=int, default=20, help="decode/encode round trips per backend")
+    parser.add_argument("--seed", type=int, default=0, help="seed of random payload")
+    parser.add_argument("--cxx", default=os.environ.get("CXX", "clang++"), help="C++ compiler")
+    parser.add_argument("--cc", default=os.environ.get("CC", "clang"), help="C compiler")
+    parser.add_argument("--work-dir", default=None, help="keep intermediate files in this directory")
+    parser.add_argument("--out", default=None, help="write result json to this file (default: stdout)")
+    parser.add_argument("--baseline", default=None, help="previous result json to compare with")
+    args = parser.parse_args()
+
+    result = {"elements": args.elements, "backends": {}}
+    with tempfile.TemporaryDirectory() as tmp:
+        work = pl.Path(args.work_dir) if args.work_dir else pl.Path(tmp)
+        work.mkdir(parents=True, exist_ok=True)
+        source = work / "bulk_bench.bgn"
+        source.write_text(SOURCE)
+        ebm = work / "bulk_bench.ebm"
+        run([pl.Path(args.tool_dir) / ("ebmgen" + EXE_SUFFIX), "-i", source, "-o", ebm])
+        payload = work / "payload.bin"
+        make_payload(payload, args.elements, args.seed)
+        for backend in args.backends.split(","):
+            backend = backend.strip()
+            if not backend:
+                continue
+            if backend not in BACKENDS:
+                print(f"unsupported backend: {backend} (supported: {', '.join(BACKENDS)})", file=sys.stderr)
+                sys.exit(1)
+            if backend == "ebm2cpp" and shutil.which(args.cxx) is None or backend == "ebm2c" and shutil.which(args.cc) is None:
+                print(f"{backend}: compiler not found, skipped", file=sys.stderr)
+                continue
+            exe = build_driver(args, backend, work, ebm)
+            r = measure(exe, payload, args.iterations)
+            print(f"{backend}: decode {r['decode_mb_s']:.1f} MB/s, encode {r['encode_mb_s']:.1f} MB/s", file=sys.stderr, flush=True)
+            result["backends"][backend] = r
+
+    text = json.dumps(result, indent=2)
+    if args.out:
+        with open(args.out, "w") as f:
+            f.write(text)
+    else:
+        print(text)
+
+    if args.baseline:
+        with open(args.baseline, "r") as f:
+            base = json.load(f)
+        for backend, r in result["backends"].items():
+            b = base.get("backends", {}).get(backend)
+            if not b:
+                continue
+            for key in ("decode_mb_s", "encode_mb_s"):
+                if b[key]:
+                    print(f"{backend}.{key}: {b[key]:.1f} -> {r[key]:.1f} (x{r[key] / b[key]:.2f})", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -762,6 +762,7 @@ namespace ebm::zc {
         MULTI_REPRESENTATION = 7,
         VECTORIZED_IO = 8,
         SCAN_UNTIL = 9,
+        BULK_INT_ARRAY = 10,
     };
     constexpr const char* to_string(LoweringIOType e, bool origin_form = false) {
         switch(e) {
@@ -775,6 +776,7 @@ namespace ebm::zc {
             case LoweringIOType::MULTI_REPRESENTATION: return origin_form ? "MULTI_REPRESENTATION":"MULTI_REPRESENTATION" ;
             case LoweringIOType::VECTORIZED_IO: return origin_form ? "VECTORIZED_IO":"VECTORIZED_IO" ;
             case LoweringIOType::SCAN_UNTIL: return origin_form ? "SCAN_UNTIL":"SCAN_UNTIL" ;
+            case LoweringIOType::BULK_INT_ARRAY: return origin_form ? "BULK_INT_ARRAY":"BULK_INT_ARRAY" ;
         }
         return "";
     }
@@ -813,6 +815,9 @@ namespace ebm::zc {
         if (str == "SCAN_UNTIL") {
             return LoweringIOType::SCAN_UNTIL;
         }
+        if (str == "BULK_INT_ARRAY") {
+            return LoweringIOType::BULK_INT_ARRAY;
+        }
         return std::nullopt;
     }
     constexpr const char* visit_enum(LoweringIOType) {
@@ -76998,11 +76998,13 @@ DEFINE_ENTRY(ebm2c::Flags, ebm2c::Output) {
     ebm2c::MergedVisitor visitor{flags,output,w,ebm,visitors_impl};
     auto entry_function = [&]() -> ebmgen::expected<ebm2c::Result> {
         ebm2c::InitialContext initial_ctx{.visitor = visitor};
+        ebmcodegen::adopt_shared_id_maps(visitor.module_); // no-op unless linked into ebm2multi
         auto pre_visit_result = ebm2c::dispatch_pre_visitor(initial_ctx,ebm);
         CODEGEN_MAY_HIJACK(pre_visit_result);
         if(!visitor.module_.valid()) {
             visitor.module_.build_maps(); // initialize mapping tables if not yet
         }
+        flags.debug_timing("mapping table built");
         auto entry_result = ebm2c::dispatch_entry(initial_ctx);
         auto post_visit_result = ebm2c::dispatch_post_entry(initial_ctx,entry_result);
         CODEGEN_MAY_HIJACK(post_visit_result);
@@ -14,6 +14,7 @@ def main():
     INPUT_FILE = sys.argv[2]
     OUTPUT_FILE = sys.argv[3]
     TEST_TARGET_FORMAT = sys.argv[4]  # The struct name
+    OPTION_SET_NAME = sys.argv[5] if len(sys.argv) > 5 else "default"
 
     print(f"Testing {TEST_TARGET_FILE} with {INPUT_FILE} and {OUTPUT_FILE}")
 
@@ -39,6 +40,9 @@ def main():
         f.write(
             "target_include_directories(test_runner PRIVATE ${CMAKE_CURRENT_SOURCE_DIR})\n"
         )
+        if OPTION_SET_NAME == "segmented-io":
+            # generated with --segmented-io; main.c splits input into segments and writes iov list
+            f.write("target_compile_definitions(test_runner PRIVATE EBM_TEST_SEGMENTED_IO)\n")
         # Disable some warnings if necessary, as generated code might trigger them
         if os.name != "nt":
             f.write(
@@ -113,6 +117,20 @@ def main():
         return 0;
     }}
 
+    /* makes room for size elements at once (bulk int array decode fills them in place) */
+    int default_reserve(struct DecoderInput* self, VECTOR_OF(void)* vector_void, size_t size, size_t elem_size) {{
+        (void)self;
+        GenericVector* vector = (GenericVector*)vector_void;
+        if (size <= vector->capacity) {{
+            return 0;
+        }}
+        void* new_data = realloc(vector->data, size * elem_size);
+        if (!new_data) return -1;
+        vector->data = new_data;
+        vector->capacity = size;
+        return 0;
+    }}
+
     void default_free(FreeFunctionInput* self, VECTOR_OF(void)* vector_void, size_t elem_size) {{
         if(elem_size == 1) {{
             return;
@@ -126,6 +144,15 @@ def main():
     }}
     #endif
     #endif
+    #ifdef EBM_TEST_SEGMENTED_IO
+    /* small enough that most multi-byte fields straddle segments. kept in globals so
+       that early returns are not reported as leaks */
+    #define EBM_TEST_SEGMENT_SIZE 7
+    #define EBM_TEST_IOV_CAPACITY 256
+    static EbmSegment* test_segments;
+    static EBM_U8_TYPE* test_scratch;
+    static EbmSegment test_iov[EBM_TEST_IOV_CAPACITY];
+    #endif
 
 
 
@@ -203,11 +230,31 @@ def main():
 
         memset(&decoder_input, 0, sizeof(decoder_input));
 
+        #ifdef EBM_TEST_SEGMENTED_IO
+        size_t segment_count = ((size_t)input_len + EBM_TEST_SEGMENT_SIZE - 1) / EBM_TEST_SEGMENT_SIZE;
+        test_segments = (EbmSegment*)malloc((segment_count ? segment_count : 1) * sizeof(EbmSegment));
+        test_scratch = (EBM_U8_TYPE*)malloc(input_len ? input_len : 1);
+        if (!test_segments || !test_scratch) {{
+            fprintf(stderr, "Failed to allocate memory for segments\\n");
+            return 1;
+        }}
+        for (size_t i = 0; i < segment_count; i++) {{
+            size_t begin = i * EBM_TEST_SEGMENT_SIZE;
+            size_t rest = (size_t)input_len - begin;
+            test_segments[i].data = input_buffer + begin;
+            test_segments[i].size = rest < EBM_TEST_SEGMENT_SIZE ? rest : EBM_TEST_SEGMENT_SIZE;
+        }}
+        ebm_decoder_input_set_segments(&decoder_input, test_segments, segment_count);
+        /* straddling fields never need more scratch than whole input */
+        decoder_input.scratch = test_scratch;
+        decoder_input.scratch_end = test_scratch + input_len;
+        #else
         decoder_input.data = input_buffer;
 
         decoder_input.data_end = input_buffer + input_len;
 
         decoder_input.offset = 0;
+        #endif
         #ifdef LAST_ERROR_HANDLER
         decoder_input.set_last_error = default_set_last_error;
         #endif
@@ -216,6 +263,7 @@ def main():
         #endif
         #ifdef VECTOR_OF
         decoder_input.append = default_append;
+        decoder_input.reserve = default_reserve;
         #endif
         /* decoder_input.can_read = NULL; */ /* Use default logic */
 
@@ -284,6 +332,9 @@ def main():
         encoder_input.data_end = output_buffer + output_capacity;
 
         encoder_input.offset = 0;
+        #ifdef EBM_TEST_SEGMENTED_IO
+        ebm_encoder_input_set_iov(&encoder_input, test_iov, EBM_TEST_IOV_CAPACITY);
+        #endif
 
         #ifdef VECTOR_OF
         /* encoder_input.emit = NULL; */ /* Use fixed buffer for now, simplest for test */
@@ -330,7 +381,14 @@ def main():
 
         }}
 
+        #ifdef EBM_TEST_SEGMENTED_IO
+        size_t iov_count = ebm_encoder_input_finish(&encoder_input);
+        for (size_t i = 0; i < iov_count; i++) {{
+            fwrite(test_iov[i].data, 1, test_iov[i].size, fp_out);
+        }}
+        #else
         fwrite(output_buffer, 1, encoder_input.offset, fp_out);
+        #endif
 
         fclose(fp_out);
 
@@ -339,6 +397,10 @@ def main():
         free(input_buffer);
 
         free(output_buffer);
+        #ifdef EBM_TEST_SEGMENTED_IO
+        free(test_segments);
+        free(test_scratch);
+        #endif
 
         #ifdef VECTOR_OF
         FreeFunctionInput free_input;
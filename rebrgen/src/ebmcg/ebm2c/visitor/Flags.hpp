@@ -37,6 +37,7 @@ DEFINE_BOOL_FLAG(no_std_header, false, "no-std-header", "Do not include standard
 DEFINE_BOOL_FLAG(omit_destructor, false, "omit-destructor", "Do not generate destructor functions for structs");
 DEFINE_STRING_FLAG(uint_form, "", "uint-form", "Form of unsigned integer types", "e.g: uintN_t, uN");
 DEFINE_STRING_FLAG(int_form, "", "int-form", "Form of signed integer types", "e.g: intN_t, iN");
+DEFINE_BOOL_FLAG(segmented_io, false, "segmented-io", "Decode from a chain of segments (EbmSegment) and encode into iovec style segment list; fields straddling segments are copied into scratch buffer");
 CONFIG_MAP("config.c.specifier", specifier);
 CONFIG_MAP("config.c.uint_form", uint_form);
 CONFIG_MAP("config.c.int_form", int_form);
@@ -68,7 +68,19 @@ DEFINE_VISITOR_CLASS(Statement_PROGRAM_DECL) {
 )a");
     }
 
-    void write_decoder_macros(CodeWriter & w) {
+    void write_decoder_macros(CodeWriter & w, bool segmented) {
+        if (segmented) {
+            // defined before the contiguous defaults below, which are guarded by #ifndef
+            w.write_unformatted(R"a(
+    #define EBM_SEGMENT_FITS(io, num_bytes) ((size_t)((io)->data_end - ((io)->data + (io)->offset)) >= (size_t)(num_bytes))
+    #ifndef DECODER_CAN_READ_PRIMITIVE
+    #define DECODER_CAN_READ_PRIMITIVE(io, num_bytes) (EBM_SEGMENT_FITS(io, num_bytes) || ebm_segment_remaining(io) >= (size_t)(num_bytes))
+    #endif
+    #ifndef EBM_GET_REMAINING_BYTES
+    #define EBM_GET_REMAINING_BYTES(io) ebm_segment_remaining(io)
+    #endif
+)a");
+        }
         w.write_unformatted(R"a(
     #ifndef DECODER_CAN_READ_PRIMITIVE
     #define DECODER_CAN_READ_PRIMITIVE(io, num_bytes)  (((io)->data + (io)->offset + (num_bytes)) <= (io)->data_end)
@@ -97,7 +109,65 @@ DEFINE_VISITOR_CLASS(Statement_PROGRAM_DECL) {
     #ifndef EBM_LOOP_HARDLIMIT
     #define EBM_LOOP_HARDLIMIT(limit)
     #endif
+)a");
+        if (segmented) {
+            // fields inside current segment are referenced as in contiguous mode;
+            // fields straddling segments are copied into scratch (see ebm_segment_contiguous)
+            w.write_unformatted(R"a(
+    #define EBM_READ_ARRAY_BYTES_TEMPORARY(io, target, size, offset_value,field_str) do { \
+        if (DECODER_CAN_READ((io), (size))) { \
+            if ((offset_value) == 0) { \
+                (target) = (EBM_U8_TYPE*)ebm_segment_contiguous((io), (size)); \
+                if (!(target)) { \
+                    EBM_EMIT_ERROR(field_str ": Not enough scratch space to read array bytes temporary"); \
+                    return -1; \
+                } \
+                EBM_FORCE_ASSERT_VERIFY(io,target,(size)); \
+            } else { \
+                ebm_segment_copy((io), NULL, (size)); \
+            } \
+        } else { \
+            EBM_EMIT_ERROR(field_str ": Not enough data to read array bytes temporary"); \
+            return -1; \
+        } \
+    } while(0)
+
+    #define EBM_READ_BYTES(io, target, size_value, offset_value,field_str) do { \
+        if (DECODER_CAN_READ((io), (size_value))) { \
+            if ((offset_value) == 0) { \
+                (target).data = (EBM_U8_TYPE*)ebm_segment_contiguous((io), (size_value)); \
+                if (!(target).data) { \
+                    EBM_EMIT_ERROR(field_str ": Not enough scratch space to read bytes"); \
+                    return -1; \
+                } \
+                (target).size = (size_value); \
+                (target).capacity = (target).size; \
+            } else { \
+                ebm_segment_copy((io), NULL, (size_value)); \
+            } \
+        } else { \
+            EBM_EMIT_ERROR(field_str ": Not enough data to read bytes"); \
+            return -1; \
+        } \
+    } while(0)
 
+    #define EBM_READ_ARRAY_BYTES(io, target, size_value, offset_value,field_str) do { \
+        if (DECODER_CAN_READ((io), (size_value))) { \
+            if ((offset_value) == 0 && EBM_SEGMENT_FITS((io), (size_value))) { \
+                MEMCPY((target), (io)->data + (io)->offset, (size_value)); \
+                (io)->offset += (size_value); \
+            } else { \
+                ebm_segment_copy((io), (offset_value) == 0 ? (EBM_U8_TYPE*)(target) : NULL, (size_value)); \
+            } \
+        } else { \
+            EBM_EMIT_ERROR(field_str ": Not enough data to read array bytes"); \
+            return -1; \
+        } \
+    } while(0)
+)a");
+        }
+        else {
+            w.write_unformatted(R"a(
     #define EBM_READ_ARRAY_BYTES_TEMPORARY(io, target, size, offset_value,field_str) do { \
         if (DECODER_CAN_READ((io), (size))) { \
             if ((offset_value) == 0) { \
@@ -136,13 +206,186 @@ DEFINE_VISITOR_CLASS(Statement_PROGRAM_DECL) {
             return -1; \
         } \
     } while(0)
-
+)a");
+        }
+        w.write_unformatted(R"a(
     #ifndef EBM_GET_REMAINING_BYTES
     #define EBM_GET_REMAINING_BYTES(io) ((size_t)((io)->data_end - ((io)->data + (io)->offset)))
     #endif
 )a");
     }
 
+    void write_segmented_io_helpers(CodeWriter & w) {
+        w.write_unformatted(R"a(
+    // decoder input: ebm_decoder_input_set_segments(input, segments, count) instead of data/data_end.
+    // fields straddling segments are copied into scratch..scratch_end, which must outlive decoded object
+    static inline void ebm_decoder_input_set_segments(DecoderInput* io, const EbmSegment* segments, size_t count) {
+        io->segments = count ? segments : NULL;
+        io->segment_count = count;
+        io->segment_index = 0;
+        io->data = count ? segments[0].data : NULL;
+        io->data_end = count ? segments[0].data + segments[0].size : NULL;
+        io->offset = 0;
+    }
+
+    static inline size_t ebm_segment_remaining(const DecoderInput* io) {
+        size_t n = (size_t)(io->data_end - (io->data + io->offset));
+        if (io->segments) {
+            for (size_t i = io->segment_index + 1; i < io->segment_count; i++) {
+                n += io->segments[i].size;
+            }
+        }
+        return n;
+    }
+
+    // moves to next non-empty segment while current one is consumed
+    static inline void ebm_segment_normalize(DecoderInput* io) {
+        while (io->segments && io->data + io->offset == io->data_end && io->segment_index + 1 < io->segment_count) {
+            io->segment_index++;
+            io->data = io->segments[io->segment_index].data;
+            io->data_end = io->data + io->segments[io->segment_index].size;
+            io->offset = 0;
+        }
+    }
+
+    // copies size bytes into dst (skips if dst is NULL). caller checks ebm_segment_remaining
+    static inline void ebm_segment_copy(DecoderInput* io, EBM_U8_TYPE* dst, size_t size) {
+        while (size) {
+            ebm_segment_normalize(io);
+            size_t avail = (size_t)(io->data_end - (io->data + io->offset));
+            size_t n = avail < size ? avail : size;
+            if (n == 0) {
+                break;
+            }
+            if (dst) {
+                MEMCPY(dst, io->data + io->offset, n);
+                dst += n;
+            }
+            io->offset += n;
+            size -= n;
+        }
+    }
+
+    // returns size contiguous bytes and consumes them. points into segment if they fit in it,
+    // otherwise copies them into scratch. NULL if scratch is exhausted
+    static inline const EBM_U8_TYPE* ebm_segment_contiguous(DecoderInput* io, size_t size) {
+        ebm_segment_normalize(io);
+        if (EBM_SEGMENT_FITS(io, size)) {
+            const EBM_U8_TYPE* p = io->data + io->offset;
+            io->offset += size;
+            return p;
+        }
+        if (!io->scratch || (size_t)(io->scratch_end - io->scratch) < size) {
+            return NULL;
+        }
+        EBM_U8_TYPE* p = io->scratch;
+        io->scratch += size;
+        ebm_segment_copy(io, p, size);
+        return p;
+    }
+
+    // contiguous view of [off, off + size) from beginning of input (first segment). NULL if out of range or scratch is exhausted
+    static inline const EBM_U8_TYPE* ebm_segment_window(DecoderInput* io, size_t off, size_t size) {
+        DecoderInput tmp = *io;
+        if (io->segments) {
+            tmp.segment_index = 0;
+            tmp.data = io->segments[0].data;
+            tmp.data_end = tmp.data + io->segments[0].size;
+        }
+        tmp.offset = 0;
+        size_t total = ebm_segment_remaining(&tmp);
+        if (total < off || total - off < size) {
+            return NULL;
+        }
+        ebm_segment_copy(&tmp, NULL, off);
+        const EBM_U8_TYPE* p = ebm_segment_contiguous(&tmp, size);
+        io->scratch = tmp.scratch;
+        return p;
+    }
+
+    // encoder output: ebm_encoder_input_set_iov(output, iov, capacity >= 1) then encode, then
+    // ebm_encoder_input_finish(output) returns number of iov entries to pass to writev.
+    // entries refer data of output and byte vectors of the encoded object
+    static inline void ebm_encoder_input_set_iov(EncoderInput* io, EbmSegment* iov, size_t capacity) {
+        io->iov = iov;
+        io->iov_count = 0;
+        io->iov_capacity = capacity;
+        io->iov_flushed = io->offset;
+    }
+
+    static inline void ebm_iov_flush(EncoderInput* io) {
+        if (io->offset > io->iov_flushed) {
+            io->iov[io->iov_count].data = io->data + io->iov_flushed;
+            io->iov[io->iov_count].size = io->offset - io->iov_flushed;
+            io->iov_count++;
+            io->iov_flushed = io->offset;
+        }
+    }
+
+    static inline void ebm_iov_append(EncoderInput* io, const EBM_U8_TYPE* data, size_t size) {
+        ebm_iov_flush(io);
+        io->iov[io->iov_count].data = data;
+        io->iov[io->iov_count].size = size;
+        io->iov_count++;
+    }
+
+    static inline size_t ebm_encoder_input_finish(EncoderInput* io) {
+        if (!io->iov) {
+            return 0;
+        }
+        ebm_iov_flush(io);
+        return io->iov_count;
+    }
+)a");
+    }
+
+    // integer arrays lowered as BULK_INT_ARRAY: whole region is bounds-checked and copied once,
+    // then byte order is fixed in place if it differs from host order
+    void write_int_array_helpers(CodeWriter & w) {
+        w.write_unformatted(R"a(
+    #ifndef EBM_HOST_LITTLE_ENDIAN
+    #define EBM_HOST_LITTLE_ENDIAN (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+    #endif
+
+    // reverses byte order of each width-byte element of p in place. width is constant at
+    // every call site, so once inlined the inner loop is unrolled and the outer one vectorized
+    static inline void ebm_swap_int_array(EBM_U8_TYPE* p, size_t n, size_t width) {
+        for (size_t i = 0; i < n; i++, p += width) {
+            for (size_t j = 0; j < width / 2; j++) {
+                EBM_U8_TYPE t = p[j];
+                p[j] = p[width - 1 - j];
+                p[width - 1 - j] = t;
+            }
+        }
+    }
+
+    #define EBM_CAN_READ_INT_ARRAY(io, n, width) ((size_t)(n) <= ((size_t)-1) / (width) && DECODER_CAN_READ((io), (size_t)(n) * (width)))
+
+    #define EBM_READ_INT_ARRAY(io, target, n, width, swap, field_str) do { \
+        if (!EBM_CAN_READ_INT_ARRAY(io, n, width)) { \
+            EBM_EMIT_ERROR(field_str ": Not enough data to read int array"); \
+            return -1; \
+        } \
+        EBM_READ_ARRAY_BYTES(io, target, (n) * (width), 0, field_str); \
+        if (swap) { \
+            ebm_swap_int_array((EBM_U8_TYPE*)(void*)(target), (n), (width)); \
+        } \
+    } while(0)
+
+    #define EBM_WRITE_INT_ARRAY(io, source, n, width, swap, field_str) do { \
+        if ((size_t)(n) > ((size_t)-1) / (width)) { \
+            EBM_EMIT_ERROR(field_str ": Too many elements to write int array"); \
+            return -1; \
+        } \
+        EBM_U8_TYPE* ebm_int_array_dst_ = (EBM_U8_TYPE*)((io)->data + (io)->offset); \
+        EBM_WRITE_ARRAY_BYTES(io, source, (n) * (width), 0, field_str); \
+        if (swap) { \
+            ebm_swap_int_array(ebm_int_array_dst_, (n), (width)); \
+        } \
+    } while(0)
+)a");
+    }
+
     void write_allocate_macros(CodeWriter & w) {
         w.write_unformatted(R"a(
     #ifndef EBM_ALLOCATE
@@ -152,7 +395,7 @@ DEFINE_VISITOR_CLASS(Statement_PROGRAM_DECL) {
 )a");
     }
 
-    void write_encoder_macros(CodeWriter & w) {
+    void write_encoder_macros(CodeWriter & w, bool segmented) {
         w.write_unformatted(R"a(
     #define EBM_RESERVE_DATA(io,target, size_value, field_str) do { \
         if ((size_t)((io)->data + (io)->offset + (size_value)) > (size_t)(io)->data_end) { \
@@ -174,6 +417,14 @@ DEFINE_VISITOR_CLASS(Statement_PROGRAM_DECL) {
     #ifndef MEMCPY
     #define MEMCPY(dest, src, size) __builtin_memcpy((dest), (src), (size))
     #endif
+)a");
+        if (segmented) {
+            // byte vectors large enough are appended to iov as they are instead of copied into data.
+            // 3 free entries are needed: pending data, the vector and data written after it
+            w.write_unformatted(R"a(
+    #ifndef EBM_IOV_MIN_BYTES
+    #define EBM_IOV_MIN_BYTES 64
+    #endif
 
     #define EBM_WRITE_BYTES(io, source, size_value, offset_value,field_str) do { \
         if((io)->emit) { \
@@ -182,6 +433,13 @@ DEFINE_VISITOR_CLASS(Statement_PROGRAM_DECL) {
                 return res; \
             } \
         } \
+        else if ((io)->iov && (size_t)(size_value) >= EBM_IOV_MIN_BYTES && (io)->iov_count + 3 <= (io)->iov_capacity) { \
+            if((source).size != (size_value)) { \
+                EBM_EMIT_ERROR(field_str ": Source size does not match size value in write bytes"); \
+                return -1; \
+            } \
+            ebm_iov_append((io), (source).data, (size_value)); \
+        } \
         else if ((size_t)((io)->data + (io)->offset + (size_value)) <= (size_t)(io)->data_end) { \
             if((source).size != (size_value)) { \
                 EBM_EMIT_ERROR(field_str ": Source size does not match size value in write bytes"); \
@@ -194,7 +452,32 @@ DEFINE_VISITOR_CLASS(Statement_PROGRAM_DECL) {
             return -1; \
         } \
     } while(0)
-
+)a");
+        }
+        else {
+            w.write_unformatted(R"a(
+    #define EBM_WRITE_BYTES(io, source, size_value, offset_value,field_str) do { \
+        if((io)->emit) { \
+            int res = (io)->emit((io), &(source), (size_value)); \
+            if (res != 0) { \
+                return res; \
+            } \
+        } \
+        else if ((size_t)((io)->data + (io)->offset + (size_value)) <= (size_t)(io)->data_end) { \
+            if((source).size != (size_value)) { \
+                EBM_EMIT_ERROR(field_str ": Source size does not match size value in write bytes"); \
+                return -1; \
+            } \
+            MEMCPY((io)->data + (io)->offset, (source).data, (size_value)); \
+            (io)->offset += (size_value); \
+        } else { \
+            EBM_EMIT_ERROR(field_str ": Not enough space to write bytes"); \
+            return -1; \
+        } \
+    } while(0)
+)a");
+        }
+        w.write_unformatted(R"a(
     #define EBM_WRITE_ARRAY_BYTES(io, source, size_value, offset_value,field_str) do { \
         if ((size_t)((io)->data + (io)->offset + (size_value)) <= (size_t)(io)->data_end) { \
             MEMCPY((io)->data + (io)->offset, (source), (size_value)); \
@@ -448,18 +731,37 @@ DEFINE_VISITOR_CLASS(Statement_PROGRAM_DECL) {
         #endif
         )"[1]);
 
-            write_encoder_macros(w);
-            write_decoder_macros(w);
+            write_encoder_macros(w, ctx.flags().segmented_io);
+            write_decoder_macros(w, ctx.flags().segmented_io);
             if (c_ctx.has_recursive_struct) {
                 write_allocate_macros(w);
             }
 
+            if (ctx.flags().segmented_io) {
+                w.writeln("// one buffer of a segment chain (decoder input) or of iovec style output (encoder)");
+                w.writeln("typedef struct EbmSegment {");
+                {
+                    auto scope = w.indent_scope();
+                    w.writeln("const EBM_U8_TYPE* data;");
+                    w.writeln("size_t size;");
+                }
+                w.writeln("} EbmSegment;");
+                w.writeln("");
+            }
+
             w.writeln("typedef struct EncoderInput {");
             {
                 auto scope = w.indent_scope();
                 w.writeln("EBM_U8_TYPE* data;");
                 w.writeln("EBM_U8_TYPE* data_end;");
                 w.writeln("size_t offset;");
+                if (ctx.flags().segmented_io) {
+                    w.writeln("// output is iov[0..iov_count] after ebm_encoder_input_finish; NULL to write only into data");
+                    w.writeln("EbmSegment* iov;");
+                    w.writeln("size_t iov_count;");
+                    w.writeln("size_t iov_capacity;");
+                    w.writeln("size_t iov_flushed;");
+                }
                 if (c_ctx.vector_types.size() > 0) {
                     w.writeln("int (*emit)(struct EncoderInput* self, const VECTOR_OF(", u8_type, ")* data, size_t size);");
                 }
@@ -476,6 +778,16 @@ DEFINE_VISITOR_CLASS(Statement_PROGRAM_DECL) {
             const EBM_U8_TYPE* data_end;
             size_t offset;
         )a"[1]);
+                if (ctx.flags().segmented_io) {
+                    // data..data_end is segments[segment_index] while decoding a chain
+                    w.write_unformatted(&R"a(
+            const EbmSegment* segments;
+            size_t segment_count;
+            size_t segment_index;
+            EBM_U8_TYPE* scratch;
+            EBM_U8_TYPE* scratch_end;
+        )a"[1]);
+                }
                 if (c_ctx.vector_types.size() > 0) {
                     w.writeln("APPEND_HANDLER;");
                     w.writeln("RESERVE_HANDLER;");
@@ -499,6 +811,12 @@ DEFINE_VISITOR_CLASS(Statement_PROGRAM_DECL) {
             w.writeln("} FreeFunctionInput;");
 
             w.writeln("");
+            if (ctx.flags().segmented_io) {
+                write_segmented_io_helpers(w);
+            }
+            if (has_lowered_io(ctx, ebm::LoweringIOType::BULK_INT_ARRAY)) {
+                write_int_array_helpers(w);
+            }
 
             auto collect_composite_fn = [&](ebm::StatementRef composite) -> expected<void> {
                 auto comp = ctx.get_field<"composite_field_decl">(composite);
@@ -57,7 +57,45 @@ DEFINE_VISITOR(Statement_SUB_BYTE_RANGE) {
     // the companion to start + length after the child ran.
     bool track_offset = false;
 
-    if (ctx.sub_byte_range.range_type == ebm::SubByteRangeType::bytes) {
+    const bool segmented_input = ctx.flags().segmented_io && ctx.sub_byte_range.stream_type == ebm::StreamType::INPUT;
+    if (ctx.flags().segmented_io && ctx.sub_byte_range.stream_type == ebm::StreamType::OUTPUT) {
+        // sub range is reserved in parent data; byte vectors must be copied into it
+        w.writeln(io_name_base, ".iov = NULL;");
+    }
+
+    if (segmented_input && (ctx.sub_byte_range.range_type == ebm::SubByteRangeType::bytes ||
+                            ctx.sub_byte_range.range_type == ebm::SubByteRangeType::seek_bytes)) {
+        // window is made contiguous (copied into scratch only if it straddles segments),
+        // so sub input never sees segment boundary
+        MAYBE(len, ctx.visit(*ctx.sub_byte_range.length()));
+        if (ctx.sub_byte_range.range_type == ebm::SubByteRangeType::bytes) {
+            w.writeln("if (EBM_GET_REMAINING_BYTES(", parent_io_name, ") < (size_t)(", len.to_writer(), ")) {");
+            w.indent_writeln("EBM_EMIT_ERROR(\"Sub-byte range exceeds parent IO data end\");");
+            w.indent_writeln("return -1;");
+            w.writeln("}");
+            w.writeln(io_name_base, ".data = ebm_segment_contiguous(", parent_io_name, ", ", len.to_writer(), ");");
+        }
+        else {
+            MAYBE(off, ctx.visit(*ctx.sub_byte_range.offset()));
+            w.writeln(io_name_base, ".data = ebm_segment_window(", parent_io_name, ", ", off.to_writer(), ", ", len.to_writer(), ");");
+        }
+        w.writeln("if (!", io_name_base, ".data) {");
+        w.indent_writeln("EBM_EMIT_ERROR(\"Sub-byte range exceeds parent IO data end or scratch space\");");
+        w.indent_writeln("return -1;");
+        w.writeln("}");
+        w.writeln(io_name_base, ".data_end = ", io_name_base, ".data + ", len.to_writer(), ";");
+        w.writeln(io_name_base, ".offset = 0;");
+        w.writeln(io_name_base, ".segments = NULL;");
+        w.writeln(io_name_base, ".segment_count = 0;");
+        w.writeln(io_name_base, ".segment_index = 0;");
+        w.writeln(io_name_base, ".scratch = ", parent_io_name, "->scratch;");
+        track_offset = ctx.sub_byte_range.range_type == ebm::SubByteRangeType::bytes &&
+                       has_absolute_offset(ctx, ctx.sub_byte_range.io_ref);
+        if (track_offset) {
+            w.writeln("size_t ", io_name, "_rs_start = runtime_state->offset;");
+        }
+    }
+    else if (ctx.sub_byte_range.range_type == ebm::SubByteRangeType::bytes) {
         MAYBE(len, ctx.visit(*ctx.sub_byte_range.length()));
         w.writeln(io_name_base, ".data = ", parent_io_name, "->data + ", parent_io_name, "->offset;");
         w.writeln(io_name_base, ".data_end = ", io_name_base, ".data + ", len.to_writer(), ";");
@@ -17,6 +17,87 @@
 
 #include "../codegen.hpp"
 #include "ebm/extended_binary_module.hpp"
+#include "ebmcodegen/stub/util.hpp"
+
+namespace CODEGEN_NAMESPACE {
+    // swap flag of EBM_READ_INT_ARRAY/EBM_WRITE_INT_ARRAY
+    inline std::string_view int_array_swap(ebm::Endian e) {
+        switch (e) {
+            case ebm::Endian::little:
+                return "!EBM_HOST_LITTLE_ENDIAN";
+            case ebm::Endian::native:
+                return "0";
+            default:
+                return "EBM_HOST_LITTLE_ENDIAN";
+        }
+    }
+
+    // BULK_INT_ARRAY decode. vectors are filled in place only if reserve handler made room,
+    // otherwise element-wise lowered statement appends them. reserve is requested only after
+    // whole region is known to be readable, so a forged count cannot cause huge allocation
+    expected<Result> read_bulk_int_array(auto&& ctx, const BulkIntArray& bulk) {
+        MAYBE(count, get_element_count_default(ctx, ctx.read_data.data_type, ctx.read_data.size));
+        MAYBE(target, ctx.visit(ctx.read_data.target));
+        MAYBE(layer_str, get_identifier_layer_str(ctx, from_weak(ctx.read_data.field)));
+        layer_str = "\"" + layer_str + "\"";
+        auto io_ = ctx.identifier(ctx.read_data.io_ref);
+        auto width = std::to_string(bulk.element_bytes);
+        auto swap = int_array_swap(bulk.endian);
+        CodeWriter w;
+        w.writeln("{");
+        {
+            auto scope = w.indent_scope();
+            w.writeln("size_t ebm_n_ = (size_t)(", count, ");");
+            if (bulk.container == BytesType::vector) {
+                auto lw = ctx.read_data.lowered_statement();
+                MAYBE(lowered, ctx.visit(lw->io_statement.id));
+                w.writeln("if (EBM_CAN_READ_INT_ARRAY(", io_, ", ebm_n_, ", width, ")) {");
+                w.indent_writeln("EBM_RESERVE_VECTOR(", target.to_writer(), ", ebm_n_);");
+                w.writeln("}");
+                w.writeln("if (", target.to_writer(), ".capacity - ", target.to_writer(), ".size >= ebm_n_) {");
+                {
+                    auto scope2 = w.indent_scope();
+                    w.writeln("EBM_READ_INT_ARRAY(", io_, ", ", target.to_writer(), ".data + ", target.to_writer(), ".size, ebm_n_, ", width, ", ", swap, ", ", layer_str, ");");
+                    w.writeln(target.to_writer(), ".size += ebm_n_;");
+                    ebmcodegen::util::append_runtime_offset(ctx, ctx.read_data.io_ref, w, "ebm_n_ * " + width);
+                }
+                w.writeln("}");
+                w.writeln("else {");
+                {
+                    auto scope2 = w.indent_scope();
+                    w.write(std::move(lowered.to_writer()));
+                }
+                w.writeln("}");
+            }
+            else {
+                w.writeln("EBM_READ_INT_ARRAY(", io_, ", ", target.to_writer(), ", ebm_n_, ", width, ", ", swap, ", ", layer_str, ");");
+                ebmcodegen::util::append_runtime_offset(ctx, ctx.read_data.io_ref, w, "ebm_n_ * " + width);
+            }
+        }
+        w.writeln("}");
+        return w;
+    }
+
+    expected<Result> write_bulk_int_array(auto&& ctx, const BulkIntArray& bulk) {
+        MAYBE(count, get_element_count_default(ctx, ctx.write_data.data_type, ctx.write_data.size));
+        MAYBE(target, ctx.visit(ctx.write_data.target));
+        MAYBE(layer_str, get_identifier_layer_str(ctx, from_weak(ctx.write_data.field)));
+        layer_str = "\"" + layer_str + "\"";
+        auto io_ = ctx.identifier(ctx.write_data.io_ref);
+        auto width = std::to_string(bulk.element_bytes);
+        CodeWriter w;
+        w.writeln("{");
+        {
+            auto scope = w.indent_scope();
+            w.writeln("size_t ebm_n_ = (size_t)(", count, ");");
+            w.writeln("EBM_WRITE_INT_ARRAY(", io_, ", ", target.to_writer(), bulk.container == BytesType::vector ? ".data" : "", ", ebm_n_, ", width, ", ", int_array_swap(bulk.endian), ", ", layer_str, ");");
+            ebmcodegen::util::append_runtime_offset(ctx, ctx.write_data.io_ref, w, "ebm_n_ * " + width);
+        }
+        w.writeln("}");
+        return w;
+    }
+}  // namespace CODEGEN_NAMESPACE
+
 DEFINE_VISITOR(entry_before) {
     using namespace CODEGEN_NAMESPACE;
     ctx.config().int_prefix = "int";
@@ -134,6 +215,9 @@ DEFINE_VISITOR(entry_before) {
         auto lw = ctx.read_data.lowered_statement();
         if (!lw) return pass;
         if (lw->lowering_type == ebm::LoweringIOType::VECTORIZED_IO) return pass;
+        if (auto bulk = get_bulk_int_array(ctx, ctx.read_data); bulk && !ctx.read_data.attribute.is_peek()) {
+            return read_bulk_int_array(ctx, *bulk);
+        }
         // bytes型はbytes_io_wrapperに委ねる（read_temporaryも含む）
         if (is_bytes_type(ctx, ctx.read_data.data_type)) return pass;
         if (lw->lowering_type == ebm::LoweringIOType::ARRAY_FOR_EACH &&
@@ -180,7 +264,13 @@ DEFINE_VISITOR(entry_before) {
     };
     ctx.config().write_data_custom = [](Context_Statement_WRITE_DATA& ctx) -> expected<Result> {
         using namespace CODEGEN_NAMESPACE;
-        if (!ctx.config().on_destructor_generation()) return pass;
+        auto bulk = get_bulk_int_array(ctx, ctx.write_data);
+        if (!ctx.config().on_destructor_generation()) {
+            if (bulk) {
+                return write_bulk_int_array(ctx, *bulk);
+            }
+            return pass;
+        }
         auto lw = ctx.write_data.lowered_statement();
         if (!lw) return pass;
         // bytes型はbytes_io_wrapperに委ねる（destructor modeのEBM_FREE_VECTOR/no-opはそちらで処理）
@@ -188,6 +278,14 @@ DEFINE_VISITOR(entry_before) {
         if (lw->lowering_type == ebm::LoweringIOType::VECTORIZED_IO) {
             return ctx.visit(lw->io_statement.id);
         }
+        if (bulk) {
+            // integer elements own nothing; only vector storage is freed
+            if (bulk->container != BytesType::vector) {
+                return CODELINE("// WRITE_DATA skipped in free function generation");
+            }
+            MAYBE(target, ctx.visit(ctx.write_data.target));
+            return CODELINE("EBM_FREE_VECTOR(", target.to_writer(), ", sizeof(", target.to_writer(), ".data[0])", ");");
+        }
         if (lw->lowering_type != ebm::LoweringIOType::STRUCT_CALL &&
             lw->lowering_type != ebm::LoweringIOType::ARRAY_FOR_EACH) {
             return CODELINE("// WRITE_DATA skipped in free function generation");
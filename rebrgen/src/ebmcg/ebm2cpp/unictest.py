@@ -53,18 +53,164 @@ def main():
     if not os.path.isdir(futils_include):
         futils_include = os.path.join(futils_dir, "include")
 
+    # brgen source tree for the shared allocation counter (src/test/testutil/alloc_hook.h)
+    brgen_dir = ""
+    if os.path.exists(build_config_path):
+        brgen_dir = build_config.get("BRGEN_DIR", "")
+    if not brgen_dir:
+        brgen_dir = os.environ.get("BRGEN_DIR", os.path.join(original_work_dir, ".."))
+    if not os.path.isabs(brgen_dir) and original_work_dir:
+        brgen_dir = os.path.join(original_work_dir, brgen_dir)
+    brgen_include = os.path.abspath(os.path.join(brgen_dir, "src"))
+
     # Create CMakeLists.txt
     futils_include_escaped = futils_include.replace("\\", "/")
+    brgen_include_escaped = brgen_include.replace("\\", "/")
     with open(proj_dir / "CMakeLists.txt", "w") as f:
         f.write("cmake_minimum_required(VERSION 3.20)\n")
         f.write("project(test_runner CXX)\n\n")
         f.write("set(CMAKE_CXX_STANDARD 20)\n")
         f.write("set(CMAKE_CXX_STANDARD_REQUIRED ON)\n\n")
         f.write("add_executable(test_runner main.cpp)\n")
-        f.write(f'target_include_directories(test_runner PRIVATE "${{CMAKE_CURRENT_SOURCE_DIR}}" "{futils_include_escaped}")\n')
+        f.write(f'target_include_directories(test_runner PRIVATE "${{CMAKE_CURRENT_SOURCE_DIR}}" "{futils_include_escaped}" "{brgen_include_escaped}")\n')
         if os.name != "nt":
             f.write('target_compile_options(test_runner PRIVATE -Wall -Wextra -Wno-unused-variable -Wno-unused-function)\n')
 
+    # decode step of the harness; resumable option sets feed input in chunks
+    # through ResumableDecoder and measure per-chunk overhead.
+    # resumable-arena also makes the decoded message live in an arena
+    resumable = OPTION_SET_NAME in ("resumable", "resumable-arena")
+    if resumable:
+        if OPTION_SET_NAME == "resumable-arena":
+            decoder_type = f"::ebm2cpp_rt::ArenaResumableDecoder<{TEST_TARGET_FORMAT}>"
+            decoder_args = "::ebm2cpp_rt::ArenaStepScope{&arena}"
+            arena_decl = """
+#include <memory_resource>
+
+alignas(std::max_align_t) static std::uint8_t arena_buffer[1 << 16];
+static std::pmr::monotonic_buffer_resource arena{arena_buffer, sizeof(arena_buffer)};
+"""
+        else:
+            decoder_type = f"::ebm2cpp_rt::ResumableDecoder<{TEST_TARGET_FORMAT}>"
+            decoder_args = ""
+            arena_decl = ""
+        decode_helper = arena_decl + f"""
+#include <algorithm>
+#include <chrono>
+#include <memory>
+
+template <class F>
+static double measure_ns(size_t iterations, F&& f) {{
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++) {{
+        if (!f()) {{
+            return -1;
+        }}
+    }}
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / iterations;
+}}
+
+// feeds whole input in chunk sized pieces, then end of stream if decoder still needs more
+static ::ebm2cpp_rt::DecodeState feed_chunks(std::unique_ptr<{decoder_type}>& dec, const std::vector<std::uint8_t>& input, size_t chunk, size_t& chunks) {{
+    auto st = ::ebm2cpp_rt::DecodeState::need_more;
+    for (size_t off = 0; off < input.size() && st == ::ebm2cpp_rt::DecodeState::need_more; off += chunk) {{
+        auto len = std::min(chunk, input.size() - off);
+        st = dec->feed(::futils::view::rvec(input.data() + off, len));
+        chunks++;
+    }}
+    if (st == ::ebm2cpp_rt::DecodeState::need_more) {{
+        st = dec->finish();
+    }}
+    return st;
+}}
+
+static void bench_resumable(const std::vector<std::uint8_t>& input) {{
+    constexpr size_t iterations = 200;
+    auto one_shot = measure_ns(iterations, [&] {{
+        {TEST_TARGET_FORMAT} obj{{}};
+        ::ebm2cpp_rt::StreamReader r{{::futils::view::rvec(input.data(), input.size())}};
+        return !obj.decode(r).run();
+    }});
+    printf("resumable bench: one-shot decode: %.0f ns/msg (%zu bytes)\\n", one_shot, input.size());
+    for (size_t chunk : {{size_t(1), size_t(16), size_t(256), input.size()}}) {{
+        if (chunk == 0 || (chunk != input.size() && chunk >= input.size())) {{
+            continue;
+        }}
+        auto dec = std::make_unique<{decoder_type}>({decoder_args});
+        size_t chunks = 0;
+        auto ns = measure_ns(iterations, [&] {{
+            if (feed_chunks(dec, input, chunk, chunks) != ::ebm2cpp_rt::DecodeState::done) {{
+                return false;
+            }}
+            // reuse decoder unless it has seen end of stream or trailing bytes
+            if (dec->consumed() == input.size() && dec->next() == ::ebm2cpp_rt::DecodeState::need_more) {{
+                return true;
+            }}
+            dec = std::make_unique<{decoder_type}>({decoder_args});
+            return true;
+        }});
+        if (ns < 0) {{
+            printf("resumable bench: chunk=%zu: decode failed\\n", chunk);
+            continue;
+        }}
+        auto per_msg = double(chunks) / iterations;
+        printf("resumable bench: chunk=%zu: %.0f ns/msg, %.1f chunks/msg, %.0f ns/chunk overhead\\n", chunk, ns, per_msg, (ns - one_shot) / per_msg);
+    }}
+}}
+"""
+        decode_step = f"""
+    // feed input byte by byte so that decoder suspends at every read
+    ::brgen::testutil::AllocScope decode_allocs;
+    {{
+        {decoder_type} dec{{{decoder_args}}};
+        auto st = ::ebm2cpp_rt::DecodeState::need_more;
+        for (long i = 0; i < input_len && st == ::ebm2cpp_rt::DecodeState::need_more; i++) {{
+            st = dec.feed(::futils::view::rvec(input_buffer.data() + i, 1));
+        }}
+        if (st == ::ebm2cpp_rt::DecodeState::need_more) {{
+            st = dec.finish();
+        }}
+        if (st != ::ebm2cpp_rt::DecodeState::done) {{
+            fprintf(stderr, "Decode failed: %s\\n", st == ::ebm2cpp_rt::DecodeState::failed ? dec.error().error<std::string>().c_str() : "need more input");
+            return 10;
+        }}
+        target_obj = std::move(dec.value());
+    }}
+    printf("decode allocations (%s): %zu\\n", "{OPTION_SET_NAME}", decode_allocs.get().count);
+    bench_resumable(input_buffer);
+"""
+    elif OPTION_SET_NAME == "arena":
+        # arena outlives target_obj (static storage); decode must not touch heap
+        # until initial buffer is exhausted
+        decode_helper = """
+#include <memory_resource>
+
+alignas(std::max_align_t) static std::uint8_t arena_buffer[1 << 16];
+static std::pmr::monotonic_buffer_resource arena{arena_buffer, sizeof(arena_buffer)};
+"""
+        decode_step = f"""
+    ::futils::binary::reader r{{::futils::view::rvec(input_buffer.data(), input_len)}};
+    ::brgen::testutil::AllocScope decode_allocs;
+    auto decode_err = ::ebm2cpp_rt::decode_in(arena, target_obj, r);
+    if (decode_err) {{
+        fprintf(stderr, "Decode failed: %s\\n", decode_err.error<std::string>().c_str());
+        return 10;
+    }}
+    printf("decode allocations (%s): %zu\\n", "{OPTION_SET_NAME}", decode_allocs.get().count);
+"""
+    else:
+        decode_helper = ""
+        decode_step = f"""
+    ::futils::binary::reader r{{::futils::view::rvec(input_buffer.data(), input_len)}};
+    ::brgen::testutil::AllocScope decode_allocs;
+    auto decode_err = target_obj.decode(r);
+    if (decode_err) {{
+        fprintf(stderr, "Decode failed: %s\\n", decode_err.error<std::string>().c_str());
+        return 10;
+    }}
+    printf("decode allocations (%s): %zu\\n", "{OPTION_SET_NAME}", decode_allocs.get().count);
+"""
+
     # Create main.cpp test harness
     with open(proj_dir / "main.cpp", "w") as f:
         f.write(f"""
@@ -75,6 +221,11 @@ def main():
 
 #include "{generated_h_name}"
 
+// count heap allocations to compare decode cost between option sets
+// (e.g. zero-copy borrows byte fields from input_buffer)
+#define BRGEN_ALLOC_HOOK_DEFINE
+#include <test/testutil/alloc_hook.h>
+{decode_helper}
 int main(int argc, char* argv[]) {{
     if (argc < 3) {{
         fprintf(stderr, "Usage: %s <input_file> <output_file>\\n", argv[0]);
@@ -105,13 +256,7 @@ int main(int argc, char* argv[]) {{
 
     // Decode
     {TEST_TARGET_FORMAT} target_obj{{}};
-    ::futils::binary::reader r{{::futils::view::rvec(input_buffer.data(), input_len)}};
-    auto decode_err = target_obj.decode(r);
-    if (decode_err) {{
-        fprintf(stderr, "Decode failed: %s\\n", decode_err.error<std::string>().c_str());
-        return 10;
-    }}
-
+{decode_step}
     // Encode
     std::vector<std::uint8_t> output_buffer;
     output_buffer.resize(input_len * 2 > 1024 ? input_len * 2 : 1024);
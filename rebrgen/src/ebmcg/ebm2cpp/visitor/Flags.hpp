@@ -27,3 +27,6 @@
 
 FILE_EXTENSIONS(".cpp");
 WEB_UI_NAME("cpp4");
+DEFINE_BOOL_FLAG(zero_copy, false, "zero-copy", "generate zero-copy decoder which borrows byte fields from decoder input buffer");
+DEFINE_BOOL_FLAG(resumable, false, "resumable", "generate decoders as C++20 coroutines taking ebm2cpp_rt::StreamReader which suspend on short input and resume when more bytes arrive (see ebm2cpp_rt::ResumableDecoder)");
+DEFINE_BOOL_FLAG(arena, false, "arena", "allocate vectors and recursive structs from std::pmr::memory_resource passed to ebm2cpp_rt::decode_in instead of heap (see ebm2cpp_rt::Allocator)");
@@ -15,3 +15,5 @@ enum class OutputPhase {
     FunctionBodyOnly, // Emit out-of-class method definitions only
 };
 OutputPhase output_phase = OutputPhase::Normal;
+// true while body of a decoder is visited in --resumable mode (body is a C++20 coroutine)
+bool in_decoder_coroutine = false;
@@ -22,7 +22,728 @@
 #include "ebmcodegen/stub/util.hpp"
 
 namespace CODEGEN_NAMESPACE {
+    // byte vector type of --zero-copy mode.
+    // guarded so that multiple generated headers can be included in one translation unit
+    inline void write_borrowed_bytes(CodeWriter& w) {
+        w.write_unformatted(R"(#ifndef EBM2CPP_RT_BORROWED_BYTES
+#define EBM2CPP_RT_BORROWED_BYTES
+#include <algorithm>
+namespace ebm2cpp_rt {
+    // refers decoder input buffer until modified (copy on write)
+    // decoder input buffer must outlive decoded object
+    struct BorrowedBytes {
+       private:
+        ::futils::view::rvec borrowed;
+        std::vector<std::uint8_t> owned;
+        bool is_owned = false;
+
+       public:
+        BorrowedBytes() = default;
+        BorrowedBytes(::futils::view::rvec v)
+            : borrowed(v) {}
+        BorrowedBytes(std::vector<std::uint8_t> v)
+            : owned(std::move(v)), is_owned(true) {}
+
+        const std::uint8_t* data() const {
+            return is_owned ? owned.data() : borrowed.data();
+        }
+        size_t size() const {
+            return is_owned ? owned.size() : borrowed.size();
+        }
+        bool empty() const {
+            return size() == 0;
+        }
+        const std::uint8_t* begin() const {
+            return data();
+        }
+        const std::uint8_t* end() const {
+            return data() + size();
+        }
+        ::futils::view::rvec view() const {
+            return ::futils::view::rvec(data(), size());
+        }
+        bool is_borrowed() const {
+            return !is_owned;
+        }
+
+        std::vector<std::uint8_t>& to_mut() {
+            if (!is_owned) {
+                owned.assign(borrowed.data(), borrowed.data() + borrowed.size());
+                borrowed = {};
+                is_owned = true;
+            }
+            return owned;
+        }
+        std::uint8_t operator[](size_t i) const {
+            return data()[i];
+        }
+        std::uint8_t& operator[](size_t i) {
+            return to_mut()[i];
+        }
+        void push_back(std::uint8_t b) {
+            to_mut().push_back(b);
+        }
+        void resize(size_t n) {
+            to_mut().resize(n);
+        }
+
+        friend bool operator==(const BorrowedBytes& a, const BorrowedBytes& b) {
+            return std::equal(a.begin(), a.end(), b.begin(), b.end());
+        }
+    };
+}  // namespace ebm2cpp_rt
+#endif
+)");
+        w.writeln("");
+    }
+
+    // reader type and driver of --resumable mode.
+    // generated decoders are C++20 coroutines returning ebm2cpp_rt::Decoding and co_await
+    // StreamReader::fill before each read. on short input the innermost decoder suspends and
+    // control returns to ResumableDecoder::feed on caller's thread; already decoded prefix stays
+    // in the coroutine frames instead of being re-parsed
+    inline void write_stream_reader(CodeWriter& w) {
+        w.write_unformatted(R"(#ifndef EBM2CPP_RT_STREAM_READER
+#define EBM2CPP_RT_STREAM_READER
+#include <binary/reader.h>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <utility>
+#include <vector>
+namespace ebm2cpp_rt {
+    struct StreamReader;
+
+    struct StreamSource {
+        // called when decoder needs at least n bytes remaining in r (n == SIZE_MAX: end of stream).
+        // returns false if decoder can continue now; otherwise keeps h and resumes it
+        // after resetting buffer of r when enough bytes arrived
+        virtual bool wait(StreamReader& r, size_t n, std::coroutine_handle<> h) = 0;
+
+       protected:
+        ~StreamSource() = default;
+    };
+
+    struct StreamReader : ::futils::binary::reader {
+        // nullptr if whole input is already in buffer (e.g. sub range)
+        StreamSource* source = nullptr;
+
+        StreamReader(::futils::view::rvec buf = {}, StreamSource* source = nullptr)
+            : ::futils::binary::reader(buf), source(source) {}
+
+        struct FillAwaiter {
+            StreamReader& r;
+            size_t n;
+
+            bool await_ready() {
+                return !r.source || (n != SIZE_MAX && r.remain().size() >= n);
+            }
+            bool await_suspend(std::coroutine_handle<> h) {
+                return r.source->wait(r, n, h);
+            }
+            // false only if stream ended before n bytes became available
+            bool await_resume() {
+                return n == SIZE_MAX || r.remain().size() >= n;
+            }
+        };
+
+        struct RemainAllAwaiter : FillAwaiter {
+            size_t await_resume() {
+                return r.remain().size();
+            }
+        };
+
+        // co_await: waits until at least n bytes remain or stream ends
+        FillAwaiter fill(size_t n) {
+            return FillAwaiter{*this, n};
+        }
+
+        // co_await: remaining bytes until end of stream
+        RemainAllAwaiter remain_all() {
+            return RemainAllAwaiter{{*this, SIZE_MAX}};
+        }
+    };
+
+    // return type of generated decode functions in --resumable mode.
+    // starts lazily; co_await runs it as a nested decoder and yields its result.
+    // exception thrown by decoder is rethrown to awaiting decoder (or caller of run()/feed())
+    struct [[nodiscard]] Decoding {
+        struct promise_type {
+            ::futils::error::Error<> result;
+            std::exception_ptr exception;
+            std::coroutine_handle<> continuation = std::noop_coroutine();
+
+            Decoding get_return_object() {
+                return Decoding{std::coroutine_handle<promise_type>::from_promise(*this)};
+            }
+            std::suspend_always initial_suspend() noexcept {
+                return {};
+            }
+            struct FinalAwaiter {
+                bool await_ready() noexcept {
+                    return false;
+                }
+                // symmetric transfer keeps stack depth constant however deep decoders nest
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+                    return h.promise().continuation;
+                }
+                void await_resume() noexcept {}
+            };
+            FinalAwaiter final_suspend() noexcept {
+                return {};
+            }
+            void return_value(::futils::error::Error<> err) {
+                result = std::move(err);
+            }
+            void unhandled_exception() {
+                exception = std::current_exception();
+            }
+        };
+
+       private:
+        std::coroutine_handle<promise_type> h;
+
+        explicit Decoding(std::coroutine_handle<promise_type> h)
+            : h(h) {}
+
+       public:
+        Decoding(Decoding&& other) noexcept
+            : h(std::exchange(other.h, nullptr)) {}
+        Decoding& operator=(Decoding&& other) noexcept {
+            if (this != &other) {
+                if (h) {
+                    h.destroy();
+                }
+                h = std::exchange(other.h, nullptr);
+            }
+            return *this;
+        }
+        ~Decoding() {
+            if (h) {
+                h.destroy();
+            }
+        }
+
+        bool await_ready() const noexcept {
+            return false;
+        }
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> parent) noexcept {
+            h.promise().continuation = parent;
+            return h;
+        }
+        ::futils::error::Error<> await_resume() {
+            return take();
+        }
+
+        std::coroutine_handle<> handle() const {
+            return h;
+        }
+        bool done() const {
+            return h.done();
+        }
+
+        // result of finished decoder; rethrows exception thrown in it
+        ::futils::error::Error<> take() {
+            if (auto e = std::exchange(h.promise().exception, nullptr)) {
+                std::rethrow_exception(e);
+            }
+            return std::move(h.promise().result);
+        }
+
+        // runs decoder to completion on reader without source (whole input in buffer)
+        ::futils::error::Error<> run() {
+            h.resume();
+            if (!h.done()) {
+                return ::futils::error::Error<>("decoder waits for input of stream", ::futils::error::Category::lib);
+            }
+            return take();
+        }
+    };
+
+    enum class DecodeState {
+        need_more,
+        done,
+        failed,
+    };
+
+    // runs each step of ResumableDecoder as is
+    struct NoStepScope {
+        template <class F>
+        decltype(auto) run(F&& f) {
+            return f();
+        }
+    };
+
+    // decodes T from chunked input on caller's thread.
+    // feed() returns done when a whole message is decoded, then value() holds it and
+    // next() starts next message from remaining bytes.
+    // formats which read until end of input (e.g. trailing bytes) need finish() to complete.
+    // every step (construction of value, feed/finish/next) runs inside Scope::run
+    template <class T, class Scope = NoStepScope>
+    struct ResumableDecoder final : StreamSource {
+        using DecodeFn = std::function<Decoding(T&, StreamReader&)>;
+
+       private:
+        Scope scope;
+        DecodeFn decode_fn;
+        bool eof = false;
+        // current message and bytes after it
+        std::vector<std::uint8_t> buffer;
+        // buffer size the decoder waits for (SIZE_MAX: end of stream)
+        size_t want = 1;
+        DecodeState state_ = DecodeState::need_more;
+        size_t consumed_ = 0;
+        ::futils::error::Error<> error_;
+        std::optional<T> value_;
+        // decoder frames refer value_ and reader, so ResumableDecoder is not movable
+        std::optional<StreamReader> reader;
+        std::optional<Decoding> task;
+        // innermost suspended decoder and the reader it waits on
+        std::coroutine_handle<> waiting;
+        StreamReader* waiting_reader = nullptr;
+        size_t waiting_pos = 0;
+
+        static Decoding default_decode(T& t, StreamReader& r) {
+            return t.decode(r);
+        }
+
+        ::futils::view::rvec view() const {
+            return ::futils::view::rvec(buffer.data(), buffer.size());
+        }
+
+        bool wait(StreamReader& r, size_t n, std::coroutine_handle<> h) override {
+            auto pos = r.offset();
+            want = n > SIZE_MAX - pos ? SIZE_MAX : pos + n;
+            if (eof || buffer.size() >= want) {
+                return false;
+            }
+            waiting = h;
+            waiting_reader = &r;
+            waiting_pos = pos;
+            return true;
+        }
+
+        // runs decoder until it waits for input or completes
+        DecodeState resume() {
+            if (state_ != DecodeState::need_more) {
+                return state_;
+            }
+            // not enough bytes yet; don't resume decoder for nothing
+            if (!eof && buffer.size() < want) {
+                return state_;
+            }
+            scope.run([&] {
+                if (!task) {
+                    reader.emplace(view(), this);
+                    task.emplace(decode_fn(*value_, *reader));
+                    task->handle().resume();
+                    return;
+                }
+                // buffer may be reallocated by feed()
+                waiting_reader->reset_buffer(view());
+                waiting_reader->offset(waiting_pos);
+                std::exchange(waiting, nullptr).resume();
+            });
+            if (!task->done()) {
+                return state_;
+            }
+            auto finished = std::move(*task);
+            task.reset();
+            consumed_ = reader->offset();
+            // stays failed if take() rethrows exception of decoder
+            state_ = DecodeState::failed;
+            error_ = finished.take();
+            state_ = error_ ? DecodeState::failed : DecodeState::done;
+            return state_;
+        }
+
+       public:
+        explicit ResumableDecoder(Scope scope, DecodeFn fn = default_decode)
+            : scope(std::move(scope)), decode_fn(std::move(fn)) {
+            this->scope.run([&] { value_.emplace(); });
+        }
+
+        ResumableDecoder(DecodeFn fn = default_decode)
+            : ResumableDecoder(Scope{}, std::move(fn)) {}
+
+        ResumableDecoder(const ResumableDecoder&) = delete;
+        ResumableDecoder& operator=(const ResumableDecoder&) = delete;
+
+        // appends chunk and resumes decoder if it can make progress.
+        // exception thrown by decoder propagates from here
+        DecodeState feed(::futils::view::rvec chunk) {
+            buffer.insert(buffer.end(), chunk.data(), chunk.data() + chunk.size());
+            return resume();
+        }
+
+        // no more input will come
+        DecodeState finish() {
+            eof = true;
+            return resume();
+        }
+
+        // discards decoded message and starts decoding next one from remaining bytes
+        DecodeState next() {
+            if (state_ == DecodeState::need_more) {
+                return state_;
+            }
+            buffer.erase(buffer.begin(), buffer.begin() + consumed_);
+            consumed_ = 0;
+            scope.run([&] { value_.emplace(); });
+            error_ = {};
+            state_ = DecodeState::need_more;
+            want = 1;
+            return resume();
+        }
+
+        DecodeState state() const {
+            return state_;
+        }
+
+        // bytes required before decoder can make progress.
+        // 0 if it waits for end of stream (call finish())
+        size_t needed() const {
+            if (state_ != DecodeState::need_more || want == SIZE_MAX) {
+                return 0;
+            }
+            return want > buffer.size() ? want - buffer.size() : 0;
+        }
+
+        // size of decoded message. on failure, offset where decoder stopped
+        size_t consumed() const {
+            return consumed_;
+        }
+
+        T& value() {
+            return *value_;
+        }
+
+        const ::futils::error::Error<>& error() const {
+            return error_;
+        }
+    };
+}  // namespace ebm2cpp_rt
+#endif
+)");
+        w.writeln("");
+    }
+
+    // --arena together with --resumable: ResumableDecoder steps run with arena current,
+    // so decoded message is allocated from arena like decode_in
+    inline void write_arena_resumable(CodeWriter& w) {
+        w.write_unformatted(R"(#ifndef EBM2CPP_RT_ARENA_RESUMABLE
+#define EBM2CPP_RT_ARENA_RESUMABLE
+namespace ebm2cpp_rt {
+    struct ArenaStepScope {
+        // nullptr: plain heap
+        std::pmr::memory_resource* arena = nullptr;
+
+        template <class F>
+        decltype(auto) run(F&& f) {
+            if (!arena) {
+                return f();
+            }
+            ArenaScope scope{*arena};
+            return f();
+        }
+    };
+
+    // usage: ArenaResumableDecoder<T> dec{ArenaStepScope{&arena}};
+    // arena must outlive dec and every value() taken from it; coroutine frames still use heap
+    template <class T>
+    using ArenaResumableDecoder = ResumableDecoder<T, ArenaStepScope>;
+}  // namespace ebm2cpp_rt
+#endif
+)");
+        w.writeln("");
+    }
+
+    // vector and recursive struct types of --arena mode.
+    // containers take memory resource current on their thread when constructed, so every
+    // object made while decode_in runs lives in caller's arena and is freed with it
+    inline void write_arena(CodeWriter& w) {
+        w.write_unformatted(R"(#ifndef EBM2CPP_RT_ARENA
+#define EBM2CPP_RT_ARENA
+#include <memory_resource>
+#include <new>
+#include <utility>
+namespace ebm2cpp_rt {
+    // nullptr means plain heap (same as std::allocator)
+    inline std::pmr::memory_resource*& current_resource() {
+        thread_local std::pmr::memory_resource* resource = nullptr;
+        return resource;
+    }
+
+    // makes resource current on this thread until end of scope
+    struct ArenaScope {
+        explicit ArenaScope(std::pmr::memory_resource& resource)
+            : prev(std::exchange(current_resource(), &resource)) {}
+        ~ArenaScope() {
+            current_resource() = prev;
+        }
+        ArenaScope(const ArenaScope&) = delete;
+        ArenaScope& operator=(const ArenaScope&) = delete;
+
+       private:
+        std::pmr::memory_resource* prev;
+    };
+
+    template <class T>
+    struct Allocator {
+        using value_type = T;
+        // moved object keeps its resource; copy is made in resource current at that point
+        using propagate_on_container_move_assignment = std::true_type;
+        using propagate_on_container_swap = std::true_type;
+        using propagate_on_container_copy_assignment = std::false_type;
+        using is_always_equal = std::false_type;
+
+        std::pmr::memory_resource* resource = current_resource();
+
+        Allocator() = default;
+        template <class U>
+        Allocator(const Allocator<U>& other) noexcept
+            : resource(other.resource) {}
+
+        T* allocate(size_t n) {
+            if (!resource) {
+                return std::allocator<T>{}.allocate(n);
+            }
+            return static_cast<T*>(resource->allocate(n * sizeof(T), alignof(T)));
+        }
+        void deallocate(T* p, size_t n) noexcept {
+            if (!resource) {
+                std::allocator<T>{}.deallocate(p, n);
+                return;
+            }
+            resource->deallocate(p, n * sizeof(T), alignof(T));
+        }
+        Allocator select_on_container_copy_construction() const {
+            return Allocator{};
+        }
+
+        friend bool operator==(const Allocator& a, const Allocator& b) noexcept {
+            return a.resource == b.resource;
+        }
+    };
+
+    template <class T>
+    using Vector = std::vector<T, Allocator<T>>;
+
+    // owning pointer of recursive struct. unlike std::shared_ptr it has no reference count;
+    // copy is deep and allocated from resource current at that point
+    template <class T>
+    struct Box {
+       private:
+        T* ptr = nullptr;
+        Allocator<T> alloc;
+
+       public:
+        Box() = default;
+        Box(std::nullptr_t) {}
+        Box(const Box& other) {
+            if (other.ptr) {
+                emplace(*other.ptr);
+            }
+        }
+        Box(Box&& other) noexcept
+            : ptr(std::exchange(other.ptr, nullptr)), alloc(other.alloc) {}
+        Box& operator=(Box other) noexcept {
+            std::swap(ptr, other.ptr);
+            std::swap(alloc, other.alloc);
+            return *this;
+        }
+        ~Box() {
+            reset();
+        }
+
+        template <class... Args>
+        T& emplace(Args&&... args) {
+            reset();
+            alloc = Allocator<T>{};
+            T* p = alloc.allocate(1);
+            try {
+                ptr = new (p) T(std::forward<Args>(args)...);
+            } catch (...) {
+                alloc.deallocate(p, 1);
+                throw;
+            }
+            return *ptr;
+        }
+
+        void reset() noexcept {
+            if (ptr) {
+                ptr->~T();
+                alloc.deallocate(ptr, 1);
+                ptr = nullptr;
+            }
+        }
+
+        T* get() const {
+            return ptr;
+        }
+        T& operator*() const {
+            return *ptr;
+        }
+        T* operator->() const {
+            return ptr;
+        }
+        explicit operator bool() const {
+            return ptr != nullptr;
+        }
+        friend bool operator==(const Box& a, std::nullptr_t) {
+            return a.ptr == nullptr;
+        }
+    };
+
+    template <class T, class... Args>
+    Box<T> make_box(Args&&... args) {
+        Box<T> b;
+        b.emplace(std::forward<Args>(args)...);
+        return b;
+    }
+
+    // decodes obj with all of its dynamic storage taken from arena
+    // (e.g. std::pmr::monotonic_buffer_resource, optionally over caller's buffer).
+    // arena must outlive obj; with monotonic resource, destroying obj frees nothing
+    // and releasing arena frees whole message at once
+    template <class T, class Reader>
+    auto decode_in(std::pmr::memory_resource& arena, T& obj, Reader& r) {
+        ArenaScope scope{arena};
+        obj = T{};
+        if constexpr (requires { obj.decode(r).run(); }) {
+            // --resumable: run decoder coroutine to completion while arena is current
+            return obj.decode(r).run();
+        }
+        else {
+            return obj.decode(r);
+        }
+    }
+}  // namespace ebm2cpp_rt
+#endif
+)");
+        w.writeln("");
+    }
+
+    // integer arrays lowered as BULK_INT_ARRAY.
+    // whole region is bounds-checked once; byte order is converted by plain loops over the
+    // region (memcpy if wire order equals host order) which compilers unroll and vectorize
+    inline void write_int_array(CodeWriter& w) {
+        w.write_unformatted(R"(#ifndef EBM2CPP_RT_INT_ARRAY
+#define EBM2CPP_RT_INT_ARRAY
+#include <bit>
+#include <cstring>
+#include <type_traits>
+namespace ebm2cpp_rt {
+    template <class U>
+    constexpr U byteswap_int(U v) {
+#if defined(__GNUC__) || defined(__clang__)
+        if constexpr (sizeof(U) == 2) {
+            return __builtin_bswap16(v);
+        }
+        else if constexpr (sizeof(U) == 4) {
+            return __builtin_bswap32(v);
+        }
+        else {
+            return __builtin_bswap64(v);
+        }
+#else
+        U r = 0;
+        for (size_t i = 0; i < sizeof(U); i++) {
+            r = U((r << 8) | ((v >> (8 * i)) & 0xff));
+        }
+        return r;
+#endif
+    }
+
+    // src is n elements of wire order E, may be unaligned
+    template <std::endian E, class T>
+    void load_int_array(T* dst, const std::uint8_t* src, size_t n) {
+        if (n == 0) {
+            return;
+        }
+        if constexpr (E == std::endian::native) {
+            std::memcpy(dst, src, n * sizeof(T));
+        }
+        else {
+            using U = std::make_unsigned_t<T>;
+            for (size_t i = 0; i < n; i++) {
+                U v;
+                std::memcpy(&v, src + i * sizeof(T), sizeof(T));
+                dst[i] = T(byteswap_int(v));
+            }
+        }
+    }
 
+    template <std::endian E, class T>
+    void store_int_array(std::uint8_t* dst, const T* src, size_t n) {
+        if (n == 0) {
+            return;
+        }
+        if constexpr (E == std::endian::native) {
+            std::memcpy(dst, src, n * sizeof(T));
+        }
+        else {
+            using U = std::make_unsigned_t<T>;
+            for (size_t i = 0; i < n; i++) {
+                U v = byteswap_int(U(src[i]));
+                std::memcpy(dst + i * sizeof(T), &v, sizeof(T));
+            }
+        }
+    }
+
+    // caller checks that r has n * sizeof(T) bytes
+    template <std::endian E, class Reader, class T>
+    bool read_int_array(Reader& r, T* dst, size_t n) {
+        ::futils::view::rvec src;
+        if (!r.read(src, n * sizeof(T))) {
+            return false;
+        }
+        load_int_array<E>(dst, src.data(), n);
+        return true;
+    }
+
+    template <std::endian E, class Writer, class T>
+    bool write_int_array(Writer& w, const T* src, size_t n) {
+        if constexpr (E == std::endian::native) {
+            return n == 0 || w.write(::futils::view::rvec(reinterpret_cast<const std::uint8_t*>(src), n * sizeof(T)));
+        }
+        else {
+            // converted through fixed chunk so that output needs no extra allocation
+            std::uint8_t buf[512];
+            constexpr size_t per_chunk = sizeof(buf) / sizeof(T);
+            for (size_t i = 0; i < n; i += per_chunk) {
+                auto k = n - i < per_chunk ? n - i : per_chunk;
+                store_int_array<E>(buf, src + i, k);
+                if (!w.write(::futils::view::rvec(buf, k * sizeof(T)))) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    }
+}  // namespace ebm2cpp_rt
+#endif
+)");
+        w.writeln("");
+    }
+
+    // generated decoders are coroutines in --resumable mode (see write_stream_reader)
+    template <class Ctx>
+    std::string_view return_keyword(Ctx& ctx) {
+        return ctx.config().in_decoder_coroutine ? "co_return" : "return";
+    }
+
+    inline std::string_view int_array_endian(ebm::Endian e) {
+        switch (e) {
+            case ebm::Endian::little:
+                return "std::endian::little";
+            case ebm::Endian::native:
+                return "std::endian::native";
+            default:
+                return "std::endian::big";
+        }
+    }
 }  // namespace CODEGEN_NAMESPACE
 
 DEFINE_VISITOR(entry_before) {
@@ -103,6 +824,13 @@ DEFINE_VISITOR(entry_before) {
     config.decoder_return_type = "::futils::error::Error<>";
     config.encoder_input_type = "::futils::binary::writer&";
     config.decoder_input_type = "::futils::binary::reader&";
+    if (ctx.flags().resumable) {
+        // BorrowedBytes would dangle when StreamReader buffer grows
+        if (ctx.flags().zero_copy) {
+            return unexpect_error("--resumable cannot be used with --zero-copy");
+        }
+        config.decoder_input_type = "::ebm2cpp_rt::StreamReader&";
+    }
 
     // Default values
     config.default_value_option.encoder_return_init = "::futils::error::Error<>()";
@@ -136,9 +864,17 @@ DEFINE_VISITOR(entry_before) {
     };
 
     // Vector type wrapper: std::vector<T>
+    // in zero-copy mode, byte vector is BorrowedBytes which refers decoder input buffer
+    // in arena mode, ebm2cpp_rt::Vector<T> which allocates from current arena
     config.vector_type_wrapper = [](Context_Type_VECTOR& ctx) -> expected<Result> {
         using namespace CODEGEN_NAMESPACE;
+        if (ctx.flags().zero_copy && is_bytes_type(ctx, ctx.item_id, BytesType::vector)) {
+            return CODE("::ebm2cpp_rt::BorrowedBytes");
+        }
         MAYBE(elem_type, ctx.visit(ctx.element_type));
+        if (ctx.flags().arena) {
+            return CODE("::ebm2cpp_rt::Vector<", elem_type.to_writer(), ">");
+        }
         return CODE("std::vector<", elem_type.to_writer(), ">");
     };
 
@@ -154,9 +890,12 @@ DEFINE_VISITOR(entry_before) {
         return CODE(elem_type.to_writer(), "*");
     };
 
-    // Recursive struct type wrapper: std::shared_ptr<T>
-    config.recursive_struct_type_wrapper = [](Result elem_type) -> expected<Result> {
+    // Recursive struct type wrapper: std::shared_ptr<T>, or ebm2cpp_rt::Box<T> in arena mode
+    config.recursive_struct_type_wrapper = [arena = ctx.flags().arena](Result elem_type) -> expected<Result> {
         using namespace CODEGEN_NAMESPACE;
+        if (arena) {
+            return CODE("::ebm2cpp_rt::Box<", elem_type.to_writer(), ">");
+        }
         return CODE("std::shared_ptr<", elem_type.to_writer(), ">");
     };
 
@@ -188,18 +927,60 @@ DEFINE_VISITOR(entry_before) {
         // Propagate the original error value instead of replacing it with a generic message.
         if (!is_nil(ctx.value)) {
             MAYBE(val, ctx.visit(ctx.value));
-            return CODELINE("return ", val.to_writer(), ";");
+            return CODELINE(return_keyword(ctx), " ", val.to_writer(), ";");
         }
-        return CODELINE("return ::futils::error::Error<>(\"error\", ::futils::error::Category::lib);");
+        return CODELINE(return_keyword(ctx), " ::futils::error::Error<>(\"error\", ::futils::error::Category::lib);");
     };
 
     config.error_report_visitor = [](Context_Statement_ERROR_REPORT& ctx) -> expected<Result> {
         using namespace CODEGEN_NAMESPACE;
         MAYBE(literal, ctx.get(ctx.error_report.message));
         auto text = futils::escape::escape_str<std::string>(literal.body.data);
-        return CODELINE(std::format("return ::futils::error::Error<>(\"{}\", ::futils::error::Category::lib);", text));
+        return CODELINE(std::format("{} ::futils::error::Error<>(\"{}\", ::futils::error::Category::lib);", return_keyword(ctx), text));
     };
 
+    if (ctx.flags().resumable) {
+        // same as default visitor except co_return inside decoder coroutines
+        config.return_visitor = [](Context_Statement_RETURN& ctx) -> expected<Result> {
+            using namespace CODEGEN_NAMESPACE;
+            CodeWriter w;
+            if (!is_nil(ctx.value)) {
+                auto add = ctx.add_writer();
+                MAYBE(ret_val, ctx.visit(ctx.value));
+                MAYBE(got, ctx.get_writer());
+                w.merge(std::move(got.get()));
+                w.writeln(return_keyword(ctx), " ", ret_val.to_writer(), ctx.config().endof_statement);
+            }
+            else {
+                w.writeln(return_keyword(ctx), ctx.config().endof_statement);
+            }
+            return w;
+        };
+
+        // nested decoder (struct field or *_impl called from wrapper) is awaited
+        config.call_custom = [](Context_Expression_CALL& ctx) -> expected<Result> {
+            using namespace CODEGEN_NAMESPACE;
+            MAYBE(type, ctx.get(ctx.type));
+            if (type.body.kind != ebm::TypeKind::DECODER_RETURN) {
+                return pass;
+            }
+            CodeWriter w;
+            MAYBE(callee, ctx.visit(ctx.call_desc.callee));
+            w.write("(co_await ", callee.to_writer(), "(");
+            bool first = true;
+            for (auto& arg : ctx.call_desc.arguments.container) {
+                MAYBE(arg_str, ctx.visit(arg));
+                if (!first) {
+                    w.write(",");
+                }
+                first = false;
+                w.write(arg_str.to_writer());
+            }
+            w.write("))");
+            return w;
+        };
+    }
+
     config.is_error_visitor = [](Context_Expression_IS_ERROR& ctx) -> expected<Result> {
         using namespace CODEGEN_NAMESPACE;
         MAYBE(t, ctx.visit(ctx.target_expr));
@@ -273,6 +1054,10 @@ DEFINE_VISITOR(entry_before) {
         using namespace CODEGEN_NAMESPACE;
         auto io_ = ctx.identifier(ctx.io_ref);
         MAYBE(size_str, get_size_str(ctx, ctx.num_bytes));
+        if (ctx.flags().resumable) {
+            // waits for bytes instead of answering from what has arrived so far
+            return CODE("(co_await ", io_, ".fill(", size_str, "))");
+        }
         return CODE(io_, ".remain().size() >= ", size_str);
     };
 
@@ -280,6 +1065,9 @@ DEFINE_VISITOR(entry_before) {
     config.get_remaining_bytes_custom = [](Context_Expression_GET_REMAINING_BYTES& ctx) -> expected<Result> {
         using namespace CODEGEN_NAMESPACE;
         auto io_ = ctx.identifier(ctx.io_ref);
+        if (ctx.flags().resumable) {
+            return CODE("(co_await ", io_, ".remain_all())");
+        }
         return CODE(io_, ".remain().size()");
     };
 
@@ -298,8 +1086,18 @@ DEFINE_VISITOR(entry_before) {
             w.writeln("{");
             {
                 auto scope = w.indent_scope();
+                if (ctx.flags().resumable) {
+                    // whole range is buffered before sub-reader refers it,
+                    // so parent buffer is not reallocated while sub-reader is alive
+                    w.writeln("co_await ", parent_io_, ".fill(", length_str.to_writer(), ");");
+                }
                 w.writeln("auto _sub_view = ", parent_io_, ".remain().substr(0, ", length_str.to_writer(), ");");
-                w.writeln("::futils::binary::reader ", io_, "{_sub_view};");
+                if (ctx.flags().resumable) {
+                    w.writeln("::ebm2cpp_rt::StreamReader ", io_, "{_sub_view};");
+                }
+                else {
+                    w.writeln("::futils::binary::reader ", io_, "{_sub_view};");
+                }
                 if (track_offset) {
                     w.writeln("const auto _rs_start = runtime_state.offset;");
                 }
@@ -359,7 +1157,12 @@ DEFINE_VISITOR(entry_before) {
                 w.writeln("if (!", target_txt.to_writer(), ") {");
                 {
                     auto scope = w.indent_scope();
-                    w.writeln(target_txt.to_writer(), " = std::make_shared<", type_txt.to_writer(), ">();");
+                    if (ctx.flags().arena) {
+                        w.writeln(target_txt.to_writer(), " = ::ebm2cpp_rt::make_box<", type_txt.to_writer(), ">();");
+                    }
+                    else {
+                        w.writeln(target_txt.to_writer(), " = std::make_shared<", type_txt.to_writer(), ">();");
+                    }
                 }
                 w.writeln("}");
                 return w;
@@ -543,6 +1346,21 @@ DEFINE_VISITOR(entry_before) {
         w.writeln("#include <binary/number.h>");
         w.writeln("#include <error/error.h>");
         w.writeln("");
+        if (ctx.flags().zero_copy) {
+            write_borrowed_bytes(w);
+        }
+        if (ctx.flags().resumable) {
+            write_stream_reader(w);
+        }
+        if (ctx.flags().arena) {
+            write_arena(w);
+            if (ctx.flags().resumable) {
+                write_arena_resumable(w);
+            }
+        }
+        if (has_lowered_io(ctx, ebm::LoweringIOType::BULK_INT_ARRAY)) {
+            write_int_array(w);
+        }
 
         // Phase 1: Enum definitions + top-level constants + struct forward declarations
         for (const auto& stmt : ctx.module().module().statements) {
@@ -600,6 +1418,67 @@ DEFINE_VISITOR(entry_before) {
         return w;
     };
 
+    // BULK_INT_ARRAY: bounds-check whole region once, then convert byte order in bulk
+    config.read_data_custom = [](Context_Statement_READ_DATA& ctx) -> expected<Result> {
+        using namespace CODEGEN_NAMESPACE;
+        auto bulk = get_bulk_int_array(ctx, ctx.read_data);
+        if (!bulk || ctx.read_data.attribute.is_peek()) {
+            return pass;
+        }
+        MAYBE(count, get_element_count_default(ctx, ctx.read_data.data_type, ctx.read_data.size));
+        MAYBE(target, ctx.visit(ctx.read_data.target));
+        MAYBE(layer_str, get_identifier_layer_str(ctx, from_weak(ctx.read_data.field)));
+        auto io_name = ctx.identifier(ctx.read_data.io_ref);
+        auto width = std::to_string(bulk->element_bytes);
+        CodeWriter w;
+        w.writeln("{");
+        {
+            auto scope = w.indent_scope();
+            w.writeln("auto _n = static_cast<size_t>(", count, ");");
+            if (ctx.flags().resumable) {
+                w.writeln("co_await ", io_name, ".fill(_n < SIZE_MAX / ", width, " ? _n * ", width, " : SIZE_MAX);");
+            }
+            w.writeln("if (", io_name, ".remain().size() / ", width, " < _n) {");
+            w.indent_writeln(std::format("{} ::futils::error::Error<>(\"decode: {}: not enough data for int array\", ::futils::error::Category::lib);", return_keyword(ctx), layer_str));
+            w.writeln("}");
+            if (bulk->container == BytesType::vector) {
+                w.writeln(target.to_writer(), ".resize(_n);");
+            }
+            w.writeln("if (!::ebm2cpp_rt::read_int_array<", int_array_endian(bulk->endian), ">(", io_name, ", ", target.to_writer(), ".data(), _n)) {");
+            w.indent_writeln(std::format("{} ::futils::error::Error<>(\"decode: {}: read int array failed\", ::futils::error::Category::lib);", return_keyword(ctx), layer_str));
+            w.writeln("}");
+            ebmcodegen::util::append_runtime_offset(ctx, ctx.read_data.io_ref, w, "_n * " + width);
+        }
+        w.writeln("}");
+        return w;
+    };
+
+    config.write_data_custom = [](Context_Statement_WRITE_DATA& ctx) -> expected<Result> {
+        using namespace CODEGEN_NAMESPACE;
+        auto bulk = get_bulk_int_array(ctx, ctx.write_data);
+        if (!bulk) {
+            return pass;
+        }
+        // LENGTH_CHECK of vector is already emitted before this statement
+        MAYBE(count, get_element_count_default(ctx, ctx.write_data.data_type, ctx.write_data.size));
+        MAYBE(target, ctx.visit(ctx.write_data.target));
+        MAYBE(layer_str, get_identifier_layer_str(ctx, from_weak(ctx.write_data.field)));
+        auto io_name = ctx.identifier(ctx.write_data.io_ref);
+        auto width = std::to_string(bulk->element_bytes);
+        CodeWriter w;
+        w.writeln("{");
+        {
+            auto scope = w.indent_scope();
+            w.writeln("auto _n = static_cast<size_t>(", count, ");");
+            w.writeln("if (!::ebm2cpp_rt::write_int_array<", int_array_endian(bulk->endian), ">(", io_name, ", ", target.to_writer(), ".data(), _n)) {");
+            w.indent_writeln(std::format("return ::futils::error::Error<>(\"encode: {}: write int array failed\", ::futils::error::Category::lib);", layer_str));
+            w.writeln("}");
+            ebmcodegen::util::append_runtime_offset(ctx, ctx.write_data.io_ref, w, "_n * " + width);
+        }
+        w.writeln("}");
+        return w;
+    };
+
     // Read data: use futils binary read API
     config.read_data_bytes_io_wrapper = [](Context_Statement_READ_DATA& ctx, BytesType cand, Result target, std::string io_name) -> expected<Result> {
         using namespace CODEGEN_NAMESPACE;
@@ -609,19 +1488,44 @@ DEFINE_VISITOR(entry_before) {
         MAYBE(size_str, get_size_str(ctx, ctx.read_data.size));
         const bool track_offset = !ctx.read_data.attribute.is_peek();
         CodeWriter w;
+        if (ctx.flags().resumable) {
+            // result is ignored; read below fails if stream ended
+            w.writeln("co_await ", io_name, ".fill(", size_str, ");");
+        }
         if (cand == BytesType::array) {
             // Read only size_str bytes; the backing std::array may be larger (e.g. alignment padding).
             w.writeln("if (!", io_name, ".read(::futils::view::wvec(", target.to_writer(), ".data(), ", size_str, "))) {");
             {
                 auto scope = w.indent_scope();
                 MAYBE(layer_str, get_identifier_layer_str(ctx, from_weak(ctx.read_data.field)));
-                w.writeln(std::format("return ::futils::error::Error<>(\"decode: {}: read byte array failed\", ::futils::error::Category::lib);", layer_str));
+                w.writeln(std::format("{} ::futils::error::Error<>(\"decode: {}: read byte array failed\", ::futils::error::Category::lib);", return_keyword(ctx), layer_str));
             }
             w.writeln("}");
             if (track_offset) {
                 ebmcodegen::util::append_runtime_offset(ctx, ctx.read_data.io_ref, w, size_str);
             }
         }
+        else if (ctx.flags().zero_copy) {
+            // BorrowedBytes - refer reader buffer without copy
+            w.writeln("{");
+            {
+                auto scope = w.indent_scope();
+                w.writeln("auto _sz = ", size_str, ";");
+                w.writeln("::futils::view::rvec _view;");
+                w.writeln("if (!", io_name, ".read(_view, _sz)) {");
+                {
+                    auto scope2 = w.indent_scope();
+                    MAYBE(layer_str, get_identifier_layer_str(ctx, from_weak(ctx.read_data.field)));
+                    w.writeln(std::format("{} ::futils::error::Error<>(\"decode: {}: read bytes failed\", ::futils::error::Category::lib);", return_keyword(ctx), layer_str));
+                }
+                w.writeln("}");
+                w.writeln(target.to_writer(), " = _view;");
+                if (track_offset) {
+                    ebmcodegen::util::append_runtime_offset(ctx, ctx.read_data.io_ref, w, "_sz");
+                }
+            }
+            w.writeln("}");
+        }
         else {
             // Vector<uint8_t> - resize then read
             w.writeln("{");
@@ -629,11 +1533,16 @@ DEFINE_VISITOR(entry_before) {
                 auto scope = w.indent_scope();
                 w.writeln("auto _sz = ", size_str, ";");
                 w.writeln(target.to_writer(), ".resize(_sz);");
-                w.writeln("if (!", io_name, ".read(", target.to_writer(), ")) {");
+                if (ctx.flags().arena) {
+                    w.writeln("if (!", io_name, ".read(::futils::view::wvec(", target.to_writer(), ".data(), _sz))) {");
+                }
+                else {
+                    w.writeln("if (!", io_name, ".read(", target.to_writer(), ")) {");
+                }
                 {
                     auto scope2 = w.indent_scope();
                     MAYBE(layer_str, get_identifier_layer_str(ctx, from_weak(ctx.read_data.field)));
-                    w.writeln(std::format("return ::futils::error::Error<>(\"decode: {}: read bytes failed\", ::futils::error::Category::lib);", layer_str));
+                    w.writeln(std::format("{} ::futils::error::Error<>(\"decode: {}: read bytes failed\", ::futils::error::Category::lib);", return_keyword(ctx), layer_str));
                 }
                 w.writeln("}");
                 if (track_offset) {
@@ -658,6 +1567,12 @@ DEFINE_VISITOR(entry_before) {
             // because sub-byte IO buffers may be larger than the actual write size (e.g. QUIC varint).
             w.writeln("if (!", io_name, ".write(::futils::view::rvec(", target.to_writer(), ".data(), ", size_str, "))) {");
         }
+        else if (ctx.flags().zero_copy) {
+            w.writeln("if (!", io_name, ".write(", target.to_writer(), ".view())) {");
+        }
+        else if (ctx.flags().arena) {
+            w.writeln("if (!", io_name, ".write(::futils::view::rvec(", target.to_writer(), ".data(), ", target.to_writer(), ".size()))) {");
+        }
         else {
             w.writeln("if (!", io_name, ".write(", target.to_writer(), ")) {");
         }
@@ -791,11 +1706,22 @@ DEFINE_VISITOR(entry_before) {
         if (!ctx.func_decl.attribute.is_mutable() && ret_type_info.body.kind == ebm::TypeKind::PTR) {
             return CODE("const ", ret_type.to_writer());
         }
+        if (ctx.flags().resumable && ret_type_info.body.kind == ebm::TypeKind::DECODER_RETURN) {
+            return CODE("::ebm2cpp_rt::Decoding");
+        }
         return ret_type;
     };
 
+    // called before body of each function is visited; body of decoder is a coroutine in --resumable mode
+    auto enter_function = [](Context_Statement_FUNCTION_DECL& ctx) -> expected<void> {
+        using namespace CODEGEN_NAMESPACE;
+        MAYBE(ret_type_info, ctx.get(ctx.func_decl.return_type));
+        ctx.config().in_decoder_coroutine = ctx.flags().resumable && ret_type_info.body.kind == ebm::TypeKind::DECODER_RETURN;
+        return {};
+    };
+
     // Function declaration: phase-aware
-    config.function_decl_custom = [format_return_type](Context_Statement_FUNCTION_DECL& ctx) -> expected<Result> {
+    config.function_decl_custom = [format_return_type, enter_function](Context_Statement_FUNCTION_DECL& ctx) -> expected<Result> {
         using namespace CODEGEN_NAMESPACE;
         auto phase = ctx.config().output_phase;
         if (phase == OutputPhase::Normal) {
@@ -841,6 +1767,7 @@ DEFINE_VISITOR(entry_before) {
             w.writeln(ret_type.to_writer(), " ", name, "(", params, ") {");
             {
                 auto scope = w.indent_scope();
+                MAYBE_VOID(entered, enter_function(ctx));
                 MAYBE(body, ctx.visit(ctx.func_decl.body));
                 w.write(body.to_writer());
             }
@@ -863,6 +1790,7 @@ DEFINE_VISITOR(entry_before) {
         w.writeln(ret_type.to_writer(), " ", struct_name, "::", prefix, name, "(", params, ")", const_suffix, " {");
         {
             auto scope = w.indent_scope();
+            MAYBE_VOID(entered, enter_function(ctx));
             MAYBE(body, ctx.visit(ctx.func_decl.body));
             w.write(body.to_writer());
         }
@@ -876,9 +1804,11 @@ DEFINE_VISITOR(entry_before) {
     };
 
     // Function definition start: used in Normal phase (default visitor path)
-    config.function_definition_start_wrapper = [format_return_type](Result return_type, std::string_view name, CodeWriter params, Context_Statement_FUNCTION_DECL& ctx) -> expected<Result> {
+    config.function_definition_start_wrapper = [format_return_type, enter_function](Result return_type, std::string_view name, CodeWriter params, Context_Statement_FUNCTION_DECL& ctx) -> expected<Result> {
         using namespace CODEGEN_NAMESPACE;
         MAYBE(ret_type, format_return_type(ctx, return_type));
+        // default visitor visits body right after this
+        MAYBE_VOID(entered, enter_function(ctx));
         std::string prefix;
         if (ctx.func_decl.kind == ebm::FunctionKind::VECTOR_SETTER) {
             prefix = "set_";
@@ -756,6 +756,87 @@ DEFINE_VISITOR(entry_before) {
         auto len = ctx.length.value();
         return CODE("[", type.to_writer(), "; ", std::to_string(len), "]");
     };
+    // BULK_INT_ARRAY: read/write through fixed chunk buffer and convert with
+    // {from,to}_{be,le,ne}_bytes over chunks_exact, which LLVM vectorizes.
+    // direct (slice) decode keeps element-wise lowered statement
+    config.read_data_custom = [](Context_Statement_READ_DATA& ctx) -> expected<Result> {
+        using namespace CODEGEN_NAMESPACE;
+        auto bulk = get_bulk_int_array(ctx, ctx.read_data);
+        if (!bulk || ctx.read_data.attribute.is_peek() || ctx.config().in_direct_decode) {
+            return pass;
+        }
+        MAYBE(count, get_element_count_default(ctx, ctx.read_data.data_type, ctx.read_data.size));
+        MAYBE(target, ctx.visit(ctx.read_data.target));
+        MAYBE(elem, ctx.visit(bulk->element_type));
+        MAYBE(err_loc, get_identifier_layer_str(ctx, from_weak(ctx.read_data.field)));
+        auto io_name = ctx.identifier(ctx.read_data.io_ref);
+        auto width = std::to_string(bulk->element_bytes);
+        std::string bytes = "[";
+        for (size_t i = 0; i < bulk->element_bytes; i++) {
+            bytes += std::format("{}_c[{}]", i ? ", " : "", i);
+        }
+        bytes += "]";
+        auto convert = std::format("{}::{}({})", elem.to_string(), ebm2rust::int_array_from_bytes(bulk->endian), bytes);
+        CodeWriter w;
+        w.writeln("{");
+        {
+            auto scope = w.indent_scope();
+            w.writeln("let _n = ", count, " as usize;");
+            w.writeln("let mut _buf = [0u8; 4096];");
+            w.writeln("let mut _done = 0usize;");
+            w.writeln("while _done < _n {");
+            {
+                auto scope2 = w.indent_scope();
+                w.writeln("let _k = std::cmp::min(_n - _done, 4096 / ", width, ");");
+                w.writeln(io_name, ".read_exact(&mut _buf[.._k * ", width, "])", ebm2rust::map_io_err(true, err_loc, ctx.flags().use_async), ";");
+                if (bulk->container == BytesType::vector) {
+                    auto mut_target = ctx.flags().zero_copy ? target.to_string() + ".to_mut()" : target.to_string();
+                    w.writeln(mut_target, ".extend(_buf[.._k * ", width, "].chunks_exact(", width, ").map(|_c| ", convert, "));");
+                }
+                else {
+                    w.writeln("for (_d, _c) in ", target.to_writer(), "[_done.._done + _k].iter_mut().zip(_buf[.._k * ", width, "].chunks_exact(", width, ")) {");
+                    w.indent_writeln("*_d = ", convert, ";");
+                    w.writeln("}");
+                }
+                w.writeln("_done += _k;");
+            }
+            w.writeln("}");
+            ebmcodegen::util::append_runtime_offset(ctx, ctx.read_data.io_ref, w, "_n * " + width);
+        }
+        w.writeln("}");
+        return w;
+    };
+    config.write_data_custom = [](Context_Statement_WRITE_DATA& ctx) -> expected<Result> {
+        using namespace CODEGEN_NAMESPACE;
+        auto bulk = get_bulk_int_array(ctx, ctx.write_data);
+        if (!bulk) {
+            return pass;
+        }
+        MAYBE(count, get_element_count_default(ctx, ctx.write_data.data_type, ctx.write_data.size));
+        MAYBE(target, ctx.visit(ctx.write_data.target));
+        MAYBE(err_loc, get_identifier_layer_str(ctx, from_weak(ctx.write_data.field)));
+        auto io_name = ctx.identifier(ctx.write_data.io_ref);
+        auto width = std::to_string(bulk->element_bytes);
+        CodeWriter w;
+        w.writeln("{");
+        {
+            auto scope = w.indent_scope();
+            w.writeln("let _n = ", count, " as usize;");
+            w.writeln("let mut _buf = [0u8; 4096];");
+            w.writeln("for _c in ", target.to_writer(), "[.._n].chunks(4096 / ", width, ") {");
+            {
+                auto scope2 = w.indent_scope();
+                w.writeln("for (_d, _v) in _buf.chunks_exact_mut(", width, ").zip(_c.iter()) {");
+                w.indent_writeln("_d.copy_from_slice(&_v.", ebm2rust::int_array_to_bytes(bulk->endian), "());");
+                w.writeln("}");
+                w.writeln(io_name, ".write_all(&_buf[.._c.len() * ", width, "])", ebm2rust::map_io_err(false, err_loc, ctx.flags().use_async), ";");
+            }
+            w.writeln("}");
+            ebmcodegen::util::append_runtime_offset(ctx, ctx.write_data.io_ref, w, "_n * " + width);
+        }
+        w.writeln("}");
+        return w;
+    };
     config.read_data_bytes_io_wrapper = [zero_copy](Context_Statement_READ_DATA& ctx, BytesType cand, Result target, std::string io_name) -> expected<Result> {
         using namespace CODEGEN_NAMESPACE;
         // lowered statement がある場合は default の lowered fallback に委ねる
@@ -32,6 +32,15 @@ namespace ebm2rust {
         return (static_cast<std::uint64_t>(flags) & static_cast<std::uint64_t>(flag)) != 0;
     }
 
+    // conversion of BULK_INT_ARRAY elements (unspec is resolved to big by get_bulk_int_array)
+    inline std::string_view int_array_from_bytes(ebm::Endian e) {
+        return e == ebm::Endian::little ? "from_le_bytes" : e == ebm::Endian::native ? "from_ne_bytes" : "from_be_bytes";
+    }
+
+    inline std::string_view int_array_to_bytes(ebm::Endian e) {
+        return e == ebm::Endian::little ? "to_le_bytes" : e == ebm::Endian::native ? "to_ne_bytes" : "to_be_bytes";
+    }
+
     // zero-copy direct-decode mode helpers. Offset は io 変数名から機械的に導出する
     // (Go 版 offset_var/offset_ref と同じ発想) ので config state を持たなくて済む。
     inline std::string offset_var(const std::string& io) {
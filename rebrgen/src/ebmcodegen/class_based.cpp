@@ -1695,11 +1695,13 @@ namespace ebmcodegen {
             {
                 auto entry_scope = w.indent_scope();
                 w.writeln(ns_name, "::InitialContext initial_ctx{.visitor = visitor};");
+                w.writeln("ebmcodegen::adopt_shared_id_maps(visitor.module_); // no-op unless linked into ebm2multi");
                 w.writeln("auto pre_visit_result = ", ns_name, "::dispatch_pre_visitor(initial_ctx,ebm);");
                 handle_hijack_logic(w, "pre_visit_result");
                 w.writeln("if(!visitor.module_.valid()) {");
                 w.indent_writeln("visitor.module_.build_maps(); // initialize mapping tables if not yet");
                 w.writeln("}");
+                w.writeln("flags.debug_timing(\"mapping table built\");");
                 w.writeln("auto entry_result = ", ns_name, "::dispatch_entry(initial_ctx);");
                 w.writeln("auto post_visit_result = ", ns_name, "::dispatch_post_entry(initial_ctx,entry_result);");
                 handle_hijack_logic(w, "post_visit_result");
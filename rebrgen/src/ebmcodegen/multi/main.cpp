@@ -0,0 +1,225 @@
+/*license*/
+// ebm2multi: loads EBM once and runs several code generators on it concurrently.
+// generators are linked in by compiling their main.cpp with EBMCODEGEN_MULTI_BACKEND (see src/ebmcg/CMakeLists.txt)
+#include <cmdline/template/help_option.h>
+#include <cmdline/template/parse_and_err.h>
+#include <wrap/cout.h>
+#include <wrap/argv.h>
+#include <file/file_view.h>
+#include <helper/defer.h>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ebmcodegen/stub/multi_entry.hpp"
+#include "ebmgen/mapping.hpp"
+#include "ebmgen/stdin.hpp"
+
+struct Flags : futils::cmdline::templ::HelpOption {
+    std::vector<std::string_view> args;
+    std::string_view input;
+    std::string_view output_dir = ".";
+    std::string_view name;
+    size_t jobs = 0;
+    bool list = false;
+    bool timing = false;
+
+    void bind(futils::cmdline::option::Context& ctx) {
+        bind_help(ctx);
+        ctx.VarString<true>(&input, "input,i", "input EBM file (- for stdin)", "FILE");
+        ctx.VarString<true>(&output_dir, "output-dir,d", "output directory (default: current directory)", "DIR");
+        ctx.VarString<true>(&name, "name", "output file name without extension (default: input file name)", "NAME");
+        ctx.VarInt(&jobs, "jobs,j", "number of generators run at once (0=hardware concurrency)", "<num>");
+        ctx.VarBool(&list, "list", "list linked generators");
+        ctx.VarBool(&timing, "timing", "show elapsed time of each generator");
+    }
+};
+
+auto& cout = futils::wrap::cout_wrap();
+auto& cerr = futils::wrap::cerr_wrap();
+
+struct Job {
+    const ebmcodegen::multi::Backend* backend = nullptr;
+    std::vector<std::string> argv;
+    int exit_code = 0;
+    std::chrono::milliseconds elapsed{};
+};
+
+const ebmcodegen::multi::Backend* find_backend(std::string_view name) {
+    for (auto& b : ebmcodegen::multi::registry()) {
+        if (b.name == name) {
+            return &b;
+        }
+    }
+    return nullptr;
+}
+
+// <generator>[:<arg>,<arg>...] (e.g. ebm2cpp:--zero-copy)
+bool parse_job(std::string_view arg, Job& job) {
+    auto sep = arg.find(':');
+    auto name = arg.substr(0, sep);
+    job.backend = find_backend(name);
+    if (!job.backend) {
+        cerr << "ebm2multi: unknown generator: " << name << " (see --list)\n";
+        return false;
+    }
+    job.argv.push_back(std::string(name));
+    if (sep != arg.npos) {
+        auto rest = arg.substr(sep + 1);
+        while (rest.size()) {
+            auto comma = rest.find(',');
+            job.argv.push_back(std::string(rest.substr(0, comma)));
+            rest = comma == rest.npos ? std::string_view{} : rest.substr(comma + 1);
+        }
+    }
+    return true;
+}
+
+void run_job(Job& job, ebm::ExtendedBinaryModule& shared, const std::shared_ptr<const ebmgen::mapping::IdMaps>& maps, const ebmcodegen::multi::Target& target) {
+    std::vector<char*> argv;
+    for (auto& a : job.argv) {
+        argv.push_back(a.data());
+    }
+    argv.push_back(nullptr);
+    auto begin = std::chrono::steady_clock::now();
+    if (job.backend->private_module) {
+        ebmcodegen::multi::shared_id_maps = nullptr;
+        ebm::ExtendedBinaryModule copy = shared;
+        // views still point into the input buffer; only the list is copied so that promotion stays private
+        std::optional<ebmgen::ZeroCopyStrings> strings;
+        if (auto shared_strings = ebmgen::find_zero_copy_strings(shared)) {
+            strings = *shared_strings;
+            ebmgen::attach_zero_copy_strings(copy, &*strings);
+        }
+        job.exit_code = job.backend->run(int(job.argv.size()), argv.data(), copy, target);
+        ebmgen::attach_zero_copy_strings(copy, nullptr);
+    }
+    else {
+        // shared module is never modified by these generators; only read concurrently
+        ebmcodegen::multi::shared_id_maps = maps;
+        job.exit_code = job.backend->run(int(job.argv.size()), argv.data(), shared, target);
+        ebmcodegen::multi::shared_id_maps = nullptr;
+    }
+    job.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin);
+}
+
+int Main(Flags& flags, futils::cmdline::option::Context& ctx) {
+    if (flags.list) {
+        for (auto& b : ebmcodegen::multi::registry()) {
+            cout << b.name << (b.private_module ? " (private module)" : "") << "\n";
+        }
+        return 0;
+    }
+    if (flags.input.empty()) {
+        cerr << "ebm2multi: no input file\n";
+        return 1;
+    }
+    if (flags.args.empty()) {
+        cerr << "ebm2multi: no generator specified (see --list)\n";
+        return 1;
+    }
+    std::vector<Job> jobs(flags.args.size());
+    for (size_t i = 0; i < flags.args.size(); i++) {
+        if (!parse_job(flags.args[i], jobs[i])) {
+            return 1;
+        }
+    }
+    auto start = std::chrono::steady_clock::now();
+    ebmgen::Stdin stdin_data;
+    futils::file::View view;
+    futils::binary::reader r{futils::view::rvec{}};
+    if (flags.input == "-") {
+        auto stdin_result = stdin_data.try_read_stdin();
+        if (!stdin_result) {
+            cerr << "ebm2multi: failed to read stdin: " << stdin_result.error().error<std::string>() << '\n';
+            return 1;
+        }
+        r.reset_buffer(*stdin_data.stdin_data);
+    }
+    else {
+        if (auto res = view.open(flags.input); !res) {
+            cerr << "ebm2multi: " << res.error().template error<std::string>() << '\n';
+            return 1;
+        }
+        if (!view.data()) {
+            cerr << "ebm2multi: Empty file\n";
+            return 1;
+        }
+        r.reset_buffer(view);
+    }
+    ebm::ExtendedBinaryModule ebm;
+    ebmgen::ZeroCopyStrings strings;
+    if (auto err = ebmgen::decode_zero_copy(r, ebm, strings)) {
+        cerr << "ebm2multi: " << err.error<std::string>() << '\n';
+        return 1;
+    }
+    const auto detach = futils::helper::defer([&] {
+        ebmgen::attach_zero_copy_strings(ebm, nullptr);
+    });
+    if (!r.empty()) {
+        cerr << "ebm2multi: unexpected remaining data for input\n";
+        return 1;
+    }
+    ebmgen::MappingTable table(ebm);
+    auto maps = table.id_maps();
+    auto loaded = std::chrono::steady_clock::now();
+
+    std::string name{flags.name};
+    if (name.empty()) {
+        name = flags.input == "-" ? "stdin" : std::filesystem::path(flags.input).stem().string();
+    }
+    auto base = (std::filesystem::path(flags.output_dir) / name).generic_string();
+    ebmcodegen::multi::Target target{.output_base = base};
+
+    size_t n_threads = flags.jobs == 0 ? std::thread::hardware_concurrency() : flags.jobs;
+    n_threads = std::max<size_t>(1, std::min(n_threads, jobs.size()));
+    std::atomic_size_t next = 0;
+    auto worker = [&] {
+        for (auto i = next++; i < jobs.size(); i = next++) {
+            run_job(jobs[i], ebm, maps, target);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < n_threads; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    int exit_code = 0;
+    for (auto& job : jobs) {
+        if (flags.timing) {
+            cerr << "ebm2multi: [timing] " << job.backend->name << " took " << job.elapsed.count() << " ms\n";
+        }
+        if (job.exit_code != 0 && exit_code == 0) {
+            exit_code = job.exit_code;
+        }
+    }
+    if (flags.timing) {
+        auto now = std::chrono::steady_clock::now();
+        cerr << "ebm2multi: [timing] load took " << std::chrono::duration_cast<std::chrono::milliseconds>(loaded - start).count() << " ms, "
+             << "total " << std::chrono::duration_cast<std::chrono::milliseconds>(now - start).count() << " ms\n";
+    }
+    return exit_code;
+}
+
+int main(int argc, char** argv) {
+    futils::wrap::U8Arg _(argc, argv);
+    Flags flags;
+    return futils::cmdline::templ::parse_or_err<std::string>(
+        argc, argv, flags,
+        [](auto&& str, bool err) {
+            if (err)
+                cerr << str;
+            else
+                cout << str;
+        },
+        [](Flags& flags, futils::cmdline::option::Context& ctx) {
+            return Main(flags, ctx);
+        });
+}
@@ -8,6 +8,7 @@
 #include <wrap/cout.h>
 #include <file/file_view.h>
 #include <file/file_stream.h>
+#include <helper/defer.h>
 #include <json/stringer.h>
 #include <set>
 #include <unordered_map>
@@ -19,6 +20,7 @@
 #include <tool/common/em_main.h>
 #endif
 #include "output.hpp"
+#include "multi_entry.hpp"
 #include <wrap/argv.h>
 #include <chrono>
 
@@ -105,7 +107,73 @@ namespace ebmcodegen {
             web_filtered = {"help", "input", "output", "show-flags", "dump-code", "test-info", "test-separator", "timing"};
         }
     };
+    // adopts id maps of the module shared by multi-backend driver (see multi_entry.hpp).
+    // no-op when running as standalone generator
+    inline void adopt_shared_id_maps(ebmgen::MappingTable& table) {
+        if (multi::shared_id_maps) {
+            table.share_id_maps(multi::shared_id_maps);
+        }
+    }
+
     namespace internal {
+        // Run codegen through `w`, then optionally dump test info.
+        // the code writer targets either stdout (default / `-o -`) or an `-o FILE` output file
+        int write_output(auto& flags, auto& output, ebm::ExtendedBinaryModule& ebm, auto&& then) {
+            auto& cout = futils::wrap::cout_wrap();
+            auto& cerr = futils::wrap::cerr_wrap();
+            auto emit = [&](futils::binary::writer& w) -> int {
+                flags.debug_timing("file loaded");
+                int ret = then(w, ebm, output);
+                if (flags.dump_test_file.size()) {
+                    futils::json::Stringer str;
+                    auto obj = str.object();
+                    obj("line_map", output.line_maps);
+                    obj("structs", output.struct_names);
+                    obj.close();
+                    if (flags.dump_test_file == "-") {
+                        cout << flags.dump_test_separator;
+                        cout << str.out() << "\n";
+                        return ret;
+                    }
+                    auto file = futils::file::File::create(flags.dump_test_file);
+                    if (!file) {
+                        cerr << flags.program_name << ": " << file.error().template error<std::string>() << '\n';
+                        return 1;
+                    }
+                    futils::file::FileStream<std::string> tfs{*file};
+                    futils::binary::writer tw{tfs.get_direct_write_handler(), &tfs};
+                    tw.write(str.out());
+                }
+                return ret;
+            };
+            // Default to stdout; `-o -` is also stdout. A non-empty, non-"-"
+            // `-o FILE` writes the generated source to that file (mirrors ebmgen).
+            if (flags.output.empty() || flags.output == "-") {
+                futils::file::FileStream<std::string> fs{futils::file::File::stdout_file()};
+                futils::binary::writer w{fs.get_direct_write_handler(), &fs};
+                return emit(w);
+            }
+            auto out_file = futils::file::File::create(flags.output);
+            if (!out_file) {
+                cerr << flags.program_name << ": " << out_file.error().template error<std::string>() << '\n';
+                return 1;
+            }
+            futils::file::FileStream<std::string> fs{*out_file};
+            futils::binary::writer w{fs.get_direct_write_handler(), &fs};
+            return emit(w);
+        }
+
+        // entry of backend linked into multi-backend driver. module is already loaded by the driver
+        int run_multi(auto& flags, auto& output, ebm::ExtendedBinaryModule& ebm, const multi::Target& target, auto&& then) {
+            std::string path;
+            if (flags.output.empty()) {
+                path = target.output_base;
+                path += flags.file_extensions.size() ? flags.file_extensions[0] : std::string_view(".txt");
+                flags.output = path;
+            }
+            return write_output(flags, output, ebm, then);
+        }
+
         int load_file(auto& flags, auto& output, futils::cmdline::option::Context& ctx, auto&& then) {
             if (flags.show_flags) {
                 futils::wrap::cout_wrap() << flag_description_json(ctx, flags.lang_name, flags.ui_lang_name, flags.lsp_name, flags.webworker_name, flags.file_extensions, flags.web_filtered, flags.web_type_map) << '\n';
@@ -118,6 +186,8 @@ namespace ebmcodegen {
             ebmgen::Stdin stdin_data;
             futils::file::View view;
             ebm::ExtendedBinaryModule ebm;
+            // identifiers and strings stay in stdin_data/view (see docs/decisions/0046-codegen-input-zero-copy.md)
+            ebmgen::ZeroCopyStrings strings;
             auto& cout = futils::wrap::cout_wrap();
             auto& cerr = futils::wrap::cerr_wrap();
             flags.debug_timing("start loading file");
@@ -143,77 +213,65 @@ namespace ebmcodegen {
                 flags.debug_timing("file opened");
                 r.reset_buffer(view);
             }
-            auto err = ebm.decode(r);
+            auto input = r.remain();
+            auto err = ebmgen::decode_zero_copy(r, ebm, strings);
+            const auto detach = futils::helper::defer([&] {
+                ebmgen::attach_zero_copy_strings(ebm, nullptr);
+            });
             flags.debug_timing("file decoded");
-            if (err) {
+            // printer prints module itself, so decode again into owning one for it
+            auto dump_code = [&] {
                 if (flags.dump_code) {
+                    ebm::ExtendedBinaryModule owning;
+                    futils::binary::reader dump_r{input};
+                    (void)owning.decode(dump_r);
                     std::stringstream ss;
-                    ebmgen::MappingTable table(ebm);
+                    ebmgen::MappingTable table(owning);
                     ebmgen::DebugPrinter printer(table, ss);
                     printer.print_module();
                     cout << ss.str();
                 }
+            };
+            if (err) {
+                dump_code();
                 cerr << flags.program_name << ": " << err.error<std::string>() << '\n';
                 return 1;
             }
             if (!r.empty()) {
-                if (flags.dump_code) {
-                    std::stringstream ss;
-                    ebmgen::MappingTable table(ebm);
-                    ebmgen::DebugPrinter printer(table, ss);
-                    printer.print_module();
-                    cout << ss.str();
-                }
+                dump_code();
                 cerr << flags.program_name << ": " << "unexpected remaining data for input\n";
                 return 1;
             }
-            // Run codegen through `w`, then optionally dump test info. Factored
-            // into a lambda so the code writer can target either stdout (default
-            // / `-o -`) or an `-o FILE` output file without duplicating the tail.
-            auto emit = [&](futils::binary::writer& w) -> int {
-                flags.debug_timing("file loaded");
-                int ret = then(w, ebm, output);
-                if (flags.dump_test_file.size()) {
-                    futils::json::Stringer str;
-                    auto obj = str.object();
-                    obj("line_map", output.line_maps);
-                    obj("structs", output.struct_names);
-                    obj.close();
-                    if (flags.dump_test_file == "-") {
-                        cout << flags.dump_test_separator;
-                        cout << str.out() << "\n";
-                        return ret;
-                    }
-                    auto file = futils::file::File::create(flags.dump_test_file);
-                    if (!file) {
-                        cerr << flags.program_name << ": " << file.error().template error<std::string>() << '\n';
-                        return 1;
-                    }
-                    futils::file::FileStream<std::string> tfs{*file};
-                    futils::binary::writer tw{tfs.get_direct_write_handler(), &tfs};
-                    tw.write(str.out());
-                }
-                return ret;
-            };
-            // Default to stdout; `-o -` is also stdout. A non-empty, non-"-"
-            // `-o FILE` writes the generated source to that file (mirrors ebmgen).
-            if (flags.output.empty() || flags.output == "-") {
-                futils::file::FileStream<std::string> fs{futils::file::File::stdout_file()};
-                futils::binary::writer w{fs.get_direct_write_handler(), &fs};
-                return emit(w);
-            }
-            auto out_file = futils::file::File::create(flags.output);
-            if (!out_file) {
-                cerr << flags.program_name << ": " << out_file.error().template error<std::string>() << '\n';
-                return 1;
-            }
-            futils::file::FileStream<std::string> fs{*out_file};
-            futils::binary::writer w{fs.get_direct_write_handler(), &fs};
-            return emit(w);
+            return write_output(flags, output, ebm, then);
         }
     }  // namespace internal
 }  // namespace ebmcodegen
 
+#if defined(EBMCODEGEN_MULTI_BACKEND)
+// linked into multi-backend driver: register backend instead of defining main
+#if defined(EBMCODEGEN_MULTI_PRIVATE_MODULE)
+#define EBMCODEGEN_MULTI_PRIVATE_MODULE_VALUE true
+#else
+#define EBMCODEGEN_MULTI_PRIVATE_MODULE_VALUE false
+#endif
+#define EBMCODEGEN_MULTI_STRINGIFY_IMPL(x) #x
+#define EBMCODEGEN_MULTI_STRINGIFY(x) EBMCODEGEN_MULTI_STRINGIFY_IMPL(x)
+#define DEFINE_ENTRY(FlagType, OutputType)                                                                                                                                                                                    \
+    int Main(FlagType& flags, futils::cmdline::option::Context& ctx, futils::binary::writer& w, ebm::ExtendedBinaryModule& ebm, OutputType& output);                                                                          \
+    static ebmcodegen::multi::Registrar ebmcodegen_multi_registrar{ebmcodegen::multi::Backend{                                                                                                                                \
+        .name = EBMCODEGEN_MULTI_STRINGIFY(EBMCODEGEN_MULTI_BACKEND),                                                                                                                                                         \
+        .private_module = EBMCODEGEN_MULTI_PRIVATE_MODULE_VALUE,                                                                                                                                                             \
+        .run = [](int argc, char** argv, ebm::ExtendedBinaryModule& ebm, const ebmcodegen::multi::Target& target) -> int {                                                                                                     \
+            FlagType flags;                                                                                                                                                                                                   \
+            OutputType output;                                                                                                                                                                                                \
+            flags.program_name = argv[0];                                                                                                                                                                                     \
+            return futils::cmdline::templ::parse_or_err<std::string>(                                                                                                                                                         \
+                argc, argv, flags, [&](auto&& str, bool err) {  if(err){ futils::wrap::cerr_wrap()<< flags.program_name << ": " <<str; } else { futils::wrap::cout_wrap() << str;} },                                                                                                                                                             \
+                [&](FlagType& flags, futils::cmdline::option::Context& ctx) { return ebmcodegen::internal::run_multi(flags, output, ebm, target, [&](auto& w, auto& ebm, auto& output) { return Main(flags, ctx, w, ebm, output); }); }); \
+        },                                                                                                                                                                                                                    \
+    }};                                                                                                                                                                                                                       \
+    int Main(FlagType& flags, futils::cmdline::option::Context& ctx, futils::binary::writer& w, ebm::ExtendedBinaryModule& ebm, OutputType& output)
+#else
 #define DEFINE_ENTRY(FlagType, OutputType)                                                                                                                                                                                    \
     int Main(FlagType& flags, futils::cmdline::option::Context& ctx, futils::binary::writer& w, ebm::ExtendedBinaryModule& ebm, OutputType& output);                                                                          \
     int ebmcodegen_main(int argc, char** argv) {                                                                                                                                                                              \
@@ -226,6 +284,9 @@ namespace ebmcodegen {
     }                                                                                                                                                                                                                         \
     int Main(FlagType& flags, futils::cmdline::option::Context& ctx, futils::binary::writer& w, ebm::ExtendedBinaryModule& ebm, OutputType& output)
 
+#endif
+
+#if !defined(EBMCODEGEN_MULTI_BACKEND)
 int ebmcodegen_main(int argc, char** argv);
 #if defined(__EMSCRIPTEN__)
 extern "C" int EMSCRIPTEN_KEEPALIVE emscripten_main(const char* cmdline) {
@@ -237,3 +298,4 @@ int main(int argc, char** argv) {
     return ebmcodegen_main(argc, argv);
 }
 #endif
+#endif
@@ -0,0 +1,41 @@
+/*license*/
+#pragma once
+#include <ebm/extended_binary_module.hpp>
+#include <memory>
+#include <string_view>
+#include <vector>
+#include "ebmgen/mapping.hpp"
+
+// support for running several code generators in one process (ebm2multi).
+// a generator's main.cpp compiled with EBMCODEGEN_MULTI_BACKEND=<name> registers itself
+// here instead of defining main (see DEFINE_ENTRY in entry.hpp)
+namespace ebmcodegen::multi {
+    struct Target {
+        // output path without extension. the generator appends its first FILE_EXTENSIONS
+        std::string_view output_base;
+    };
+
+    struct Backend {
+        std::string_view name;
+        // the generator rewrites module in its pre_visitor (e.g. modify_keyword_identifier),
+        // so it must run on its own copy instead of the shared module
+        bool private_module = false;
+        int (*run)(int argc, char** argv, ebm::ExtendedBinaryModule& ebm, const Target& target) = nullptr;
+    };
+
+    inline std::vector<Backend>& registry() {
+        static std::vector<Backend> backends;
+        return backends;
+    }
+
+    struct Registrar {
+        Registrar(Backend backend) {
+            registry().push_back(backend);
+        }
+    };
+
+    // id maps of the shared module, set by the driver on each worker thread
+    // while it runs a generator which does not use private module.
+    // generated entry adopts them via adopt_shared_id_maps instead of building own
+    inline thread_local std::shared_ptr<const ebmgen::mapping::IdMaps> shared_id_maps;
+}  // namespace ebmcodegen::multi
@@ -398,6 +398,61 @@ namespace ebmcodegen::util {
         return std::nullopt;
     }
 
+    // layout of integer array lowered as BULK_INT_ARRAY (read/written as one contiguous region)
+    struct BulkIntArray {
+        ebm::TypeRef element_type;
+        size_t element_bytes = 0;  // 2, 4 or 8
+        bool is_signed = false;
+        ebm::Endian endian = ebm::Endian::big;  // big, little or native. unspec is resolved to big (network order)
+        BytesType container = BytesType::array;
+    };
+
+    std::optional<BulkIntArray> get_bulk_int_array(auto&& visitor, const ebm::IOData& io) {
+        auto lw = io.lowered_statement();
+        if (!lw || lw->lowering_type != ebm::LoweringIOType::BULK_INT_ARRAY) {
+            return std::nullopt;
+        }
+        const ebmgen::MappingTable& module_ = get_visitor(visitor).module_;
+        auto type = module_.get_type(io.data_type);
+        if (!type || (type->body.kind != ebm::TypeKind::ARRAY && type->body.kind != ebm::TypeKind::VECTOR)) {
+            return std::nullopt;
+        }
+        auto elem_type_ref = type->body.element_type();
+        if (!elem_type_ref) {
+            return std::nullopt;
+        }
+        auto elem_type = module_.get_type(*elem_type_ref);
+        if (!elem_type || !elem_type->body.size() || elem_type->body.size()->value() % 8 != 0) {
+            return std::nullopt;
+        }
+        BulkIntArray bulk;
+        bulk.element_type = *elem_type_ref;
+        bulk.element_bytes = elem_type->body.size()->value() / 8;
+        bulk.is_signed = io.attribute.sign();
+        if (io.attribute.endian() == ebm::Endian::little || io.attribute.endian() == ebm::Endian::native) {
+            bulk.endian = io.attribute.endian();
+        }
+        bulk.container = type->body.kind == ebm::TypeKind::VECTOR ? BytesType::vector : BytesType::array;
+        return bulk;
+    }
+
+    // whether any READ_DATA/WRITE_DATA of module is lowered as lowering_type.
+    // used to emit runtime helpers only when generated code refers them
+    bool has_lowered_io(auto&& ctx, ebm::LoweringIOType lowering_type) {
+        for (auto& stmt : ctx.module().module().statements) {
+            const ebm::IOData* io = stmt.body.read_data();
+            if (!io) {
+                io = stmt.body.write_data();
+            }
+            if (io) {
+                if (auto lw = io->lowered_statement(); lw && lw->lowering_type == lowering_type) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
     ebmgen::expected<std::string> get_default_value(auto&& visitor, ebm::TypeRef ref, const DefaultValueOption& option = {}) {
         const ebmgen::MappingTable& module_ = get_visitor(visitor).module_;
         MAYBE(type, module_.get_type(ref));
@@ -638,6 +693,18 @@ namespace ebmcodegen::util {
     }
 
     void modify_keyword_identifier(ebm::ExtendedBinaryModule& m, const std::unordered_set<std::string_view>& keyword_list, auto&& change_rule) {
+        // identifiers decoded by ebmgen::decode_zero_copy are views into input; only keywords are copied out to be rewritten
+        if (auto zero_copy = ebmgen::find_zero_copy_strings(m)) {
+            std::vector<std::uint64_t> keywords;
+            for (auto& ident : zero_copy->identifiers) {
+                if (keyword_list.contains(ident.data)) {
+                    keywords.push_back(get_id(ident.id));
+                }
+            }
+            for (auto id : keywords) {
+                ebmgen::promote_identifier(m, *zero_copy, id);
+            }
+        }
         for (auto& ident : m.identifiers) {
             if (keyword_list.contains(ident.body.data)) {
                 ident.body.data = change_rule(ident.body.data);
@@ -0,0 +1,194 @@
+/*license*/
+// benchmark of ReferenceRepository interning keys
+// loads ebm files and replays interning of every type/statement/expression body in id order,
+// keyed either by serialized body string (previous implementation) or by structural fingerprint
+// verified field by field on hit (current).
+// run once per --strategy so that peak RSS is measured per strategy;
+// alias_digest must be the same for both (same dedup decisions). prints result as json
+#define BRGEN_ALLOC_HOOK_DEFINE
+#include <test/testutil/alloc_hook.h>
+#include <test/testutil/peak_rss.h>
+#include <binary/reader.h>
+#include <file/file_view.h>
+#include <json/stringer.h>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../converter.hpp"
+
+enum class Strategy {
+    string,
+    fingerprint,
+};
+
+struct Replay {
+    std::uint64_t wall_ns = 0;
+    size_t bodies = 0;
+    size_t aliases = 0;
+    std::uint64_t alias_digest = 0;  // order dependent hash of (from, to) of every alias
+    size_t key_bytes = 0;            // bytes held by cache keys
+    size_t allocs = 0;
+    size_t alloc_bytes = 0;
+};
+
+struct FileResult {
+    std::string file;
+    bool ok = true;
+    std::string error;
+    Replay replay;
+};
+
+template <class Instance>
+bool replay(Strategy strategy, const std::vector<Instance>& instances, Replay& out) {
+    auto record_alias = [&](std::uint64_t from, std::uint64_t to) {
+        out.aliases++;
+        ebmgen::Fingerprint d{.lo = out.alias_digest, .hi = 0};
+        d.add(from);
+        d.add(to);
+        out.alias_digest = d.lo;
+    };
+    out.bodies += instances.size();
+    if (strategy == Strategy::string) {
+        std::unordered_map<std::string, std::uint64_t> cache;
+        for (auto& instance : instances) {
+            auto key = ebmgen::serialize(instance.body);
+            if (!key) {
+                return false;
+            }
+            if (auto it = cache.find(*key); it != cache.end()) {
+                record_alias(ebmgen::get_id(instance.id), it->second);
+                continue;
+            }
+            out.key_bytes += key->size();
+            cache.emplace(std::move(*key), ebmgen::get_id(instance.id));
+        }
+    }
+    else {
+        // hit is verified against the stored body as ReferenceRepository::add does
+        std::unordered_map<ebmgen::Fingerprint, const Instance*, ebmgen::FingerprintHash> cache;
+        for (auto& instance : instances) {
+            auto key = ebmgen::fingerprint(instance.body);
+            auto it = cache.find(key);
+            if (it != cache.end() && ebmgen::same_value(it->second->body, instance.body)) {
+                record_alias(ebmgen::get_id(instance.id), ebmgen::get_id(it->second->id));
+                continue;
+            }
+            if (it == cache.end()) {
+                out.key_bytes += sizeof(key) + sizeof(const Instance*);
+            }
+            cache[key] = &instance;
+        }
+    }
+    return true;
+}
+
+FileResult run_file(std::string_view input, Strategy strategy) {
+    FileResult result;
+    result.file = input;
+    futils::file::View view;
+    if (auto res = view.open(input); !res) {
+        result.ok = false;
+        result.error = res.error().error<std::string>();
+        return result;
+    }
+    futils::binary::reader r{view};
+    ebm::ExtendedBinaryModule ebm;
+    if (auto err = ebm.decode(r)) {
+        result.ok = false;
+        result.error = err.error<std::string>();
+        return result;
+    }
+    brgen::testutil::AllocScope scope;
+    auto begin = std::chrono::steady_clock::now();
+    bool ok = replay(strategy, ebm.types, result.replay) &&
+              replay(strategy, ebm.statements, result.replay) &&
+              replay(strategy, ebm.expressions, result.replay);
+    auto end = std::chrono::steady_clock::now();
+    auto count = scope.get();
+    result.replay.wall_ns = std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+    result.replay.allocs = count.count;
+    result.replay.alloc_bytes = count.bytes;
+    if (!ok) {
+        result.ok = false;
+        result.error = "failed to serialize body";
+    }
+    return result;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " [--strategy string|fingerprint] <file.ebm>...\n";
+        return 2;
+    }
+    Strategy strategy = Strategy::fingerprint;
+    std::vector<FileResult> results;
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if (arg == "--strategy") {
+            if (i + 1 >= argc) {
+                std::cerr << "--strategy requires string or fingerprint\n";
+                return 2;
+            }
+            std::string_view s = argv[++i];
+            if (s == "string") {
+                strategy = Strategy::string;
+            }
+            else if (s == "fingerprint") {
+                strategy = Strategy::fingerprint;
+            }
+            else {
+                std::cerr << "unknown strategy: " << s << "\n";
+                return 2;
+            }
+            continue;
+        }
+        results.push_back(run_file(arg, strategy));
+    }
+    Replay total;
+    futils::json::Stringer<> d;
+    {
+        auto field = d.object();
+        field("tool", "ebmgen_intern_bench");
+        field("strategy", strategy == Strategy::string ? "string" : "fingerprint");
+        field("files", [&] {
+            auto field = d.array();
+            for (auto& r : results) {
+                field([&] {
+                    auto field = d.object();
+                    field("file", r.file);
+                    field("ok", r.ok);
+                    if (!r.ok) {
+                        field("error", r.error);
+                    }
+                    field("bodies", r.replay.bodies);
+                    field("aliases", r.replay.aliases);
+                    field("alias_digest", r.replay.alias_digest);
+                    field("wall_ns", r.replay.wall_ns);
+                    field("key_bytes", r.replay.key_bytes);
+                    field("allocs", r.replay.allocs);
+                    field("alloc_bytes", r.replay.alloc_bytes);
+                });
+                total.bodies += r.replay.bodies;
+                total.aliases += r.replay.aliases;
+                total.wall_ns += r.replay.wall_ns;
+                total.key_bytes += r.replay.key_bytes;
+                total.allocs += r.replay.allocs;
+                total.alloc_bytes += r.replay.alloc_bytes;
+            }
+        });
+        field("total", [&] {
+            auto field = d.object();
+            field("bodies", total.bodies);
+            field("aliases", total.aliases);
+            field("wall_ns", total.wall_ns);
+            field("key_bytes", total.key_bytes);
+            field("allocs", total.allocs);
+            field("alloc_bytes", total.alloc_bytes);
+        });
+        field("peak_rss", brgen::testutil::peak_rss());
+    }
+    std::cout << d.out() << "\n";
+    return 0;
+}
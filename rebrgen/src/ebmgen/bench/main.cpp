@@ -0,0 +1,161 @@
+/*license*/
+// ebmgen part of pipeline benchmark (see $BRGEN_DIR/script/pipeline_bench.py)
+// converts json ast files (output of pipeline_bench --ast-out) to ebm,
+// timing each transform phase via Option::timer_cb, and prints result as json
+#define BRGEN_ALLOC_HOOK_DEFINE
+#include <test/testutil/alloc_hook.h>
+#include <test/testutil/peak_rss.h>
+#include <binary/writer.h>
+#include <file/file_stream.h>
+#include <json/stringer.h>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include "../convert.hpp"
+#include "../load_json.hpp"
+
+struct Phase {
+    std::string name;
+    std::uint64_t wall_ns = 0;
+    size_t allocs = 0;
+    size_t alloc_bytes = 0;
+};
+
+// records elapsed time and allocations between checkpoints
+struct Checkpoint {
+    std::vector<Phase>& phases;
+    std::chrono::steady_clock::time_point prev = std::chrono::steady_clock::now();
+    brgen::testutil::AllocScope scope;
+
+    void operator()(const char* name) {
+        auto now = std::chrono::steady_clock::now();
+        auto count = scope.get();
+        phases.push_back(Phase{
+            .name = name,
+            .wall_ns = std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(now - prev).count()),
+            .allocs = count.count,
+            .alloc_bytes = count.bytes,
+        });
+        prev = std::chrono::steady_clock::now();
+        scope = brgen::testutil::AllocScope{};
+    }
+};
+
+struct FileResult {
+    std::string file;
+    bool ok = true;
+    std::string error;
+    std::vector<Phase> phases;
+};
+
+FileResult run_file(std::string_view input, std::string_view ebm_out) {
+    FileResult result;
+    result.file = input;
+    Checkpoint cp{result.phases};
+    auto ast = ebmgen::load_json(input, nullptr);
+    if (!ast) {
+        result.ok = false;
+        result.error = ast.error().error<std::string>();
+        return result;
+    }
+    cp("load_json");
+    ebm::ExtendedBinaryModule ebm;
+    auto output = ebmgen::convert_ast_to_ebm(ast->first, std::move(ast->second), ebm, {.timer_cb = [&](const char* phase) {
+                                                                                          cp(phase);
+                                                                                      }});
+    if (!output) {
+        result.ok = false;
+        result.error = output.error().error<std::string>();
+        return result;
+    }
+    std::string buffer;
+    futils::binary::writer w{futils::binary::resizable_buffer_writer<std::string>(), &buffer};
+    if (auto err = ebm.encode(w)) {
+        result.ok = false;
+        result.error = err.error<std::string>();
+        return result;
+    }
+    cp("encode");
+    if (!ebm_out.empty()) {
+        auto file = futils::file::File::create(ebm_out);
+        if (!file) {
+            result.ok = false;
+            result.error = file.error().error<std::string>();
+            return result;
+        }
+        futils::file::FileStream<std::string> fs{*file};
+        futils::binary::writer fw{fs.get_direct_write_handler(), &fs};
+        fw.write(buffer);
+    }
+    return result;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <ast.json> [--ebm-out <file.ebm>] [<ast.json> [--ebm-out <file.ebm>]]...\n";
+        return 2;
+    }
+    std::vector<FileResult> results;
+    for (int i = 1; i < argc; i++) {
+        std::string_view input = argv[i];
+        std::string_view ebm_out;
+        if (i + 1 < argc && std::string_view(argv[i + 1]) == "--ebm-out") {
+            if (i + 2 >= argc) {
+                std::cerr << "--ebm-out requires file name\n";
+                return 2;
+            }
+            ebm_out = argv[i + 2];
+            i += 2;
+        }
+        results.push_back(run_file(input, ebm_out));
+    }
+    std::map<std::string, Phase> total;
+    futils::json::Stringer<> d;
+    {
+        auto field = d.object();
+        field("tool", "ebmgen_bench");
+        field("files", [&] {
+            auto field = d.array();
+            for (auto& r : results) {
+                field([&] {
+                    auto field = d.object();
+                    field("file", r.file);
+                    field("ok", r.ok);
+                    if (!r.ok) {
+                        field("error", r.error);
+                    }
+                    field("phases", [&] {
+                        auto field = d.array();
+                        for (auto& ph : r.phases) {
+                            auto& t = total[ph.name];
+                            t.wall_ns += ph.wall_ns;
+                            t.allocs += ph.allocs;
+                            t.alloc_bytes += ph.alloc_bytes;
+                            field([&] {
+                                auto field = d.object();
+                                field("name", ph.name);
+                                field("wall_ns", ph.wall_ns);
+                                field("allocs", ph.allocs);
+                                field("alloc_bytes", ph.alloc_bytes);
+                            });
+                        }
+                    });
+                });
+            }
+        });
+        field("total", [&] {
+            auto field = d.object();
+            for (auto& [name, t] : total) {
+                field(name, [&] {
+                    auto field = d.object();
+                    field("wall_ns", t.wall_ns);
+                    field("allocs", t.allocs);
+                    field("alloc_bytes", t.alloc_bytes);
+                });
+            }
+        });
+        field("peak_rss", brgen::testutil::peak_rss());
+    }
+    std::cout << d.out() << "\n";
+    return 0;
+}
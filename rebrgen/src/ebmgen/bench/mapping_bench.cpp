@@ -0,0 +1,197 @@
+/*license*/
+// microbenchmark of ebmgen::MappingTable
+// loads ebm files, then measures startup (decode + build_maps) with owning and zero copy decode,
+// building id maps, resolving every id through get_object/get_statement/get_expression/get_type
+// and building inverse refs.
+// prints result as json
+#include <binary/reader.h>
+#include <file/file_view.h>
+#include <json/stringer.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "../mapping.hpp"
+
+struct Measure {
+    std::string name;
+    std::uint64_t wall_ns = 0;
+    size_t operations = 0;
+};
+
+struct FileResult {
+    std::string file;
+    bool ok = true;
+    std::string error;
+    size_t max_id = 0;
+    std::vector<Measure> measures;
+};
+
+template <class F>
+Measure measure(const char* name, size_t operations, F&& f) {
+    auto begin = std::chrono::steady_clock::now();
+    f();
+    auto end = std::chrono::steady_clock::now();
+    return Measure{
+        .name = name,
+        .wall_ns = std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()),
+        .operations = operations,
+    };
+}
+
+FileResult run_file(std::string_view input, size_t rounds) {
+    FileResult result;
+    result.file = input;
+    futils::file::View view;
+    if (auto res = view.open(input); !res) {
+        result.ok = false;
+        result.error = res.error().error<std::string>();
+        return result;
+    }
+    // startup of code generators: owning decode against decode_zero_copy, each followed by build_maps
+    // (see docs/decisions/0046-codegen-input-zero-copy.md)
+    ::futils::error::Error<> decode_err;
+    ebm::ExtendedBinaryModule zero_copy_ebm;
+    ebmgen::ZeroCopyStrings strings;
+    result.measures.push_back(measure("startup_zero_copy", 1, [&] {
+        futils::binary::reader r{view};
+        decode_err = ebmgen::decode_zero_copy(r, zero_copy_ebm, strings);
+        if (!decode_err) {
+            ebmgen::MappingTable table{zero_copy_ebm};
+        }
+    }));
+    ebmgen::attach_zero_copy_strings(zero_copy_ebm, nullptr);
+    if (decode_err) {
+        result.ok = false;
+        result.error = decode_err.error<std::string>();
+        return result;
+    }
+    ebm::ExtendedBinaryModule ebm;
+    result.measures.push_back(measure("startup_owning", 1, [&] {
+        futils::binary::reader r{view};
+        decode_err = ebm.decode(r);
+        if (!decode_err) {
+            ebmgen::MappingTable table{ebm};
+        }
+    }));
+    if (decode_err) {
+        result.ok = false;
+        result.error = decode_err.error<std::string>();
+        return result;
+    }
+    result.max_id = get_id(ebm.max_id);
+    ebmgen::MappingTable table{ebm, ebmgen::lazy_init};
+    result.measures.push_back(measure("build_maps", 1, [&] {
+        table.build_maps(ebmgen::mapping::BuildMapOption::NONE);
+    }));
+
+    // same ids in sequential and shuffled order. shuffled order is closer to how code generators follow refs
+    std::vector<std::uint64_t> ids(result.max_id);
+    for (size_t i = 0; i < ids.size(); i++) {
+        ids[i] = i + 1;
+    }
+    auto shuffled = ids;
+    std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937_64{0});
+
+    size_t found = 0;  // keeps lookups from being optimized out
+    auto lookup_all = [&](const std::vector<std::uint64_t>& order) {
+        for (size_t n = 0; n < rounds; n++) {
+            for (auto id : order) {
+                auto obj = table.get_object(ebm::AnyRef{id});
+                found += obj.index() != 0;
+            }
+        }
+    };
+    result.measures.push_back(measure("get_object_sequential", ids.size() * rounds, [&] {
+        lookup_all(ids);
+    }));
+    result.measures.push_back(measure("get_object_shuffled", shuffled.size() * rounds, [&] {
+        lookup_all(shuffled);
+    }));
+    result.measures.push_back(measure("get_typed_shuffled", shuffled.size() * rounds * 3, [&] {
+        for (size_t n = 0; n < rounds; n++) {
+            for (auto id : shuffled) {
+                found += table.get_statement(ebm::StatementRef{id}) != nullptr;
+                found += table.get_expression(ebm::ExpressionRef{id}) != nullptr;
+                found += table.get_type(ebm::TypeRef{id}) != nullptr;
+            }
+        }
+    }));
+
+    ebmgen::MappingTable inverse{ebm, ebmgen::lazy_init};
+    inverse.build_maps(ebmgen::mapping::BuildMapOption::BUILD_MAP_USE_INVERSE_REF);
+    result.measures.push_back(measure("build_inverse_refs", 1, [&] {
+        found += inverse.get_inverse_ref(ebm::AnyRef{1}).has_value();
+    }));
+    result.measures.push_back(measure("get_inverse_ref_shuffled", shuffled.size() * rounds, [&] {
+        for (size_t n = 0; n < rounds; n++) {
+            for (auto id : shuffled) {
+                if (auto refs = inverse.get_inverse_ref(ebm::AnyRef{id})) {
+                    found += refs->size();
+                }
+            }
+        }
+    }));
+    if (found == 0) {
+        result.ok = false;
+        result.error = "no object found";
+    }
+    return result;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " [--rounds <n>] <file.ebm>...\n";
+        return 2;
+    }
+    size_t rounds = 10;
+    std::vector<FileResult> results;
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if (arg == "--rounds") {
+            if (i + 1 >= argc) {
+                std::cerr << "--rounds requires number\n";
+                return 2;
+            }
+            rounds = std::stoull(argv[++i]);
+            continue;
+        }
+        results.push_back(run_file(arg, rounds));
+    }
+    futils::json::Stringer<> d;
+    {
+        auto field = d.object();
+        field("tool", "ebmgen_mapping_bench");
+        field("rounds", rounds);
+        field("files", [&] {
+            auto field = d.array();
+            for (auto& r : results) {
+                field([&] {
+                    auto field = d.object();
+                    field("file", r.file);
+                    field("ok", r.ok);
+                    if (!r.ok) {
+                        field("error", r.error);
+                    }
+                    field("max_id", r.max_id);
+                    field("measures", [&] {
+                        auto field = d.array();
+                        for (auto& m : r.measures) {
+                            field([&] {
+                                auto field = d.object();
+                                field("name", m.name);
+                                field("wall_ns", m.wall_ns);
+                                field("operations", m.operations);
+                                field("ns_per_op", m.operations ? double(m.wall_ns) / m.operations : 0.0);
+                            });
+                        }
+                    });
+                });
+            }
+        });
+    }
+    std::cout << d.out() << "\n";
+    return 0;
+}
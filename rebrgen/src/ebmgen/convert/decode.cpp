@@ -421,8 +421,16 @@ namespace ebmgen {
             EBM_COUNTER_LOOP_START(counter);
             MAYBE(decode_info, underlying_decoder(aty->length_value.has_value() ? std::make_optional(counter) : std::nullopt));
             EBM_COUNTER_LOOP_END(lowered_stmt, counter, *length, decode_info);
+            auto lowering_type = ebm::LoweringIOType::ARRAY_FOR_EACH;
+            MAYBE(bulk, get_bulk_int_array_attribute(ctx, aty->element_type));
+            if (bulk) {
+                // whole region is read at once; lowered_stmt remains as element-wise fallback
+                io_desc.attribute.endian(bulk->endian());
+                io_desc.attribute.sign(bulk->sign());
+                lowering_type = ebm::LoweringIOType::BULK_INT_ARRAY;
+            }
             io_desc.attribute.has_lowered_statement(true);
-            io_desc.lowered_statement(make_lowered_statement(ebm::LoweringIOType::ARRAY_FOR_EACH, lowered_stmt));
+            io_desc.lowered_statement(make_lowered_statement(lowering_type, lowered_stmt));
         }
         else {
             return unexpect_error("Neither length nor cond_loop is set, which is not allowed; maybe BUG");
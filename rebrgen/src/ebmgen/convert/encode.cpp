@@ -296,6 +296,20 @@ namespace ebmgen {
         EBMA_ADD_STATEMENT(encode_stmt, std::move(encode_info));
         EBM_COUNTER_LOOP_END(loop_stmt, counter, length, encode_stmt);
 
+        MAYBE(bulk, get_bulk_int_array_attribute(ctx, aty->element_type));
+        if (bulk) {
+            // whole region is written at once; loop_stmt remains as element-wise fallback.
+            // LENGTH_CHECK is needed by both, so it is emitted as a pre-statement like byte arrays
+            if (!is_nil(assert_)) {
+                pre_statements.push_back(assert_);
+            }
+            io_desc.attribute.endian(bulk->endian());
+            io_desc.attribute.sign(bulk->sign());
+            io_desc.attribute.has_lowered_statement(true);
+            io_desc.lowered_statement(make_lowered_statement(ebm::LoweringIOType::BULK_INT_ARRAY, loop_stmt));
+            return {};
+        }
+
         ebm::Block block;
         block.container.reserve(2 + (!is_nil(assert_)));
         if (!is_nil(assert_)) {
@@ -457,7 +471,7 @@ namespace ebmgen {
         assert(io_desc.size.unit != ebm::SizeUnit::UNKNOWN);
         if (!pre_statements.empty()) {
             // Wrap pre-statements (e.g. LENGTH_CHECK) + WRITE_DATA in a BLOCK.
-            // This occurs for byte arrays with expression-length validation.
+            // This occurs for byte arrays and BULK_INT_ARRAY with expression-length validation.
             EBM_WRITE_DATA(write_ref, io_desc);
             ebm::Block block;
             block.container.reserve(pre_statements.size() + 1);
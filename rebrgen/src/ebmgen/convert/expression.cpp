@@ -268,6 +268,24 @@ namespace ebmgen {
         return ref;
     }
 
+    expected<std::optional<ebm::IOAttribute>> get_bulk_int_array_attribute(ConverterContext& ctx, const std::shared_ptr<ast::Type>& element_type) {
+        if (auto ident = ast::as<ast::IdentType>(element_type)) {
+            return get_bulk_int_array_attribute(ctx, ident->base.lock());
+        }
+        auto ity = ast::as<ast::IntType>(element_type);
+        if (!ity || !ity->bit_size) {
+            return std::nullopt;
+        }
+        if (*ity->bit_size != 16 && *ity->bit_size != 32 && *ity->bit_size != 64) {
+            return std::nullopt;
+        }
+        MAYBE(attr, ctx.state().get_io_attribute(ebm::Endian(ity->endian), ity->is_signed));
+        if (attr.endian() == ebm::Endian::dynamic) {
+            return std::nullopt;  // byte order is decided per element at runtime
+        }
+        return attr;
+    }
+
     expected<ebm::ExpressionRef> get_alignment_requirement(ConverterContext& ctx, std::uint64_t alignment_bytes, ebm::StreamType type, ebm::StatementRef io_ref) {
         if (alignment_bytes == 0) {
             return unexpect_error("0 is not valid alignment");
@@ -3,7 +3,9 @@
 #include "common.hpp"
 #include <core/ast/ast.h>
 #include <ebm/extended_binary_module.hpp>
+#include <bit>
 #include <memory>
+#include <optional>
 #include <unordered_map>
 #include <unordered_set>
 #include "core/ast/node/ast_enum.h"
@@ -89,6 +91,165 @@ namespace ebmgen {
         return buffer;
     }
 
+    // 128-bit structural fingerprint of a body.
+    // two independently mixed 64-bit lanes. equal fingerprint only selects a candidate;
+    // ReferenceRepository::add compares the bodies with same_value before reusing the id
+    struct Fingerprint {
+        std::uint64_t lo = 0xcbf29ce484222325ull;
+        std::uint64_t hi = 0x9e3779b97f4a7c15ull;
+
+        constexpr void add(std::uint64_t v) {
+            lo = (lo ^ v) * 0x100000001b3ull;
+            lo ^= lo >> 29;
+            hi = std::rotl(hi ^ (v * 0xbf58476d1ce4e5b9ull), 27) * 0x94d049bb133111ebull;
+        }
+
+        constexpr void add_bytes(std::string_view data) {
+            add(data.size());
+            size_t i = 0;
+            for (; i + 8 <= data.size(); i += 8) {
+                std::uint64_t word = 0;
+                for (size_t j = 0; j < 8; j++) {
+                    word |= std::uint64_t(std::uint8_t(data[i + j])) << (j * 8);
+                }
+                add(word);
+            }
+            std::uint64_t tail = 0;
+            for (size_t j = 0; i + j < data.size(); j++) {
+                tail |= std::uint64_t(std::uint8_t(data[i + j])) << (j * 8);
+            }
+            add(tail);
+        }
+
+        friend constexpr bool operator==(const Fingerprint&, const Fingerprint&) = default;
+    };
+
+    struct FingerprintHash {
+        size_t operator()(const Fingerprint& f) const {
+            return size_t(f.lo ^ (f.hi * 0x9e3779b97f4a7c15ull));
+        }
+    };
+
+    // hash child refs and scalar fields directly via visit() (same field walk as JSONPrinter::print_value).
+    // children are already interned, so a ref id stands for the whole child.
+    // inactive union members are nullptr, so only the variant selected by kind contributes
+    template <typename T>
+    constexpr void fingerprint_value(Fingerprint& fp, const T& value) {
+        if constexpr (std::is_array_v<T>) {
+            fp.add_bytes(std::string_view(value));
+        }
+        else if constexpr (std::is_pointer_v<T>) {
+            fp.add(value != nullptr);
+            if (value) {
+                if constexpr (std::is_same_v<std::remove_cv_t<std::remove_pointer_t<T>>, char>) {
+                    fp.add_bytes(value);
+                }
+                else {
+                    fingerprint_value(fp, *value);
+                }
+            }
+        }
+        else if constexpr (std::is_enum_v<T>) {
+            fp.add(std::uint64_t(value));
+        }
+        else if constexpr (std::is_same_v<T, bool>) {
+            fp.add(value);
+        }
+        else if constexpr (futils::helper::is_template_instance_of<T, std::vector>) {
+            fp.add(value.size());
+            for (const auto& elem : value) {
+                fingerprint_value(fp, elem);
+            }
+        }
+        else if constexpr (AnyRef<T>) {
+            fp.add(get_id(value));
+        }
+        else if constexpr (std::is_same_v<T, std::string>) {
+            fp.add_bytes(value);
+        }
+        else if constexpr (has_visit<T, DummyFn>) {
+            value.visit([&](auto&&, const char*, auto&& field) {
+                fingerprint_value(fp, field);
+            });
+        }
+        else if constexpr (std::is_integral_v<T>) {
+            fp.add(std::uint64_t(value));
+        }
+        else {
+            static_assert(std::is_same_v<T, void>, "unexpected field type");
+        }
+    }
+
+    template <typename T>
+    constexpr Fingerprint fingerprint(const T& body) {
+        Fingerprint fp;
+        fingerprint_value(fp, body);
+        return fp;
+    }
+
+    // field by field equality over the same walk as fingerprint_value
+    template <typename T>
+    constexpr bool same_value(const T& a, const T& b) {
+        if constexpr (std::is_array_v<T>) {
+            return std::string_view(a) == std::string_view(b);
+        }
+        else if constexpr (std::is_pointer_v<T>) {
+            if (!a || !b) {
+                return a == b;
+            }
+            if constexpr (std::is_same_v<std::remove_cv_t<std::remove_pointer_t<T>>, char>) {
+                return std::string_view(a) == std::string_view(b);
+            }
+            else {
+                return same_value(*a, *b);
+            }
+        }
+        else if constexpr (std::is_enum_v<T> || std::is_same_v<T, bool> || std::is_same_v<T, std::string>) {
+            return a == b;
+        }
+        else if constexpr (futils::helper::is_template_instance_of<T, std::vector>) {
+            if (a.size() != b.size()) {
+                return false;
+            }
+            for (size_t i = 0; i < a.size(); i++) {
+                if (!same_value(a[i], b[i])) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        else if constexpr (AnyRef<T>) {
+            return get_id(a) == get_id(b);
+        }
+        else if constexpr (has_visit<T, DummyFn>) {
+            // visit() walks one object; pair i-th field of a with i-th field of b
+            bool same = true;
+            size_t i = 0;
+            a.visit([&](auto&&, const char*, auto&& field_a) {
+                if (!same) {
+                    return;
+                }
+                size_t j = 0;
+                b.visit([&](auto&&, const char*, auto&& field_b) {
+                    if constexpr (std::is_same_v<std::decay_t<decltype(field_a)>, std::decay_t<decltype(field_b)>>) {
+                        if (i == j) {
+                            same = same_value(field_a, field_b);
+                        }
+                    }
+                    j++;
+                });
+                i++;
+            });
+            return same;
+        }
+        else if constexpr (std::is_integral_v<T>) {
+            return a == b;
+        }
+        else {
+            static_assert(std::is_same_v<T, void>, "unexpected field type");
+        }
+    }
+
     template <AnyRef ID, class Instance, class Body, ebm::AliasHint hint>
     struct ReferenceRepository {
         using RelocPtr = RelocPtr<ReferenceRepository, ID, Instance>;
@@ -112,41 +273,51 @@ namespace ebmgen {
             return id;
         }
 
+        // id of registered body equal to body, if any.
+        // fingerprint hit is verified against the stored body so that a collision never merges different bodies.
+        // stored body rewritten after registration does not match anymore; the new body then takes over the entry
+        std::optional<ID> find_same(const Fingerprint& fp, const Body& body) {
+            auto it = cache.find(fp);
+            if (it == cache.end()) {
+                return std::nullopt;
+            }
+            auto index = id_index_map.find(get_id(it->second));
+            if (index == id_index_map.end() || index->second >= instances.size() ||
+                !same_value(instances[index->second].body, body)) {
+                return std::nullopt;
+            }
+            return it->second;
+        }
+
        public:
         expected<ID> add(ID id, Body&& body) {
-            auto serialized = serialize(body);
-            if (!serialized) {
-                return unexpect_error(std::move(serialized.error()));
-            }
-            if (auto it = cache.find(*serialized); it != cache.end()) {
-                debug_id_inspect(get_id(it->second), DebugIDInspect::alias_creation_to);
+            auto fp = fingerprint(body);
+            if (auto same = find_same(fp, body)) {
+                debug_id_inspect(get_id(*same), DebugIDInspect::alias_creation_to);
                 debug_id_inspect(get_id(id), DebugIDInspect::alias_creation_from);
                 // add alias if the same body is already present
                 aliases.push_back(ebm::RefAlias{
                     .hint = hint,
                     .from = to_any_ref(id),
-                    .to = to_any_ref(it->second),
+                    .to = to_any_ref(*same),
                 });
-                alias_id_map[get_id(id)] = get_id(it->second);
+                alias_id_map[get_id(id)] = get_id(*same);
                 return id;
             }
-            cache[*serialized] = id;
+            cache[fp] = id;
             return add_internal(id, std::move(body));
         }
 
         expected<ID> add(ReferenceSource& source, Body&& body) {
-            auto serialized = serialize(body);
-            if (!serialized) {
-                return unexpect_error(std::move(serialized.error()));
-            }
-            if (auto it = cache.find(*serialized); it != cache.end()) {
-                return it->second;
+            auto fp = fingerprint(body);
+            if (auto same = find_same(fp, body)) {
+                return *same;
             }
             auto id = new_id(source);
             if (!id) {
                 return unexpect_error(std::move(id.error()));
             }
-            cache[*serialized] = id.value();
+            cache[fp] = id.value();
             return add_internal(*id, std::move(body));
         }
 
@@ -201,8 +372,9 @@ namespace ebmgen {
 
         void recalculate_cache() {
             cache.clear();
+            cache.reserve(instances.size());
             for (const auto& instance : instances) {
-                cache[serialize(instance.body).value()] = instance.id;
+                cache[fingerprint(instance.body)] = instance.id;
             }
         }
 
@@ -226,7 +398,9 @@ namespace ebmgen {
         }
 
        private:
-        std::unordered_map<std::string, ID> cache;
+        // fingerprint of body at add() time -> id. like the previous serialized-body key,
+        // the key is captured when the body is registered and is not affected by later rewrites of the body
+        std::unordered_map<Fingerprint, ID, FingerprintHash> cache;
         std::unordered_map<uint64_t, size_t> id_index_map;
         std::vector<Instance> instances;
         std::vector<ebm::RefAlias>& aliases;  // for aliasing references
@@ -877,6 +1051,10 @@ namespace ebmgen {
 
     expected<ebm::ExpressionRef> get_alignment_requirement(ConverterContext& ctx, std::uint64_t alignment_bytes, ebm::StreamType type, ebm::StatementRef io_ref);
 
+    // returns byte order and sign of element if array of element_type can be lowered as BULK_INT_ARRAY
+    // (byte aligned 16/32/64 bit integer with statically known endian), otherwise nullopt
+    expected<std::optional<ebm::IOAttribute>> get_bulk_int_array_attribute(ConverterContext& ctx, const std::shared_ptr<ast::Type>& element_type);
+
     struct EncoderConverter {
         ConverterContext& ctx;
         expected<ebm::StatementBody> encode_field_type(const std::shared_ptr<ast::Type>& typ, ebm::ExpressionRef base_ref, const std::shared_ptr<ast::Field>& field, ebm::StatementRef field_ref);
@@ -4159,6 +4159,10 @@ namespace ebm {
                 obj = LoweringIOType::SCAN_UNTIL;
                 return true;
             }
+            if (s == "BULK_INT_ARRAY") {
+                obj = LoweringIOType::BULK_INT_ARRAY;
+                return true;
+            }
             return false;
         }
         return false;
@@ -2,6 +2,7 @@
 #include <file/file_view.h>
 #include <core/ast/file.h>
 #include <core/ast/json.h>
+#include <core/ast/binary.h>
 #include <json/parser.h>
 #include <json/constructor.h>
 #include <string_view>
@@ -60,7 +61,24 @@ namespace ebmgen {
         }
     };
 
+    expected<std::pair<std::shared_ptr<brgen::ast::Node>, std::vector<std::string>>> load_binary_ast_file(futils::view::rvec input, std::function<void(const char*)> timer_cb) {
+        if (timer_cb) timer_cb("binary ast file open");
+        brgen::ast::BinaryConverter c;
+        auto res = c.decode(std::string_view(reinterpret_cast<const char*>(input.data()), input.size()));
+        if (!res) {
+            return unexpect_error("cannot decode binary ast file: {}", res.error().locations[0].msg);
+        }
+        if (!res->ast) {
+            return unexpect_error("cannot decode binary ast file");
+        }
+        if (timer_cb) timer_cb("binary ast file decode");
+        return std::pair{std::move(res->ast), std::move(res->files)};
+    }
+
     expected<std::pair<std::shared_ptr<brgen::ast::Node>, std::vector<std::string>>> load_json_file(futils::view::rvec input, std::function<void(const char*)> timer_cb) {
+        if (brgen::ast::is_binary_ast(std::string_view(reinterpret_cast<const char*>(input.data()), input.size()))) {
+            return load_binary_ast_file(input, timer_cb);
+        }
         if (timer_cb) timer_cb("json file open");
         futils::json::BytesLikeReader<futils::view::rvec> r{input};
         r.size = r.bytes.size();
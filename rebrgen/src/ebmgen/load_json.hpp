@@ -8,9 +8,10 @@
 #include "converter.hpp"
 
 namespace ebmgen {
-    // Function to load brgen AST from JSON
+    // Function to load brgen AST from JSON (binary ast is also accepted, detected by magic)
     expected<std::pair<std::shared_ptr<brgen::ast::Node>, std::vector<std::string>>> load_json(std::string_view input, std::function<void(const char*)> timer_cb);
     expected<std::pair<std::shared_ptr<brgen::ast::Node>, std::vector<std::string>>> load_json_file(futils::view::rvec input, std::function<void(const char*)> timer_cb);
+    expected<std::pair<std::shared_ptr<brgen::ast::Node>, std::vector<std::string>>> load_binary_ast_file(futils::view::rvec input, std::function<void(const char*)> timer_cb);
     expected<ebm::ExtendedBinaryModule> load_json_ebm(std::string_view input);
     expected<ebm::ExtendedBinaryModule> decode_json_ebm(futils::view::rvec input);
 
@@ -54,6 +54,7 @@ enum class InputFormat {
     AUTO,
     BGN,  // with libs2j
     JSON_AST,
+    BINARY_AST,  // binary ast from src2json --binary-ast
     JSON_EBM,  // direct EBM JSON format, for testing
     EBM,
 };
@@ -93,11 +94,12 @@ struct Flags : futils::cmdline::templ::HelpOption {
         libs2j_path = env_libs2j_path;
         bind_help(ctx);
         ctx.VarString<true>(&input, "input,i", "input file", "FILE");
-        ctx.VarMap(&input_format, "input-format", "input format (default: decided by file extension)", "{json-ast,ebm,bgn,json-ebm}",
+        ctx.VarMap(&input_format, "input-format", "input format (default: decided by file extension)", "{json-ast,binary-ast,ebm,bgn,json-ebm}",
                    std::map<std::string, InputFormat>{
                        {"bgn", InputFormat::BGN},
                        {"ebm", InputFormat::EBM},
                        {"json-ast", InputFormat::JSON_AST},
+                       {"binary-ast", InputFormat::BINARY_AST},
                        {"json-ebm", InputFormat::JSON_EBM},
                    });
         ctx.VarString<true>(&output, "output,o", "output file (if -, write to stdout)", "FILE");
@@ -187,6 +189,9 @@ int Main(Flags& flags, futils::cmdline::option::Context& ctx) {
         else if (flags.input.ends_with(".json")) {
             flags.input_format = InputFormat::JSON_AST;
         }
+        else if (flags.input.ends_with(".bast")) {
+            flags.input_format = InputFormat::BINARY_AST;
+        }
         else {
             cerr << "Cannot detect input format from file extension. Please specify --input-format\n";
             return 1;
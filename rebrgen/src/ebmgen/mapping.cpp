@@ -2,9 +2,131 @@
 #include "mapping.hpp"
 #include "common.hpp"
 #include "ebm/extended_binary_module.hpp"
+#include <algorithm>
+#include <mutex>
 
 namespace ebmgen {
     bool verbose_error;
+
+    template <class Ref>
+    static ::futils::error::Error<> decode_zero_copy_section(::futils::binary::reader& r, ebm::Varint& len, std::vector<ZeroCopyString<Ref>>& section) {
+        if (auto err = len.decode(r)) {
+            return err;
+        }
+        section.clear();
+        for (size_t i = 0; i < len.value(); ++i) {
+            ZeroCopyString<Ref> entry;
+            if (auto err = entry.id.decode(r)) {
+                return err;
+            }
+            ebm::Varint length;
+            if (auto err = length.decode(r)) {
+                return err;
+            }
+            ::futils::view::rvec data;
+            if (!r.read_direct(data, length.value())) {
+                return ::futils::error::Error<>("decode: String::data: read byte array failed", ::futils::error::Category::lib);
+            }
+            entry.data = std::string_view(reinterpret_cast<const char*>(data.data()), data.size());
+            section.push_back(entry);
+        }
+        return ::futils::error::Error<>();
+    }
+
+    template <class T>
+    static ::futils::error::Error<> decode_section(::futils::binary::reader& r, ebm::Varint& len, std::vector<T>& section) {
+        if (auto err = len.decode(r)) {
+            return err;
+        }
+        section.clear();
+        for (size_t i = 0; i < len.value(); ++i) {
+            T item;
+            if (auto err = item.decode(r)) {
+                return err;
+            }
+            section.push_back(std::move(item));
+        }
+        return ::futils::error::Error<>();
+    }
+
+    // same layout as ExtendedBinaryModule::decode. only identifiers and strings sections differ
+    ::futils::error::Error<> decode_zero_copy(::futils::binary::reader& r, ebm::ExtendedBinaryModule& module, ZeroCopyStrings& strings) {
+        ::futils::view::rvec magic;
+        if (!r.read_direct(magic, 4)) {
+            return ::futils::error::Error<>("decode: ExtendedBinaryModule::magic: read string failed", ::futils::error::Category::lib);
+        }
+        if (magic != ::futils::view::rvec("EBMG", 4)) {
+            return ::futils::error::Error<>("decode: ExtendedBinaryModule::magic: read string failed; not match to \"EBMG\"", ::futils::error::Category::lib);
+        }
+        if (!::futils::binary::read_num(r, module.version, true)) {
+            return ::futils::error::Error<>("decode: ExtendedBinaryModule::version: read int failed", ::futils::error::Category::lib);
+        }
+        if (auto err = module.max_id.decode(r)) {
+            return err;
+        }
+        if (auto err = decode_zero_copy_section(r, module.identifiers_len, strings.identifiers)) {
+            return err;
+        }
+        if (auto err = decode_zero_copy_section(r, module.strings_len, strings.strings)) {
+            return err;
+        }
+        module.identifiers.clear();
+        module.strings.clear();
+        if (auto err = decode_section(r, module.types_len, module.types)) {
+            return err;
+        }
+        if (auto err = decode_section(r, module.statements_len, module.statements)) {
+            return err;
+        }
+        if (auto err = decode_section(r, module.expressions_len, module.expressions)) {
+            return err;
+        }
+        if (auto err = decode_section(r, module.aliases_len, module.aliases)) {
+            return err;
+        }
+        if (auto err = module.debug_info.decode(r)) {
+            return err;
+        }
+        attach_zero_copy_strings(module, &strings);
+        return ::futils::error::Error<>();
+    }
+
+    // few modules are attached at once (one per input, plus private copies in ebm2multi)
+    static std::mutex zero_copy_mutex;
+    static std::vector<std::pair<const ebm::ExtendedBinaryModule*, ZeroCopyStrings*>> zero_copy_modules;
+
+    void attach_zero_copy_strings(const ebm::ExtendedBinaryModule& module, ZeroCopyStrings* strings) {
+        std::lock_guard lock(zero_copy_mutex);
+        std::erase_if(zero_copy_modules, [&](auto& entry) { return entry.first == &module; });
+        if (strings) {
+            zero_copy_modules.push_back({&module, strings});
+        }
+    }
+
+    ZeroCopyStrings* find_zero_copy_strings(const ebm::ExtendedBinaryModule& module) {
+        std::lock_guard lock(zero_copy_mutex);
+        for (auto& entry : zero_copy_modules) {
+            if (entry.first == &module) {
+                return entry.second;
+            }
+        }
+        return nullptr;
+    }
+
+    ebm::Identifier* promote_identifier(ebm::ExtendedBinaryModule& module, ZeroCopyStrings& strings, std::uint64_t id) {
+        auto found = std::find_if(strings.identifiers.begin(), strings.identifiers.end(), [&](auto& entry) {
+            return get_id(entry.id) == id;
+        });
+        if (found == strings.identifiers.end()) {
+            return nullptr;
+        }
+        auto& ident = module.identifiers.emplace_back();
+        ident.id = found->id;
+        ident.body.length = varint(found->data.size()).value();
+        ident.body.data = std::string(found->data);
+        strings.identifiers.erase(found);
+        return &ident;
+    }
     // Builds maps from vector data for faster access
     void MappingTable::build_maps(mapping::BuildMapOption options) {
         if (options & mapping::BuildMapOption::BUILD_MAP_SKIP_IF_UNCHANGED) {
@@ -13,96 +135,233 @@ namespace ebmgen {
             }
         }
 
-        auto map_to = [&](auto& map, const auto& vec, ebm::AliasHint hint) {
+        // ids are dense up to max_id. max_id is not known for tables viewing a module under construction
+        std::uint64_t max_id = get_id(module_.max_id);
+        auto max_of = [&](const auto& vec) {
             for (const auto& item : vec) {
-                map[get_id(item.id)] = &item;
-                if (!(options & mapping::BuildMapOption::BUILD_MAP_USE_INVERSE_REF)) {
-                    continue;
-                }
-                item.body.visit([&](auto&& visitor, const char* name, auto&& val, std::optional<size_t> index = std::nullopt) -> void {
-                    if constexpr (AnyRef<decltype(val)>) {
-                        if (!is_nil(val)) {
-                            inverse_refs_[get_id(val)].push_back(InverseRef{
-                                .name = name,
-                                .index = index,
-                                .ref = to_any_ref(item.id),
-                                .hint = hint,
-                            });
-                        }
-                    }
-                    else if constexpr (is_container<decltype(val)>) {
-                        for (size_t i = 0; i < val.container.size(); ++i) {
-                            visitor(visitor, name, val.container[i], i);
-                        }
-                    }
-                    else
-                        VISITOR_RECURSE(visitor, name, val)
-                });
+                max_id = (std::max)(max_id, get_id(item.id));
+            }
+        };
+        max_of(module_.identifiers);
+        max_of(module_.strings);
+        if (module_.zero_copy) {
+            max_of(module_.zero_copy->identifiers);
+            max_of(module_.zero_copy->strings);
+        }
+        max_of(module_.types);
+        max_of(module_.statements);
+        max_of(module_.expressions);
+        for (const auto& alias : module_.aliases) {
+            max_id = (std::max)({max_id, get_id(alias.from), get_id(alias.to)});
+        }
+
+        auto maps = std::make_shared<mapping::IdMaps>();
+        maps->objects.resize(max_id + 1);
+        // mapped_count counts keys of per kind maps as before the dense table:
+        // an id counts once per kind it is mapped as, and an alias counts its target
+        // even if the target is missing or of another kind
+        std::vector<std::uint8_t> counted(max_id + 1);
+        auto count = [&](std::uint64_t id, mapping::ObjectKind kind) {
+            if (kind == mapping::ObjectKind::ZERO_COPY_IDENTIFIER) {
+                kind = mapping::ObjectKind::IDENTIFIER;
+            }
+            else if (kind == mapping::ObjectKind::ZERO_COPY_STRING_LITERAL) {
+                kind = mapping::ObjectKind::STRING_LITERAL;
+            }
+            auto bit = std::uint8_t(1) << std::uint8_t(kind);
+            if (!(counted[id] & bit)) {
+                counted[id] |= bit;
+                maps->mapped_count++;
+            }
+        };
+        auto set = [&](std::uint64_t id, mapping::TaggedObject object) {
+            maps->objects[id] = object;
+        };
+        auto map_to = [&](const auto& vec, mapping::ObjectKind kind) {
+            for (const auto& item : vec) {
+                count(get_id(item.id), kind);
+                set(get_id(item.id), mapping::TaggedObject(&item, kind));
             }
         };
-        map_to(identifier_map_, module_.identifiers, ebm::AliasHint::IDENTIFIER);
-        map_to(string_literal_map_, module_.strings, ebm::AliasHint::STRING);
-        map_to(type_map_, module_.types, ebm::AliasHint::TYPE);
-        map_to(statement_map_, module_.statements, ebm::AliasHint::STATEMENT);
-        map_to(expression_map_, module_.expressions, ebm::AliasHint::EXPRESSION);
-
-        auto map_alias = [&](auto& map, const auto& alias) {
-            map[get_id(alias.from)] = map[get_id(alias.to)];
-            inverse_refs_[get_id(alias.to)].push_back(InverseRef{
-                .name = to_string(alias.hint),
-                .ref = to_any_ref(alias.from),
-                .hint = ebm::AliasHint::ALIAS,
-            });
+        map_to(module_.identifiers, mapping::ObjectKind::IDENTIFIER);
+        map_to(module_.strings, mapping::ObjectKind::STRING_LITERAL);
+        if (module_.zero_copy) {
+            map_to(module_.zero_copy->identifiers, mapping::ObjectKind::ZERO_COPY_IDENTIFIER);
+            map_to(module_.zero_copy->strings, mapping::ObjectKind::ZERO_COPY_STRING_LITERAL);
+        }
+        map_to(module_.types, mapping::ObjectKind::TYPE);
+        map_to(module_.statements, mapping::ObjectKind::STATEMENT);
+        map_to(module_.expressions, mapping::ObjectKind::EXPRESSION);
+
+        // alias resolves only if its target is an object of hinted kind
+        auto map_alias = [&](mapping::ObjectKind kind, const auto& alias, mapping::ObjectKind zero_copy_kind = mapping::ObjectKind::NONE) {
+            count(get_id(alias.from), kind);
+            count(get_id(alias.to), kind);
+            auto target = maps->objects[get_id(alias.to)];
+            if (target.kind() == kind || (zero_copy_kind != mapping::ObjectKind::NONE && target.kind() == zero_copy_kind)) {
+                set(get_id(alias.from), target);
+            }
         };
 
         for (const auto& alias : module_.aliases) {
             switch (alias.hint) {
                 case ebm::AliasHint::IDENTIFIER:
-                    map_alias(identifier_map_, alias);
+                    map_alias(mapping::ObjectKind::IDENTIFIER, alias, mapping::ObjectKind::ZERO_COPY_IDENTIFIER);
                     break;
                 case ebm::AliasHint::STRING:
-                    map_alias(string_literal_map_, alias);
+                    map_alias(mapping::ObjectKind::STRING_LITERAL, alias, mapping::ObjectKind::ZERO_COPY_STRING_LITERAL);
                     break;
                 case ebm::AliasHint::TYPE:
-                    map_alias(type_map_, alias);
+                    map_alias(mapping::ObjectKind::TYPE, alias);
                     break;
                 case ebm::AliasHint::EXPRESSION:
-                    map_alias(expression_map_, alias);
+                    map_alias(mapping::ObjectKind::EXPRESSION, alias);
                     break;
                 case ebm::AliasHint::STATEMENT:
-                    map_alias(statement_map_, alias);
+                    map_alias(mapping::ObjectKind::STATEMENT, alias);
                     break;
                 case ebm::AliasHint::ALIAS:
                     // ALIAS hint is not used for mapping, it's just a marker
                     break;
             }
         }
+        id_maps_ = std::move(maps);
+        if (options & mapping::BuildMapOption::BUILD_MAP_USE_INVERSE_REF) {
+            inverse_refs_pending_ = true;
+        }
         if (options & mapping::BuildMapOption::BUILD_MAP_USE_DEBUG_LOC) {
-            for (const auto& debug_loc : module_.locs) {
-                debug_loc_map_[get_id(debug_loc.ident)] = &debug_loc;
+            debug_locs_pending_ = true;
+        }
+    }
+
+    void MappingTable::share_id_maps(std::shared_ptr<const mapping::IdMaps> maps) {
+        id_maps_ = std::move(maps);
+        // same as build_maps with default options
+        inverse_refs_pending_ = true;
+        debug_locs_pending_ = true;
+    }
+
+    void MappingTable::build_inverse_refs() const {
+        // collect (referenced id, reference) in visiting order, then bucket them by id keeping that order
+        std::vector<std::pair<std::uint64_t, InverseRef>> collected;
+        std::uint64_t max_id = 0;
+        auto add = [&](std::uint64_t id, InverseRef ref) {
+            max_id = (std::max)(max_id, id);
+            collected.push_back({id, ref});
+        };
+        auto map_to = [&](const auto& vec, ebm::AliasHint hint) {
+            for (const auto& item : vec) {
+                item.body.visit([&](auto&& visitor, const char* name, auto&& val, std::optional<size_t> index = std::nullopt) -> void {
+                    if constexpr (AnyRef<decltype(val)>) {
+                        if (!is_nil(val)) {
+                            add(get_id(val), InverseRef{
+                                                 .name = name,
+                                                 .index = index,
+                                                 .ref = to_any_ref(item.id),
+                                                 .hint = hint,
+                                             });
+                        }
+                    }
+                    else if constexpr (is_container<decltype(val)>) {
+                        for (size_t i = 0; i < val.container.size(); ++i) {
+                            visitor(visitor, name, val.container[i], i);
+                        }
+                    }
+                    else
+                        VISITOR_RECURSE(visitor, name, val)
+                });
+            }
+        };
+        map_to(module_.identifiers, ebm::AliasHint::IDENTIFIER);
+        map_to(module_.strings, ebm::AliasHint::STRING);
+        map_to(module_.types, ebm::AliasHint::TYPE);
+        map_to(module_.statements, ebm::AliasHint::STATEMENT);
+        map_to(module_.expressions, ebm::AliasHint::EXPRESSION);
+        for (const auto& alias : module_.aliases) {
+            if (alias.hint == ebm::AliasHint::ALIAS) {
+                continue;
             }
+            add(get_id(alias.to), InverseRef{
+                                      .name = to_string(alias.hint),
+                                      .ref = to_any_ref(alias.from),
+                                      .hint = ebm::AliasHint::ALIAS,
+                                  });
+        }
+        auto& index = inverse_refs_;
+        index.offsets.assign(collected.empty() ? 0 : max_id + 2, 0);
+        for (auto& c : collected) {
+            index.offsets[c.first + 1]++;
+        }
+        for (size_t i = 1; i < index.offsets.size(); i++) {
+            index.offsets[i] += index.offsets[i - 1];
+        }
+        index.refs.resize(collected.size());
+        std::vector<std::uint32_t> cursor(index.offsets.begin(), index.offsets.end());
+        for (auto& c : collected) {
+            index.refs[cursor[c.first]++] = c.second;
         }
     }
 
+    void MappingTable::build_debug_locs() const {
+        debug_loc_map_.reserve(module_.locs.size());
+        for (const auto& debug_loc : module_.locs) {
+            debug_loc_map_[get_id(debug_loc.ident)] = &debug_loc;
+        }
+    }
+
+    template <class T, class Ref>
+    static const T* materialize(mapping::TaggedObject object, mapping::ObjectKind owning_kind, mapping::ObjectKind zero_copy_kind, std::unordered_map<std::uint64_t, T>& cache) {
+        if (auto owning = object.get<T>(owning_kind)) {
+            return owning;
+        }
+        auto entry = object.get<ZeroCopyString<Ref>>(zero_copy_kind);
+        if (!entry) {
+            return nullptr;
+        }
+        auto [found, inserted] = cache.try_emplace(get_id(entry->id));
+        if (inserted) {
+            found->second.id = entry->id;
+            found->second.body.length = varint(entry->data.size()).value();
+            found->second.body.data = std::string(entry->data);
+        }
+        return &found->second;
+    }
+
+    const ebm::Identifier* MappingTable::materialize_identifier(mapping::TaggedObject object) const {
+        return materialize<ebm::Identifier, ebm::IdentifierRef>(object, mapping::ObjectKind::IDENTIFIER, mapping::ObjectKind::ZERO_COPY_IDENTIFIER, zero_copy_identifiers_);
+    }
+
+    const ebm::StringLiteral* MappingTable::materialize_string_literal(mapping::TaggedObject object) const {
+        return materialize<ebm::StringLiteral, ebm::StringRef>(object, mapping::ObjectKind::STRING_LITERAL, mapping::ObjectKind::ZERO_COPY_STRING_LITERAL, zero_copy_strings_);
+    }
+
     // --- Helper functions to get objects from references ---
     const ebm::Identifier* MappingTable::get_identifier(const ebm::IdentifierRef& ref) const {
-        auto it = identifier_map_.find(get_id(ref));
-        return (it != identifier_map_.end()) ? it->second : nullptr;
+        if (!id_maps_) {
+            return nullptr;
+        }
+        return materialize_identifier(id_maps_->find(get_id(ref)));
     }
 
     const ebm::StringLiteral* MappingTable::get_string_literal(const ebm::StringRef& ref) const {
-        auto it = string_literal_map_.find(get_id(ref));
-        return (it != string_literal_map_.end()) ? it->second : nullptr;
+        if (!id_maps_) {
+            return nullptr;
+        }
+        return materialize_string_literal(id_maps_->find(get_id(ref)));
     }
 
     const ebm::Type* MappingTable::get_type(const ebm::TypeRef& ref) const {
-        auto it = type_map_.find(get_id(ref));
-        return (it != type_map_.end()) ? it->second : nullptr;
+        if (!id_maps_) {
+            return nullptr;
+        }
+        return id_maps_->find(get_id(ref)).get<ebm::Type>(mapping::ObjectKind::TYPE);
     }
 
     const ebm::Statement* MappingTable::get_statement(const ebm::StatementRef& ref) const {
-        auto it = statement_map_.find(get_id(ref));
-        return (it != statement_map_.end()) ? it->second : nullptr;
+        if (!id_maps_) {
+            return nullptr;
+        }
+        return id_maps_->find(get_id(ref)).get<ebm::Statement>(mapping::ObjectKind::STATEMENT);
     }
 
     const ebm::Statement* MappingTable::get_statement(const ebm::WeakStatementRef& ref) const {
@@ -110,27 +369,33 @@ namespace ebmgen {
     }
 
     const ebm::Expression* MappingTable::get_expression(const ebm::ExpressionRef& ref) const {
-        auto it = expression_map_.find(get_id(ref));
-        return (it != expression_map_.end()) ? it->second : nullptr;
+        if (!id_maps_) {
+            return nullptr;
+        }
+        return id_maps_->find(get_id(ref)).get<ebm::Expression>(mapping::ObjectKind::EXPRESSION);
     }
 
     ObjectVariant MappingTable::get_object(const ebm::AnyRef& ref) const {
-        if (auto i = get_identifier(ebm::IdentifierRef{ref.id})) {
-            return i;
-        }
-        if (auto s = get_string_literal(ebm::StringRef{ref.id})) {
-            return s;
-        }
-        if (auto t = get_type(ebm::TypeRef{ref.id})) {
-            return t;
+        if (!id_maps_) {
+            return std::monostate{};
         }
-        if (auto s = get_statement(ebm::StatementRef{ref.id})) {
-            return s;
-        }
-        if (auto e = get_expression(ebm::ExpressionRef{ref.id})) {
-            return e;
+        auto object = id_maps_->find(get_id(ref));
+        switch (object.kind()) {
+            case mapping::ObjectKind::IDENTIFIER:
+            case mapping::ObjectKind::ZERO_COPY_IDENTIFIER:
+                return materialize_identifier(object);
+            case mapping::ObjectKind::STRING_LITERAL:
+            case mapping::ObjectKind::ZERO_COPY_STRING_LITERAL:
+                return materialize_string_literal(object);
+            case mapping::ObjectKind::TYPE:
+                return object.get<ebm::Type>(mapping::ObjectKind::TYPE);
+            case mapping::ObjectKind::STATEMENT:
+                return object.get<ebm::Statement>(mapping::ObjectKind::STATEMENT);
+            case mapping::ObjectKind::EXPRESSION:
+                return object.get<ebm::Expression>(mapping::ObjectKind::EXPRESSION);
+            default:
+                return std::monostate{};
         }
-        return std::monostate{};
     }
 
     ObjectVariant MappingTable::get_object(const ebm::StatementRef& ref) const {
@@ -165,12 +430,12 @@ namespace ebmgen {
         return std::monostate{};
     }
 
-    const std::vector<InverseRef>* MappingTable::get_inverse_ref(const ebm::AnyRef& ref) const {
-        auto it = inverse_refs_.find(get_id(ref));
-        if (it != inverse_refs_.end()) {
-            return &it->second;
+    std::optional<std::span<const InverseRef>> MappingTable::get_inverse_ref(const ebm::AnyRef& ref) const {
+        if (inverse_refs_pending_) {
+            build_inverse_refs();
+            inverse_refs_pending_ = false;
         }
-        return nullptr;
+        return inverse_refs_.find(get_id(ref));
     }
 
     const ebm::Statement* MappingTable::get_entry_point() const {
@@ -292,7 +557,12 @@ namespace ebmgen {
     }
 
     size_t MappingTable::original_id_count() const {
-        return module_.identifiers.size() +
+        size_t zero_copy_count = 0;
+        if (module_.zero_copy) {
+            zero_copy_count = module_.zero_copy->identifiers.size() + module_.zero_copy->strings.size();
+        }
+        return zero_copy_count +
+               module_.identifiers.size() +
                module_.strings.size() +
                module_.types.size() +
                module_.statements.size() +
@@ -301,11 +571,10 @@ namespace ebmgen {
     }
 
     size_t MappingTable::mapped_id_count() const {
-        return identifier_map_.size() +
-               string_literal_map_.size() +
-               type_map_.size() +
-               statement_map_.size() +
-               expression_map_.size();
+        if (!id_maps_) {
+            return 0;
+        }
+        return id_maps_->mapped_count;
     }
 
     bool MappingTable::valid() const {
@@ -313,6 +582,10 @@ namespace ebmgen {
     }
 
     const ebm::Loc* MappingTable::get_debug_loc(const ebm::AnyRef& ref) const {
+        if (debug_locs_pending_) {
+            build_debug_locs();
+            debug_locs_pending_ = false;
+        }
         auto it = debug_loc_map_.find(get_id(ref));
         if (it != debug_loc_map_.end()) {
             return it->second;
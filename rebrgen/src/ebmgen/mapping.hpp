@@ -1,8 +1,13 @@
 /*license*/
 #pragma once
 #include <ebm/extended_binary_module.hpp>
+#include <binary/reader.h>
 #include <unordered_map>
 #include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
 #include <variant>
 #include <vector>
 #include "common.hpp"
@@ -16,6 +21,34 @@ namespace ebmgen {
         ebm::AliasHint hint;
     };
 
+    // identifier or string literal left as a view into the input buffer by decode_zero_copy
+    template <class Ref>
+    struct ZeroCopyString {
+        Ref id;
+        std::string_view data;
+    };
+
+    // identifiers and string literals of a module decoded by decode_zero_copy.
+    // the module's own identifiers/strings hold only entries rewritten after decode (see promote_identifier)
+    struct ZeroCopyStrings {
+        std::vector<ZeroCopyString<ebm::IdentifierRef>> identifiers;
+        std::vector<ZeroCopyString<ebm::StringRef>> strings;
+    };
+
+    // decodes module same as ExtendedBinaryModule::decode except that identifiers and string literals
+    // are kept in strings as views into r's buffer, so the buffer must outlive module.
+    // module is attached to strings (see attach_zero_copy_strings)
+    ::futils::error::Error<> decode_zero_copy(::futils::binary::reader& r, ebm::ExtendedBinaryModule& module, ZeroCopyStrings& strings);
+
+    // associates zero copy strings with module so that EBMProxy built from module sees them.
+    // nullptr detaches. strings must outlive every EBMProxy built from module
+    void attach_zero_copy_strings(const ebm::ExtendedBinaryModule& module, ZeroCopyStrings* strings);
+    ZeroCopyStrings* find_zero_copy_strings(const ebm::ExtendedBinaryModule& module);
+
+    // moves identifier id from zero copy strings into module.identifiers so that it can be rewritten.
+    // returns the owning entry, or nullptr if id is not a zero copy identifier
+    ebm::Identifier* promote_identifier(ebm::ExtendedBinaryModule& module, ZeroCopyStrings& strings, std::uint64_t id);
+
     using ObjectVariant = std::variant<std::monostate, const ebm::Identifier*, const ebm::StringLiteral*, const ebm::Type*, const ebm::Statement*, const ebm::Expression*>;
 
     struct EBMProxy {
@@ -28,9 +61,12 @@ namespace ebmgen {
         const std::vector<ebm::RefAlias>& aliases;
         const std::vector<ebm::Loc>& locs;
         const ebm::ExtendedBinaryModule* origin = nullptr;
+        // set if origin was decoded by decode_zero_copy. pointer rather than copy of spans
+        // because pre_visitor may promote identifiers after the proxy is built
+        const ZeroCopyStrings* zero_copy = nullptr;
 
-        constexpr EBMProxy(const ebm::ExtendedBinaryModule& module)
-            : max_id(module.max_id), statements(module.statements), expressions(module.expressions), types(module.types), identifiers(module.identifiers), strings(module.strings), aliases(module.aliases), locs(module.debug_info.locs), origin(&module) {
+        EBMProxy(const ebm::ExtendedBinaryModule& module)
+            : max_id(module.max_id), statements(module.statements), expressions(module.expressions), types(module.types), identifiers(module.identifiers), strings(module.strings), aliases(module.aliases), locs(module.debug_info.locs), origin(&module), zero_copy(find_zero_copy_strings(module)) {
         }
 
         constexpr EBMProxy(const std::vector<ebm::Statement>& stmts,
@@ -62,6 +98,74 @@ namespace ebmgen {
         constexpr bool operator&(BuildMapOption a, BuildMapOption b) {
             return (static_cast<int>(a) & static_cast<int>(b)) != 0;
         }
+
+        enum class ObjectKind : std::uint8_t {
+            NONE = 0,
+            IDENTIFIER,
+            STRING_LITERAL,
+            TYPE,
+            STATEMENT,
+            EXPRESSION,
+            // entries of ZeroCopyStrings. materialized per table on first lookup
+            ZERO_COPY_IDENTIFIER,
+            ZERO_COPY_STRING_LITERAL,
+        };
+
+        // object pointer with its kind in low bits
+        struct TaggedObject {
+            static constexpr std::uintptr_t kind_mask = 0x7;
+
+            constexpr TaggedObject() = default;
+
+            template <class T>
+            TaggedObject(const T* object, ObjectKind kind)
+                : value_(reinterpret_cast<std::uintptr_t>(object) | static_cast<std::uintptr_t>(kind)) {
+                static_assert(alignof(T) > kind_mask, "object alignment is too small to hold kind");
+            }
+
+            ObjectKind kind() const {
+                return static_cast<ObjectKind>(value_ & kind_mask);
+            }
+
+            template <class T>
+            const T* get(ObjectKind expected_kind) const {
+                if (kind() != expected_kind) {
+                    return nullptr;
+                }
+                return reinterpret_cast<const T*>(value_ & ~kind_mask);
+            }
+
+           private:
+            std::uintptr_t value_ = 0;
+        };
+
+        // id to object table. ids are dense up to max_id, so index is id.
+        // aliases are resolved to their target when built.
+        // never modified after built, so tables viewing the same module can share them across threads
+        struct IdMaps {
+            std::vector<TaggedObject> objects;
+            size_t mapped_count = 0;  // number of (id, kind) keys including aliases and their targets. see build_maps
+
+            TaggedObject find(std::uint64_t id) const {
+                if (id >= objects.size()) {
+                    return {};
+                }
+                return objects[id];
+            }
+        };
+
+        // inverse references in CSR form: references to id are refs[offsets[id], offsets[id + 1])
+        struct InverseRefIndex {
+            std::vector<std::uint32_t> offsets;
+            std::vector<InverseRef> refs;
+
+            std::optional<std::span<const InverseRef>> find(std::uint64_t id) const {
+                if (id + 1 >= offsets.size() || offsets[id] == offsets[id + 1]) {
+                    return std::nullopt;
+                }
+                return std::span<const InverseRef>(refs.data() + offsets[id], offsets[id + 1] - offsets[id]);
+            }
+        };
     }  // namespace mapping
 
     struct MappingTable {
@@ -137,7 +241,8 @@ namespace ebmgen {
             return module_;
         }
 
-        const std::vector<InverseRef>* get_inverse_ref(const ebm::AnyRef& ref) const;
+        // inverse references are built on first call (see build_maps)
+        std::optional<std::span<const InverseRef>> get_inverse_ref(const ebm::AnyRef& ref) const;
 
         void register_default_prefix(ebm::StatementKind kind, std::string_view prefix) {
             default_identifier_prefix_[kind] = prefix;
@@ -153,28 +258,49 @@ namespace ebmgen {
             return "tmp";
         }
 
+        // debug location map is built on first call (see build_maps)
         const ebm::Loc* get_debug_loc(const ebm::AnyRef& ref) const;
 
         void directly_map_statement_identifier(ebm::StatementRef ref, std::string&& name);
         void remove_directly_mapped_statement_identifier(ebm::StatementRef ref);
+        // BUILD_MAP_USE_DEBUG_LOC and BUILD_MAP_USE_INVERSE_REF only mark these maps as requested.
+        // they are built from current module on first get_debug_loc/get_inverse_ref call,
+        // so that code generators which never query them do not pay for walking every node
         void build_maps(mapping::BuildMapOption options = mapping::BuildMapOption::BUILD_MAP_USE_DEBUG_LOC | mapping::BuildMapOption::BUILD_MAP_USE_INVERSE_REF);
 
+        const std::shared_ptr<const mapping::IdMaps>& id_maps() const {
+            return id_maps_;
+        }
+
+        // adopts id maps built by another table for the same module instead of calling build_maps.
+        // identifier modifiers, direct mappings and inverse ref/debug loc maps stay per table
+        void share_id_maps(std::shared_ptr<const mapping::IdMaps> maps);
+
         void set_identifier_modifier(std::function<void(ebm::StatementRef, std::string&)>&& modifier) {
             identifier_modifier = std::move(modifier);
         }
 
        private:
+        void build_inverse_refs() const;
+        void build_debug_locs() const;
+        const ebm::Identifier* materialize_identifier(mapping::TaggedObject object) const;
+        const ebm::StringLiteral* materialize_string_literal(mapping::TaggedObject object) const;
+
         EBMProxy module_;
         // Caches for faster lookups
-        std::unordered_map<std::uint64_t, const ebm::Identifier*> identifier_map_;
-        std::unordered_map<std::uint64_t, const ebm::StringLiteral*> string_literal_map_;
-        std::unordered_map<std::uint64_t, const ebm::Type*> type_map_;
-        std::unordered_map<std::uint64_t, const ebm::Statement*> statement_map_;
-        std::unordered_map<std::uint64_t, const ebm::Expression*> expression_map_;
-        std::unordered_map<std::uint64_t, std::vector<InverseRef>> inverse_refs_;
+        std::shared_ptr<const mapping::IdMaps> id_maps_;
+        mutable mapping::InverseRefIndex inverse_refs_;
         std::unordered_map<ebm::StatementKind, std::string> default_identifier_prefix_;
         std::unordered_map<std::uint64_t, std::string> statement_identifier_direct_map_;
-        std::unordered_map<std::uint64_t, const ebm::Loc*> debug_loc_map_;
+        mutable std::unordered_map<std::uint64_t, const ebm::Loc*> debug_loc_map_;
+        // owning copies of zero copy identifiers/strings made on first lookup, keyed by the entry's id.
+        // code generators look up only a part of them, so the rest are never copied
+        mutable std::unordered_map<std::uint64_t, ebm::Identifier> zero_copy_identifiers_;
+        mutable std::unordered_map<std::uint64_t, ebm::StringLiteral> zero_copy_strings_;
+        // set by build_maps, cleared by first get_inverse_ref/get_debug_loc. not synchronized, so a table is used by one thread
+        // (see docs/decisions/0046-codegen-input-zero-copy.md)
+        mutable bool inverse_refs_pending_ = false;
+        mutable bool debug_locs_pending_ = false;
         std::function<void(ebm::StatementRef, std::string&)> identifier_modifier;
     };
 }  // namespace ebmgen
\ No newline at end of file
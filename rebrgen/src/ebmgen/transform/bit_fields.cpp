@@ -13,7 +13,7 @@
 namespace ebmgen {
 
     struct Route {
-        std::vector<std::shared_ptr<CFG>> route;
+        std::vector<CFGIndex> route;
         size_t bit_size = 0;
     };
 
@@ -21,7 +21,8 @@ namespace ebmgen {
         return write ? stmt.body.write_data() : stmt.body.read_data();
     }
 
-    std::vector<Route> search_byte_aligned_route(CFGContext& tctx, const std::shared_ptr<CFG>& root, size_t root_size, bool write) {
+    std::vector<Route> search_byte_aligned_route(CFGContext& tctx, CFGIndex root, size_t root_size, bool write) {
+        auto& graph = tctx.stack.graph;
         std::vector<Route> finalized_routes;
         std::queue<Route> candidates;
         candidates.push({
@@ -31,10 +32,10 @@ namespace ebmgen {
         while (!candidates.empty()) {
             auto r = candidates.front();
             candidates.pop();
-            for (auto& n : r.route.back()->next) {
+            for (auto n : graph.next(r.route.back())) {
                 auto copy = r;
                 copy.route.push_back(n);
-                auto stmt = tctx.tctx.statement_repository().get(n->original_node);
+                auto stmt = tctx.tctx.statement_repository().get(graph.node(n).original_node);
                 if (!stmt) {
                     continue;  // drop route
                 }
@@ -171,7 +172,7 @@ namespace ebmgen {
             EBMA_ADD_STATEMENT(flush_stmt, flush_buffer_statement, std::move(write_data));
             return flush_stmt;
         };
-        std::set<std::shared_ptr<CFG>> reached_route;
+        std::set<CFGIndex> reached_route;
         for (auto& r : finalized_routes) {
             BitManipulator extractor(ctx, tmp_buffer, u8_t);
             for (size_t i = 0; i < r.route.size(); i++) {
@@ -180,7 +181,7 @@ namespace ebmgen {
                     continue;
                 }
                 reached_route.insert(c);
-                MAYBE(stmt, tctx.tctx.statement_repository().get(c->original_node));
+                MAYBE(stmt, tctx.tctx.statement_repository().get(tctx.stack.graph.node(c).original_node));
                 auto io_ = get_io(stmt, write);
                 if (io_) {
                     auto io_copy = *io_;  // to avoid memory location movement
@@ -246,7 +247,7 @@ namespace ebmgen {
                         append(block, flush);
                     }
                     EBM_BLOCK(lowered_bit_operation, std::move(block));
-                    MAYBE_VOID(add, add_lowered_statements(tctx, io_copy, c->original_node, lowered_bit_operation, write));
+                    MAYBE_VOID(add, add_lowered_statements(tctx, io_copy, tctx.stack.graph.node(c).original_node, lowered_bit_operation, write));
                 }
             }
         }
@@ -316,7 +317,7 @@ namespace ebmgen {
             if (is_single_route) {
                 // read upfront for single route
                 size_t read_offset = 0;
-                MAYBE(read_data, do_read(finalized_routes[0].route[0]->original_node, read_offset, max_bit_size / 8));
+                MAYBE(read_data, do_read(tctx.stack.graph.node(finalized_routes[0].route[0]).original_node, read_offset, max_bit_size / 8));
                 initial_reserve_stmt = read_data;
             }
         }
@@ -382,7 +383,7 @@ namespace ebmgen {
             EBMA_ADD_STATEMENT(flush_stmt, flush_buffer_statement, std::move(write_data));
             return flush_stmt;
         };
-        std::set<std::shared_ptr<CFG>> reached_route;
+        std::set<CFGIndex> reached_route;
         for (auto& r : finalized_routes) {
             BitManipulator extractor(ctx, tmp_buffer, u8_t);
             size_t current_bit_offset = 0;
@@ -390,7 +391,7 @@ namespace ebmgen {
             for (size_t i = 0; i < r.route.size(); i++) {
                 auto& c = r.route[i];
 
-                MAYBE(stmt, tctx.tctx.statement_repository().get(c->original_node));
+                MAYBE(stmt, tctx.tctx.statement_repository().get(tctx.stack.graph.node(c).original_node));
                 auto io_ = get_io(stmt, write);
                 if (io_) {
                     auto io_copy = *io_;  // to avoid memory location movement
@@ -477,7 +478,7 @@ namespace ebmgen {
                     // append(block, update_current_bit_offset);
                     current_bit_offset = new_size_bit;
                     EBM_BLOCK(lowered_bit_operation, std::move(block));
-                    MAYBE_VOID(add, add_lowered_statements(tctx, io_copy, c->original_node, lowered_bit_operation, write));
+                    MAYBE_VOID(add, add_lowered_statements(tctx, io_copy, tctx.stack.graph.node(c).original_node, lowered_bit_operation, write));
                 }
             }
         }
@@ -495,12 +496,12 @@ namespace ebmgen {
         // detect first divergence
         while (true) {
             bool break_outer = false;
-            std::shared_ptr<CFG> node;
+            CFGIndex node = cfg_nil;
             for (auto& r : finalized_routes) {
                 if (i >= r.route.size()) {
                     return false;  // unexpected end
                 }
-                if (!node) {
+                if (node == cfg_nil) {
                     node = r.route[i];
                 }
                 else if (node != r.route[i]) {
@@ -511,13 +512,13 @@ namespace ebmgen {
             if (break_outer) {
                 break;
             }
-            if (!node) {
+            if (node == cfg_nil) {
                 return false;
             }
             i++;
         }
         // check routes after divergence are not merged again
-        std::unordered_set<std::shared_ptr<CFG>> visited;
+        std::unordered_set<CFGIndex> visited;
         for (auto& r : finalized_routes) {
             for (size_t j = i; j < r.route.size(); j++) {
                 auto& c = r.route[j];
@@ -545,17 +546,22 @@ namespace ebmgen {
         return {};
     }
 
-    expected<void> lowered_dynamic_bit_io(CFGContext& tctx, bool write) {
-        auto& ctx = tctx.tctx.context();
+    expected<void> lowered_dynamic_bit_io(CFGContext& tctx, bool write, std::function<void(const char*)> timer) {
         auto& all_statements = tctx.tctx.statement_repository().get_all();
         auto current_added = all_statements.size();
 
+        // search all routes first; lowering adds statements and may relocate all_statements
+        struct Candidate {
+            ebm::StatementRef io_ref;
+            std::vector<Route> routes;
+        };
+        std::vector<Candidate> candidates;
         for (size_t i = 0; i < current_added; ++i) {
             auto block = get_block(all_statements[i].body);
             if (!block) {
                 continue;
             }
-            std::set<std::shared_ptr<CFG>> handled;
+            std::set<CFGIndex> handled;
             for (auto& ref : block->container) {
                 MAYBE(stmt, tctx.tctx.statement_repository().get(ref));
                 if (auto r = get_io(stmt, write); r && r->size.unit == ebm::SizeUnit::BIT_FIXED) {
@@ -568,16 +574,25 @@ namespace ebmgen {
                     }
                     auto finalized_routes = search_byte_aligned_route(tctx, found->second, r->size.size()->value(), write);
                     if (finalized_routes.size()) {
-                        MAYBE_VOID(added, add_lowered_bit_io(tctx, r->io_ref, finalized_routes, write));
                         for (auto& fin : finalized_routes) {
                             for (auto& node : fin.route) {
                                 handled.insert(node);
                             }
                         }
+                        candidates.push_back({r->io_ref, std::move(finalized_routes)});
                     }
                 }
             }
         }
+        if (timer) {
+            timer(write ? "bit io write route search" : "bit io read route search");
+        }
+        for (auto& c : candidates) {
+            MAYBE_VOID(added, add_lowered_bit_io(tctx, c.io_ref, c.routes, write));
+        }
+        if (timer) {
+            timer(write ? "bit io write lowering" : "bit io read lowering");
+        }
         return {};
     }
 
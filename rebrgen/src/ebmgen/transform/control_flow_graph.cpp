@@ -1,6 +1,5 @@
 /*license*/
 #include "control_flow_graph.hpp"
-#include <memory>
 #include "code/code_writer.h"
 #include "ebm/extended_binary_module.hpp"
 #include "ebmgen/common.hpp"
@@ -13,16 +12,45 @@
 #include <vector>
 
 namespace ebmgen {
+    // edges are kept per node while building and removing <phi> node,
+    // then compacted into CFGGraph::next_edges/prev_edges
+    struct CFGBuildNode {
+        std::vector<CFGIndex> next;
+        std::vector<CFGIndex> prev;
+        std::vector<CFGTuple> lowered;
+    };
+
     struct InternalCFGContext {
         CFGStack& stack;
         RepositoryProxy proxy;
+        std::vector<CFGBuildNode> build;  // parallel to stack.graph.nodes
+
+        CFGIndex new_node(ebm::StatementRef ref = {}) {
+            auto index = CFGIndex(stack.graph.nodes.size());
+            stack.graph.nodes.push_back(CFG{.original_node = ref});
+            build.emplace_back();
+            return index;
+        }
+
+        void link(CFGIndex from, CFGIndex to) {
+            build[from].next.push_back(to);
+            build[to].prev.push_back(from);
+        }
+
+        CFG& node(CFGIndex i) {
+            return stack.graph.nodes[i];
+        }
+
+        CFGExpression& expression(CFGIndex i) {
+            return stack.graph.expressions[i];
+        }
     };
 
     expected<CFGTuple> analyze_ref(InternalCFGContext& tctx, ebm::StatementRef ref);
 
-    expected<std::shared_ptr<CFGExpression>> analyze_expression(InternalCFGContext& tctx, ebm::ExpressionRef ref) {
-        auto expr = std::make_shared<CFGExpression>();
-        expr->original_node = ref;
+    // children of an expression are allocated contiguously before analyzing each of them
+    expected<void> analyze_expression_at(InternalCFGContext& tctx, CFGIndex index, ebm::ExpressionRef ref) {
+        tctx.expression(index).original_node = ref;
         MAYBE(expr_v, tctx.proxy.get_expression(ref));
         std::vector<std::pair<std::string_view, ebm::ExpressionRef>> children;
         expr_v.body.visit([&](auto&& visitor, const char* name, auto&& value) -> void {
@@ -39,21 +67,31 @@ namespace ebmgen {
                 VISITOR_RECURSE_CONTAINER(visitor, name, value)
             else VISITOR_RECURSE(visitor, name, value)
         });
+        auto& expressions = tctx.stack.graph.expressions;
+        auto first = CFGIndex(expressions.size());
         for (auto& child : children) {
-            MAYBE(child_expr, analyze_expression(tctx, child.second));
-            child_expr->parent = expr;
-            child_expr->relation_name = child.first;
-            expr->children.push_back(std::move(child_expr));
+            expressions.push_back(CFGExpression{.parent = index, .relation_name = child.first});
+        }
+        tctx.expression(index).children = CFGRange{first, std::uint32_t(children.size())};
+        for (size_t i = 0; i < children.size(); i++) {
+            MAYBE_VOID(child_expr, analyze_expression_at(tctx, first + i, children[i].second));
         }
         if (auto w = expr_v.body.io_statement()) {
             MAYBE(related_cfg, analyze_ref(tctx, *w));
-            expr->related_cfg = std::move(related_cfg);
+            tctx.expression(index).related_cfg = related_cfg;
         }
         else if (auto v = expr_v.body.conditional_stmt()) {
             MAYBE(related_cfg, analyze_ref(tctx, *v));
-            expr->related_cfg = std::move(related_cfg);
+            tctx.expression(index).related_cfg = related_cfg;
         }
-        return expr;
+        return {};
+    }
+
+    expected<CFGIndex> analyze_expression(InternalCFGContext& tctx, ebm::ExpressionRef ref) {
+        auto index = CFGIndex(tctx.stack.graph.expressions.size());
+        tctx.stack.graph.expressions.emplace_back();
+        MAYBE_VOID(expr, analyze_expression_at(tctx, index, ref));
+        return index;
     }
 
     expected<std::vector<CFGTuple>> analyze_lowered(InternalCFGContext& tctx, ebm::StatementRef ref) {
@@ -73,26 +111,24 @@ namespace ebmgen {
     }
 
     expected<CFGTuple> analyze_ref(InternalCFGContext& tctx, ebm::StatementRef ref) {
-        auto root = std::make_shared<CFG>();
-        root->original_node = ref;
+        auto root = tctx.new_node(ref);
         auto current = root;
-        auto link = [](auto& from, auto& to) {
-            from->next.push_back(to);
-            to->prev.push_back(from);
+        auto link = [&](CFGIndex from, CFGIndex to) {
+            tctx.link(from, to);
         };
         MAYBE(stmt, tctx.proxy.get_statement(ref));
-        root->statement_op = stmt.body.kind;
+        tctx.node(root).statement_op = stmt.body.kind;
         tctx.stack.cfg_map[get_id(ref)] = root;
         bool brk = false;
         if (auto block = stmt.body.block()) {
-            auto join = std::make_shared<CFG>();
+            auto join = tctx.new_node();
             for (auto& ref : block->container) {
                 MAYBE(child, analyze_ref(tctx, ref));
                 link(current, child.start);
                 if (!child.brk) {
                     link(child.end, join);
-                    current = std::move(join);
-                    join = std::make_shared<CFG>();
+                    current = join;
+                    join = tctx.new_node();
                     continue;
                 }
                 current = child.end;
@@ -103,8 +139,8 @@ namespace ebmgen {
         else if (auto if_stmt = stmt.body.if_statement()) {
             MAYBE(then_block, analyze_ref(tctx, if_stmt->then_block));
             MAYBE(cond, analyze_expression(tctx, if_stmt->condition.cond));
-            then_block.start->condition = std::move(cond);
-            auto join = std::make_shared<CFG>();
+            tctx.node(then_block.start).condition = cond;
+            auto join = tctx.new_node();
             link(current, then_block.start);
             if (!then_block.brk) {
                 link(then_block.end, join);
@@ -120,14 +156,14 @@ namespace ebmgen {
             else {
                 link(current, join);
             }
-            current = std::move(join);
+            current = join;
         }
         else if (auto loop_ = stmt.body.loop()) {
             if (auto cond = loop_->condition()) {
                 MAYBE(cond_node, analyze_expression(tctx, cond->cond));
-                current->condition = std::move(cond_node);
+                tctx.node(current).condition = cond_node;
             }
-            auto join = std::make_shared<CFG>();
+            auto join = tctx.new_node();
             tctx.stack.loop_stack.push_back(CFGTuple{current, join});
             MAYBE(body, analyze_ref(tctx, loop_->body));
             tctx.stack.loop_stack.pop_back();
@@ -138,17 +174,17 @@ namespace ebmgen {
             if (!body.brk) {
                 link(body.end, current);
             }
-            current = std::move(join);
+            current = join;
         }
         else if (auto match_ = stmt.body.match_statement()) {
-            auto join = std::make_shared<CFG>();
+            auto join = tctx.new_node();
             bool all_break = true;
             for (auto& b : match_->branches.container) {
                 MAYBE(branch_stmt, tctx.proxy.get_statement(b));
                 MAYBE(branch_ptr, branch_stmt.body.match_branch());
                 MAYBE(branch, analyze_ref(tctx, branch_ptr.body));
                 MAYBE(cond, analyze_expression(tctx, branch_ptr.condition.cond));
-                branch.start->condition = std::move(cond);
+                tctx.node(branch.start).condition = cond;
                 link(current, branch.start);
                 if (!branch.brk) {
                     link(branch.end, join);
@@ -159,7 +195,7 @@ namespace ebmgen {
                 link(current, join);
             }
             brk = all_break;
-            current = std::move(join);
+            current = join;
         }
         else if (auto cont = stmt.body.continue_()) {
             if (tctx.stack.loop_stack.size() == 0) {
@@ -181,7 +217,7 @@ namespace ebmgen {
             if (stmt.body.kind != ebm::StatementKind::ERROR_REPORT) {
                 if (stmt.body.value()->id.value() != 0) {
                     MAYBE(expr_node, analyze_expression(tctx, *stmt.body.value()));
-                    current->condition = std::move(expr_node);
+                    tctx.node(current).condition = expr_node;
                 }
             }
             link(current, tctx.stack.end_of_function);
@@ -192,24 +228,24 @@ namespace ebmgen {
             auto io_ = stmt.body.read_data() ? stmt.body.read_data() : stmt.body.write_data();
             if (auto lw = io_->lowered_statement()) {
                 MAYBE(r, analyze_lowered(tctx, lw->io_statement.id));
-                current->lowered = std::move(r);
+                tctx.build[current].lowered = std::move(r);
             }
             if (!is_nil(io_->target)) {
                 MAYBE(expr_node, analyze_expression(tctx, io_->target));
-                current->condition = expr_node;
+                tctx.node(current).condition = expr_node;
             }
         }
         else if (auto var_decl = stmt.body.var_decl()) {
             MAYBE(expr_node, analyze_expression(tctx, var_decl->initial_value));
-            current->condition = expr_node;
+            tctx.node(current).condition = expr_node;
         }
         else if (auto expr = stmt.body.expression()) {
             MAYBE(expr_node, analyze_expression(tctx, *expr));
-            current->condition = std::move(expr_node);
+            tctx.node(current).condition = expr_node;
         }
         else if (auto assert_ = stmt.body.assert_desc()) {
             MAYBE(expr_node, analyze_expression(tctx, assert_->condition.cond));
-            current->condition = std::move(expr_node);
+            tctx.node(current).condition = expr_node;
         }
         else if (auto desc = stmt.body.sub_byte_range()) {
             MAYBE(range, analyze_ref(tctx, desc->io_statement));
@@ -219,227 +255,262 @@ namespace ebmgen {
         }
         return CFGTuple{root, current, brk};
     }
+
     struct OptimizeContext {
-        std::map<std::shared_ptr<CFG>, std::set<std::shared_ptr<CFG>>> per_roots;
-        std::set<std::shared_ptr<CFG>> all_cfg;
-        std::set<std::shared_ptr<CFG>>* current_root = nullptr;
+        InternalCFGContext& cfg;
+        std::vector<CFGIndex>& owner;  // root which the node is reached from first. cfg_nil if not yet reached
+        std::vector<CFGIndex> roots;
+        std::unordered_set<CFGIndex> root_set;
+        CFGIndex current_root = cfg_nil;
 
-        void with_root(std::shared_ptr<CFG>& cfg, auto&& fn) {
+        void with_root(CFGIndex root, auto&& fn) {
             auto tmp = current_root;
             const auto _defer = futils::helper::defer([&] {
                 current_root = tmp;
             });
-            current_root = &per_roots[cfg];
+            if (root_set.insert(root).second) {
+                roots.push_back(root);
+            }
+            current_root = root;
             fn();
         }
     };
 
-    std::shared_ptr<CFG> optimize_cfg_node(std::shared_ptr<CFG>& cfg, OptimizeContext& ctx);
+    CFGIndex optimize_cfg_node(CFGIndex cfg, OptimizeContext& ctx);
 
-    std::shared_ptr<CFGExpression> optimize_cfg_expression(std::shared_ptr<CFGExpression>& cfg, OptimizeContext& ctx) {
-        for (auto& child : cfg->children) {
-            child = optimize_cfg_expression(child, ctx);
+    void optimize_cfg_expression(CFGIndex expr, OptimizeContext& ctx) {
+        auto children = ctx.cfg.expression(expr).children;
+        for (auto i = children.offset; i < children.offset + children.size; i++) {
+            optimize_cfg_expression(i, ctx);
         }
-        if (cfg->related_cfg) {
-            ctx.with_root(cfg->related_cfg->start, [&] {
-                cfg->related_cfg->start = optimize_cfg_node(cfg->related_cfg->start, ctx);
+        if (auto related = ctx.cfg.expression(expr).related_cfg) {
+            ctx.with_root(related->start, [&] {
+                ctx.cfg.expression(expr).related_cfg->start = optimize_cfg_node(related->start, ctx);
             });
         }
-        return cfg;
     }
 
-    void unique(std::shared_ptr<CFG>& cfg) {
-        std::unordered_set<std::shared_ptr<CFG>> uniq;
-        std::erase_if(cfg->next, [&](auto& q) {
+    void unique(std::vector<CFGIndex>& edges) {
+        std::unordered_set<CFGIndex> uniq;
+        std::erase_if(edges, [&](auto q) {
             return !uniq.insert(q).second;
         });
-        uniq.clear();
-        std::erase_if(cfg->prev, [&](auto& q) {
-            return !uniq.insert(q.lock()).second;
-        });
     }
 
     // remove <phi> node (not related to original node)
-    std::shared_ptr<CFG> optimize_cfg_node(std::shared_ptr<CFG>& cfg, OptimizeContext& ctx) {
-        if (ctx.all_cfg.find(cfg) != ctx.all_cfg.end()) {
+    CFGIndex optimize_cfg_node(CFGIndex cfg, OptimizeContext& ctx) {
+        if (ctx.owner[cfg] != cfg_nil) {
             return cfg;
         }
-        unique(cfg);
-        if (cfg->prev.size() && cfg->next.size() == 1 && is_nil(cfg->original_node)) {
-            auto rem = cfg;
-            for (auto& prev : rem->prev) {
-                if (auto p = prev.lock()) {
-                    for (auto& n : p->next) {
-                        if (n == cfg) {
-                            n = rem->next[0];
-                        }
+        auto& build = ctx.cfg.build;
+        unique(build[cfg].next);
+        unique(build[cfg].prev);
+        if (build[cfg].prev.size() && build[cfg].next.size() == 1 && is_nil(ctx.cfg.node(cfg).original_node)) {
+            auto to = build[cfg].next[0];
+            for (auto p : build[cfg].prev) {
+                for (auto& n : build[p].next) {
+                    if (n == cfg) {
+                        n = to;
                     }
                 }
             }
-            std::erase_if(rem->next[0]->prev, [&](auto& a) {
-                return a.lock() == rem;
-            });
-            rem->next[0]->prev.insert(rem->next[0]->prev.end(), rem->prev.begin(), rem->prev.end());
-            return optimize_cfg_node(rem->next[0], ctx);
+            std::erase(build[to].prev, cfg);
+            build[to].prev.insert(build[to].prev.end(), build[cfg].prev.begin(), build[cfg].prev.end());
+            return optimize_cfg_node(to, ctx);
         }
-        ctx.all_cfg.insert(cfg);
-        ctx.current_root->insert(cfg);
-        for (auto& n : cfg->next) {
-            n = optimize_cfg_node(n, ctx);
+        ctx.owner[cfg] = ctx.current_root;
+        // next is not resized while visiting successors, only rewritten in place
+        for (size_t i = 0; i < build[cfg].next.size(); i++) {
+            build[cfg].next[i] = optimize_cfg_node(build[cfg].next[i], ctx);
         }
-        for (auto& v : cfg->lowered) {
-            ctx.with_root(v.start, [&] {
-                v.start = optimize_cfg_node(v.start, ctx);
+        for (size_t i = 0; i < build[cfg].lowered.size(); i++) {
+            ctx.with_root(build[cfg].lowered[i].start, [&] {
+                build[cfg].lowered[i].start = optimize_cfg_node(build[cfg].lowered[i].start, ctx);
             });
         }
-        if (cfg->condition) {
-            cfg->condition = optimize_cfg_expression(cfg->condition, ctx);
+        if (auto cond = ctx.cfg.node(cfg).condition; cond != cfg_nil) {
+            optimize_cfg_expression(cond, ctx);
         }
         return cfg;
     }
 
-    expected<void> analyze_dominators(DominatorTree& dom_tree, const std::shared_ptr<CFG>& root, std::set<std::shared_ptr<CFG>>& all_node) {
+    // Cooper, Harvey, Kennedy: "A Simple, Fast Dominance Algorithm"
+    // nodes reached from root (owner[n] == root) form the subgraph
+    void analyze_dominators(DominatorTree& dom_tree, InternalCFGContext& tctx, CFGIndex root, const std::vector<CFGIndex>& owner) {
         dom_tree.roots.push_back(root);
-        std::map<std::shared_ptr<CFG>, std::set<std::shared_ptr<CFG>>> doms;
-        for (auto& n : all_node) {
-            if (n == root) {
-                doms[n].insert(n);
-            }
-            else {
-                doms[n] = all_node;
+        auto& build = tctx.build;
+        auto local = [&](CFGIndex n) {
+            return n - dom_tree.base;
+        };
+        auto in_subgraph = [&](CFGIndex n) {
+            return n >= dom_tree.base && local(n) < dom_tree.parent.size() && owner[n] == root;
+        };
+        if (!in_subgraph(root)) {
+            return;
+        }
+        // reverse post order
+        std::vector<CFGIndex> post_order;
+        std::vector<std::uint32_t> order(dom_tree.parent.size(), ~std::uint32_t(0));
+        std::vector<std::pair<CFGIndex, size_t>> stack;
+        std::vector<bool> visited(dom_tree.parent.size());
+        visited[local(root)] = true;
+        stack.push_back({root, 0});
+        while (stack.size()) {
+            auto& [n, i] = stack.back();
+            if (i < build[n].next.size()) {
+                auto succ = build[n].next[i++];
+                if (in_subgraph(succ) && !visited[local(succ)]) {
+                    visited[local(succ)] = true;
+                    stack.push_back({succ, 0});
+                }
+                continue;
             }
+            order[local(n)] = std::uint32_t(post_order.size());
+            post_order.push_back(n);
+            stack.pop_back();
         }
+        auto& idom = dom_tree.parent;
+        idom[local(root)] = root;
+        auto intersect = [&](CFGIndex a, CFGIndex b) {
+            while (a != b) {
+                while (order[local(a)] < order[local(b)]) {
+                    a = idom[local(a)];
+                }
+                while (order[local(b)] < order[local(a)]) {
+                    b = idom[local(b)];
+                }
+            }
+            return a;
+        };
         bool changed = true;
         while (changed) {
             changed = false;
-            // 開始ノード以外の全てのノードnについてループ
-            for (auto& n : all_node) {
+            for (auto it = post_order.rbegin(); it != post_order.rend(); it++) {
+                auto n = *it;
                 if (n == root) continue;
-
-                // ===== nの支配集合を再計算 =====
-
-                // 1. nの先行ノード(prev)全ての支配集合の共通部分(intersection)を求める
-                std::optional<std::set<std::shared_ptr<CFG>>> intersection;
-
-                for (auto& weak_pred : n->prev) {
-                    if (auto pred = weak_pred.lock()) {  // weak_ptrからshared_ptrを取得
-                        auto found = doms.find(pred);
-                        if (found == doms.end()) {
-                            continue;  // 外部ノード
-                        }
-                        auto& nodes = found->second;
-                        if (!intersection.has_value()) {
-                            // 最初の先行ノード
-                            intersection = nodes;
-                        }
-                        else {
-                            // 2つ目以降は、現在の共通集合と積集合を取る
-                            // (C++では std::set_intersection などを利用)
-                            std::set<std::shared_ptr<CFG>> temp_result;
-                            std::set_intersection(
-                                intersection->begin(), intersection->end(),
-                                nodes.begin(), nodes.end(),
-                                std::inserter(temp_result, temp_result.begin()));
-                            intersection = std::move(temp_result);
-                        }
+                CFGIndex new_idom = cfg_nil;
+                for (auto pred : build[n].prev) {
+                    if (!in_subgraph(pred) || idom[local(pred)] == cfg_nil) {
+                        continue;  // outside of subgraph or not processed yet
                     }
+                    new_idom = new_idom == cfg_nil ? pred : intersect(pred, new_idom);
                 }
-
-                // 2. 求めた共通部分に、ノードn自身を加える
-                std::set<std::shared_ptr<CFG>> new_doms_for_n;
-                if (intersection.has_value()) {
-                    new_doms_for_n = *intersection;
-                }
-                new_doms_for_n.insert(n);
-
-                // 3. もし支配集合が変化していたら、更新してフラグを立てる
-                if (new_doms_for_n != doms.at(n)) {
-                    doms[n] = new_doms_for_n;
+                if (new_idom != cfg_nil && idom[local(n)] != new_idom) {
+                    idom[local(n)] = new_idom;
                     changed = true;
                 }
             }
         }
+        idom[local(root)] = cfg_nil;
+    }
 
-        // 全てのノードnについてループ
-        for (const auto& n : all_node) {
-            if (n == root) continue;
-
-            // nの支配ノードからn自身を除いた集合Sを用意
-            const auto& n_doms = doms.at(n);
-
-            std::shared_ptr<CFG> best_candidate = nullptr;
-            size_t max_size = 0;
-
-            // 集合Sの中で、|doms(d)|が最大になるdを探す
-            for (const auto& d : n_doms) {
-                if (d == n) continue;  // n自身は除外
-
-                const size_t candidate_size = doms.at(d).size();
-                if (candidate_size > max_size) {
-                    max_size = candidate_size;
-                    best_candidate = d;
-                }
-            }
-
-            if (best_candidate) {
-                dom_tree.parent[n] = best_candidate;
-            }
+    // move per node edges into contiguous arrays
+    void compact_cfg(InternalCFGContext& tctx) {
+        auto& graph = tctx.stack.graph;
+        size_t next_count = 0, prev_count = 0, lowered_count = 0;
+        for (auto& b : tctx.build) {
+            next_count += b.next.size();
+            prev_count += b.prev.size();
+            lowered_count += b.lowered.size();
         }
-
-        return {};
+        graph.next_edges.reserve(next_count);
+        graph.prev_edges.reserve(prev_count);
+        graph.lowered.reserve(lowered_count);
+        for (size_t i = 0; i < tctx.build.size(); i++) {
+            auto& b = tctx.build[i];
+            auto& node = graph.nodes[i];
+            node.next = CFGRange{std::uint32_t(graph.next_edges.size()), std::uint32_t(b.next.size())};
+            graph.next_edges.insert(graph.next_edges.end(), b.next.begin(), b.next.end());
+            node.prev = CFGRange{std::uint32_t(graph.prev_edges.size()), std::uint32_t(b.prev.size())};
+            graph.prev_edges.insert(graph.prev_edges.end(), b.prev.begin(), b.prev.end());
+            node.lowered = CFGRange{std::uint32_t(graph.lowered.size()), std::uint32_t(b.lowered.size())};
+            graph.lowered.insert(graph.lowered.end(), b.lowered.begin(), b.lowered.end());
+        }
+        tctx.build.clear();
     }
 
-    expected<CFGList> analyze_control_flow_graph(CFGStack& stack, RepositoryProxy proxy) {
+    expected<CFGList> analyze_control_flow_graph(CFGStack& stack, RepositoryProxy proxy, std::function<void(const char*)> timer) {
         InternalCFGContext ctx{
             .stack = stack,
             .proxy = proxy,
         };
+        stack.graph = {};
         auto all_stmt = ctx.proxy.get_all_statement();
         CFGList cfg_list;
+        cfg_list.graph = &stack.graph;
+        std::vector<CFGIndex> end_index;
         for (auto& stmt : *all_stmt) {
             auto fn = stmt.body.func_decl();
             if (!fn) {
                 continue;
             }
-            ctx.stack.end_of_function = std::make_shared<CFG>();
+            auto base = CFGIndex(stack.graph.nodes.size());
+            ctx.stack.end_of_function = ctx.new_node();
             MAYBE(cfg, analyze_ref(ctx, fn->body));
-            cfg.end->next.push_back(ctx.stack.end_of_function);
-            ctx.stack.end_of_function->prev.push_back(cfg.end);
-            OptimizeContext ctx;
-            ctx.with_root(cfg.start, [&] {
-                cfg.start = optimize_cfg_node(cfg.start, ctx);
+            ctx.link(cfg.end, ctx.stack.end_of_function);
+            cfg_list.list.push_back(CFGResult{
+                .function_id = get_id(stmt.id),
+                .cfg = cfg,
+                .dom_tree = {.base = base},
             });
-            DominatorTree dom_tree;
-            for (auto& p : ctx.per_roots) {
-                MAYBE_VOID(dom_tree, analyze_dominators(dom_tree, p.first, p.second));
+            end_index.push_back(CFGIndex(stack.graph.nodes.size()));
+        }
+        if (timer) {
+            timer("cfg build");
+        }
+        std::vector<CFGIndex> owner(stack.graph.nodes.size(), cfg_nil);
+        for (auto& result : cfg_list.list) {
+            OptimizeContext opt{.cfg = ctx, .owner = owner};
+            opt.with_root(result.cfg.start, [&] {
+                result.cfg.start = optimize_cfg_node(result.cfg.start, opt);
+            });
+            result.dom_tree.roots = std::move(opt.roots);
+        }
+        if (timer) {
+            timer("cfg remove phi");
+        }
+        for (size_t i = 0; i < cfg_list.list.size(); i++) {
+            auto& dom_tree = cfg_list.list[i].dom_tree;
+            auto roots = std::move(dom_tree.roots);
+            dom_tree.parent.assign(end_index[i] - dom_tree.base, cfg_nil);
+            for (auto root : roots) {
+                analyze_dominators(dom_tree, ctx, root, owner);
             }
-            cfg_list.list[get_id(stmt.id)] = CFGResult{
-                .cfg = std::move(cfg),
-                .dom_tree = std::move(dom_tree),
-            };
+        }
+        if (timer) {
+            timer("cfg dominators");
+        }
+        compact_cfg(ctx);
+        std::stable_sort(cfg_list.list.begin(), cfg_list.list.end(), [](const CFGResult& a, const CFGResult& b) {
+            return a.function_id < b.function_id;
+        });
+        if (timer) {
+            timer("cfg compact");
         }
         return cfg_list;
     }
 
     void write_cfg(futils::binary::writer& result, const CFGList& m, const MappingTable& ctx) {
         futils::code::CodeWriter<std::string> w;
+        auto& g = *m.graph;
         std::uint64_t id = 0;
-        std::map<std::shared_ptr<CFG>, std::uint64_t> node_id;
-        std::set<std::pair<std::shared_ptr<CFG>, std::shared_ptr<CFG>>> dominate_edges;
-        std::map<std::shared_ptr<CFGExpression>, std::uint64_t> expr_id;
+        std::vector<std::optional<std::uint64_t>> node_id(g.nodes.size());
+        std::set<std::pair<CFGIndex, CFGIndex>> dominate_edges;
+        std::vector<std::optional<std::uint64_t>> expr_id(g.expressions.size());
         std::vector<std::function<void()>> inter_subgraph_vector;
-        auto write_expr = [&](auto&& write, auto&& write_expr, const std::shared_ptr<CFGExpression>& cfg, const DominatorTree& dom_tree) -> void {
-            if (expr_id.find(cfg) != expr_id.end()) {
+        auto write_expr = [&](auto&& write, auto&& write_expr, CFGIndex cfg, const DominatorTree& dom_tree) -> void {
+            if (expr_id[cfg]) {
                 return;
             }
             expr_id[cfg] = id++;
-            w.write(std::format("{} [label=\"", expr_id[cfg]));
-            auto origin = ctx.get_expression(cfg->original_node);
-            if (cfg->children.size()) {
-                w.write(std::format("{}:{}\\n", origin ? to_string(origin->body.kind) : "<end>", get_id(cfg->original_node)));
+            auto& expr = g.expression(cfg);
+            w.write(std::format("{} [label=\"", *expr_id[cfg]));
+            auto origin = ctx.get_expression(expr.original_node);
+            if (expr.children.size) {
+                w.write(std::format("{}:{}\\n", origin ? to_string(origin->body.kind) : "<end>", get_id(expr.original_node)));
             }
             else {
-                w.write(std::format("{}:{}\\n", origin ? to_string(origin->body.kind) : "<phi>", get_id(cfg->original_node)));
+                w.write(std::format("{}:{}\\n", origin ? to_string(origin->body.kind) : "<phi>", get_id(expr.original_node)));
             }
             if (origin) {
                 origin->body.visit([&](auto&& visitor, std::string_view name, auto&& value) -> void {
@@ -467,17 +538,17 @@ namespace ebmgen {
                 });
             }
             w.writeln("\"];");
-            for (auto& child : cfg->children) {
+            for (auto child = expr.children.offset; child < expr.children.offset + expr.children.size; child++) {
                 write_expr(write, write_expr, child, dom_tree);
-                w.write(std::format("{} -> {}", expr_id[cfg], expr_id[child]));
-                if (child->relation_name.size()) {
-                    w.write(" [label=\"", child->relation_name, "\"]");
+                w.write(std::format("{} -> {}", *expr_id[cfg], *expr_id[child]));
+                if (auto relation = g.expression(child).relation_name; relation.size()) {
+                    w.write(" [label=\"", relation, "\"]");
                 }
                 w.writeln(";");
             }
-            if (cfg->related_cfg) {
-                write(write, write_expr, dom_tree, std::nullopt, cfg->related_cfg->start);
-                w.writeln(std::format("{} -> {} [style=dotted,label=\"related\"];", expr_id[cfg], node_id[cfg->related_cfg->start]));
+            if (expr.related_cfg) {
+                write(write, write_expr, dom_tree, std::nullopt, expr.related_cfg->start);
+                w.writeln(std::format("{} -> {} [style=dotted,label=\"related\"];", *expr_id[cfg], *node_id[expr.related_cfg->start]));
             }
             if (auto call_ = origin ? origin->body.call_desc() : nullptr) {
                 auto expr = ctx.get_expression(call_->callee);
@@ -490,31 +561,31 @@ namespace ebmgen {
                 }
                 if (expr) {
                     if (auto id = expr->body.id()) {
-                        auto found = m.list.find(get_id(*id));
-                        if (found != m.list.end()) {
+                        if (auto found = m.find(get_id(*id))) {
                             inter_subgraph_vector.push_back([&, found, cfg] {
-                                w.writeln(std::format("{} -> {} [style=dotted,label=\"call\"];", expr_id[cfg], node_id[found->second.cfg.start]));
+                                w.writeln(std::format("{} -> {} [style=dotted,label=\"call\"];", *expr_id[cfg], node_id[found->cfg.start].value_or(0)));
                             });
                         }
                     }
                 }
             }
         };
-        auto write_node = [&](auto&& write, auto&& write_expr, const DominatorTree& dom_tree, std::optional<std::string> name, const std::shared_ptr<CFG>& cfg) -> void {
-            if (node_id.find(cfg) != node_id.end()) {
+        auto write_node = [&](auto&& write, auto&& write_expr, const DominatorTree& dom_tree, std::optional<std::string> name, CFGIndex cfg) -> void {
+            if (node_id[cfg]) {
                 return;
             }
             node_id[cfg] = id++;
-            w.write(std::format("{} [label=\"", node_id[cfg]));
+            auto& node = g.node(cfg);
+            w.write(std::format("{} [label=\"", *node_id[cfg]));
             if (name) {
                 w.write(std::format("fn {}\\n", name.value()));
             }
-            auto origin = ctx.get_statement(cfg->original_node);
-            if (cfg->next.size() == 0) {
-                w.write(std::format("{}:{}\\n", origin ? to_string(origin->body.kind) : "<end>", get_id(cfg->original_node)));
+            auto origin = ctx.get_statement(node.original_node);
+            if (node.next.size == 0) {
+                w.write(std::format("{}:{}\\n", origin ? to_string(origin->body.kind) : "<end>", get_id(node.original_node)));
             }
             else {
-                w.write(std::format("{}:{}\\n", origin ? to_string(origin->body.kind) : "<phi>", get_id(cfg->original_node)));
+                w.write(std::format("{}:{}\\n", origin ? to_string(origin->body.kind) : "<phi>", get_id(node.original_node)));
             }
             if (origin) {
                 auto add_io = [&](const ebm::IOData* io) {
@@ -540,40 +611,40 @@ namespace ebmgen {
             }
 
             w.writeln("\"];");
-            for (auto& n : cfg->next) {
+            for (auto n : g.next(cfg)) {
                 write(write, write_expr, dom_tree, std::nullopt, n);
-                w.write(std::format("{} -> {}", node_id[cfg], node_id[n]));
-                if (n->condition) {
-                    auto cond_expr = ctx.get_expression(n->condition->original_node);
-                    w.write(std::format("[label=\"{}:{}\"]", cond_expr ? to_string(cond_expr->body.kind) : "<unknown expr>", get_id(n->condition->original_node)));
+                auto condition = g.node(n).condition;
+                w.write(std::format("{} -> {}", *node_id[cfg], *node_id[n]));
+                if (condition != cfg_nil) {
+                    auto cond_node = g.expression(condition).original_node;
+                    auto cond_expr = ctx.get_expression(cond_node);
+                    w.write(std::format("[label=\"{}:{}\"]", cond_expr ? to_string(cond_expr->body.kind) : "<unknown expr>", get_id(cond_node)));
                 }
                 w.writeln(";");
-                if (n->condition) {
-                    write_expr(write, write_expr, n->condition, dom_tree);
-                    w.writeln(std::format("{} -> {} [style=dotted,label=\"expression\"];", node_id[n], expr_id[n->condition]));
+                if (condition != cfg_nil) {
+                    write_expr(write, write_expr, condition, dom_tree);
+                    w.writeln(std::format("{} -> {} [style=dotted,label=\"expression\"];", *node_id[n], *expr_id[condition]));
                 }
 
-                auto it = dom_tree.parent.find(n);
-                if (it != dom_tree.parent.end()) {
-                    auto parent = it->second;
+                if (auto parent = dom_tree.parent_of(n); parent != cfg_nil) {
                     write(write, write_expr, dom_tree, std::nullopt, parent);
-                    auto dom_id = node_id[parent];
+                    auto dom_id = *node_id[parent];
                     if (dominate_edges.contains({parent, n})) {
                         continue;
                     }
                     dominate_edges.insert({parent, n});
-                    w.writeln(std::format("{} -> {} [style=dotted,label=\"dominates\"];", dom_id, node_id[n]));
+                    w.writeln(std::format("{} -> {} [style=dotted,label=\"dominates\"];", dom_id, *node_id[n]));
                 }
             }
-            for (auto& n : cfg->lowered) {
+            for (auto& n : g.lowered_of(cfg)) {
                 write(write, write_expr, dom_tree, std::nullopt, n.start);
-                w.writeln(std::format("{} -> {} [style=dotted,label=\"lowered\"];", node_id[cfg], node_id[n.start]));
+                w.writeln(std::format("{} -> {} [style=dotted,label=\"lowered\"];", *node_id[cfg], *node_id[n.start]));
             }
         };
         w.writeln("digraph ControlFlowGraph {");
         auto indent = w.indent_scope();
         for (auto& cfg : m.list) {
-            auto fn = ctx.get_statement(ebm::StatementRef{cfg.first});
+            auto fn = ctx.get_statement(ebm::StatementRef{cfg.function_id});
             std::optional<std::string> name;
             if (fn) {
                 if (auto fn_decl = fn->body.func_decl()) {
@@ -596,7 +667,7 @@ namespace ebmgen {
             }
             w.writeln("\" {");
             auto indent = w.indent_scope();
-            write_node(write_node, write_expr, cfg.second.dom_tree, name, cfg.second.cfg.start);
+            write_node(write_node, write_expr, cfg.dom_tree, name, cfg.cfg.start);
             indent.execute();
             w.writeln("}");
         }
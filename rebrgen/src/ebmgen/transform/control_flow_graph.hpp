@@ -1,54 +1,122 @@
 /*license*/
 #pragma once
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+#include <unordered_map>
 #include <vector>
-#include <memory>
 #include <ebm/extended_binary_module.hpp>
 #include "ebmgen/converter.hpp"
 #include "ebmgen/mapping.hpp"
 
 namespace ebmgen {
 
-    struct CFG;
+    // index into CFGGraph::nodes or CFGGraph::expressions
+    using CFGIndex = std::uint32_t;
+    constexpr CFGIndex cfg_nil = ~CFGIndex(0);
+
+    // [offset, offset + size) of a contiguous array in CFGGraph
+    struct CFGRange {
+        std::uint32_t offset = 0;
+        std::uint32_t size = 0;
+    };
+
     struct CFGTuple {
-        std::shared_ptr<CFG> start;
-        std::shared_ptr<CFG> end;
+        CFGIndex start = cfg_nil;
+        CFGIndex end = cfg_nil;
         bool brk = false;  // break the flow
     };
 
     struct CFGExpression {
-        std::weak_ptr<CFGExpression> parent;
+        CFGIndex parent = cfg_nil;
         std::string_view relation_name;
         ebm::ExpressionRef original_node;
-        std::vector<std::shared_ptr<CFGExpression>> children;
+        CFGRange children;  // contiguous in CFGGraph::expressions
         std::optional<CFGTuple> related_cfg;
     };
 
-    // Control Flow Graph
+    // Control Flow Graph node
     // original_node: reference to original statement
-    // next: list of next CFG
-    // prev: list of previous CFG
+    // next: range of next CFG in CFGGraph::next_edges
+    // prev: range of previous CFG in CFGGraph::prev_edges
     struct CFG {
         ebm::StatementRef original_node;
-        std::shared_ptr<CFGExpression> condition;
+        CFGIndex condition = cfg_nil;                    // index into CFGGraph::expressions
         std::optional<ebm::StatementKind> statement_op;  // for debug
-        std::vector<std::shared_ptr<CFG>> next;
-        std::vector<std::weak_ptr<CFG>> prev;
+        CFGRange next;
+        CFGRange prev;
         // for lowered statement representation
+        CFGRange lowered;
+    };
+
+    // all nodes of all analyzed functions.
+    // nodes of one function are allocated contiguously
+    struct CFGGraph {
+        std::vector<CFG> nodes;
+        std::vector<CFGExpression> expressions;
+        std::vector<CFGIndex> next_edges;
+        std::vector<CFGIndex> prev_edges;
         std::vector<CFGTuple> lowered;
+
+        const CFG& node(CFGIndex i) const {
+            return nodes[i];
+        }
+
+        const CFGExpression& expression(CFGIndex i) const {
+            return expressions[i];
+        }
+
+        std::span<const CFGIndex> next(CFGIndex i) const {
+            auto& r = nodes[i].next;
+            return {next_edges.data() + r.offset, r.size};
+        }
+
+        std::span<const CFGIndex> prev(CFGIndex i) const {
+            auto& r = nodes[i].prev;
+            return {prev_edges.data() + r.offset, r.size};
+        }
+
+        std::span<const CFGTuple> lowered_of(CFGIndex i) const {
+            auto& r = nodes[i].lowered;
+            return {lowered.data() + r.offset, r.size};
+        }
     };
 
+    // immediate dominators of nodes in [base, base + parent.size())
     struct DominatorTree {
-        std::vector<std::shared_ptr<CFG>> roots;
-        std::unordered_map<std::shared_ptr<CFG>, std::shared_ptr<CFG>> parent;
+        std::vector<CFGIndex> roots;
+        CFGIndex base = 0;
+        std::vector<CFGIndex> parent;  // cfg_nil for roots and nodes not reached from any root
+
+        CFGIndex parent_of(CFGIndex n) const {
+            if (n < base || n - base >= parent.size()) {
+                return cfg_nil;
+            }
+            return parent[n - base];
+        }
     };
 
     struct CFGResult {
+        std::uint64_t function_id = 0;
         CFGTuple cfg;
         DominatorTree dom_tree;
     };
 
     struct CFGList {
-        std::map<std::uint64_t, CFGResult> list;
+        const CFGGraph* graph = nullptr;
+        std::vector<CFGResult> list;  // sorted by function_id
+
+        const CFGResult* find(std::uint64_t function_id) const {
+            auto it = std::lower_bound(list.begin(), list.end(), function_id, [](const CFGResult& r, std::uint64_t id) {
+                return r.function_id < id;
+            });
+            if (it == list.end() || it->function_id != function_id) {
+                return nullptr;
+            }
+            return &*it;
+        }
     };
 
     struct RepositoryProxy {
@@ -85,8 +153,9 @@ namespace ebmgen {
 
     struct CFGStack {
         std::vector<CFGTuple> loop_stack;
-        std::shared_ptr<CFG> end_of_function;
-        std::map<std::uint64_t, std::shared_ptr<CFG>> cfg_map;
+        CFGIndex end_of_function = cfg_nil;
+        std::unordered_map<std::uint64_t, CFGIndex> cfg_map;
+        CFGGraph graph;
     };
 
     struct CFGContext {
@@ -94,6 +163,6 @@ namespace ebmgen {
         CFGStack stack;
     };
 
-    expected<CFGList> analyze_control_flow_graph(CFGStack& stack, RepositoryProxy proxy);
+    expected<CFGList> analyze_control_flow_graph(CFGStack& stack, RepositoryProxy proxy, std::function<void(const char*)> timer = nullptr);
     void write_cfg(futils::binary::writer& w, const CFGList& m, const MappingTable& ctx);
 }  // namespace ebmgen
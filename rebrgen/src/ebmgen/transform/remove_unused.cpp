@@ -4,12 +4,48 @@
 #include "ebmgen/mapping.hpp"
 #include "transform.hpp"
 #include <cstddef>
-#include <unordered_set>
+#include <optional>
+#include <unordered_map>
 #include <testutil/timer.h>
 
 namespace ebmgen {
 
-    using InverseRefs = std::unordered_map<size_t, std::vector<ebm::AnyRef>>;
+    // EBM ids form one dense space bounded by max_id, so liveness and usage counts are indexed by id
+    struct IdBitset {
+        std::vector<bool> bits;
+
+        // true if newly inserted
+        bool insert(size_t id) {
+            if (id >= bits.size()) {
+                bits.resize(id + 1);
+            }
+            if (bits[id]) {
+                return false;
+            }
+            bits[id] = true;
+            return true;
+        }
+
+        bool contains(size_t id) const {
+            return id < bits.size() && bits[id];
+        }
+    };
+
+    struct Usage {
+        std::vector<size_t> counts;  // id -> number of references
+        // ids in the order they were first referenced. id assignment breaks ties of counts
+        // in the iteration order of an unordered_map filled in this order, as earlier ebmgen did
+        std::vector<size_t> first_use;
+
+        void count(size_t id) {
+            if (id >= counts.size()) {
+                counts.resize(id + 1);
+            }
+            if (counts[id]++ == 0) {
+                first_use.push_back(id);
+            }
+        }
+    };
 
     EBMProxy to_mapping_table(TransformContext& ctx) {
         return EBMProxy(ctx.statement_repository().get_all(),
@@ -21,59 +57,96 @@ namespace ebmgen {
                         ctx.debug_locations());
     }
 
-    expected<InverseRefs> mark_and_sweep(TransformContext& ctx, std::function<void(const char*)> timer) {
+    expected<Usage> mark_and_sweep(TransformContext& ctx, size_t max_id, std::function<void(const char*)> timer) {
         MappingTable table{to_mapping_table(ctx), lazy_init};
         table.build_maps(mapping::BuildMapOption::NONE);
-        std::unordered_set<size_t> reachable;
-        InverseRefs inverse_refs;  // ref -> item.id
-        auto search = [&](auto&& search, const auto& item) -> void {
-            item.body.visit([&](auto&& visitor, const char* name, auto&& val) -> void {
-                if constexpr (AnyRef<decltype(val)>) {
-                    if (!is_nil(val)) {
-                        // if newly reachable, mark and search further
-                        if (reachable.insert(get_id(val)).second) {
-                            auto object = table.get_object(val);
-                            std::visit(
-                                [&](auto&& obj) -> void {
-                                    using T = std::decay_t<decltype(obj)>;
-                                    if constexpr (std::is_pointer_v<T>) {
-                                        // if val is an alias, also mark the canonical ID reachable
-                                        auto canonical_id = get_id(obj->id);
-                                        if (canonical_id != get_id(val)) {
-                                            reachable.insert(canonical_id);
-                                            inverse_refs[canonical_id].push_back(to_any_ref(item.id));
-                                        }
-                                        search(search, *obj);
-                                    }
-                                },
-                                object);
-                        }
-                        inverse_refs[get_id(val)].push_back(to_any_ref(item.id));
+        IdBitset reachable;
+        reachable.bits.resize(max_id + 1);
+        Usage usage;
+        usage.counts.resize(max_id + 1);
+        // depth first search with explicit stack. references of an object (id and the object it resolves to)
+        // are collected into refs when it is entered,
+        // and a reference is counted after the object it made reachable is finished, same as a recursive search would.
+        // this keeps Usage::first_use (and so the id assignment) equal to the recursive search of earlier ebmgen
+        struct Frame {
+            size_t begin = 0;  // refs[begin, end) are references of this object
+            size_t next = 0;
+            size_t end = 0;
+            std::optional<size_t> counted_on_exit;  // reference which made this object reachable
+        };
+        std::vector<std::pair<size_t, ObjectVariant>> refs;
+        std::vector<Frame> stack;
+        auto enter = [&](const ObjectVariant& object, std::optional<size_t> counted_on_exit) {
+            Frame frame{.begin = refs.size(), .counted_on_exit = counted_on_exit};
+            std::visit(
+                [&](auto&& obj) -> void {
+                    using T = std::decay_t<decltype(obj)>;
+                    if constexpr (std::is_pointer_v<T>) {
+                        obj->body.visit([&](auto&& visitor, const char* name, auto&& val) -> void {
+                            if constexpr (AnyRef<decltype(val)>) {
+                                if (!is_nil(val)) {
+                                    refs.push_back({get_id(val), table.get_object(val)});
+                                }
+                            }
+                            else
+                                VISITOR_RECURSE_CONTAINER(visitor, name, val)
+                            else VISITOR_RECURSE(visitor, name, val)
+                        });
                     }
-                }
-                else
-                    VISITOR_RECURSE_CONTAINER(visitor, name, val)
-                else VISITOR_RECURSE(visitor, name, val)
-            });
+                },
+                object);
+            frame.next = frame.begin;
+            frame.end = refs.size();
+            stack.push_back(frame);
         };
         // root is item_id == 1
         reachable.insert(1);
-        {
-            ebm::StatementRef root{1};
-            auto object = table.get_object(root);
-            std::visit(
-                [&](auto&& obj) -> void {
+        enter(table.get_object(ebm::StatementRef{1}), std::nullopt);
+        while (!stack.empty()) {
+            auto& frame = stack.back();
+            if (frame.next == frame.end) {
+                auto counted_on_exit = frame.counted_on_exit;
+                refs.resize(frame.begin);
+                stack.pop_back();
+                if (counted_on_exit) {
+                    usage.count(*counted_on_exit);
+                }
+                continue;
+            }
+            auto id = refs[frame.next].first;
+            auto object = refs[frame.next].second;  // copy; enter may grow refs
+            frame.next++;
+            // if newly reachable, mark and search further
+            if (!reachable.insert(id)) {
+                usage.count(id);
+                continue;
+            }
+            bool found = std::visit(
+                [&](auto&& obj) -> bool {
                     using T = std::decay_t<decltype(obj)>;
                     if constexpr (std::is_pointer_v<T>) {
-                        search(search, *obj);
+                        // if id is an alias, also mark the canonical ID reachable
+                        auto canonical_id = get_id(obj->id);
+                        if (canonical_id != id) {
+                            reachable.insert(canonical_id);
+                            usage.count(canonical_id);
+                        }
+                        return true;
                     }
+                    return false;
                 },
                 object);
+            if (found) {
+                enter(object, id);  // frame is invalidated here
+            }
+            else {
+                usage.count(id);
+            }
         }
         // also, reachable from file names
         for (const auto& d : ctx.file_names()) {
             reachable.insert(get_id(d));
-            inverse_refs[get_id(d)].push_back(ebm::AnyRef{1});  // used from root
+            usage.count(get_id(d));  // used from root
         }
         if (timer) {
             timer("mark phase");
@@ -84,7 +157,7 @@ namespace ebmgen {
             std::decay_t<decltype(rem)> new_vec;
             new_vec.reserve(rem.size());
             for (auto& r : rem) {
-                if (reachable.find(get_id(r.id)) == reachable.end()) {
+                if (!reachable.contains(get_id(r.id))) {
                     remove_count++;
                     if (ebmgen::verbose_error) {
                         print_if_verbose("Removing unused item: ", get_id(r.id));
@@ -105,30 +178,38 @@ namespace ebmgen {
         remove(ctx.string_repository().get_all());
         remove(ctx.expression_repository().get_all());
         std::erase_if(ctx.alias_vector(), [&](const auto& alias) {
-            return reachable.find(get_id(alias.from)) == reachable.end() ||
-                   reachable.find(get_id(alias.to)) == reachable.end();
+            return !reachable.contains(get_id(alias.from)) ||
+                   !reachable.contains(get_id(alias.to));
         });
         print_if_verbose("Total removed unused items: ", remove_count, "\n");
         if (timer) {
             timer("sweep phase");
         }
-        return inverse_refs;
+        return usage;
     }
 
     expected<void> remove_unused_object(TransformContext& ctx, std::function<void(const char*)> timer) {
         MAYBE(max_id, ctx.max_id());
         futils::test::Timer t;
-        MAYBE(inverse_refs, mark_and_sweep(ctx, timer));
+        MAYBE(usage, mark_and_sweep(ctx, max_id.value(), timer));
 
         print_if_verbose("Removed unused items in ", t.next_step<std::chrono::microseconds>(), "\n");
+        // most used id gets smallest new id. ties keep the iteration order of an unordered_map
+        // filled in first use order, which is what earlier ebmgen (and its golden outputs) assigned
+        std::unordered_map<size_t, size_t> first_use;
+        for (auto id : usage.first_use) {
+            first_use.emplace(id, usage.counts[id]);
+        }
         std::vector<std::tuple<ebm::AnyRef, size_t>> most_used;
-        for (const auto& [id, refs] : inverse_refs) {
-            most_used.emplace_back(ebm::AnyRef{id}, refs.size());
+        most_used.reserve(first_use.size());
+        for (const auto& [id, count] : first_use) {
+            most_used.emplace_back(ebm::AnyRef{id}, count);
         }
         std::stable_sort(most_used.begin(), most_used.end(), [](const auto& a, const auto& b) {
             return std::get<1>(a) > std::get<1>(b);
         });
-        std::unordered_map<size_t, ebm::AnyRef> old_to_new;
+        // old id -> new id. nil if not remapped
+        std::vector<ebm::AnyRef> old_to_new(std::max<size_t>(usage.counts.size(), 2));
         ctx.set_max_id(0);  // reset
         for (auto& mapping : most_used) {
             MAYBE(new_id, ctx.new_id());
@@ -136,13 +217,19 @@ namespace ebmgen {
         }
         MAYBE(entry_id, ctx.new_id());
         old_to_new[1] = entry_id;
+        auto find_new = [&](size_t id) -> const ebm::AnyRef* {
+            if (id < old_to_new.size() && !is_nil(old_to_new[id])) {
+                return &old_to_new[id];
+            }
+            return nullptr;
+        };
         auto remap = [&](auto& vec) {
             t.reset();
             std::vector<std::pair<ebm::AnyRef, size_t>> id_sort;
             size_t index = 0;
             for (auto& item : vec) {
-                if (auto it = old_to_new.find(get_id(item.id)); it != old_to_new.end()) {
-                    item.id.id = it->second.id;
+                if (auto it = find_new(get_id(item.id))) {
+                    item.id.id = it->id;
                 }
                 else {
                     if (ebmgen::verbose_error) {
@@ -154,9 +241,8 @@ namespace ebmgen {
                 item.body.visit([&](auto&& visitor, const char* name, auto&& val, std::optional<size_t> index = std::nullopt) -> void {
                     if constexpr (AnyRef<decltype(val)>) {
                         if (!is_nil(val)) {
-                            auto it = old_to_new.find(get_id(val));
-                            if (it != old_to_new.end()) {
-                                val.id = it->second.id;
+                            if (auto it = find_new(get_id(val))) {
+                                val.id = it->id;
                             }
                         }
                     }
@@ -190,16 +276,16 @@ namespace ebmgen {
         remap(ctx.expression_repository().get_all());
         t.reset();
         for (auto& alias : ctx.alias_vector()) {
-            if (auto it = old_to_new.find(get_id(alias.from)); it != old_to_new.end()) {
-                alias.from.id = it->second.id;
+            if (auto it = find_new(get_id(alias.from))) {
+                alias.from.id = it->id;
             }
             else {
                 if (ebmgen::verbose_error) {
                     print_if_verbose("Warning: alias with from id ", get_id(alias.from), " is not reachable but still present. This may cause issues.\n");
                 }
             }
-            if (auto it = old_to_new.find(get_id(alias.to)); it != old_to_new.end()) {
-                alias.to.id = it->second.id;
+            if (auto it = find_new(get_id(alias.to))) {
+                alias.to.id = it->id;
             }
             else {
                 if (ebmgen::verbose_error) {
@@ -216,7 +302,7 @@ namespace ebmgen {
         t.reset();
         size_t removed_debug = 0;
         std::erase_if(ctx.debug_locations(), [&](auto& d) {
-            if (!old_to_new.contains(get_id(d.ident))) {
+            if (!find_new(get_id(d.ident))) {
                 removed_debug++;
                 return true;
             }
@@ -224,15 +310,15 @@ namespace ebmgen {
         });
         print_if_verbose("Removed ", removed_debug, " unreferenced debug information in ", t.delta<std::chrono::microseconds>(), "\n");
         for (auto& loc : ctx.debug_locations()) {
-            if (auto it = old_to_new.find(get_id(loc.ident)); it != old_to_new.end()) {
-                loc.ident.id = it->second.id;
+            if (auto it = find_new(get_id(loc.ident))) {
+                loc.ident.id = it->id;
             }
         }
         print_if_verbose("Remap ", ctx.debug_locations().size(), " items in ", t.delta<std::chrono::microseconds>(), "\n");
         t.reset();
         for (auto& f : ctx.file_names()) {
-            if (auto it = old_to_new.find(get_id(f)); it != old_to_new.end()) {
-                f.id = it->second.id;
+            if (auto it = find_new(get_id(f))) {
+                f.id = it->id;
             }
         }
         if (timer) {
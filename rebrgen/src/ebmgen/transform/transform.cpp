@@ -16,18 +16,9 @@ namespace ebmgen {
         // internal CFG used optimization
         {
             CFGContext cfg_ctx{ctx};
-            MAYBE(cfg, analyze_control_flow_graph(cfg_ctx.stack, {&ctx.context().repository(), &ctx.statement_repository().get_all()}));
-            if (timer) {
-                timer("initial cfg");
-            }
-            MAYBE_VOID(bit_io_read, lowered_dynamic_bit_io(cfg_ctx, false));
-            if (timer) {
-                timer("bit io read");
-            }
-            MAYBE_VOID(bit_io_write, lowered_dynamic_bit_io(cfg_ctx, true));
-            if (timer) {
-                timer("bit io write");
-            }
+            MAYBE(cfg, analyze_control_flow_graph(cfg_ctx.stack, {&ctx.context().repository(), &ctx.statement_repository().get_all()}, timer));
+            MAYBE_VOID(bit_io_read, lowered_dynamic_bit_io(cfg_ctx, false, timer));
+            MAYBE_VOID(bit_io_write, lowered_dynamic_bit_io(cfg_ctx, true, timer));
         }
         MAYBE_VOID(merge_bit_field, merge_bit_field(ctx));
         if (timer) {
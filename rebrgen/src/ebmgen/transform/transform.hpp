@@ -11,7 +11,7 @@ namespace ebmgen {
     ebm::Block* get_block(ebm::StatementBody& body);
     expected<void> vectorized_io(TransformContext& tctx, bool write);
     expected<void> remove_unused_object(TransformContext& ctx, std::function<void(const char*)> timer);
-    expected<void> lowered_dynamic_bit_io(CFGContext& tctx, bool write);
+    expected<void> lowered_dynamic_bit_io(CFGContext& tctx, bool write, std::function<void(const char*)> timer);
     expected<void> merge_bit_field(TransformContext& tctx);
     expected<void> derive_property_setter_getter(TransformContext& tctx);
     expected<void> flatten_io_expression(TransformContext& tctx);
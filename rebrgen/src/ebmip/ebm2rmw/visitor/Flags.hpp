@@ -39,6 +39,7 @@ DEFINE_BOOL_FLAG(dump_output, false, "dump-output", "dump encoded output as hex"
 DEFINE_STRING_FLAG(modify_fields, "", "modify-fields", "semicolon-separated field modifications applied after decode (e.g., header.version=2;ttl=64)", "FIELDS");
 DEFINE_STRING_FLAG(modify_json, "", "modify-json", "JSON file with field modifications ({\"field.path\": integer_value, ...})", "FILE");
 DEFINE_BOOL_FLAG(skip_write_size_check, false, "skip-write-size-check", "skip dynamic-size validation in WRITE_BYTES (suppress size mismatch errors)");
+DEFINE_INT_FLAG(bench_iterations, size_t, 0, "bench-iterations", "benchmark: re-run decode (and encode) N times on fresh runtime after decode and print timing to stderr", "N");
 DEFINE_BOOL_FLAG(skip_variant_check, false, "skip-variant-check", "skip active-variant validation when navigating STRUCT_UNION fields by index");
 // Fuzzing flags
 DEFINE_BOOL_FLAG(fuzz_generate, false, "fuzz-generate", "generate random structurally-valid binary inputs from the format spec");
@@ -49,3 +50,20 @@ DEFINE_INT_FLAG(fuzz_max_vector_len, size_t, 16, "fuzz-max-vector-len", "maximum
 DEFINE_BOOL_FLAG(fuzz_mutate, false, "fuzz-mutate", "mutate an existing binary input by randomly modifying fields (requires --binary-file)");
 DEFINE_INT_FLAG(fuzz_mutations, size_t, 3, "fuzz-mutations", "number of field mutations to apply per output in mutate mode", "N");
 DEFINE_STRING_FLAG(fuzz_dict, "", "fuzz-dict", "generate AFL/libFuzzer dictionary file from the format spec", "FILE");
+DEFINE_INT_FLAG(jobs, size_t, 1, "jobs,j", "number of worker threads for fuzz generate/mutate (0 = hardware concurrency); input N always uses seed+N", "N");
+DEFINE_BOOL_FLAG(fuzz_dedup, false, "fuzz-dedup", "drop generated inputs whose content is the same as an earlier output (by content hash)");
+DEFINE_BOOL_FLAG(fuzz_persistent, false, "fuzz-persistent", "in-process round-trip fuzzing: decode -> --modify-fields -> encode each input and abort on encode failure or round-trip mismatch (libFuzzer/AFL persistent loop when built for it, otherwise replays --binary-file and --fuzz-corpus-dir --fuzz-count times)");
+DEFINE_STRING_FLAG(fuzz_driver_args, "", "fuzz-driver-args", "space-separated arguments passed to libFuzzer in --fuzz-persistent mode (e.g. \"-runs=100000 -max_len=4096\")", "ARGS");
+DEFINE_INT_FLAG(fuzz_report_interval, size_t, 100000, "fuzz-report-interval", "print executions per second every N executions in --fuzz-persistent mode (0 = only at exit)", "N");
+DEFINE_STRING_FLAG(batch_input, "", "batch-input", "batch mode: decode (and --modify-fields, encode) every record of a record stream file or of every file in a directory after compiling once", "FILE|DIR");
+BEGIN_MAP_FLAG(batch_framing, BatchFraming, BatchFraming::Concat, "batch-framing", "record framing of --batch-input file (concat: records back to back until EOF, u32be/u32le: length-prefixed)")
+MAP_FLAG_ITEM("concat", BatchFraming::Concat)
+MAP_FLAG_ITEM("u32be", BatchFraming::U32BE)
+MAP_FLAG_ITEM("u32le", BatchFraming::U32LE);
+END_MAP_FLAG();
+DEFINE_STRING_FLAG(batch_output, "", "batch-output", "write encoded records of batch mode to this file using --batch-framing", "FILE");
+DEFINE_STRING_FLAG(profile, "", "profile", "write execution profile as JSON: instruction count per opcode, calls/inclusive/exclusive time per function, bytes read/written per function and format", "FILE");
+DEFINE_STRING_FLAG(profile_folded, "", "profile-folded", "write exclusive time (ns) per call stack in folded-stack format (for flamegraph.pl, speedscope, ...)", "FILE");
+DEFINE_BOOL_FLAG(no_optimize, false, "no-optimize", "run compiled bytecode as is (skip constant folding, peephole, jump threading and immediate fusion)");
+DEFINE_BOOL_FLAG(opt_report, false, "opt-report", "print instruction count after each bytecode optimization pass");
+DEFINE_BOOL_FLAG(opt_verify, false, "opt-verify", "also run decode/modify/encode with unoptimized bytecode and fail if its result differs from the optimized run");
@@ -29,12 +29,27 @@
 #include "interpret.hpp"
 #include "layout.hpp"
 #include "json/json.h"
+#include "json/stringer.h"
 #include "number/hex/bin2hex.h"
 #include "number/prefix.h"
 #include "strutil/splits.h"
 #include "fuzz.hpp"
 #include "optimize.hpp"
+#include "profile.hpp"
 #include "wrap/cout.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+
+#if defined(EBM2RMW_LIBFUZZER)
+// provided by libFuzzer (-fsanitize=fuzzer-no-link + libclang_rt.fuzzer_no_main)
+extern "C" int LLVMFuzzerRunDriver(int* argc, char*** argv, int (*user_cb)(const std::uint8_t* data, size_t size));
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, size_t size);
+#elif defined(__AFL_FUZZ_TESTCASE_LEN)
+__AFL_FUZZ_INIT();
+#endif
 
 namespace ebm2rmw {
 
@@ -250,21 +265,35 @@ namespace ebm2rmw {
     }
 
     // -------------------------------------------------------------------------
-    // decode_binary: decode a binary file into the runtime
+    // decode_binary: decode a binary input into the runtime
     // -------------------------------------------------------------------------
     expected<void> decode_binary(Context_Statement_PROGRAM_DECL& ctx,
                                  RuntimeEnv& runtime,
                                  ebm::StatementRef entry_stmt_id,
                                  const ebm::FunctionDecl& decl,
-                                 futils::file::View& file) {
+                                 futils::view::rvec input) {
         InitialContext ictx{.visitor = ctx.visitor};
+        MAYBE(entry_stmt, ctx.get(entry_stmt_id));
+        auto decode_fn = entry_stmt.body.struct_decl() ? entry_stmt.body.struct_decl()->decode_fn() : nullptr;
+        auto entry_func = decode_fn ? ctx.config().env.find_function(*decode_fn) : nullptr;
+        if (!entry_func) {
+            return unexpect_error("decode function of {} is not compiled", get_id(entry_stmt_id));
+        }
         auto decode_params = build_state_params(ctx, runtime, decl, true);
-        runtime.input = futils::view::rvec(file.data(), file.size());
+        runtime.input = input;
         runtime.input_pos = 0;
-        MAYBE_VOID(_, runtime.interpret(ictx, entry_stmt_id, decode_params));
+        MAYBE_VOID(_, runtime.interpret(ictx, *entry_func, entry_stmt_id, decode_params));
         return {};
     }
 
+    expected<void> decode_binary(Context_Statement_PROGRAM_DECL& ctx,
+                                 RuntimeEnv& runtime,
+                                 ebm::StatementRef entry_stmt_id,
+                                 const ebm::FunctionDecl& decl,
+                                 futils::file::View& file) {
+        return decode_binary(ctx, runtime, entry_stmt_id, decl, futils::view::rvec(file.data(), file.size()));
+    }
+
     // -------------------------------------------------------------------------
     // zero_init_struct: zero-initialize a struct in the runtime (write-only mode)
     // -------------------------------------------------------------------------
@@ -288,7 +317,7 @@ namespace ebm2rmw {
     // -------------------------------------------------------------------------
     // modify_fields: apply --modify-fields / --modify-json modifications
     // -------------------------------------------------------------------------
-    expected<void> modify_fields(Context_Statement_PROGRAM_DECL& ctx, RuntimeEnv& runtime) {
+    expected<void> modify_fields(Context_Statement_PROGRAM_DECL& ctx, RuntimeEnv& runtime, bool report = true) {
         const bool has_modifications =
             !ctx.flags().modify_fields.empty() || !ctx.flags().modify_json.empty();
         if (!has_modifications) return {};
@@ -471,7 +500,9 @@ namespace ebm2rmw {
         auto apply_one = [&](std::string_view path, std::uint64_t new_value) -> expected<void> {
             MAYBE(field_obj, navigate_field(path));
             MAYBE_VOID(_, encode_uint64(field_obj, new_value));
-            futils::wrap::cerr_wrap() << "Modified '" << path << "' = " << new_value << "\n";
+            if (report) {
+                futils::wrap::cerr_wrap() << "Modified '" << path << "' = " << new_value << "\n";
+            }
             return {};
         };
 
@@ -517,13 +548,13 @@ namespace ebm2rmw {
     // -------------------------------------------------------------------------
     expected<void> run_encode(Context_Statement_PROGRAM_DECL& ctx,
                                RuntimeEnv& runtime,
-                               ebm::StatementRef entry_encode_fn) {
+                               ebm::StatementRef entry_encode_fn,
+                               bool report = true) {
         InitialContext ictx{.visitor = ctx.visitor};
         if (!ctx.config().env.has_function(entry_encode_fn)) {
             futils::wrap::cerr_wrap() << "Warning: encode function not compiled, skipping.\n";
             return {};
         }
-        const auto encode_env = ctx.config().env.new_function(entry_encode_fn);
         auto* encode_fnt = ctx.module().get_statement(entry_encode_fn);
         if (!encode_fnt) {
             futils::wrap::cerr_wrap() << "Warning: failed to get encode function statement\n";
@@ -533,9 +564,62 @@ namespace ebm2rmw {
         if (auto encode_decl_res = encode_fnt->body.func_decl()) {
             encode_params = build_state_params(ctx, runtime, *encode_decl_res, false);
         }
-        MAYBE_VOID(_, runtime.interpret_encode(ictx, encode_params));
-        futils::wrap::cerr_wrap() << "Encode complete. Output size: "
-                                  << runtime.output_buf.size() << " bytes\n";
+        MAYBE_VOID(_, runtime.interpret_encode(ictx, ctx.config().env.ensure_function(entry_encode_fn), encode_params));
+        if (report) {
+            futils::wrap::cerr_wrap() << "Encode complete. Output size: "
+                                      << runtime.output_buf.size() << " bytes\n";
+        }
+        return {};
+    }
+
+    // -------------------------------------------------------------------------
+    // run_benchmark: re-run decode (and encode) --bench-iterations times on
+    // fresh runtimes and report timing. every iteration must reproduce the
+    // decoded object of the normal run and the output of the first iteration
+    // -------------------------------------------------------------------------
+    expected<void> run_benchmark(Context_Statement_PROGRAM_DECL& ctx,
+                                 const RuntimeEnv& reference,
+                                 ebm::StatementRef entry_stmt_id,
+                                 const ebm::FunctionDecl& decl,
+                                 futils::file::View& file,
+                                 const ebm::StatementRef* entry_encode_fn) {
+        const size_t iterations = ctx.flags().bench_iterations;
+        const bool do_encode = !ctx.flags().skip_encode && entry_encode_fn &&
+                               ctx.config().env.has_function(*entry_encode_fn);
+        std::chrono::nanoseconds decode_total{0};
+        std::chrono::nanoseconds encode_total{0};
+        std::vector<std::uint8_t> first_output;
+        for (size_t i = 0; i < iterations; i++) {
+            RuntimeEnv iter_runtime;
+            auto start = std::chrono::steady_clock::now();
+            MAYBE_VOID(_, decode_binary(ctx, iter_runtime, entry_stmt_id, decl, file));
+            auto decoded = std::chrono::steady_clock::now();
+            decode_total += decoded - start;
+            if (iter_runtime.decoded_self_bytes != reference.decoded_self_bytes) {
+                return unexpect_error("benchmark: decoded object of iteration {} differs from normal run", i);
+            }
+            if (!do_encode) {
+                continue;
+            }
+            MAYBE_VOID(_, run_encode(ctx, iter_runtime, *entry_encode_fn, false));
+            encode_total += std::chrono::steady_clock::now() - decoded;
+            if (i == 0) {
+                first_output = std::move(iter_runtime.output_buf);
+            }
+            else if (iter_runtime.output_buf != first_output) {
+                return unexpect_error("benchmark: encoded output of iteration {} differs from first iteration", i);
+            }
+        }
+        auto per_iter_us = [&](std::chrono::nanoseconds total) {
+            return std::chrono::duration<double, std::micro>(total).count() / iterations;
+        };
+        futils::wrap::cerr_wrap() << std::format("Benchmark: iterations={} input={} bytes decode={:.3f} us/iter",
+                                                 iterations, file.size(), per_iter_us(decode_total));
+        if (do_encode) {
+            futils::wrap::cerr_wrap() << std::format(" encode={:.3f} us/iter output={} bytes",
+                                                     per_iter_us(encode_total), first_output.size());
+        }
+        futils::wrap::cerr_wrap() << "\n";
         return {};
     }
 
@@ -570,6 +654,80 @@ namespace ebm2rmw {
         return {};
     }
 
+    // -------------------------------------------------------------------------
+    // print_optimize_report: instruction count after each optimization pass (--opt-report)
+    // -------------------------------------------------------------------------
+    void print_optimize_report(const Optimizer& optimizer) {
+        futils::wrap::cerr_wrap() << "Bytecode optimization: " << optimizer.instructions_before << " instructions\n";
+        for (auto& stat : optimizer.stats) {
+            futils::wrap::cerr_wrap() << std::format("  {:<22} changes={:<8} instructions={}\n",
+                                                     stat.name, stat.changes, stat.instructions_after);
+        }
+    }
+
+    // -------------------------------------------------------------------------
+    // OptimizationReference: result of decode -> modify -> encode with
+    // unoptimized bytecode (--opt-verify). run() must be called before the
+    // optimizer rewrites instructions, check() after the optimized run
+    // -------------------------------------------------------------------------
+    struct OptimizationReference {
+        std::optional<std::string> error;
+        std::vector<std::uint8_t> decoded_self_bytes;
+        std::vector<std::uint8_t> output_buf;
+
+        void run(Context_Statement_PROGRAM_DECL& ctx,
+                 ebm::StatementRef entry_stmt_id,
+                 const ebm::FunctionDecl& decl,
+                 std::string_view entry_str,
+                 const ebm::StatementRef* entry_encode_fn) {
+            // failure is compared with the optimized run, not reported
+            const int saved_exit_code = ctx.output().exit_code;
+            RuntimeEnv runtime;
+            runtime.superinstructions = false;
+            auto result = [&]() -> expected<void> {
+                if (!ctx.flags().binary_file.empty()) {
+                    futils::file::View file;
+                    if (auto fres = file.open(ctx.flags().binary_file); !fres) {
+                        return unexpect_error("Failed to open binary file {}: {}",
+                                              ctx.flags().binary_file, fres.error().error<std::string>());
+                    }
+                    MAYBE_VOID(_, decode_binary(ctx, runtime, entry_stmt_id, decl, file));
+                }
+                else {
+                    MAYBE_VOID(_, zero_init_struct(ctx, runtime, entry_stmt_id, entry_str));
+                }
+                MAYBE_VOID(_, modify_fields(ctx, runtime, false));
+                if (!ctx.flags().skip_encode && entry_encode_fn) {
+                    MAYBE_VOID(_, run_encode(ctx, runtime, *entry_encode_fn, false));
+                }
+                return {};
+            }();
+            ctx.output().exit_code = saved_exit_code;
+            if (!result) {
+                error = result.error().error<std::string>();
+                return;
+            }
+            decoded_self_bytes = std::move(runtime.decoded_self_bytes);
+            output_buf = std::move(runtime.output_buf);
+        }
+
+        // optimized run completed; it must have produced the same object and output
+        expected<void> check(const RuntimeEnv& optimized) const {
+            if (error) {
+                return unexpect_error("opt-verify: unoptimized run failed but optimized run succeeded: {}", *error);
+            }
+            if (optimized.decoded_self_bytes != decoded_self_bytes) {
+                return unexpect_error("opt-verify: decoded object differs from unoptimized run");
+            }
+            if (optimized.output_buf != output_buf) {
+                return unexpect_error("opt-verify: encoded output differs from unoptimized run ({} bytes vs {} bytes)",
+                                      optimized.output_buf.size(), output_buf.size());
+            }
+            futils::wrap::cerr_wrap() << "opt-verify: optimized run matches unoptimized run\n";
+            return {};
+        }
+    };
+
     // -------------------------------------------------------------------------
     // write_corpus_file: write a single generated buffer to the corpus directory
     // or fallback to --output-file / --dump-output
@@ -615,6 +773,94 @@ namespace ebm2rmw {
         }
     }
 
+    // -------------------------------------------------------------------------
+    // FuzzOutput: collects outputs of fuzz workers. logging and non-corpus
+    // outputs are serialized, and with --fuzz-dedup outputs whose content hash
+    // was already seen are dropped
+    // -------------------------------------------------------------------------
+    struct FuzzOutput {
+        std::mutex mutex;
+        std::unordered_set<size_t> seen;
+        size_t success = 0;
+        size_t duplicates = 0;
+
+        void emit(Context_Statement_PROGRAM_DECL& ctx,
+                  const std::vector<std::uint8_t>& buf,
+                  size_t index,
+                  std::uint64_t iter_seed,
+                  const std::filesystem::path& corpus_dir,
+                  std::string_view log_line) {
+            const bool dedup = ctx.flags().fuzz_dedup;
+            const size_t hash = dedup ? std::hash<std::string_view>{}(std::string_view(
+                                            reinterpret_cast<const char*>(buf.data()), buf.size()))
+                                      : 0;
+            {
+                std::lock_guard lock(mutex);
+                if (dedup && !seen.insert(hash).second) {
+                    ++duplicates;
+                    return;
+                }
+                ++success;
+                futils::wrap::cerr_wrap() << log_line;
+                if (corpus_dir.empty()) {
+                    write_corpus_file(ctx, buf, index, iter_seed, corpus_dir);
+                    return;
+                }
+            }
+            // corpus files are distinct per index, so they are written without lock
+            write_corpus_file(ctx, buf, index, iter_seed, corpus_dir);
+        }
+
+        void report(std::string_view what, size_t count) {
+            futils::wrap::cerr_wrap() << what << ": " << success << "/" << count << " inputs generated";
+            if (duplicates) {
+                futils::wrap::cerr_wrap() << " (" << duplicates << " duplicates dropped)";
+            }
+            futils::wrap::cerr_wrap() << ".\n";
+        }
+    };
+
+    // -------------------------------------------------------------------------
+    // run_fuzz_jobs: call fn(i, runtime) for each i in [0, count) on --jobs threads.
+    // indices are handed out one by one and each thread reuses its own RuntimeEnv.
+    // callers derive everything of input i from seed + i, so outputs do not
+    // depend on the number of threads and `--fuzz-seed S` replays id N with seed S+N
+    // -------------------------------------------------------------------------
+    template <class F>
+    void run_fuzz_jobs(Context_Statement_PROGRAM_DECL& ctx, size_t count, F&& fn) {
+        size_t n_threads = ctx.flags().jobs == 0 ? std::thread::hardware_concurrency() : ctx.flags().jobs;
+#ifdef __EMSCRIPTEN__
+        n_threads = 1;
+#endif
+        n_threads = std::max<size_t>(1, std::min(n_threads, count));
+        if (n_threads > 1 && ctx.config().profiler) {
+            futils::wrap::cerr_wrap() << "Profiling: fuzz jobs run on one thread\n";
+            n_threads = 1;
+        }
+        if (n_threads > 1) {
+            // workers only read compiled functions after this
+            InitialContext ictx{.visitor = ctx.visitor};
+            RuntimeEnv{}.lower_all_functions(ictx);
+            futils::wrap::cerr_wrap() << "Fuzz jobs: " << n_threads << "\n";
+        }
+        std::atomic_size_t next = 0;
+        auto worker = [&] {
+            RuntimeEnv runtime;
+            for (auto i = next++; i < count; i = next++) {
+                runtime.reset();
+                fn(i, runtime);
+            }
+        };
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < n_threads; i++) {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (auto& t : threads) {
+            t.join();
+        }
+    }
+
     // -------------------------------------------------------------------------
     // fuzz_generate_loop: generate fuzz_count random inputs from the format spec
     // -------------------------------------------------------------------------
@@ -636,13 +882,12 @@ namespace ebm2rmw {
 
         const size_t count = ctx.flags().fuzz_count;
         const size_t max_vec_len = ctx.flags().fuzz_max_vector_len;
-        size_t success = 0;
+        FuzzOutput output;
 
-        for (size_t i = 0; i < count; i++) {
+        run_fuzz_jobs(ctx, count, [&](size_t i, RuntimeEnv& iter_runtime) {
             const std::uint64_t iter_seed = seed + i;
             FuzzRng rng(iter_seed);
 
-            RuntimeEnv iter_runtime;
             iter_runtime.decoded_self_bytes.assign(layout->size, 0);
             iter_runtime.decoded_self_type = layout->type;
 
@@ -651,23 +896,21 @@ namespace ebm2rmw {
             fuzz_fill_object(ictx, rng, iter_runtime, self_obj, max_vec_len, access);
 
             if (!ctx.flags().skip_encode) {
-                auto enc_res = run_encode(ctx, iter_runtime, entry_encode_fn);
+                auto enc_res = run_encode(ctx, iter_runtime, entry_encode_fn, false);
                 if (!enc_res) {
                     futils::wrap::cerr_wrap()
-                        << "Warning [iter " << i << ", seed=" << iter_seed
-                        << "]: encode failed: " << enc_res.error().error<std::string>() << "\n";
-                    continue;
+                        << std::format("Warning [iter {}, seed={}]: encode failed: {}\n",
+                                       i, iter_seed, enc_res.error().error<std::string>());
+                    return;
                 }
             }
 
-            futils::wrap::cerr_wrap() << "[" << i << "] " << iter_runtime.output_buf.size()
-                                      << " bytes (seed=" << iter_seed << ")\n";
-            write_corpus_file(ctx, iter_runtime.output_buf, i, iter_seed, corpus_dir);
-            ++success;
-        }
+            output.emit(ctx, iter_runtime.output_buf, i, iter_seed, corpus_dir,
+                        std::format("[{}] {} bytes (seed={})\n",
+                                    i, iter_runtime.output_buf.size(), iter_seed));
+        });
 
-        futils::wrap::cerr_wrap() << "Fuzz generation complete: " << success << "/" << count
-                                  << " inputs generated.\n";
+        output.report("Fuzz generation complete", count);
         return {};
     }
 
@@ -698,13 +941,13 @@ namespace ebm2rmw {
 
         const size_t count = ctx.flags().fuzz_count;
         const size_t mutations_per = ctx.flags().fuzz_mutations;
-        size_t success = 0;
+        FuzzOutput output;
 
-        for (size_t i = 0; i < count; i++) {
+        // base_runtime is only read by workers
+        run_fuzz_jobs(ctx, count, [&](size_t i, RuntimeEnv& iter_runtime) {
             const std::uint64_t iter_seed = seed + i;
             FuzzRng rng(iter_seed);
 
-            RuntimeEnv iter_runtime;
             iter_runtime.decoded_self_bytes = base_runtime.decoded_self_bytes;
             iter_runtime.decoded_self_type = base_runtime.decoded_self_type;
 
@@ -713,28 +956,524 @@ namespace ebm2rmw {
                 apply_mutation(rng, iter_runtime.decoded_self_bytes, fields[field_idx]);
             }
 
-            auto enc_res = run_encode(ctx, iter_runtime, entry_encode_fn);
+            auto enc_res = run_encode(ctx, iter_runtime, entry_encode_fn, false);
             if (!enc_res) {
                 futils::wrap::cerr_wrap()
-                    << "Warning [iter " << i << ", seed=" << iter_seed
-                    << "]: encode failed: " << enc_res.error().error<std::string>() << "\n";
-                continue;
+                    << std::format("Warning [iter {}, seed={}]: encode failed: {}\n",
+                                   i, iter_seed, enc_res.error().error<std::string>());
+                return;
+            }
+
+            output.emit(ctx, iter_runtime.output_buf, i, iter_seed, corpus_dir,
+                        std::format("[{}] {} bytes (seed={}, mutations={})\n",
+                                    i, iter_runtime.output_buf.size(), iter_seed, mutations_per));
+        });
+
+        output.report("Fuzz mutate complete", count);
+        return {};
+    }
+
+    // -------------------------------------------------------------------------
+    // PersistentFuzzer: runs decode -> --modify-fields -> encode on many inputs
+    // in one process (--fuzz-persistent), reusing compiled bytecode, frames and buffers.
+    // without modifications the output must equal the consumed part of the input;
+    // with modifications, decoding and encoding the output again must reproduce it
+    // -------------------------------------------------------------------------
+    struct PersistentFuzzer {
+        Context_Statement_PROGRAM_DECL& ctx;
+        ebm::StatementRef entry_stmt_id;
+        const ebm::FunctionDecl& decl;
+        const ebm::StatementRef* entry_encode_fn = nullptr;
+        RuntimeEnv runtime;
+        RuntimeEnv recheck;
+        size_t executions = 0;
+        size_t rejected = 0;
+        size_t findings = 0;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        bool do_encode() const {
+            return !ctx.flags().skip_encode && entry_encode_fn &&
+                   ctx.config().env.has_function(*entry_encode_fn);
+        }
+
+        static bool same_bytes(const std::vector<std::uint8_t>& a, futils::view::rvec b) {
+            return a.size() == b.size() && std::equal(a.begin(), a.end(), b.data());
+        }
+
+        // returns reason if input is a finding
+        std::optional<std::string> check(futils::view::rvec input) {
+            runtime.reset();
+            if (!decode_binary(ctx, runtime, entry_stmt_id, decl, input)) {
+                rejected++;
+                return std::nullopt;
+            }
+            // modified path may not exist in this input (e.g. inactive variant)
+            if (!modify_fields(ctx, runtime, false)) {
+                rejected++;
+                return std::nullopt;
+            }
+            if (!do_encode()) {
+                return std::nullopt;
+            }
+            if (auto res = run_encode(ctx, runtime, *entry_encode_fn, false); !res) {
+                return std::format("encode failed after successful decode: {}", res.error().error<std::string>());
+            }
+            const bool has_modifications =
+                !ctx.flags().modify_fields.empty() || !ctx.flags().modify_json.empty();
+            if (!has_modifications) {
+                if (!same_bytes(runtime.output_buf, input.substr(0, runtime.input_pos))) {
+                    return std::format("round trip mismatch: decoded {} bytes, encoded {} bytes",
+                                       runtime.input_pos, runtime.output_buf.size());
+                }
+                return std::nullopt;
+            }
+            recheck.reset();
+            if (auto res = decode_binary(ctx, recheck, entry_stmt_id, decl, futils::view::rvec(runtime.output_buf)); !res) {
+                return std::format("decode of modified output failed: {}", res.error().error<std::string>());
             }
+            if (auto res = run_encode(ctx, recheck, *entry_encode_fn, false); !res) {
+                return std::format("encode of re-decoded modified output failed: {}", res.error().error<std::string>());
+            }
+            if (!same_bytes(recheck.output_buf, futils::view::rvec(runtime.output_buf))) {
+                return std::format("modified output changed by decode/encode: {} bytes -> {} bytes",
+                                   runtime.output_buf.size(), recheck.output_buf.size());
+            }
+            return std::nullopt;
+        }
 
-            futils::wrap::cerr_wrap() << "[" << i << "] " << iter_runtime.output_buf.size()
-                                      << " bytes (seed=" << iter_seed << ", mutations="
-                                      << mutations_per << ")\n";
-            write_corpus_file(ctx, iter_runtime.output_buf, i, iter_seed, corpus_dir);
-            ++success;
+        // returns false if input is a finding
+        bool run_one(futils::view::rvec input) {
+            executions++;
+            auto finding = check(input);
+            const size_t interval = ctx.flags().fuzz_report_interval;
+            if (interval && executions % interval == 0) {
+                report();
+            }
+            if (!finding) {
+                return true;
+            }
+            findings++;
+            std::string hex_input, hex_output;
+            futils::number::hex::to_hex(hex_input, input);
+            futils::number::hex::to_hex(hex_output, futils::view::rvec(runtime.output_buf));
+            futils::wrap::cerr_wrap() << "Persistent fuzz finding: " << *finding << "\n"
+                                      << "  input  (hex): " << hex_input << "\n"
+                                      << "  output (hex): " << hex_output << "\n";
+            return false;
         }
 
-        futils::wrap::cerr_wrap() << "Fuzz mutate complete: " << success << "/" << count
-                                  << " inputs generated.\n";
+        void report() {
+            auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            futils::wrap::cerr_wrap() << std::format("Persistent fuzz: execs={} rejected={} findings={} exec/s={:.0f}\n",
+                                                     executions, rejected, findings,
+                                                     elapsed > 0 ? executions / elapsed : 0.0);
+        }
+    };
+
+    inline PersistentFuzzer* active_persistent_fuzzer = nullptr;
+
+    // -------------------------------------------------------------------------
+    // run_persistent_fuzz: feed inputs to PersistentFuzzer from libFuzzer
+    // (EBM2RMW_LIBFUZZER build), AFL++ persistent mode (afl-clang-fast build)
+    // or, otherwise, by replaying --binary-file and --fuzz-corpus-dir --fuzz-count times
+    // -------------------------------------------------------------------------
+    expected<void> run_persistent_fuzz(Context_Statement_PROGRAM_DECL& ctx,
+                                       ebm::StatementRef entry_stmt_id,
+                                       const ebm::FunctionDecl& decl,
+                                       const ebm::StatementRef* entry_encode_fn) {
+        PersistentFuzzer fuzzer{
+            .ctx = ctx,
+            .entry_stmt_id = entry_stmt_id,
+            .decl = decl,
+            .entry_encode_fn = entry_encode_fn,
+        };
+        // failed decode sets exit code, but rejected inputs are expected here
+        const int saved_exit_code = ctx.output().exit_code;
+#if defined(EBM2RMW_LIBFUZZER)
+        std::vector<std::string> args{ctx.flags().program_name};
+        for (auto& arg : futils::strutil::split(ctx.flags().fuzz_driver_args, " ")) {
+            if (!arg.empty()) args.emplace_back(arg);
+        }
+        if (!ctx.flags().fuzz_dict.empty()) {
+            args.push_back("-dict=" + std::string(ctx.flags().fuzz_dict));
+        }
+        if (!ctx.flags().fuzz_corpus_dir.empty()) {
+            args.emplace_back(ctx.flags().fuzz_corpus_dir);
+        }
+        std::vector<char*> argv;
+        for (auto& arg : args) {
+            argv.push_back(arg.data());
+        }
+        argv.push_back(nullptr);
+        int argc = int(args.size());
+        char** argv_ptr = argv.data();
+        active_persistent_fuzzer = &fuzzer;
+        LLVMFuzzerRunDriver(&argc, &argv_ptr, LLVMFuzzerTestOneInput);
+        active_persistent_fuzzer = nullptr;
+#elif defined(__AFL_FUZZ_TESTCASE_LEN)
+        // fork server starts here, after the module is loaded and compiled
+        __AFL_INIT();
+        const unsigned char* buf = __AFL_FUZZ_TESTCASE_BUF;
+        while (__AFL_LOOP(10000)) {
+            if (!fuzzer.run_one(futils::view::rvec(buf, __AFL_FUZZ_TESTCASE_LEN))) {
+                std::abort();
+            }
+        }
+#else
+        std::vector<std::vector<std::uint8_t>> inputs;
+        auto load = [&](const std::string& path) -> expected<void> {
+            futils::file::View file;
+            if (auto fres = file.open(path); !fres) {
+                return unexpect_error("Failed to open fuzz input {}: {}", path, fres.error().error<std::string>());
+            }
+            inputs.emplace_back(file.data(), file.data() + file.size());
+            return {};
+        };
+        if (!ctx.flags().binary_file.empty()) {
+            MAYBE_VOID(_, load(std::string(ctx.flags().binary_file)));
+        }
+        if (!ctx.flags().fuzz_corpus_dir.empty()) {
+            std::vector<std::filesystem::path> files;
+            std::error_code ec;
+            for (auto& entry : std::filesystem::directory_iterator(ctx.flags().fuzz_corpus_dir, ec)) {
+                if (entry.is_regular_file()) files.push_back(entry.path());
+            }
+            if (ec) {
+                return unexpect_error("Failed to read corpus directory {}: {}", ctx.flags().fuzz_corpus_dir, ec.message());
+            }
+            std::sort(files.begin(), files.end());
+            for (auto& file : files) {
+                MAYBE_VOID(_, load(file.string()));
+            }
+        }
+        if (inputs.empty()) {
+            return unexpect_error("--fuzz-persistent without libFuzzer/AFL requires --binary-file or --fuzz-corpus-dir");
+        }
+        futils::wrap::cerr_wrap() << "Persistent fuzz: replaying " << inputs.size() << " inputs "
+                                  << ctx.flags().fuzz_count << " times\n";
+        for (size_t round = 0; round < ctx.flags().fuzz_count; round++) {
+            for (auto& input : inputs) {
+                fuzzer.run_one(futils::view::rvec(input));
+            }
+        }
+#endif
+        ctx.output().exit_code = saved_exit_code;
+        fuzzer.report();
+        if (fuzzer.findings) {
+            return unexpect_error("persistent fuzz: {} findings", fuzzer.findings);
+        }
+        return {};
+    }
+
+    // -------------------------------------------------------------------------
+    // run_batch: decode -> --modify-fields -> encode every record of --batch-input
+    // with one RuntimeEnv, then report records/sec and per-record latency percentiles.
+    // a failed record is reported and skipped, except in concat framing where
+    // the end of a failed record (so the start of the next one) is unknown
+    // -------------------------------------------------------------------------
+    expected<void> run_batch(Context_Statement_PROGRAM_DECL& ctx,
+                             ebm::StatementRef entry_stmt_id,
+                             const ebm::FunctionDecl& decl,
+                             const ebm::StatementRef* entry_encode_fn) {
+        const auto framing = ctx.flags().batch_framing;
+        const size_t prefix_len = framing == BatchFraming::Concat ? 0 : 4;
+        const bool do_encode = !ctx.flags().skip_encode && entry_encode_fn &&
+                               ctx.config().env.has_function(*entry_encode_fn);
+
+        // read inputs before timing starts. each element of streams is split by framing,
+        // files of a directory are one record each
+        futils::file::View stream_file;
+        std::vector<std::vector<std::uint8_t>> dir_records;
+        std::vector<std::string> dir_names;
+        std::error_code ec;
+        const bool is_dir = std::filesystem::is_directory(ctx.flags().batch_input, ec);
+        if (is_dir) {
+            std::vector<std::filesystem::path> files;
+            for (auto& entry : std::filesystem::directory_iterator(ctx.flags().batch_input, ec)) {
+                if (entry.is_regular_file()) files.push_back(entry.path());
+            }
+            if (ec) {
+                return unexpect_error("Failed to read batch directory {}: {}", ctx.flags().batch_input, ec.message());
+            }
+            std::sort(files.begin(), files.end());
+            for (auto& path : files) {
+                futils::file::View file;
+                if (auto fres = file.open(path.string()); !fres) {
+                    return unexpect_error("Failed to open batch record {}: {}", path.string(), fres.error().error<std::string>());
+                }
+                dir_records.emplace_back(file.data(), file.data() + file.size());
+                dir_names.push_back(path.filename().string());
+            }
+        }
+        else if (auto fres = stream_file.open(ctx.flags().batch_input); !fres) {
+            return unexpect_error("Failed to open batch input {}: {}", ctx.flags().batch_input, fres.error().error<std::string>());
+        }
+
+        RuntimeEnv runtime;
+        std::vector<std::uint8_t> output_stream;
+        std::vector<std::chrono::nanoseconds> latencies;
+        size_t failed = 0;
+        size_t input_bytes = 0;
+
+        auto append_output = [&](const std::vector<std::uint8_t>& buf) {
+            if (ctx.flags().batch_output.empty()) return;
+            const auto len = std::uint32_t(buf.size());
+            for (size_t i = 0; i < prefix_len; i++) {
+                const size_t shift = framing == BatchFraming::U32BE ? (3 - i) * 8 : i * 8;
+                output_stream.push_back(std::uint8_t(len >> shift));
+            }
+            output_stream.insert(output_stream.end(), buf.begin(), buf.end());
+        };
+
+        // returns false if record failed
+        auto process = [&](futils::view::rvec record, std::string_view name) -> bool {
+            runtime.reset();
+            auto start = std::chrono::steady_clock::now();
+            auto res = decode_binary(ctx, runtime, entry_stmt_id, decl, record);
+            if (res) {
+                res = modify_fields(ctx, runtime, false);
+            }
+            if (res && do_encode) {
+                res = run_encode(ctx, runtime, *entry_encode_fn, false);
+            }
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            if (!res) {
+                failed++;
+                futils::wrap::cerr_wrap() << "Batch record " << name << " failed: "
+                                          << res.error().error<std::string>() << "\n";
+                return false;
+            }
+            latencies.push_back(elapsed);
+            input_bytes += runtime.input_pos;
+            append_output(runtime.output_buf);
+            return true;
+        };
+
+        const auto batch_start = std::chrono::steady_clock::now();
+        if (is_dir) {
+            for (size_t i = 0; i < dir_records.size(); i++) {
+                process(futils::view::rvec(dir_records[i]), dir_names[i]);
+            }
+        }
+        else {
+            const auto data = futils::view::rvec(stream_file.data(), stream_file.size());
+            size_t offset = 0;
+            for (size_t index = 0; offset < data.size(); index++) {
+                auto name = std::format("#{} (offset {})", index, offset);
+                if (framing == BatchFraming::Concat) {
+                    if (!process(data.substr(offset), name)) {
+                        break;
+                    }
+                    if (runtime.input_pos == 0) {
+                        return unexpect_error("batch: record {} consumed no input; concat framing cannot advance", name);
+                    }
+                    offset += runtime.input_pos;
+                    continue;
+                }
+                if (data.size() - offset < prefix_len) {
+                    return unexpect_error("batch: truncated length prefix of record {}", name);
+                }
+                std::uint32_t len = 0;
+                for (size_t i = 0; i < prefix_len; i++) {
+                    const size_t shift = framing == BatchFraming::U32BE ? (3 - i) * 8 : i * 8;
+                    len |= std::uint32_t(data[offset + i]) << shift;
+                }
+                offset += prefix_len;
+                if (data.size() - offset < len) {
+                    return unexpect_error("batch: record {} needs {} bytes but only {} remain", name, len, data.size() - offset);
+                }
+                process(data.substr(offset, len), name);
+                offset += len;
+            }
+        }
+        const auto total = std::chrono::steady_clock::now() - batch_start;
+
+        if (!ctx.flags().batch_output.empty()) {
+            auto out_file = futils::file::File::create(ctx.flags().batch_output);
+            if (!out_file) {
+                return unexpect_error("Failed to open batch output {}: {}", ctx.flags().batch_output,
+                                      out_file.error().error<std::string>());
+            }
+            if (auto w = out_file->write_file_all(futils::view::rvec(output_stream)); !w) {
+                return unexpect_error("Failed to write batch output {}: {}", ctx.flags().batch_output,
+                                      w.error().error<std::string>());
+            }
+        }
+
+        const size_t records = latencies.size();
+        const double total_s = std::chrono::duration<double>(total).count();
+        std::sort(latencies.begin(), latencies.end());
+        auto percentile_us = [&](double p) {
+            if (latencies.empty()) return 0.0;
+            const size_t i = std::min(latencies.size() - 1, size_t(p * latencies.size()));
+            return std::chrono::duration<double, std::micro>(latencies[i]).count();
+        };
+        futils::wrap::cerr_wrap() << std::format(
+            "Batch: records={} failed={} input={} bytes time={:.3f} ms records/s={:.0f} "
+            "latency us p50={:.3f} p90={:.3f} p99={:.3f} max={:.3f}\n",
+            records, failed, input_bytes, total_s * 1e3, total_s > 0 ? records / total_s : 0.0,
+            percentile_us(0.5), percentile_us(0.9), percentile_us(0.99),
+            latencies.empty() ? 0.0 : std::chrono::duration<double, std::micro>(latencies.back()).count());
+        if (failed) {
+            return unexpect_error("batch: {} records failed", failed);
+        }
+        return {};
+    }
+
+    // -------------------------------------------------------------------------
+    // write_profile: write --profile (JSON) and --profile-folded (folded stacks)
+    // -------------------------------------------------------------------------
+    expected<void> write_profile(Context_Statement_PROGRAM_DECL& ctx, const Profiler& profiler) {
+        struct Named {
+            std::string name;    // Format.function or function
+            std::string format;  // empty if function does not belong to a format
+        };
+        std::unordered_map<const FunctionDecl*, Named> names;
+        for (auto& [ref, func] : ctx.config().env.get_functions()) {
+            Named n{.name = ctx.identifier(ref)};
+            if (auto func_decl_res = ctx.get_field<"func_decl">(ref)) {
+                auto& func_decl = *func_decl_res;
+                if (!is_nil(func_decl.parent_format)) {
+                    n.format = ctx.identifier(func_decl.parent_format);
+                    n.name = n.format + "." + n.name;
+                }
+            }
+            names.emplace(&func, std::move(n));
+        }
+        auto name_of = [&](const FunctionDecl* func) -> const Named& {
+            static const Named unknown{.name = "(unknown)"};
+            auto found = names.find(func);
+            return found != names.end() ? found->second : unknown;
+        };
+        auto write_file = [&](std::string_view path, const std::string& content) -> expected<void> {
+            auto out_file = futils::file::File::create(path);
+            if (!out_file) {
+                return unexpect_error("Failed to open profile output {}: {}", path, out_file.error().error<std::string>());
+            }
+            if (auto w = out_file->write_file_all(futils::view::rvec(content)); !w) {
+                return unexpect_error("Failed to write profile output {}: {}", path, w.error().error<std::string>());
+            }
+            return {};
+        };
+
+        if (!ctx.flags().profile.empty()) {
+            std::vector<std::pair<std::string, std::uint64_t>> ops;
+            std::uint64_t total_instructions = 0;
+            auto& op_counts = profiler.get_op_counts();
+            for (size_t op = 0; op < end_stats_slot; op++) {
+                if (op_counts[op] == 0) continue;
+                ops.emplace_back(to_string(static_cast<ebm::OpCode>(op), true), op_counts[op]);
+                total_instructions += op_counts[op];
+            }
+            std::sort(ops.begin(), ops.end(), [](auto& a, auto& b) { return a.second > b.second; });
+
+            std::vector<std::pair<const Named*, const Profiler::FunctionProfile*>> functions;
+            std::map<std::string, Profiler::FunctionProfile> formats;
+            for (auto& [func, prof] : profiler.get_functions()) {
+                auto& named = name_of(func);
+                functions.emplace_back(&named, &prof);
+                auto& fmt = formats[named.format];
+                fmt.calls += prof.calls;
+                fmt.exclusive_ns += prof.exclusive_ns;
+                fmt.bytes_read += prof.bytes_read;
+                fmt.bytes_written += prof.bytes_written;
+            }
+            std::sort(functions.begin(), functions.end(), [](auto& a, auto& b) {
+                return a.second->exclusive_ns > b.second->exclusive_ns;
+            });
+
+            futils::json::Stringer<> d;
+            {
+                auto field = d.object();
+                field("total_instructions", total_instructions);
+                field("ops", [&] {
+                    auto field = d.array();
+                    for (auto& [op, count] : ops) {
+                        field([&] {
+                            auto field = d.object();
+                            field("op", op);
+                            field("count", count);
+                        });
+                    }
+                });
+                field("functions", [&] {
+                    auto field = d.array();
+                    for (auto& [named, prof] : functions) {
+                        field([&] {
+                            auto field = d.object();
+                            field("name", named->name);
+                            field("format", named->format);
+                            field("calls", prof->calls);
+                            field("inclusive_ns", prof->inclusive_ns);
+                            field("exclusive_ns", prof->exclusive_ns);
+                            field("bytes_read", prof->bytes_read);
+                            field("bytes_written", prof->bytes_written);
+                        });
+                    }
+                });
+                // exclusive sums of functions belonging to each format ("" = no format)
+                field("formats", [&] {
+                    auto field = d.array();
+                    for (auto& [format, prof] : formats) {
+                        field([&] {
+                            auto field = d.object();
+                            field("format", format);
+                            field("calls", prof.calls);
+                            field("exclusive_ns", prof.exclusive_ns);
+                            field("bytes_read", prof.bytes_read);
+                            field("bytes_written", prof.bytes_written);
+                        });
+                    }
+                });
+            }
+            MAYBE_VOID(_, write_file(ctx.flags().profile, d.out()));
+            futils::wrap::cerr_wrap() << "Profile written to: " << ctx.flags().profile << "\n";
+        }
+
+        if (!ctx.flags().profile_folded.empty()) {
+            // one line per call path: "root;caller;callee <exclusive ns>"
+            auto& nodes = profiler.get_nodes();
+            std::string folded;
+            std::vector<std::string_view> path;
+            auto walk = [&](auto&& walk, size_t index) -> void {
+                auto& node = nodes[index];
+                if (node.func) {
+                    path.push_back(name_of(node.func).name);
+                    if (node.self_ns) {
+                        for (size_t i = 0; i < path.size(); i++) {
+                            if (i) folded += ';';
+                            folded += path[i];
+                        }
+                        folded += std::format(" {}\n", node.self_ns);
+                    }
+                }
+                for (auto child : node.children) {
+                    walk(walk, child);
+                }
+                if (node.func) {
+                    path.pop_back();
+                }
+            };
+            walk(walk, 0);
+            MAYBE_VOID(_, write_file(ctx.flags().profile_folded, folded));
+            futils::wrap::cerr_wrap() << "Folded profile written to: " << ctx.flags().profile_folded << "\n";
+        }
         return {};
     }
 
 }  // namespace ebm2rmw
 
+#if defined(EBM2RMW_LIBFUZZER)
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, size_t size) {
+    if (auto fuzzer = ebm2rmw::active_persistent_fuzzer) {
+        if (!fuzzer->run_one(futils::view::rvec(data, size))) {
+            std::abort();
+        }
+    }
+    return 0;
+}
+#endif
+
 DEFINE_VISITOR(Statement_PROGRAM_DECL) {
     using namespace CODEGEN_NAMESPACE;
 
@@ -804,7 +1543,8 @@ DEFINE_VISITOR(Statement_PROGRAM_DECL) {
     const bool has_modifications =
         !ctx.flags().modify_fields.empty() || !ctx.flags().modify_json.empty();
     if (ctx.flags().binary_file.empty() && !has_modifications &&
-        !ctx.flags().fuzz_generate && !ctx.flags().fuzz_mutate) {
+        !ctx.flags().fuzz_generate && !ctx.flags().fuzz_mutate && !ctx.flags().fuzz_persistent &&
+        ctx.flags().batch_input.empty()) {
         futils::wrap::cerr_wrap() << "No binary file specified, skipping execution.\n";
         return res;
     }
@@ -812,8 +1552,46 @@ DEFINE_VISITOR(Statement_PROGRAM_DECL) {
     // --- Optimize compiled bytecode ---
     MAYBE(fnt, ctx.module().get_statement(entry_decode_fn));
     MAYBE(decl, fnt.body.func_decl());
-    Optimizer optimizer;
-    optimizer.optimize_function(ctx.config().env);
+    // the unoptimized run of --opt-verify only applies to normal RMW mode below
+    const bool normal_mode = !ctx.flags().fuzz_persistent && ctx.flags().batch_input.empty() &&
+                             !ctx.flags().fuzz_generate && !ctx.flags().fuzz_mutate;
+    OptimizationReference opt_reference;
+    if (ctx.flags().opt_verify && normal_mode) {
+        opt_reference.run(ctx, entry_stmt.id, decl, entry_str, entry_encode_fn_ptr);
+    }
+    if (!ctx.flags().no_optimize) {
+        Optimizer optimizer;
+        optimizer.optimize_function(ctx.config().env);
+        if (ctx.flags().opt_report) {
+            print_optimize_report(optimizer);
+        }
+    }
+
+    // --- Profiling (covers every mode below) ---
+    Profiler profiler;
+    const bool profiling = !ctx.flags().profile.empty() || !ctx.flags().profile_folded.empty();
+    if (profiling) {
+        ctx.config().profiler = &profiler;
+    }
+    const auto finish_profile = futils::helper::defer([&] {
+        if (!profiling) return;
+        ctx.config().profiler = nullptr;
+        if (auto pres = write_profile(ctx, profiler); !pres) {
+            futils::wrap::cerr_wrap() << "Warning: " << pres.error().error<std::string>() << "\n";
+        }
+    });
+
+    // --- Persistent round-trip fuzz mode ---
+    if (ctx.flags().fuzz_persistent) {
+        MAYBE_VOID(_, run_persistent_fuzz(ctx, entry_stmt.id, decl, entry_encode_fn_ptr));
+        return res;
+    }
+
+    // --- Batch record-stream mode ---
+    if (!ctx.flags().batch_input.empty()) {
+        MAYBE_VOID(_, run_batch(ctx, entry_stmt.id, decl, entry_encode_fn_ptr));
+        return res;
+    }
 
     // --- Fuzz generate mode ---
     if (ctx.flags().fuzz_generate) {
@@ -838,6 +1616,9 @@ DEFINE_VISITOR(Statement_PROGRAM_DECL) {
         // errors if a fixed-size field needs bytes that aren't present, so an
         // explicit empty-file guard would wrongly reject legitimately-empty input.
         MAYBE_VOID(_, decode_binary(ctx, runtime, entry_stmt.id, decl, file));
+        if (ctx.flags().bench_iterations > 0) {
+            MAYBE_VOID(_, run_benchmark(ctx, runtime, entry_stmt.id, decl, file, entry_encode_fn_ptr));
+        }
     }
     else {
         MAYBE_VOID(_, zero_init_struct(ctx, runtime, entry_stmt.id, entry_str));
@@ -859,5 +1640,9 @@ DEFINE_VISITOR(Statement_PROGRAM_DECL) {
         MAYBE_VOID(_, encode_output(ctx, runtime, *entry_encode_fn_ptr));
     }
 
+    if (ctx.flags().opt_verify) {
+        MAYBE_VOID(_, opt_reference.check(runtime));
+    }
+
     return res;
 }
@@ -10,5 +10,6 @@
 /*here to write the hook*/
 struct Env env;
 struct TypeLayoutContext* layout_context;
+struct Profiler* profiler = nullptr;
 bool is_lvalue = false;
 std::vector<size_t> pending_breaks;
\ No newline at end of file
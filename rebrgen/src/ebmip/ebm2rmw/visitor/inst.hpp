@@ -2,9 +2,11 @@
 #pragma once
 
 #include <cstddef>
+#include <optional>
 #include <unordered_map>
 #include <vector>
 #include "ebm/extended_binary_module.hpp"
+#include "ebmcodegen/stub/ops_macros.hpp"
 #include "helper/defer.h"
 namespace ebm2rmw {
 
@@ -15,6 +17,112 @@ namespace ebm2rmw {
         ebm::TypeRef type_info;
     };
 
+    // dense opcode of pre-decoded instruction. used as index of dispatch table
+#define EBM2RMW_DECODED_OPS(X) \
+    X(NOP)                     \
+    X(BINARY)                  \
+    X(UNARY)                   \
+    X(PUSH_SUB_INPUT)          \
+    X(POP_SUB_INPUT)           \
+    X(PUSH_SEEK_SUB_INPUT)     \
+    X(POP_SEEK_SUB_INPUT)      \
+    X(PUSH_SUB_OUTPUT)         \
+    X(POP_SUB_OUTPUT)          \
+    X(HALT)                    \
+    X(PUSH_IMM_INT)            \
+    X(NEW_BYTES)               \
+    X(LOAD_SELF)               \
+    X(LOAD_LOCAL)              \
+    X(LOAD_LOCAL_REF)          \
+    X(STORE_LOCAL_IMM)         \
+    X(EQ_IMM)                  \
+    X(STORE_LOCAL)             \
+    X(STORE_REF)               \
+    X(ASSERT)                  \
+    X(ARRAY_LEN)               \
+    X(ARRAY_GET_IMM)           \
+    X(ARRAY_GET)               \
+    X(BINARY_IMM)              \
+    X(EQ_IMM_JUMP_IF_FALSE)    \
+    X(BINARY_JUMP_IF_FALSE)    \
+    X(AVAILABLE)               \
+    X(GET_OFFSET)              \
+    X(READ_BYTE)               \
+    X(READ_BYTES)              \
+    X(LOAD_SELF_MEMBER)        \
+    X(LOAD_MEMBER)             \
+    X(CALL_GETTER)             \
+    X(LOAD_PARAM)              \
+    X(LOAD_FUNC)               \
+    X(CALL)                    \
+    X(CALL_DIRECT)             \
+    X(JUMP_IF_FALSE)           \
+    X(JUMP)                    \
+    X(NEW_STRUCT)              \
+    X(RET)                     \
+    X(POP)                     \
+    X(WRITE_U8)                \
+    X(WRITE_BYTES)             \
+    X(VECTOR_PUSH)             \
+    X(ERROR)                   \
+    X(UNSUPPORTED)             \
+    X(MALFORMED)               \
+    X(END)
+
+    enum class DecodedOp : std::uint8_t {
+#define EBM2RMW_DECODED_OP_ENUM(name) name,
+        EBM2RMW_DECODED_OPS(EBM2RMW_DECODED_OP_ENUM)
+#undef EBM2RMW_DECODED_OP_ENUM
+    };
+
+    // stats slot of END sentinel (next to 256 slots of ebm::OpCode)
+    constexpr size_t end_stats_slot = 256;
+
+    // integer result of BINARY/UNARY shared by interpreter superinstructions and constant folding.
+    // nullopt if op is not supported
+    inline std::optional<std::uint64_t> eval_binary_op(ebm::BinaryOp bop, std::uint64_t lhs, std::uint64_t rhs) {
+        APPLY_BINARY_OP(bop, [&](auto&& op) -> std::optional<std::uint64_t> {
+            return std::uint64_t(op(lhs, rhs));
+        });
+        return std::nullopt;
+    }
+
+    inline std::optional<std::uint64_t> eval_unary_op(ebm::UnaryOp uop, std::uint64_t operand) {
+        APPLY_UNARY_OP(uop, [&](auto&& op) -> std::optional<std::uint64_t> {
+            return std::uint64_t(op(operand));
+        });
+        return std::nullopt;
+    }
+
+    struct FunctionDecl;
+
+    // Instruction lowered once before execution.
+    // immediates are extracted from ebm::Instruction and jump targets are resolved to absolute index
+    // operands used only by a few ops (call target, READ_BYTES offset) live in
+    // FunctionDecl::wide_operands so that the hot fields stay in 40 bytes
+    struct DecodedInstruction {
+        DecodedOp op = DecodedOp::END;
+        ebm::OpCode source_op = ebm::OpCode::NOP;
+        std::uint16_t stats_slot = end_stats_slot;
+        ebm::BinaryOp bop{};
+        ebm::UnaryOp uop{};
+        bool flag = false;         // RET: has value, READ_BYTES: has static size, CALL_DIRECT: has self
+        std::uint32_t target = 0;  // JUMP/JUMP_IF_FALSE
+        std::uint32_t wide = 0;    // CALL_GETTER/LOAD_FUNC/CALL_DIRECT/READ_BYTES: index of FunctionDecl::wide_operands
+        std::uint64_t imm = 0;     // value/index/offset/size/arg_num or index of FunctionDecl::lowering_errors
+        std::uint64_t scratch = 0;
+        ebm::TypeRef type_info;
+    };
+
+    static_assert(sizeof(DecodedInstruction) <= 40, "keep DecodedInstruction small; move rare operands to DecodedWideOperand");
+
+    // rare operands of DecodedInstruction
+    struct DecodedWideOperand {
+        std::uint64_t imm2 = 0;  // READ_BYTES: offset
+        ebm::StatementRef func_id;
+        FunctionDecl* callee = nullptr;  // CALL_GETTER/CALL_DIRECT. nullptr if not compiled when lowered
+    };
+
     struct FunctionDecl {
         std::vector<Instruction> instructions;
         size_t local_count = 0;
@@ -22,11 +130,29 @@ namespace ebm2rmw {
         size_t param_count = 0;
         std::unordered_map<ebm::StatementRef, size_t> param_indices;
         size_t structs_area = 0;
+
+        // lowered form of instructions (instructions.size() + 1 for END sentinel)
+        // built lazily by interpreter and cleared when instructions are rewritten
+        std::vector<DecodedInstruction> decoded;
+        std::vector<DecodedWideOperand> wide_operands;
+        std::vector<std::string> lowering_errors;
+
+        bool is_lowered() const {
+            return decoded.size() == instructions.size() + 1;
+        }
+
+        void invalidate_lowered() {
+            decoded.clear();
+            wide_operands.clear();
+            lowering_errors.clear();
+        }
     };
 
     struct Env {
        private:
-        FunctionDecl* instructions;
+        // function currently compiled.
+        // interpreter does not use this; each StackFrame holds the function it runs
+        FunctionDecl* instructions = nullptr;
 
         std::map<ebm::StatementRef, FunctionDecl> functions;
         std::vector<ebm::StatementRef> function_insert_order;
@@ -35,6 +161,10 @@ namespace ebm2rmw {
         const FunctionDecl* get_current_function() const {
             return instructions;
         }
+
+        FunctionDecl* access_current_function() {
+            return instructions;
+        }
         const std::vector<Instruction>& get_instructions() const {
             return instructions->instructions;
         }
@@ -91,13 +221,34 @@ namespace ebm2rmw {
             return functions.find(func_id) != functions.end();
         }
 
-        auto new_function(ebm::StatementRef func_id) {
-            auto old = instructions;
-            if (!has_function(func_id)) {
-                functions[func_id] = {};
+        FunctionDecl* find_function(ebm::StatementRef func_id) {
+            auto found = functions.find(func_id);
+            if (found == functions.end()) {
+                return nullptr;
+            }
+            return &found->second;
+        }
+
+        FunctionDecl& ensure_function(ebm::StatementRef func_id) {
+            // lookup first; once all functions exist (e.g. while fuzz workers run) map is never modified
+            if (auto found = find_function(func_id)) {
+                return *found;
+            }
+            auto [it, inserted] = functions.try_emplace(func_id);
+            if (inserted) {
                 function_insert_order.push_back(func_id);
             }
-            instructions = &functions[func_id];
+            return it->second;
+        }
+
+        auto new_function(ebm::StatementRef func_id) {
+            return enter_function(ensure_function(func_id));
+        }
+
+        // same as new_function but with already resolved function (pointer is stable in std::map)
+        auto enter_function(FunctionDecl& decl) {
+            auto old = instructions;
+            instructions = &decl;
             return futils::helper::defer([&, old] {
                 instructions = old;
             });
@@ -111,4 +262,11 @@ namespace ebm2rmw {
             return function_insert_order;
         }
     };
+
+    // how records are laid out in --batch-input file
+    enum class BatchFraming {
+        Concat,  // records back to back; each ends where decode of the entry format stops
+        U32BE,   // each record is preceded by its length as big endian u32
+        U32LE,   // each record is preceded by its length as little endian u32
+    };
 }  // namespace ebm2rmw
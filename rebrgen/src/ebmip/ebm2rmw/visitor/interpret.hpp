@@ -13,6 +13,7 @@
 #include "inst.hpp"
 #include "ebmcodegen/stub/ops_macros.hpp"
 #include "layout.hpp"
+#include "profile.hpp"
 #include "number/hex/bin2hex.h"
 #include "ebmcodegen/stub/js_cancel.hpp"
 
@@ -206,10 +207,11 @@ namespace ebm2rmw {
     };
 
     struct StackFrame {
+        FunctionDecl* func = nullptr;  // function running in this frame
         ObjectRef self;
         std::vector<Value> params;
         std::vector<Value> locals;
-        std::vector<std::pair<ebm::OpCode, Value>> stack;
+        std::vector<Value> stack;
         std::vector<std::uint8_t> local_bytes;  // for storing local variables of struct/bytes type
     };
 
@@ -376,26 +378,81 @@ namespace ebm2rmw {
             return {};
         }
 
-       private:
-        std::vector<std::shared_ptr<StackFrame>> frame_pool;
+        // reset per-input state so that one RuntimeEnv can run many inputs (e.g. a fuzz worker).
+        // capacity of output buffer and frames is kept
+        void reset() {
+            input = {};
+            input_pos = 0;
+            output_buf.clear();
+            sub_input_stack.clear();
+            sub_output_stack.clear();
+            state_buffers.clear();
+            is_encoding = false;
+            decoded_self_bytes.clear();
+            decoded_self_type = {};
+            bytes_arena.clear();
+            bytes_arena_usage = 0;
+            // failed run leaves its frames on call_stack
+            call_stack.clear();
+            for (auto& frame : frame_storage) {
+                frame->func = nullptr;
+                frame->self = {};
+                frame->params.clear();
+                frame->locals.clear();
+                frame->stack.clear();
+                frame->local_bytes.clear();
+            }
+            std::fill(std::begin(stats_op_count), std::end(stats_op_count), 0);
+        }
 
-        auto new_frame(bool& no_error) {
-            if (frame_pool.empty()) {
-                frame_pool.push_back(std::make_shared<StackFrame>());
+        // lower every function and create callees that were not compiled, so that
+        // interpretation afterwards only reads Env. required before running RuntimeEnvs on multiple threads
+        void lower_all_functions(InitialContext& ctx) {
+            auto& env = ctx.config().env;
+            for (bool changed = true; changed;) {
+                changed = false;
+                for (auto& [_, func] : env.get_functions()) {
+                    if (!func.is_lowered()) {
+                        lower_function(ctx, func);
+                    }
+                }
+                for (auto& [_, func] : env.get_functions()) {
+                    for (auto& d : func.decoded) {
+                        if ((d.op == DecodedOp::CALL_GETTER || d.op == DecodedOp::LOAD_FUNC || d.op == DecodedOp::CALL_DIRECT) && !d.callee) {
+                            d.callee = &env.ensure_function(d.func_id);
+                            changed = true;
+                        }
+                    }
+                }
             }
-            auto frame = frame_pool.back();
-            frame_pool.pop_back();
-            call_stack.push_back(frame);
+        }
+
+       private:
+        // frames are owned per call depth and reused by next call at same depth
+        // (same reuse order as LIFO frame pool, without shared_ptr refcount)
+        std::vector<std::unique_ptr<StackFrame>> frame_storage;
+
+        auto new_frame(FunctionDecl& func, bool& no_error) {
+            auto& frame = next_frame();
+            frame.func = &func;
+            call_stack.push_back(&frame);
             return futils::helper::defer([&] {
                 if (no_error) {
-                    auto popped_frame = call_stack.back();
                     call_stack.pop_back();
-                    frame_pool.push_back(std::move(popped_frame));
                 }
             });
         }
 
-        std::uint64_t stats_op_count[256] = {0};
+        std::uint64_t stats_op_count[end_stats_slot + 1] = {0};
+        // fuse instruction pairs when lowering. false to run instructions one by one (--opt-verify reference run)
+        bool superinstructions = true;
+
+        // hand opcode counts of finished run to profiler (--profile)
+        void flush_op_counts(InitialContext& ctx) {
+            if (auto profiler = ctx.config().profiler) {
+                profiler->take_op_counts(stats_op_count);
+            }
+        }
 
        public:
         VariantEvalFn make_variant_eval_fn(InitialContext& ctx) {
@@ -419,9 +476,8 @@ namespace ebm2rmw {
             ExtractFn&& extract) {
             // Inherit caller's params (state variables) for selector/length functions
             auto caller_params = call_stack.empty() ? std::vector<Value>{} : call_stack.back()->params;
-            auto fn_guard = ctx.config().env.new_function(fn_ref);
             bool no_error = false;
-            const auto frame = new_frame(no_error);
+            const auto frame = new_frame(ctx.config().env.ensure_function(fn_ref), no_error);
             auto& this_ = *call_stack.back();
             this_.self = parent_self;
             this_.params = std::move(caller_params);
@@ -450,15 +506,15 @@ namespace ebm2rmw {
         ebmgen::expected<std::uint64_t> eval_vector_length(InitialContext& ctx, ebm::StatementRef length_fn_ref, ObjectRef parent_self) {
             return eval_compiled_fn(ctx, length_fn_ref, parent_self,
                 [](auto& frame) -> Value* {
-                    return frame.stack.empty() ? nullptr : &frame.stack.back().second;
+                    return frame.stack.empty() ? nullptr : &frame.stack.back();
                 });
         }
 
-        ebmgen::expected<void> interpret(InitialContext& ctx, ebm::StatementRef self_type, std::vector<Value>& params) {
+        ebmgen::expected<void> interpret(InitialContext& ctx, FunctionDecl& entry, ebm::StatementRef self_type, std::vector<Value>& params) {
             size_t ip = 0;
             bool no_error = false;
             auto start = ebmcodegen::Timepoint{};
-            const auto frame = new_frame(no_error);
+            const auto frame = new_frame(entry, no_error);
             auto& this_ = *call_stack.back();
             this_.params = params;
             LayoutAccess access(ctx);
@@ -472,7 +528,6 @@ namespace ebm2rmw {
             auto end = ebmcodegen::Timepoint{};
             auto variant_eval_fn = make_variant_eval_fn(ctx);
             auto dump_stack = [&] {
-                auto& env = ctx.config().env;
                 futils::code::CodeWriter<std::string> w;
                 size_t call_stack_depth = 0;
                 for (auto& frame : call_stack) {
@@ -482,8 +537,8 @@ namespace ebm2rmw {
                     auto& stack = frame->stack;
                     w.writeln("=== Stack ", std::to_string(call_stack_depth), " ===");
                     w.writeln("IP: ", std::to_string(ip));
-                    if (env.get_instructions().size() > ip) {
-                        w.writeln("Current Instruction: ", to_string(env.get_instructions()[ip].instr.op, true), " ", env.get_instructions()[ip].str_repr);
+                    if (auto& instructions = frame->func->instructions; instructions.size() > ip) {
+                        w.writeln("Current Instruction: ", to_string(instructions[ip].instr.op, true), " ", instructions[ip].str_repr);
                     }
                     w.writeln("Self:");
                     // Do NOT pass variant_eval_fn here: dump_stack iterates call_stack,
@@ -505,8 +560,7 @@ namespace ebm2rmw {
                     w.writeln("Stack:");
                     for (size_t i = 0; i < stack.size(); i++) {
                         w.write("  [", std::to_string(i), "]: ");
-                        stack[i].second.print(ctx, w);
-                        w.write(" by ", to_string(stack[i].first, true));
+                        stack[i].print(ctx, w);
                         w.writeln();
                     }
                     if (call_stack_depth == 0) {
@@ -529,6 +583,7 @@ namespace ebm2rmw {
                     dump_stack();
                 }
                 ctx.output().exit_code = 10;
+                flush_op_counts(ctx);
                 return ebmgen::unexpect_error(std::move(res.error()));
             }
             else {
@@ -545,10 +600,11 @@ namespace ebm2rmw {
                                               << vw.out() << "\n";
                 }
             }
+            flush_op_counts(ctx);
             return res;
         }
 
-        ebmgen::expected<void> interpret_encode(InitialContext& ctx, std::vector<Value>& params) {
+        ebmgen::expected<void> interpret_encode(InitialContext& ctx, FunctionDecl& entry, std::vector<Value>& params) {
             if (decoded_self_bytes.empty()) {
                 return ebmgen::unexpect_error("no decoded self available for encode (decode must run first)");
             }
@@ -558,7 +614,7 @@ namespace ebm2rmw {
             size_t ip = 0;
             bool no_error = false;
             auto start = ebmcodegen::Timepoint{};
-            const auto frame = new_frame(no_error);
+            const auto frame = new_frame(entry, no_error);
             auto& this_ = *call_stack.back();
             this_.params = params;
             this_.self = ObjectRef(decoded_self_type, futils::view::wvec(decoded_self_bytes));
@@ -566,7 +622,6 @@ namespace ebm2rmw {
             auto end = ebmcodegen::Timepoint{};
             auto variant_eval_fn = make_variant_eval_fn(ctx);
             auto dump_stack = [&] {
-                auto& env = ctx.config().env;
                 futils::code::CodeWriter<std::string> w;
                 size_t call_stack_depth = 0;
                 for (auto& frame : call_stack) {
@@ -576,8 +631,8 @@ namespace ebm2rmw {
                     auto& stack = frame->stack;
                     w.writeln("=== Stack ", std::to_string(call_stack_depth), " ===");
                     w.writeln("IP: ", std::to_string(ip));
-                    if (env.get_instructions().size() > ip) {
-                        w.writeln("Current Instruction: ", to_string(env.get_instructions()[ip].instr.op, true), " ", env.get_instructions()[ip].str_repr);
+                    if (auto& instructions = frame->func->instructions; instructions.size() > ip) {
+                        w.writeln("Current Instruction: ", to_string(instructions[ip].instr.op, true), " ", instructions[ip].str_repr);
                     }
                     w.writeln("Self:");
                     // Do NOT pass variant_eval_fn here: dump_stack iterates call_stack,
@@ -599,8 +654,7 @@ namespace ebm2rmw {
                     w.writeln("Stack:");
                     for (size_t i = 0; i < stack.size(); i++) {
                         w.write("  [", std::to_string(i), "]: ");
-                        stack[i].second.print(ctx, w);
-                        w.write(" by ", to_string(stack[i].first, true));
+                        stack[i].print(ctx, w);
                         w.writeln();
                     }
                     call_stack_depth++;
@@ -613,6 +667,7 @@ namespace ebm2rmw {
                 if (ctx.flags().print_final_stack) {
                     dump_stack();
                 }
+                flush_op_counts(ctx);
                 return ebmgen::unexpect_error(std::move(res.error()));
             }
             else {
@@ -621,6 +676,7 @@ namespace ebm2rmw {
                     dump_stack();
                 }
             }
+            flush_op_counts(ctx);
             return res;
         }
 
@@ -644,841 +700,1182 @@ namespace ebm2rmw {
        private:
         BytesArena bytes_arena;
         size_t bytes_arena_usage = 0;
-        std::vector<std::shared_ptr<StackFrame>> call_stack;
+        std::vector<StackFrame*> call_stack;
+
+        // lower instructions of function once into DecodedInstruction
+        // malformed instructions are lowered to MALFORMED so that error is reported only when reached
+        void lower_function(InitialContext& ctx, FunctionDecl& func) {
+            auto& env = ctx.config().env;
+            auto& module_ = get_visitor_arg_from_context(ctx).module_;
+            auto& code = func.decoded;
+            code.clear();
+            func.wide_operands.clear();
+            func.lowering_errors.clear();
+            const size_t count = func.instructions.size();
+            code.reserve(count + 1);
+            for (size_t ip = 0; ip < count; ip++) {
+                auto& instr = func.instructions[ip];
+                auto& op = instr.instr.op;
+                DecodedInstruction d{
+                    .source_op = op,
+                    .stats_slot = static_cast<std::uint8_t>(op),
+                    .scratch = instr.scratch,
+                    .type_info = instr.type_info,
+                };
+                auto wide = [&]() -> DecodedWideOperand& {
+                    d.wide = static_cast<std::uint32_t>(func.wide_operands.size());
+                    return func.wide_operands.emplace_back();
+                };
+                auto malformed = [&](std::string msg) {
+                    d.op = DecodedOp::MALFORMED;
+                    d.imm = func.lowering_errors.size();
+                    func.lowering_errors.push_back(std::move(msg));
+                };
+                auto lower_jump = [&] {
+                    auto offset = instr.instr.target();
+                    if (!offset) {
+                        return malformed(std::format("missing jump target in {}", to_string(op, true)));
+                    }
+                    // out of range target (including wrap around of backward jump) terminates function like ip >= count
+                    size_t target = offset->backward() ? ip - offset->offset.value() : ip + offset->offset.value();
+                    d.target = static_cast<std::uint32_t>(target > count ? count : target);
+                };
+                auto lower_callee = [&](const char* name) {
+                    auto func_id = instr.instr.func_id();
+                    if (!func_id) {
+                        return malformed(std::format("missing function id in {}", name));
+                    }
+                    auto& w = wide();
+                    w.func_id = *func_id;
+                    w.callee = env.find_function(*func_id);
+                };
+                auto lower_arg_num = [&](const char* name) {
+                    auto num_args = instr.instr.arg_num();
+                    if (!num_args) {
+                        return malformed(std::format("missing argument number in {}", name));
+                    }
+                    d.imm = num_args->value();
+                };
+                auto lower_value = [&](const char* name) {
+                    auto value = instr.instr.value();
+                    if (!value) {
+                        return malformed(std::format("missing immediate value in {}", name));
+                    }
+                    d.imm = value->value();
+                };
+                if (auto bop = OpCode_to_BinaryOp(op)) {
+                    d.op = DecodedOp::BINARY;
+                    d.bop = *bop;
+                }
+                else if (auto uop = OpCode_to_UnaryOp(op)) {
+                    d.op = DecodedOp::UNARY;
+                    d.uop = *uop;
+                }
+                else {
+                    switch (op) {
+#define EBM2RMW_SIMPLE_OP(name)   \
+    case ebm::OpCode::name:       \
+        d.op = DecodedOp::name; \
+        break;
+                        EBM2RMW_SIMPLE_OP(NOP)
+                        EBM2RMW_SIMPLE_OP(PUSH_SUB_INPUT)
+                        EBM2RMW_SIMPLE_OP(POP_SUB_INPUT)
+                        EBM2RMW_SIMPLE_OP(PUSH_SEEK_SUB_INPUT)
+                        EBM2RMW_SIMPLE_OP(POP_SEEK_SUB_INPUT)
+                        EBM2RMW_SIMPLE_OP(PUSH_SUB_OUTPUT)
+                        EBM2RMW_SIMPLE_OP(POP_SUB_OUTPUT)
+                        EBM2RMW_SIMPLE_OP(HALT)
+                        EBM2RMW_SIMPLE_OP(LOAD_SELF)
+                        EBM2RMW_SIMPLE_OP(LOAD_LOCAL)
+                        EBM2RMW_SIMPLE_OP(LOAD_LOCAL_REF)
+                        EBM2RMW_SIMPLE_OP(STORE_LOCAL)
+                        EBM2RMW_SIMPLE_OP(STORE_REF)
+                        EBM2RMW_SIMPLE_OP(ASSERT)
+                        EBM2RMW_SIMPLE_OP(ARRAY_LEN)
+                        EBM2RMW_SIMPLE_OP(ARRAY_GET)
+                        EBM2RMW_SIMPLE_OP(AVAILABLE)
+                        EBM2RMW_SIMPLE_OP(GET_OFFSET)
+                        EBM2RMW_SIMPLE_OP(LOAD_SELF_MEMBER)
+                        EBM2RMW_SIMPLE_OP(LOAD_MEMBER)
+                        EBM2RMW_SIMPLE_OP(LOAD_PARAM)
+                        EBM2RMW_SIMPLE_OP(NEW_STRUCT)
+                        EBM2RMW_SIMPLE_OP(POP)
+                        EBM2RMW_SIMPLE_OP(WRITE_U8)
+                        EBM2RMW_SIMPLE_OP(WRITE_BYTES)
+                        EBM2RMW_SIMPLE_OP(VECTOR_PUSH)
+                        EBM2RMW_SIMPLE_OP(ERROR)
+#undef EBM2RMW_SIMPLE_OP
+                        case ebm::OpCode::PUSH_IMM_INT:
+                            d.op = DecodedOp::PUSH_IMM_INT;
+                            lower_value("PUSH_IMM_INT");
+                            break;
+                        case ebm::OpCode::STORE_LOCAL_IMM:
+                            d.op = DecodedOp::STORE_LOCAL_IMM;
+                            lower_value("STORE_LOCAL_IMM");
+                            break;
+                        case ebm::OpCode::EQ_IMM:
+                            d.op = DecodedOp::EQ_IMM;
+                            lower_value("EQ_IMM");
+                            break;
+                        case ebm::OpCode::NEW_BYTES: {
+                            d.op = DecodedOp::NEW_BYTES;
+                            auto imm = instr.instr.imm();
+                            if (!imm || !imm->size()) {
+                                malformed("missing size immediate in NEW_BYTES");
+                                break;
+                            }
+                            d.imm = imm->size()->value();
+                            break;
+                        }
+                        case ebm::OpCode::ARRAY_GET_IMM: {
+                            d.op = DecodedOp::ARRAY_GET_IMM;
+                            auto index = instr.instr.index();
+                            if (!index) {
+                                malformed("missing index in ARRAY_GET_IMM");
+                                break;
+                            }
+                            d.imm = index->value();
+                            break;
+                        }
+                        case ebm::OpCode::READ_BYTE: {
+                            d.op = DecodedOp::READ_BYTE;
+                            auto offset = instr.instr.offset();
+                            if (!offset) {
+                                malformed("missing offset in READ_BYTE");
+                                break;
+                            }
+                            d.imm = offset->value();
+                            break;
+                        }
+                        case ebm::OpCode::READ_BYTES: {
+                            d.op = DecodedOp::READ_BYTES;
+                            auto imm = instr.instr.imm();
+                            if (!imm) {
+                                malformed("missing immediate in READ_BYTES");
+                                break;
+                            }
+                            if (auto static_size = imm->size()) {
+                                d.flag = true;
+                                d.imm = static_size->value();
+                            }
+                            auto& w = wide();
+                            if (auto offset = instr.instr.offset()) {
+                                w.imm2 = offset->value();
+                            }
+                            break;
+                        }
+                        case ebm::OpCode::CALL_GETTER:
+                            d.op = DecodedOp::CALL_GETTER;
+                            lower_callee("CALL_GETTER");
+                            break;
+                        case ebm::OpCode::LOAD_FUNC:
+                            d.op = DecodedOp::LOAD_FUNC;
+                            lower_callee("LOAD_FUNC");
+                            break;
+                        case ebm::OpCode::CALL:
+                            d.op = DecodedOp::CALL;
+                            lower_arg_num("CALL");
+                            break;
+                        case ebm::OpCode::CALL_DIRECT: {
+                            d.op = DecodedOp::CALL_DIRECT;
+                            lower_arg_num("CALL_DIRECT");
+                            if (d.op == DecodedOp::MALFORMED) {
+                                break;
+                            }
+                            lower_callee("CALL_DIRECT");
+                            if (d.op == DecodedOp::MALFORMED) {
+                                break;
+                            }
+                            // A free function (an imported module's top-level fn, whose
+                            // FUNCTION_DECL has a nil parent_format) is called without a
+                            // self receiver on the stack; a method pops its receiver.
+                            d.flag = true;
+                            if (auto* fstmt = module_.get_statement(func.wide_operands[d.wide].func_id)) {
+                                if (auto* fd = fstmt->body.func_decl()) {
+                                    d.flag = !is_nil(fd->parent_format);
+                                }
+                            }
+                            break;
+                        }
+                        case ebm::OpCode::JUMP_IF_FALSE:
+                            d.op = DecodedOp::JUMP_IF_FALSE;
+                            lower_jump();
+                            break;
+                        case ebm::OpCode::JUMP:
+                            d.op = DecodedOp::JUMP;
+                            lower_jump();
+                            break;
+                        case ebm::OpCode::RET: {
+                            d.op = DecodedOp::RET;
+                            auto ret_value = instr.instr.ret_value();
+                            d.flag = ret_value && ret_value->has_value();
+                            break;
+                        }
+                        default:
+                            d.op = DecodedOp::UNSUPPORTED;
+                            break;
+                    }
+                }
+                code.push_back(d);
+            }
+            code.push_back(DecodedInstruction{});  // END sentinel
+            if (superinstructions && !ctx.flags().no_optimize) {
+                fuse_superinstructions(code);
+            }
+        }
+
+        // fuse common pairs into the first slot. fused instruction continues at ip + 2
+        // (or jumps), and the second slot is left as is so that jumps into it still work
+        static void fuse_superinstructions(std::vector<DecodedInstruction>& code) {
+            for (size_t i = 0; i + 1 < code.size(); i++) {
+                auto& first = code[i];
+                const auto& second = code[i + 1];
+                if (first.op == DecodedOp::PUSH_IMM_INT && second.op == DecodedOp::BINARY) {
+                    first.op = DecodedOp::BINARY_IMM;
+                    first.bop = second.bop;
+                    first.source_op = second.source_op;
+                }
+                else if (first.op == DecodedOp::EQ_IMM && second.op == DecodedOp::JUMP_IF_FALSE) {
+                    first.op = DecodedOp::EQ_IMM_JUMP_IF_FALSE;
+                    first.target = second.target;
+                }
+                else if (first.op == DecodedOp::BINARY && second.op == DecodedOp::JUMP_IF_FALSE) {
+                    first.op = DecodedOp::BINARY_JUMP_IF_FALSE;
+                    first.target = second.target;
+                }
+            }
+        }
+
+        StackFrame& next_frame() {
+            if (frame_storage.size() <= call_stack.size()) {
+                frame_storage.push_back(std::make_unique<StackFrame>());
+            }
+            return *frame_storage[call_stack.size()];
+        }
+
+        // callee resolved at lowering time, or resolve it now
+        FunctionDecl& resolve_callee(Env& env, const DecodedWideOperand& w) {
+            return w.callee ? *w.callee : env.ensure_function(w.func_id);
+        }
 
         ebmgen::expected<void> interpret_impl(InitialContext& ctx, size_t& ip) {
             auto& env = ctx.config().env;
+            auto& func = *call_stack.back()->func;
+            if (!func.is_lowered()) {
+                lower_function(ctx, func);
+            }
+            // every return path of this call, including errors, closes the profiled call
+            auto* const profiler = ctx.config().profiler;
+            if (profiler) [[unlikely]] {
+                profiler->enter(&func, input_pos, output_buf.size());
+            }
+            const auto profile_exit = futils::helper::defer([&] {
+                if (profiler) [[unlikely]] {
+                    profiler->exit(input_pos, output_buf.size());
+                }
+            });
             auto& this_ = *call_stack.back();
             auto& self = this_.self;
             auto& params = this_.params;
             auto& stack = this_.stack;
             auto& local_bytes_arena = this_.local_bytes;
-            local_bytes_arena.resize(ctx.config().env.get_current_function()->structs_area);
+            local_bytes_arena.resize(func.structs_area);
             stack.reserve(128);  // arbitrary initial stack size, can grow as needed
+            const bool trace_step = ctx.flags().print_step;
+            const bool trace_state = ctx.flags().print_state;
+            const DecodedInstruction* code = func.decoded.data();
+            const DecodedInstruction* d = code;
+            const DecodedWideOperand* wide_operands = func.wide_operands.data();
             auto stack_pop = [&] {
                 assert(!stack.empty());
                 auto val = std::move(stack.back());
                 stack.pop_back();
-                if (ctx.flags().print_state) {
+                if (trace_state) {
                     futils::wrap::cout_wrap() << "  stack_pop: ";
                     TmpCodeWriter w;
-                    val.second.print(ctx, w);
-                    futils::wrap::cout_wrap() << w.out() << " from opcode " << to_string(val.first, true) << "\n";
+                    val.print(ctx, w);
+                    futils::wrap::cout_wrap() << w.out() << "\n";
                 }
-                return val.second;
+                return val;
             };
-            auto stack_push_with_stack = [&](std::vector<std::pair<ebm::OpCode, Value>>& s, Value val) {
-                if (ctx.flags().print_state) {
+            auto stack_push_with_stack = [&](std::vector<Value>& s, Value val) {
+                if (trace_state) {
                     futils::wrap::cout_wrap() << "  stack_push: ";
                     TmpCodeWriter w;
                     val.print(ctx, w);
-                    futils::wrap::cout_wrap() << w.out() << " from opcode " << to_string(env.get_instructions()[ip].instr.op, true) << "\n";
+                    futils::wrap::cout_wrap() << w.out() << " from opcode " << to_string(d->source_op, true) << "\n";
                 }
-                s.push_back(std::make_pair(env.get_instructions()[ip].instr.op, std::move(val)));
+                s.push_back(std::move(val));
             };
             auto stack_push = [&](Value val) {
                 stack_push_with_stack(stack, std::move(val));
             };
             auto& locals = this_.locals;
-            locals.resize(env.get_current_function()->local_count);
+            locals.resize(func.local_count);
             bool no_error = false;
-            auto print_step = [&](const Instruction& instr) {
-                auto args = instruction_args(instr.instr, ctx, ip, env.get_current_function());
+            const size_t instruction_count = func.instructions.size();
+            auto print_step = [&] {
+                if (ip >= instruction_count) {
+                    return;
+                }
+                auto& instr = func.instructions[ip];
+                auto args = instruction_args(instr.instr, ctx, ip, &func);
                 futils::wrap::cout_wrap() << "ip=" << ip << ", op=" << to_string(instr.instr.op, true);
                 if (args.size() > 0) {
                     futils::wrap::cout_wrap() << ", args={" << args << "}";
                 }
                 futils::wrap::cout_wrap() << ", str_repr=" << instr.str_repr << ", stack_size=" << stack.size() << ", call_stack_size=" << call_stack.size() << "\n";
             };
+            auto str_repr = [&]() -> std::string_view {
+                return func.instructions[ip].str_repr;
+            };
             js_may_cancel_task();
-            auto instructions = env.get_instructions().data();
-            size_t instruction_count = env.get_instructions().size();
-            while (ip < instruction_count) {
-                auto& instr = instructions[ip];
-                stats_op_count[static_cast<std::uint8_t>(instr.instr.op)]++;
-                if (ctx.flags().print_step) {
-                    print_step(instr);
-                }
-                if (auto bop = OpCode_to_BinaryOp(instr.instr.op)) {
-                    if (stack.size() < 2) {
-                        return ebmgen::unexpect_error("stack underflow on binary operation");
-                    }
-                    auto right = stack_pop();
-                    auto left = stack_pop();
-                    auto r = [&]() -> ebmgen::expected<void> {
-                        APPLY_BINARY_OP(*bop, [&](auto&& op) -> ebmgen::expected<void> {
-                            right.as_int();
-                            left.as_int();
-                            if (!std::holds_alternative<std::uint64_t>(left.value) || !std::holds_alternative<std::uint64_t>(right.value)) {
-                                return ebmgen::unexpect_error("binary operation operands must be integers");
-                            }
-                            auto lval = std::get<std::uint64_t>(left.value);
-                            auto rval = std::get<std::uint64_t>(right.value);
-                            auto result = op(lval, rval);
-                            stack_push(Value{result});
-                            return ebmgen::expected<void>{};
-                        });
-                        return ebmgen::unexpect_error("unsupported binary operation in interpreter: {}", to_string(*bop));
-                    }();
-                    MAYBE_VOID(r_, r);
-                    ip++;
-                    continue;
-                }
-                if (auto uop = OpCode_to_UnaryOp(instr.instr.op)) {
-                    if (stack.empty()) {
-                        return ebmgen::unexpect_error("stack underflow on unary operation");
-                    }
-                    auto operand = stack_pop();
-                    auto r = [&]() -> ebmgen::expected<void> {
-                        APPLY_UNARY_OP(*uop, [&](auto&& op) -> ebmgen::expected<void> {
-                            operand.as_int();
-                            if (!std::holds_alternative<std::uint64_t>(operand.value)) {
-                                return ebmgen::unexpect_error("unary operation operand must be an integer");
+            if (ip > instruction_count) {
+                ip = instruction_count;
+            }
+
+            // direct threaded dispatch with computed goto if available, otherwise switch
+#if defined(__GNUC__) || defined(__clang__)
+            static const void* const dispatch_table[] = {
+#define EBM2RMW_DISPATCH_LABEL(name) &&op_##name,
+                EBM2RMW_DECODED_OPS(EBM2RMW_DISPATCH_LABEL)
+#undef EBM2RMW_DISPATCH_LABEL
+            };
+#define EBM2RMW_DISPATCH()                         \
+    do {                                           \
+        d = code + ip;                             \
+        stats_op_count[d->stats_slot]++;           \
+        if (trace_step) [[unlikely]] {             \
+            print_step();                          \
+        }                                          \
+        goto* dispatch_table[size_t(d->op)];       \
+    } while (0)
+#define EBM2RMW_OP(name) op_##name:
+#else
+#define EBM2RMW_DISPATCH() goto dispatch
+#define EBM2RMW_OP(name) case DecodedOp::name:
+#endif
+#define EBM2RMW_NEXT() \
+    do {               \
+        ip++;          \
+        EBM2RMW_DISPATCH(); \
+    } while (0)
+#define EBM2RMW_JUMP(to) \
+    do {                 \
+        ip = (to);       \
+        EBM2RMW_DISPATCH(); \
+    } while (0)
+
+#if defined(__GNUC__) || defined(__clang__)
+            EBM2RMW_DISPATCH();
+#else
+        dispatch:
+            d = code + ip;
+            stats_op_count[d->stats_slot]++;
+            if (trace_step) {
+                print_step();
+            }
+            switch (d->op) {
+#endif
+            EBM2RMW_OP(NOP) {
+                EBM2RMW_NEXT();
+            }
+            EBM2RMW_OP(BINARY) {
+                if (stack.size() < 2) {
+                    return ebmgen::unexpect_error("stack underflow on binary operation");
+                }
+                auto right = stack_pop();
+                auto left = stack_pop();
+                auto r = [&]() -> ebmgen::expected<void> {
+                    APPLY_BINARY_OP(d->bop, [&](auto&& op) -> ebmgen::expected<void> {
+                        right.as_int();
+                        left.as_int();
+                        if (!std::holds_alternative<std::uint64_t>(left.value) || !std::holds_alternative<std::uint64_t>(right.value)) {
+                            return ebmgen::unexpect_error("binary operation operands must be integers");
+                        }
+                        auto lval = std::get<std::uint64_t>(left.value);
+                        auto rval = std::get<std::uint64_t>(right.value);
+                        auto result = op(lval, rval);
+                        stack_push(Value{result});
+                        return ebmgen::expected<void>{};
+                    });
+                    return ebmgen::unexpect_error("unsupported binary operation in interpreter: {}", to_string(d->bop));
+                }();
+                MAYBE_VOID(r_, r);
+                EBM2RMW_NEXT();
+            }
+            EBM2RMW_OP(BINARY_IMM) {
+                // PUSH_IMM_INT imm; BINARY
+                if (stack.empty()) {
+                    return ebmgen::unexpect_error("stack underflow on binary operation");
+                }
+                auto left = stack_pop();
+                left.as_int();
+                if (!std::holds_alternative<std::uint64_t>(left.value)) {
+                    return ebmgen::unexpect_error("binary operation operands must be integers");
+                }
+                auto result = eval_binary_op(d->bop, std::get<std::uint64_t>(left.value), d->imm);
+                if (!result) {
+                    return ebmgen::unexpect_error("unsupported binary operation in interpreter: {}", to_string(d->bop));
+                }
+                stack_push(Value{*result});
+                EBM2RMW_JUMP(ip + 2);
+            }
+            EBM2RMW_OP(BINARY_JUMP_IF_FALSE) {
+                // BINARY; JUMP_IF_FALSE target
+                if (stack.size() < 2) {
+                    return ebmgen::unexpect_error("stack underflow on binary operation");
+                }
+                auto right = stack_pop();
+                auto left = stack_pop();
+                right.as_int();
+                left.as_int();
+                if (!std::holds_alternative<std::uint64_t>(left.value) || !std::holds_alternative<std::uint64_t>(right.value)) {
+                    return ebmgen::unexpect_error("binary operation operands must be integers");
+                }
+                auto result = eval_binary_op(d->bop, std::get<std::uint64_t>(left.value), std::get<std::uint64_t>(right.value));
+                if (!result) {
+                    return ebmgen::unexpect_error("unsupported binary operation in interpreter: {}", to_string(d->bop));
+                }
+                if (*result == 0) {
+                    EBM2RMW_JUMP(d->target);
+                }
+                EBM2RMW_JUMP(ip + 2);
+            }
+            EBM2RMW_OP(UNARY) {
+                if (stack.empty()) {
+                    return ebmgen::unexpect_error("stack underflow on unary operation");
+                }
+                auto operand = stack_pop();
+                auto r = [&]() -> ebmgen::expected<void> {
+                    APPLY_UNARY_OP(d->uop, [&](auto&& op) -> ebmgen::expected<void> {
+                        operand.as_int();
+                        if (!std::holds_alternative<std::uint64_t>(operand.value)) {
+                            return ebmgen::unexpect_error("unary operation operand must be an integer");
+                        }
+                        auto val = std::get<std::uint64_t>(operand.value);
+                        auto result = op(val);
+                        stack_push(Value{result});
+                        return ebmgen::expected<void>{};
+                    });
+                    return ebmgen::unexpect_error("unsupported unary operation in interpreter: {}", to_string(d->uop));
+                }();
+                MAYBE_VOID(r_, r);
+                EBM2RMW_NEXT();
+            }
+            EBM2RMW_OP(PUSH_SUB_INPUT) {
+                if (stack.empty()) {
+                    return ebmgen::unexpect_error("stack underflow on PUSH_SUB_INPUT");
+                }
+                auto len_val = stack_pop();
+                len_val.as_int();  // length may be a member ref holding raw bytes
+                if (!std::holds_alternative<std::uint64_t>(len_val.value)) {
+                    return ebmgen::unexpect_error("PUSH_SUB_INPUT: length is not integer");
+                }
+                size_t length = static_cast<size_t>(std::get<std::uint64_t>(len_val.value));
+                auto sub = input.substr(input_pos, length);
+                if (sub.size() < length) {
+                    return ebmgen::unexpect_error("PUSH_SUB_INPUT: need {} bytes but only {} available", length, sub.size());
+                }
+                sub_input_stack.push_back({input, input_pos, length});
+                input = sub;
+                input_pos = 0;
+                EBM2RMW_NEXT();
+            }
+            EBM2RMW_OP(POP_SUB_INPUT) {
+                if (sub_input_stack.empty()) {
+                    return ebmgen::unexpect_error("sub_input_stack underflow on POP_SUB_INPUT");
+                }
+                auto& saved = sub_input_stack.back();
+                input = saved.saved_input;
+                input_pos = saved.saved_input_pos + saved.advance_length;
+                sub_input_stack.pop_back();
+                EBM2RMW_NEXT();
+            }
+            EBM2RMW_OP(PUSH_SEEK_SUB_INPUT) {
+                if (stack.size() < 2) {
+                    return ebmgen::unexpect_error("stack underflow on PUSH_SEEK_SUB_INPUT");
+                }
+                auto len_val = stack_pop();
+                len_val.unref();
+                auto off_val = stack_pop();
+                off_val.unref();
+                if (!std::holds_alternative<std::uint64_t>(len_val.value) ||
+                    !std::holds_alternative<std::uint64_t>(off_val.value)) {
+                    return ebmgen::unexpect_error("PUSH_SEEK_SUB_INPUT: non-integer operand");
+                }
+                size_t length = static_cast<size_t>(std::get<std::uint64_t>(len_val.value));
+                size_t offset = static_cast<size_t>(std::get<std::uint64_t>(off_val.value));
+                auto sub = input.substr(offset, length);
+                if (sub.size() < length) {
+                    return ebmgen::unexpect_error("PUSH_SEEK_SUB_INPUT: need {} bytes at offset {} but only {} available", length, offset, sub.size());
+                }
+                sub_input_stack.push_back({input, input_pos, 0});
+                input = sub;
+                input_pos = 0;
+                EBM2RMW_NEXT();
+            }
+            EBM2RMW_OP(POP_SEEK_SUB_INPUT) {
+                if (sub_input_stack.empty()) {
+                    return ebmgen::unexpect_error("sub_input_stack underflow on POP_SEEK_SUB_INPUT");
+                }
+                auto& saved = sub_input_stack.back();
+                input = saved.saved_input;
+                input_pos = saved.saved_input_pos;
+                sub_input_stack.pop_back();
+                EBM2RMW_NEXT();
+            }
+            EBM2RMW_OP(PUSH_SUB_OUTPUT) {
+                if (stack.empty()) {
+                    return ebmgen::unexpect_error("stack underflow on PUSH_SUB_OUTPUT");
+                }
+                auto len_val = stack_pop();
+                len_val.as_int();  // length may be a member ref holding raw bytes
+                if (!std::holds_alternative<std::uint64_t>(len_val.value)) {
+                    return ebmgen::unexpect_error("PUSH_SUB_OUTPUT: length is not integer");
+                }
+                auto expected = static_cast<size_t>(std::get<std::uint64_t>(len_val.value));
+                sub_output_stack.push_back({output_buf.size(), expected, str_repr()});
+                EBM2RMW_NEXT();
+            }
+            EBM2RMW_OP(POP_SUB_OUTPUT) {
+                if (sub_output_stack.empty()) {
+                    return ebmgen::unexpect_error("sub_output_stack underflow on POP_SUB_OUTPUT");
+                }
+                auto saved = sub_output_stack.back();
+                sub_output_stack.pop_back();
+                size_t written = output_buf.size() - saved.saved_output_len;
+                if (!ctx.flags().skip_write_size_check && written != saved.expected_length) {
+                    return ebmgen::unexpect_error("SUB_OUTPUT size mismatch: expected {} bytes but wrote {}: expected for {}", saved.expected_length, written, saved.str_repr);
+                }
+                EBM2RMW_NEXT();
+            }
+            EBM2RMW_OP(HALT) {
+                return ebmgen::unexpect_error("HALT reached");
+            }
+            EBM2RMW_OP(PUSH_IMM_INT) {
+                stack_push(Value{d->imm});
+                EBM2RMW_NEXT();
+            }
+            EBM2RMW_OP(NEW_BYTES) {
+                auto value = futils::view::wvec(local_bytes_arena).substr(d->scratch, d->imm);
+                if (value.size() != d->imm) {
+                    return ebmgen::unexpect_error("invalid local bytes size: expected {}, got {}", d->imm, value.size());
+                }
+                stack_push(Value{ObjectRef(d->type_info, value)});
+                EBM2RMW_NEXT();
+            }
+            EBM2RMW_OP(LOAD_SELF) {
+                stack_push(Value{self});
+                EBM2RMW_NEXT();
+            }
+            EBM2RMW_OP(LOAD_LOCAL) {
+                auto& found = locals[d->scratch];
+                if (trace_state) {
+                    futils::wrap::cout_wrap() << "  local_load: [" << d->scratch << "] = ";
+                    TmpCodeWriter w;
+                    found.print(ctx, w);
+                    futils::wrap::cout_wrap() << w.out() << "\n";
+                }
+                stack_push(Value{found});
+                EBM2RMW_NEXT();
+            }
+            EBM2RMW_OP(LOAD_LOCAL_REF) {
+                auto& found = locals[d->scratch];
+                if (trace_state) {
+                    futils::wrap::cout_wrap() << "  local_load: [" << d->scratch << "] = ";
+                    TmpCodeWriter w;
+                    found.print(ctx, w);
+                    futils::wrap::cout_wrap() << w.out() << "\n";
+                }
+                stack_push(Value{&found});
+                EBM2RMW_NEXT();
+            }
+            EBM2RMW_OP(STORE_LOCAL_IMM) {
+                if (trace_state) {
+                    futils::wrap::cout_wrap() << "  local_store_imm: [" << d->scratch << "] = " << d->imm << "\n";
+                }
+                locals[d->scratch] = Value{d->imm};
+                EBM2RMW_NEXT();
+            }
+            EBM2RMW_OP(EQ_IMM) {
+                if (stack.empty()) {
+                    return ebmgen::unexpect_error("stack underflow on EQ_IMM");
+                }
+                auto val = stack_pop();
+                val.as_int();
+                if (!std::holds_alternative<std::uint64_t>(val.value)) {
+                    return ebmgen::unexpect_error("EQ_IMM operand is not an integer");
+                }
+                std::uint64_t result = (std::get<std::uint64_t>(val.value) == d->imm) ? 1 : 0;
+                stack_push(Value{result});
+                EBM2RMW_NEXT();
+            }
+            EBM2RMW_OP(EQ_IMM_JUMP_IF_FALSE) {
+                // EQ_IMM imm; JUMP_IF_FALSE target
+                if (stack.empty()) {
+                    return ebmgen::unexpect_error("stack underflow on EQ_IMM");
+                }
+                auto val = stack_pop();
+                val.as_int();
+                if (!std::holds_alternative<std::uint64_t>(val.value)) {
+                    return ebmgen::unexpect_error("EQ_IMM operand is not an integer");
+                }
+                if (std::get<std::uint64_t>(val.value) != d->imm) {
+                    EBM2RMW_JUMP(d->target);
+                }
+                EBM2RMW_JUMP(ip + 2);
+            }
+            EBM2RMW_OP(STORE_LOCAL) {
+                if (stack.empty()) {
+                    return ebmgen::unexpect_error("stack underflow on STORE_LOCAL");
+                }
+                auto val = stack_pop();
+                val.unref();
+                if (trace_state) {
+                    futils::wrap::cout_wrap() << "  locals_store: [" << d->scratch << "] = ";
+                    TmpCodeWriter w;
+                    val.print(ctx, w);
+                    futils::wrap::cout_wrap() << w.out() << "\n";
+                }
+                locals[d->scratch] = std::move(val);
+                EBM2RMW_NEXT();
+            }
+            EBM2RMW_OP(STORE_REF) {
+                if (stack.size() < 2) {
+                    return ebmgen::unexpect_error("stack underflow on STORE_REF");
+                }
+                auto ref = stack_pop();
+                auto val = stack_pop();
+                if (!std::holds_alternative<Value*>(ref.value)) {
+                    if (auto object_ref = std::get_if<ObjectRef>(&ref.value)) {
+                        if (auto objref_src = std::get_if<ObjectRef>(&val.value)) {
+                            if (object_ref->raw_object.size() != objref_src->raw_object.size()) {
+                                return ebmgen::unexpect_error("object size mismatch in STORE_REF: {} vs {}", object_ref->raw_object.size(), objref_src->raw_object.size());
                             }
-                            auto val = std::get<std::uint64_t>(operand.value);
-                            auto result = op(val);
-                            stack_push(Value{result});
-                            return ebmgen::expected<void>{};
-                        });
-                        return ebmgen::unexpect_error("unsupported unary operation in interpreter: {}", to_string(*uop));
-                    }();
-                    MAYBE_VOID(r_, r);
-                    ip++;
-                    continue;
-                }
-                switch (instr.instr.op) {
-                    case ebm::OpCode::NOP:
-                        break;
-                    case ebm::OpCode::PUSH_SUB_INPUT: {
-                        if (stack.empty()) {
-                            return ebmgen::unexpect_error("stack underflow on PUSH_SUB_INPUT");
-                        }
-                        auto len_val = stack_pop();
-                        len_val.as_int();  // length may be a member ref holding raw bytes
-                        if (!std::holds_alternative<std::uint64_t>(len_val.value)) {
-                            return ebmgen::unexpect_error("PUSH_SUB_INPUT: length is not integer");
-                        }
-                        size_t length = static_cast<size_t>(std::get<std::uint64_t>(len_val.value));
-                        auto sub = input.substr(input_pos, length);
-                        if (sub.size() < length) {
-                            return ebmgen::unexpect_error("PUSH_SUB_INPUT: need {} bytes but only {} available", length, sub.size());
+                            std::copy(objref_src->raw_object.begin(), objref_src->raw_object.end(), object_ref->raw_object.begin());
+                            EBM2RMW_NEXT();
                         }
-                        sub_input_stack.push_back({input, input_pos, length});
-                        input = sub;
-                        input_pos = 0;
-                        break;
-                    }
-                    case ebm::OpCode::POP_SUB_INPUT: {
-                        if (sub_input_stack.empty()) {
-                            return ebmgen::unexpect_error("sub_input_stack underflow on POP_SUB_INPUT");
-                        }
-                        auto& saved = sub_input_stack.back();
-                        input = saved.saved_input;
-                        input_pos = saved.saved_input_pos + saved.advance_length;
-                        sub_input_stack.pop_back();
-                        break;
-                    }
-                    case ebm::OpCode::PUSH_SEEK_SUB_INPUT: {
-                        if (stack.size() < 2) {
-                            return ebmgen::unexpect_error("stack underflow on PUSH_SEEK_SUB_INPUT");
-                        }
-                        auto len_val = stack_pop();
-                        len_val.unref();
-                        auto off_val = stack_pop();
-                        off_val.unref();
-                        if (!std::holds_alternative<std::uint64_t>(len_val.value) ||
-                            !std::holds_alternative<std::uint64_t>(off_val.value)) {
-                            return ebmgen::unexpect_error("PUSH_SEEK_SUB_INPUT: non-integer operand");
-                        }
-                        size_t length = static_cast<size_t>(std::get<std::uint64_t>(len_val.value));
-                        size_t offset = static_cast<size_t>(std::get<std::uint64_t>(off_val.value));
-                        auto sub = input.substr(offset, length);
-                        if (sub.size() < length) {
-                            return ebmgen::unexpect_error("PUSH_SEEK_SUB_INPUT: need {} bytes at offset {} but only {} available", length, offset, sub.size());
-                        }
-                        sub_input_stack.push_back({input, input_pos, 0});
-                        input = sub;
-                        input_pos = 0;
-                        break;
-                    }
-                    case ebm::OpCode::POP_SEEK_SUB_INPUT: {
-                        if (sub_input_stack.empty()) {
-                            return ebmgen::unexpect_error("sub_input_stack underflow on POP_SEEK_SUB_INPUT");
-                        }
-                        auto& saved = sub_input_stack.back();
-                        input = saved.saved_input;
-                        input_pos = saved.saved_input_pos;
-                        sub_input_stack.pop_back();
-                        break;
-                    }
-                    case ebm::OpCode::PUSH_SUB_OUTPUT: {
-                        if (stack.empty()) {
-                            return ebmgen::unexpect_error("stack underflow on PUSH_SUB_OUTPUT");
-                        }
-                        auto len_val = stack_pop();
-                        len_val.as_int();  // length may be a member ref holding raw bytes
-                        if (!std::holds_alternative<std::uint64_t>(len_val.value)) {
-                            return ebmgen::unexpect_error("PUSH_SUB_OUTPUT: length is not integer");
-                        }
-                        auto expected = static_cast<size_t>(std::get<std::uint64_t>(len_val.value));
-                        sub_output_stack.push_back({output_buf.size(), expected, instr.str_repr});
-                        break;
-                    }
-                    case ebm::OpCode::POP_SUB_OUTPUT: {
-                        if (sub_output_stack.empty()) {
-                            return ebmgen::unexpect_error("sub_output_stack underflow on POP_SUB_OUTPUT");
-                        }
-                        auto saved = sub_output_stack.back();
-                        sub_output_stack.pop_back();
-                        size_t written = output_buf.size() - saved.saved_output_len;
-                        if (!ctx.flags().skip_write_size_check && written != saved.expected_length) {
-                            return ebmgen::unexpect_error("SUB_OUTPUT size mismatch: expected {} bytes but wrote {}: expected for {}", saved.expected_length, written, saved.str_repr);
-                        }
-                        break;
-                    }
-                    case ebm::OpCode::HALT:
-                        return ebmgen::unexpect_error("HALT reached");
-                    case ebm::OpCode::PUSH_IMM_INT: {
-                        auto val = instr.instr.value();
-                        stack_push(Value{val->value()});
-                        break;
-                    }
-                    case ebm::OpCode::NEW_BYTES: {
-                        MAYBE(imm, instr.instr.imm());
-                        if (auto v = imm.size()) {
-                            auto value = futils::view::wvec(local_bytes_arena).substr(instr.scratch, v->value());
-                            if (value.size() != v->value()) {
-                                return ebmgen::unexpect_error("invalid local bytes size: expected {}, got {}", v->value(), value.size());
+                        if (auto int_src = std::get_if<std::uint64_t>(&val.value)) {
+                            for (size_t i = 0; i < object_ref->raw_object.size(); i++) {
+                                object_ref->raw_object[i] = static_cast<char>((*int_src >> (i * 8)) & 0xFF);
                             }
-                            stack_push(Value{ObjectRef(instr.type_info, value)});
+                            EBM2RMW_NEXT();
                         }
-                        else {
-                            return ebmgen::unexpect_error("missing size immediate in NEW_BYTES");
-                        }
-                        break;
                     }
-                    case ebm::OpCode::LOAD_SELF: {
-                        stack_push(Value{self});
-                        break;
+                    return ebmgen::unexpect_error("STORE_REF target is not a reference");
+                }
+                val.unref();
+                auto ref_ptr = std::get<Value*>(ref.value);
+                *ref_ptr = std::move(val);
+                EBM2RMW_NEXT();
+            }
+            EBM2RMW_OP(ASSERT) {
+                if (stack.empty()) {
+                    return ebmgen::unexpect_error("stack underflow on ASSERT");
+                }
+                auto cond = stack_pop();
+                cond.unref();
+                if (!std::holds_alternative<std::uint64_t>(cond.value)) {
+                    return ebmgen::unexpect_error("ASSERT condition is not an integer");
+                }
+                auto cond_val = std::get<std::uint64_t>(cond.value);
+                if (cond_val == 0) {
+                    return ebmgen::unexpect_error("ASSERT failed: {}", str_repr());
+                }
+                EBM2RMW_NEXT();
+            }
+            EBM2RMW_OP(ARRAY_LEN) {
+                if (stack.empty()) {
+                    return ebmgen::unexpect_error("stack underflow on ARRAY_LEN");
+                }
+                auto arr_val = stack_pop();
+                arr_val.unref();
+                if (!std::holds_alternative<ObjectRef>(arr_val.value)) {
+                    return ebmgen::unexpect_error("ARRAY_LEN operand is not an array");
+                }
+                auto arr_ptr = std::get<ObjectRef>(arr_val.value);
+                LayoutScratch ls{d->scratch};
+                auto element_size = ls.size() > 0 ? ls.size() : size_t(1);
+                auto base_kind = ebm::TypeKind(ls.offset());
+                if (base_kind == ebm::TypeKind::VECTOR) {
+                    MAYBE(arena_index, decode_uint64(arr_ptr));
+                    if (arena_index == 0) {
+                        return ebmgen::unexpect_error("ARRAY_LEN on uninitialized vector");
                     }
-                    case ebm::OpCode::LOAD_LOCAL:
-                    case ebm::OpCode::LOAD_LOCAL_REF: {
-                        auto& found = locals[instr.scratch];
-                        if (ctx.flags().print_state) {
-                            futils::wrap::cout_wrap() << "  local_load: [" << instr.scratch << "] = ";
-                            TmpCodeWriter w;
-                            found.print(ctx, w);
-                            futils::wrap::cout_wrap() << w.out() << "\n";
-                        }
-                        if (instr.instr.op == ebm::OpCode::LOAD_LOCAL) {
-                            stack_push(Value{found});
-                        }
-                        else {
-                            stack_push(Value{&found});
-                        }
-                        break;
+                    size_t actual_index = arena_index - 1;
+                    if (actual_index >= bytes_arena.size()) {
+                        return ebmgen::unexpect_error("ARRAY_LEN: invalid vector index: {} (out of {})", actual_index, bytes_arena.size());
                     }
-                    case ebm::OpCode::STORE_LOCAL_IMM: {
-                        MAYBE(imm, instr.instr.value());
-                        if (ctx.flags().print_state) {
-                            futils::wrap::cout_wrap() << "  local_store_imm: [" << instr.scratch << "] = " << imm.value() << "\n";
-                        }
-                        locals[instr.scratch] = Value{imm.value()};
-                        break;
+                    auto& byte_array = bytes_arena[actual_index];
+                    if (byte_array.size() % element_size != 0) {
+                        return ebmgen::unexpect_error("ARRAY_LEN: vector size {} is not a multiple of element size {}", byte_array.size(), element_size);
                     }
-                    case ebm::OpCode::EQ_IMM: {
-                        if (stack.empty()) {
-                            return ebmgen::unexpect_error("stack underflow on EQ_IMM");
-                        }
-                        auto val = stack_pop();
-                        val.as_int();
-                        if (!std::holds_alternative<std::uint64_t>(val.value)) {
-                            return ebmgen::unexpect_error("EQ_IMM operand is not an integer");
-                        }
-                        std::uint64_t result = (std::get<std::uint64_t>(val.value) == instr.instr.value()->value()) ? 1 : 0;
-                        stack_push(Value{result});
-                        break;
+                    size_t length = byte_array.size() / element_size;
+                    stack_push(Value{length});
+                }
+                else {
+                    stack_push(Value{element_size});  // actually, element_size is full array length on ARRAY
+                }
+                EBM2RMW_NEXT();
+            }
+            EBM2RMW_OP(ARRAY_GET_IMM) {
+                if (stack.empty()) {
+                    return ebmgen::unexpect_error("stack underflow on ARRAY_GET_IMM");
+                }
+                auto base_val = stack_pop();
+                base_val.unref();
+                if (!std::holds_alternative<ObjectRef>(base_val.value)) {
+                    return ebmgen::unexpect_error("base value is not an array");
+                }
+                auto base_ptr = std::get<ObjectRef>(base_val.value);
+                LayoutScratch ls{d->scratch};
+                auto element_size = ls.offset() > 0 ? ls.offset() : size_t(1);
+                auto base_kind = ebm::TypeKind(ls.size());
+                auto index = d->imm;
+                if (base_kind == ebm::TypeKind::VECTOR) {
+                    MAYBE(arena_index, decode_uint64(base_ptr));
+                    if (arena_index == 0) {
+                        return ebmgen::unexpect_error("ARRAY_GET_IMM on uninitialized vector");
                     }
-                    case ebm::OpCode::STORE_LOCAL: {
-                        if (stack.empty()) {
-                            return ebmgen::unexpect_error("stack underflow on STORE_LOCAL");
-                        }
-                        auto val = stack_pop();
-                        val.unref();
-                        if (ctx.flags().print_state) {
-                            futils::wrap::cout_wrap() << "  locals_store: [" << instr.scratch << "] = ";
-                            TmpCodeWriter w;
-                            val.print(ctx, w);
-                            futils::wrap::cout_wrap() << w.out() << "\n";
-                        }
-                        locals[instr.scratch] = std::move(val);
-                        break;
+                    size_t actual_index = arena_index - 1;
+                    if (actual_index >= bytes_arena.size()) {
+                        return ebmgen::unexpect_error("ARRAY_GET_IMM: invalid vector index: {} (out of {})", actual_index, bytes_arena.size());
                     }
-                    case ebm::OpCode::STORE_REF: {
-                        if (stack.size() < 2) {
-                            return ebmgen::unexpect_error("stack underflow on STORE_REF");
-                        }
-                        auto ref = stack_pop();
-                        auto val = stack_pop();
-                        if (!std::holds_alternative<Value*>(ref.value)) {
-                            if (auto object_ref = std::get_if<ObjectRef>(&ref.value)) {
-                                if (auto objref_src = std::get_if<ObjectRef>(&val.value)) {
-                                    if (object_ref->raw_object.size() != objref_src->raw_object.size()) {
-                                        return ebmgen::unexpect_error("object size mismatch in STORE_REF: {} vs {}", object_ref->raw_object.size(), objref_src->raw_object.size());
-                                    }
-                                    std::copy(objref_src->raw_object.begin(), objref_src->raw_object.end(), object_ref->raw_object.begin());
-                                    break;
-                                }
-                                if (auto int_src = std::get_if<std::uint64_t>(&val.value)) {
-                                    for (size_t i = 0; i < object_ref->raw_object.size(); i++) {
-                                        object_ref->raw_object[i] = static_cast<char>((*int_src >> (i * 8)) & 0xFF);
-                                    }
-                                    break;
-                                }
-                            }
-                            return ebmgen::unexpect_error("STORE_REF target is not a reference");
-                        }
-                        val.unref();
-                        auto ref_ptr = std::get<Value*>(ref.value);
-                        *ref_ptr = std::move(val);
-                        break;
+                    auto& byte_array = bytes_arena[actual_index];
+                    auto raw = futils::view::wvec(byte_array).substr(index * element_size, element_size);
+                    if (raw.size() != element_size) {
+                        return ebmgen::unexpect_error("ARRAY_GET_IMM: vector element out of bounds: index={}, element_size={}, array_size={}", index, element_size, byte_array.size());
                     }
-                    case ebm::OpCode::ASSERT: {
-                        if (stack.empty()) {
-                            return ebmgen::unexpect_error("stack underflow on ASSERT");
-                        }
-                        auto cond = stack_pop();
-                        cond.unref();
-                        if (!std::holds_alternative<std::uint64_t>(cond.value)) {
-                            return ebmgen::unexpect_error("ASSERT condition is not an integer");
-                        }
-                        auto cond_val = std::get<std::uint64_t>(cond.value);
-                        if (cond_val == 0) {
-                            return ebmgen::unexpect_error("ASSERT failed: {}", instr.str_repr);
-                        }
-                        break;
-                    }
-                    case ebm::OpCode::ARRAY_LEN: {
-                        if (stack.empty()) {
-                            return ebmgen::unexpect_error("stack underflow on ARRAY_LEN");
-                        }
-                        auto arr_val = stack_pop();
-                        arr_val.unref();
-                        if (!std::holds_alternative<ObjectRef>(arr_val.value)) {
-                            return ebmgen::unexpect_error("ARRAY_LEN operand is not an array");
-                        }
-                        auto arr_ptr = std::get<ObjectRef>(arr_val.value);
-                        LayoutScratch ls{instr.scratch};
-                        auto element_size = ls.size() > 0 ? ls.size() : size_t(1);
-                        auto base_kind = ebm::TypeKind(ls.offset());
-                        if (base_kind == ebm::TypeKind::VECTOR) {
-                            MAYBE(arena_index, decode_uint64(arr_ptr));
-                            if (arena_index == 0) {
-                                return ebmgen::unexpect_error("ARRAY_LEN on uninitialized vector");
-                            }
-                            size_t actual_index = arena_index - 1;
-                            if (actual_index >= bytes_arena.size()) {
-                                return ebmgen::unexpect_error("ARRAY_LEN: invalid vector index: {} (out of {})", actual_index, bytes_arena.size());
-                            }
-                            auto& byte_array = bytes_arena[actual_index];
-                            if (byte_array.size() % element_size != 0) {
-                                return ebmgen::unexpect_error("ARRAY_LEN: vector size {} is not a multiple of element size {}", byte_array.size(), element_size);
-                            }
-                            size_t length = byte_array.size() / element_size;
-                            stack_push(Value{length});
-                        }
-                        else {
-                            stack_push(Value{element_size});  // actually, element_size is full array length on ARRAY
-                        }
-                        break;
+                    stack_push(Value{ObjectRef{d->type_info, raw}});
+                }
+                else {
+                    auto element = base_ptr.raw_object.substr(index * element_size, element_size);
+                    if (element.size() != element_size) {
+                        return ebmgen::unexpect_error("ARRAY_GET_IMM index out of bounds: index={}, element_size={}, array_size={}", index, element_size, base_ptr.raw_object.size());
                     }
-                    case ebm::OpCode::ARRAY_GET_IMM: {
-                        if (stack.empty()) {
-                            return ebmgen::unexpect_error("stack underflow on ARRAY_GET_IMM");
-                        }
-                        auto base_val = stack_pop();
-                        base_val.unref();
-                        if (!std::holds_alternative<ObjectRef>(base_val.value)) {
-                            return ebmgen::unexpect_error("base value is not an array");
-                        }
-                        auto base_ptr = std::get<ObjectRef>(base_val.value);
-                        LayoutScratch ls{instr.scratch};
-                        auto element_size = ls.offset() > 0 ? ls.offset() : size_t(1);
-                        auto base_kind = ebm::TypeKind(ls.size());
-                        auto index = instr.instr.index()->value();
-                        if (base_kind == ebm::TypeKind::VECTOR) {
-                            MAYBE(arena_index, decode_uint64(base_ptr));
-                            if (arena_index == 0) {
-                                return ebmgen::unexpect_error("ARRAY_GET_IMM on uninitialized vector");
-                            }
-                            size_t actual_index = arena_index - 1;
-                            if (actual_index >= bytes_arena.size()) {
-                                return ebmgen::unexpect_error("ARRAY_GET_IMM: invalid vector index: {} (out of {})", actual_index, bytes_arena.size());
-                            }
-                            auto& byte_array = bytes_arena[actual_index];
-                            auto raw = futils::view::wvec(byte_array).substr(index * element_size, element_size);
-                            if (raw.size() != element_size) {
-                                return ebmgen::unexpect_error("ARRAY_GET_IMM: vector element out of bounds: index={}, element_size={}, array_size={}", index, element_size, byte_array.size());
-                            }
-                            stack_push(Value{ObjectRef{instr.type_info, raw}});
-                        }
-                        else {
-                            auto element = base_ptr.raw_object.substr(index * element_size, element_size);
-                            if (element.size() != element_size) {
-                                return ebmgen::unexpect_error("ARRAY_GET_IMM index out of bounds: index={}, element_size={}, array_size={}", index, element_size, base_ptr.raw_object.size());
-                            }
-                            stack_push(Value{ObjectRef{instr.type_info, element}});
-                        }
-                        break;
+                    stack_push(Value{ObjectRef{d->type_info, element}});
+                }
+                EBM2RMW_NEXT();
+            }
+            EBM2RMW_OP(ARRAY_GET) {
+                if (stack.size() < 2) {
+                    return ebmgen::unexpect_error("stack underflow on ARRAY_GET");
+                }
+                auto index_val = stack_pop();
+                index_val.as_int();
+                auto base_val = stack_pop();
+                base_val.unref();
+                if (!std::holds_alternative<ObjectRef>(base_val.value)) {
+                    return ebmgen::unexpect_error("base value is not an array");
+                }
+                auto base_ptr = std::get<ObjectRef>(base_val.value);
+                if (!std::holds_alternative<std::uint64_t>(index_val.value)) {
+                    return ebmgen::unexpect_error("index value is not an integer");
+                }
+                LayoutScratch ls{d->scratch};
+                auto element_size = ls.offset() > 0 ? ls.offset() : size_t(1);
+                auto base_kind = ebm::TypeKind(ls.size());
+                auto index = std::get<std::uint64_t>(index_val.value);
+                if (base_kind == ebm::TypeKind::VECTOR) {
+                    MAYBE(arena_index, decode_uint64(base_ptr));
+                    if (arena_index == 0) {
+                        return ebmgen::unexpect_error("ARRAY_GET on uninitialized vector");
                     }
-                    case ebm::OpCode::ARRAY_GET: {
-                        if (stack.size() < 2) {
-                            return ebmgen::unexpect_error("stack underflow on ARRAY_GET");
-                        }
-                        auto index_val = stack_pop();
-                        index_val.as_int();
-                        auto base_val = stack_pop();
-                        base_val.unref();
-                        if (!std::holds_alternative<ObjectRef>(base_val.value)) {
-                            return ebmgen::unexpect_error("base value is not an array");
-                        }
-                        auto base_ptr = std::get<ObjectRef>(base_val.value);
-                        if (!std::holds_alternative<std::uint64_t>(index_val.value)) {
-                            return ebmgen::unexpect_error("index value is not an integer");
-                        }
-                        LayoutScratch ls{instr.scratch};
-                        auto element_size = ls.offset() > 0 ? ls.offset() : size_t(1);
-                        auto base_kind = ebm::TypeKind(ls.size());
-                        auto index = std::get<std::uint64_t>(index_val.value);
-                        if (base_kind == ebm::TypeKind::VECTOR) {
-                            MAYBE(arena_index, decode_uint64(base_ptr));
-                            if (arena_index == 0) {
-                                return ebmgen::unexpect_error("ARRAY_GET on uninitialized vector");
-                            }
-                            size_t actual_index = arena_index - 1;
-                            if (actual_index >= bytes_arena.size()) {
-                                return ebmgen::unexpect_error("ARRAY_GET: invalid vector index: {} (out of {})", actual_index, bytes_arena.size());
-                            }
-                            auto& byte_array = bytes_arena[actual_index];
-                            auto raw = futils::view::wvec(byte_array).substr(index * element_size, element_size);
-                            if (raw.size() != element_size) {
-                                return ebmgen::unexpect_error("ARRAY_GET: vector element out of bounds: index={}, element_size={}, array_size={}", index, element_size, byte_array.size());
-                            }
-                            stack_push(Value{ObjectRef{instr.type_info, raw}});
-                        }
-                        else {
-                            auto element = base_ptr.raw_object.substr(index * element_size, element_size);
-                            if (element.size() != element_size) {
-                                return ebmgen::unexpect_error("ARRAY_GET index out of bounds: index={}, element_size={}, array_size={}", index, element_size, base_ptr.raw_object.size());
-                            }
-                            stack_push(Value{ObjectRef{instr.type_info, element}});
-                        }
-                        break;
+                    size_t actual_index = arena_index - 1;
+                    if (actual_index >= bytes_arena.size()) {
+                        return ebmgen::unexpect_error("ARRAY_GET: invalid vector index: {} (out of {})", actual_index, bytes_arena.size());
                     }
-                    case ebm::OpCode::AVAILABLE: {
-                        std::uint64_t available = input.size() > input_pos ? input.size() - input_pos : 0;
-                        stack_push(Value{available});
-                        break;
+                    auto& byte_array = bytes_arena[actual_index];
+                    auto raw = futils::view::wvec(byte_array).substr(index * element_size, element_size);
+                    if (raw.size() != element_size) {
+                        return ebmgen::unexpect_error("ARRAY_GET: vector element out of bounds: index={}, element_size={}, array_size={}", index, element_size, byte_array.size());
                     }
-                    case ebm::OpCode::GET_OFFSET: {
-                        stack_push(Value{static_cast<std::uint64_t>(is_encoding ? output_buf.size() : input_pos)});
-                        break;
+                    stack_push(Value{ObjectRef{d->type_info, raw}});
+                }
+                else {
+                    auto element = base_ptr.raw_object.substr(index * element_size, element_size);
+                    if (element.size() != element_size) {
+                        return ebmgen::unexpect_error("ARRAY_GET index out of bounds: index={}, element_size={}, array_size={}", index, element_size, base_ptr.raw_object.size());
                     }
-                    case ebm::OpCode::READ_BYTE: {
-                        if (stack.empty()) [[unlikely]] {
-                            return ebmgen::unexpect_error("stack underflow on READ_BYTE");
-                        }
-                        MAYBE(offset, instr.instr.offset());
-                        if (input_pos >= input.size()) [[unlikely]] {
-                            return ebmgen::unexpect_error("READ_BYTE: end of input (pos={}, size={})", input_pos, input.size());
-                        }
-                        auto target = stack_pop();
-                        // Value* (local variable reference): dereference and write to the underlying value
-                        if (auto ref = std::get_if<Value*>(&target.value)) {
-                            auto& inner = **ref;
-                            if (auto obj = std::get_if<ObjectRef>(&inner.value)) {
-                                // underlying is ObjectRef: write byte into the object buffer
-                                if (obj->raw_object.size() < offset.value() + 1) [[unlikely]] {
-                                    return ebmgen::unexpect_error("READ_BYTE target array is too small");
-                                }
-                                obj->raw_object[offset.value()] = input[input_pos];
-                            }
-                            else {
-                                // underlying is uint64_t or similar: store byte as integer
-                                inner.value = static_cast<std::uint64_t>(static_cast<unsigned char>(input[input_pos]));
-                            }
-                            input_pos += 1;
-                            break;
-                        }
-                        target.unref();
-                        if (!std::holds_alternative<ObjectRef>(target.value)) [[unlikely]] {
-                            return ebmgen::unexpect_error("READ_BYTE target is not an object");
-                        }
-                        auto& arr = std::get<ObjectRef>(target.value);
-                        if (arr.raw_object.size() < offset.value() + 1) [[unlikely]] {
+                    stack_push(Value{ObjectRef{d->type_info, element}});
+                }
+                EBM2RMW_NEXT();
+            }
+            EBM2RMW_OP(AVAILABLE) {
+                std::uint64_t available = input.size() > input_pos ? input.size() - input_pos : 0;
+                stack_push(Value{available});
+                EBM2RMW_NEXT();
+            }
+            EBM2RMW_OP(GET_OFFSET) {
+                stack_push(Value{static_cast<std::uint64_t>(is_encoding ? output_buf.size() : input_pos)});
+                EBM2RMW_NEXT();
+            }
+            EBM2RMW_OP(READ_BYTE) {
+                if (stack.empty()) [[unlikely]] {
+                    return ebmgen::unexpect_error("stack underflow on READ_BYTE");
+                }
+                auto offset = d->imm;
+                if (input_pos >= input.size()) [[unlikely]] {
+                    return ebmgen::unexpect_error("READ_BYTE: end of input (pos={}, size={})", input_pos, input.size());
+                }
+                auto target = stack_pop();
+                // Value* (local variable reference): dereference and write to the underlying value
+                if (auto ref = std::get_if<Value*>(&target.value)) {
+                    auto& inner = **ref;
+                    if (auto obj = std::get_if<ObjectRef>(&inner.value)) {
+                        // underlying is ObjectRef: write byte into the object buffer
+                        if (obj->raw_object.size() < offset + 1) [[unlikely]] {
                             return ebmgen::unexpect_error("READ_BYTE target array is too small");
                         }
-                        arr.raw_object[offset.value()] = input[input_pos];
-                        input_pos += 1;
-                        break;
+                        obj->raw_object[offset] = input[input_pos];
                     }
-                    case ebm::OpCode::READ_BYTES: {
-                        MAYBE(imm, instr.instr.imm());
-                        std::size_t size = 0;
-                        if (auto static_size = imm.size()) {
-                            size = static_size->value();
-                        }
-                        else {
-                            if (stack.empty()) [[unlikely]] {
-                                return ebmgen::unexpect_error("stack underflow on READ_BYTES");
-                            }
-                            auto size_expr = stack_pop();
-                            size_expr.as_int();
-                            if (!std::holds_alternative<std::uint64_t>(size_expr.value)) [[unlikely]] {
-                                return ebmgen::unexpect_error("READ_BYTES size is not an integer");
-                            }
-                            size = static_cast<std::size_t>(std::get<std::uint64_t>(size_expr.value));
-                        }
-                        if (stack.empty()) [[unlikely]] {
-                            return ebmgen::unexpect_error("stack underflow on READ_BYTES target");
-                        }
-                        size_t offset_value = 0;
-                        auto offset = instr.instr.offset();
-                        if (offset) {
-                            offset_value = offset->value();
-                        }
-                        auto target = stack_pop();
-                        auto kind = ebm::TypeKind(instr.scratch);
-                        target.unref();
-                        if (!std::holds_alternative<ObjectRef>(target.value)) [[unlikely]] {
-                            return ebmgen::unexpect_error("READ_BYTES target is not an object");
-                        }
-                        auto read = input.substr(input_pos, size);
-                        if (read.size() < size) [[unlikely]] {
-                            return ebmgen::unexpect_error("expected {} bytes, but only {} bytes available in input", size, read.size());
-                        }
-                        auto& arr = std::get<ObjectRef>(target.value);
-                        // currently, vector allocation point should be front of the call stack,
-                        // so that we can assume the vector elements are alive until interpret() returns.
-                        MAYBE(byte_array, get_bytes(arr, offset_value + size, kind));
-                        if (offset_value + size > byte_array.size()) [[unlikely]] {
-                            return ebmgen::unexpect_error("READ_BYTES out of bounds: offset {} + size {} exceeds array size {}", offset_value, size, byte_array.size());
-                        }
-                        std::copy(read.begin(), read.end(), byte_array.begin() + offset_value);
-                        input_pos += size;
-                        break;
-                    }
-                    case ebm::OpCode::LOAD_SELF_MEMBER: {
-                        LayoutScratch scratch{instr.scratch};
-                        auto range = self.raw_object.substr(scratch.offset(), scratch.size());
-                        if (range.size() != scratch.size()) [[unlikely]] {
-                            return ebmgen::unexpect_error("LOAD_SELF_MEMBER range out of bounds: {} expect {} but got {} (offset: {})", instr.str_repr, scratch.size(), range.size(), scratch.offset());
-                        }
-                        stack_push(Value{ObjectRef(instr.type_info, range)});
-                        break;
-                    }
-                    case ebm::OpCode::LOAD_MEMBER: {
-                        if (stack.empty()) [[unlikely]] {
-                            return ebmgen::unexpect_error("stack underflow on LOAD_MEMBER");
-                        }
-                        auto member_base_val = stack_pop();
-                        member_base_val.unref();
-                        if (!std::holds_alternative<ObjectRef>(member_base_val.value)) [[unlikely]] {
-                            return ebmgen::unexpect_error("base value is not an object");
-                        }
-                        auto base_ref = std::get<ObjectRef>(member_base_val.value);
-                        LayoutScratch scratch{instr.scratch};
-                        auto range = base_ref.raw_object.substr(scratch.offset(), scratch.size());
-                        if (range.size() != scratch.size()) [[unlikely]] {
-                            return ebmgen::unexpect_error("LOAD_MEMBER range out of bounds");
-                        }
-                        stack_push(Value{ObjectRef(instr.type_info, range)});
-                        break;
-                    }
-                    case ebm::OpCode::CALL_GETTER: {
-                        if (stack.empty()) {
-                            return ebmgen::unexpect_error("stack underflow on CALL_GETTER");
-                        }
-                        auto obj_val = stack_pop();
-                        obj_val.unref();
-                        if (!std::holds_alternative<ObjectRef>(obj_val.value)) {
-                            return ebmgen::unexpect_error("CALL_GETTER target is not an object");
-                        }
-                        auto func_enter = ctx.config().env.new_function(*instr.instr.func_id());
-                        bool no_error = false;
-                        const auto frame = new_frame(no_error);
-                        auto& new_this = *call_stack.back();
-                        new_this.self = std::get<ObjectRef>(obj_val.value);
-                        size_t func_ip = 0;
-                        MAYBE_VOID(r, interpret_impl(ctx, func_ip));
-                        no_error = true;
-                        break;
-                    }
-                    case ebm::OpCode::LOAD_PARAM: {
-                        stack_push(Value{params[instr.scratch]});
-                        break;
+                    else {
+                        // underlying is uint64_t or similar: store byte as integer
+                        inner.value = static_cast<std::uint64_t>(static_cast<unsigned char>(input[input_pos]));
                     }
-                    case ebm::OpCode::LOAD_FUNC: {
-                        auto func_id = instr.instr.func_id();
-                        if (!func_id) {
-                            return ebmgen::unexpect_error("missing function id in LOAD_FUNC");
-                        }
-                        stack_push(Value{Function{*func_id}});
-                        break;
+                    input_pos += 1;
+                    EBM2RMW_NEXT();
+                }
+                target.unref();
+                if (!std::holds_alternative<ObjectRef>(target.value)) [[unlikely]] {
+                    return ebmgen::unexpect_error("READ_BYTE target is not an object");
+                }
+                auto& arr = std::get<ObjectRef>(target.value);
+                if (arr.raw_object.size() < offset + 1) [[unlikely]] {
+                    return ebmgen::unexpect_error("READ_BYTE target array is too small");
+                }
+                arr.raw_object[offset] = input[input_pos];
+                input_pos += 1;
+                EBM2RMW_NEXT();
+            }
+            EBM2RMW_OP(READ_BYTES) {
+                std::size_t size = 0;
+                if (d->flag) {
+                    size = d->imm;
+                }
+                else {
+                    if (stack.empty()) [[unlikely]] {
+                        return ebmgen::unexpect_error("stack underflow on READ_BYTES");
                     }
-                    case ebm::OpCode::CALL: {
-                        auto num_args = instr.instr.arg_num();
-                        if (!num_args) {
-                            return ebmgen::unexpect_error("missing argument number in CALL");
-                        }
-                        if (stack.size() < num_args->value() + 2) {
-                            return ebmgen::unexpect_error("stack underflow on CALL");
-                        }
-                        auto callee = stack_pop();
-                        callee.unref();
-                        if (!std::holds_alternative<Function>(callee.value)) [[unlikely]] {
-                            return ebmgen::unexpect_error("CALL target is not a function");
-                        }
-                        auto func = std::get<Function>(callee.value);
-                        std::vector<Value> call_params;
-                        for (int i = static_cast<int>(num_args->value()) - 1; i >= 0; i--) {
-                            auto arg_val = stack_pop();
-                            arg_val.unref();
-                            call_params.push_back(std::move(arg_val));
-                        }
-                        auto new_self = stack_pop();
-                        new_self.unref();
-                        if (!std::holds_alternative<ObjectRef>(new_self.value)) [[unlikely]] {
-                            return ebmgen::unexpect_error("CALL new self is not an object");
-                        }
-                        auto func_enter = ctx.config().env.new_function(func.id);
-                        bool no_error = false;
-                        const auto frame = new_frame(no_error);
-                        auto& new_this = *call_stack.back();
-                        new_this.params = std::move(call_params);
-                        new_this.self = std::get<ObjectRef>(new_self.value);
-                        size_t func_ip = 0;
-                        MAYBE_VOID(r, interpret_impl(ctx, func_ip));
-                        no_error = true;
-                        break;
+                    auto size_expr = stack_pop();
+                    size_expr.as_int();
+                    if (!std::holds_alternative<std::uint64_t>(size_expr.value)) [[unlikely]] {
+                        return ebmgen::unexpect_error("READ_BYTES size is not an integer");
                     }
-                    case ebm::OpCode::CALL_DIRECT: {
-                        auto num_args = instr.instr.arg_num();
-                        if (!num_args) [[unlikely]] {
-                            return ebmgen::unexpect_error("missing argument number in CALL_DIRECT");
-                        }
-                        auto func = *instr.instr.func_id();
-                        // A free function (an imported module's top-level fn, whose
-                        // FUNCTION_DECL has a nil parent_format) is called without a
-                        // self receiver on the stack; a method pops its receiver.
-                        bool has_self = true;
-                        if (auto* fstmt = get_visitor_arg_from_context(ctx).module_.get_statement(func)) {
-                            if (auto* fd = fstmt->body.func_decl()) {
-                                has_self = !is_nil(fd->parent_format);
-                            }
-                        }
-                        if (stack.size() < num_args->value() + (has_self ? 1 : 0)) [[unlikely]] {
-                            return ebmgen::unexpect_error("stack underflow on CALL_DIRECT");
-                        }
-                        std::vector<Value> call_params;
-                        for (int i = static_cast<int>(num_args->value()) - 1; i >= 0; i--) {
-                            auto arg_val = stack_pop();
-                            arg_val.unref();
-                            call_params.push_back(std::move(arg_val));
-                        }
-                        ObjectRef self_obj{};
-                        if (has_self) {
-                            auto new_self = stack_pop();
-                            new_self.unref();
-                            if (!std::holds_alternative<ObjectRef>(new_self.value)) [[unlikely]] {
-                                return ebmgen::unexpect_error("CALL_DIRECT new self is not an object");
-                            }
-                            self_obj = std::get<ObjectRef>(new_self.value);
-                        }
-                        auto func_enter = ctx.config().env.new_function(func);
-                        bool no_error = false;
-                        const auto frame = new_frame(no_error);
-                        auto& new_this = *call_stack.back();
-                        new_this.params = std::move(call_params);
-                        new_this.self = self_obj;
-                        size_t func_ip = 0;
-                        MAYBE_VOID(r, interpret_impl(ctx, func_ip));
-                        no_error = true;
-                        break;
+                    size = static_cast<std::size_t>(std::get<std::uint64_t>(size_expr.value));
+                }
+                if (stack.empty()) [[unlikely]] {
+                    return ebmgen::unexpect_error("stack underflow on READ_BYTES target");
+                }
+                size_t offset_value = wide_operands[d->wide].imm2;
+                auto target = stack_pop();
+                auto kind = ebm::TypeKind(d->scratch);
+                target.unref();
+                if (!std::holds_alternative<ObjectRef>(target.value)) [[unlikely]] {
+                    return ebmgen::unexpect_error("READ_BYTES target is not an object");
+                }
+                auto read = input.substr(input_pos, size);
+                if (read.size() < size) [[unlikely]] {
+                    return ebmgen::unexpect_error("expected {} bytes, but only {} bytes available in input", size, read.size());
+                }
+                auto& arr = std::get<ObjectRef>(target.value);
+                // currently, vector allocation point should be front of the call stack,
+                // so that we can assume the vector elements are alive until interpret() returns.
+                MAYBE(byte_array, get_bytes(arr, offset_value + size, kind));
+                if (offset_value + size > byte_array.size()) [[unlikely]] {
+                    return ebmgen::unexpect_error("READ_BYTES out of bounds: offset {} + size {} exceeds array size {}", offset_value, size, byte_array.size());
+                }
+                std::copy(read.begin(), read.end(), byte_array.begin() + offset_value);
+                input_pos += size;
+                EBM2RMW_NEXT();
+            }
+            EBM2RMW_OP(LOAD_SELF_MEMBER) {
+                LayoutScratch scratch{d->scratch};
+                auto range = self.raw_object.substr(scratch.offset(), scratch.size());
+                if (range.size() != scratch.size()) [[unlikely]] {
+                    return ebmgen::unexpect_error("LOAD_SELF_MEMBER range out of bounds: {} expect {} but got {} (offset: {})", str_repr(), scratch.size(), range.size(), scratch.offset());
+                }
+                stack_push(Value{ObjectRef(d->type_info, range)});
+                EBM2RMW_NEXT();
+            }
+            EBM2RMW_OP(LOAD_MEMBER) {
+                if (stack.empty()) [[unlikely]] {
+                    return ebmgen::unexpect_error("stack underflow on LOAD_MEMBER");
+                }
+                auto member_base_val = stack_pop();
+                member_base_val.unref();
+                if (!std::holds_alternative<ObjectRef>(member_base_val.value)) [[unlikely]] {
+                    return ebmgen::unexpect_error("base value is not an object");
+                }
+                auto base_ref = std::get<ObjectRef>(member_base_val.value);
+                LayoutScratch scratch{d->scratch};
+                auto range = base_ref.raw_object.substr(scratch.offset(), scratch.size());
+                if (range.size() != scratch.size()) [[unlikely]] {
+                    return ebmgen::unexpect_error("LOAD_MEMBER range out of bounds");
+                }
+                stack_push(Value{ObjectRef(d->type_info, range)});
+                EBM2RMW_NEXT();
+            }
+            EBM2RMW_OP(CALL_GETTER) {
+                if (stack.empty()) {
+                    return ebmgen::unexpect_error("stack underflow on CALL_GETTER");
+                }
+                auto obj_val = stack_pop();
+                obj_val.unref();
+                if (!std::holds_alternative<ObjectRef>(obj_val.value)) {
+                    return ebmgen::unexpect_error("CALL_GETTER target is not an object");
+                }
+                bool no_error = false;
+                const auto frame = new_frame(resolve_callee(env, wide_operands[d->wide]), no_error);
+                auto& new_this = *call_stack.back();
+                new_this.self = std::get<ObjectRef>(obj_val.value);
+                size_t func_ip = 0;
+                MAYBE_VOID(r, interpret_impl(ctx, func_ip));
+                no_error = true;
+                EBM2RMW_NEXT();
+            }
+            EBM2RMW_OP(LOAD_PARAM) {
+                stack_push(Value{params[d->scratch]});
+                EBM2RMW_NEXT();
+            }
+            EBM2RMW_OP(LOAD_FUNC) {
+                stack_push(Value{Function{wide_operands[d->wide].func_id}});
+                EBM2RMW_NEXT();
+            }
+            EBM2RMW_OP(CALL) {
+                auto num_args = d->imm;
+                if (stack.size() < num_args + 2) {
+                    return ebmgen::unexpect_error("stack underflow on CALL");
+                }
+                auto callee = stack_pop();
+                callee.unref();
+                if (!std::holds_alternative<Function>(callee.value)) [[unlikely]] {
+                    return ebmgen::unexpect_error("CALL target is not a function");
+                }
+                auto target_func = std::get<Function>(callee.value);
+                // arguments are popped directly into params of reused frame
+                auto& callee_frame = next_frame();
+                callee_frame.params.resize(num_args);
+                for (size_t i = 0; i < num_args; i++) {
+                    auto arg_val = stack_pop();
+                    arg_val.unref();
+                    callee_frame.params[i] = std::move(arg_val);
+                }
+                auto new_self = stack_pop();
+                new_self.unref();
+                if (!std::holds_alternative<ObjectRef>(new_self.value)) [[unlikely]] {
+                    return ebmgen::unexpect_error("CALL new self is not an object");
+                }
+                bool no_error = false;
+                const auto frame = new_frame(env.ensure_function(target_func.id), no_error);
+                auto& new_this = *call_stack.back();
+                new_this.self = std::get<ObjectRef>(new_self.value);
+                size_t func_ip = 0;
+                MAYBE_VOID(r, interpret_impl(ctx, func_ip));
+                no_error = true;
+                EBM2RMW_NEXT();
+            }
+            EBM2RMW_OP(CALL_DIRECT) {
+                auto num_args = d->imm;
+                bool has_self = d->flag;
+                if (stack.size() < num_args + (has_self ? 1 : 0)) [[unlikely]] {
+                    return ebmgen::unexpect_error("stack underflow on CALL_DIRECT");
+                }
+                auto& callee_frame = next_frame();
+                callee_frame.params.resize(num_args);
+                for (size_t i = 0; i < num_args; i++) {
+                    auto arg_val = stack_pop();
+                    arg_val.unref();
+                    callee_frame.params[i] = std::move(arg_val);
+                }
+                ObjectRef self_obj{};
+                if (has_self) {
+                    auto new_self = stack_pop();
+                    new_self.unref();
+                    if (!std::holds_alternative<ObjectRef>(new_self.value)) [[unlikely]] {
+                        return ebmgen::unexpect_error("CALL_DIRECT new self is not an object");
                     }
-                    case ebm::OpCode::JUMP_IF_FALSE: {
-                        if (stack.empty()) {
-                            return ebmgen::unexpect_error("stack underflow on JUMP_IF_FALSE");
-                        }
-                        auto cond = stack_pop();
-                        cond.unref();
-                        if (!std::holds_alternative<std::uint64_t>(cond.value)) {
-                            return ebmgen::unexpect_error("JUMP_IF_FALSE condition is not an integer");
-                        }
-                        auto cond_val = std::get<std::uint64_t>(cond.value);
-                        if (cond_val == 0) {
-                            MAYBE(offset, instr.instr.target());
-                            if (offset.backward()) {
-                                ip -= offset.offset.value();
-                            }
-                            else {
-                                ip += offset.offset.value();
-                            }
-                            continue;
-                        }
-                        break;
+                    self_obj = std::get<ObjectRef>(new_self.value);
+                }
+                bool no_error = false;
+                const auto frame = new_frame(resolve_callee(env, wide_operands[d->wide]), no_error);
+                auto& new_this = *call_stack.back();
+                new_this.self = self_obj;
+                size_t func_ip = 0;
+                MAYBE_VOID(r, interpret_impl(ctx, func_ip));
+                no_error = true;
+                EBM2RMW_NEXT();
+            }
+            EBM2RMW_OP(JUMP_IF_FALSE) {
+                if (stack.empty()) {
+                    return ebmgen::unexpect_error("stack underflow on JUMP_IF_FALSE");
+                }
+                auto cond = stack_pop();
+                cond.unref();
+                if (!std::holds_alternative<std::uint64_t>(cond.value)) {
+                    return ebmgen::unexpect_error("JUMP_IF_FALSE condition is not an integer");
+                }
+                auto cond_val = std::get<std::uint64_t>(cond.value);
+                if (cond_val == 0) {
+                    EBM2RMW_JUMP(d->target);
+                }
+                EBM2RMW_NEXT();
+            }
+            EBM2RMW_OP(JUMP) {
+                EBM2RMW_JUMP(d->target);
+            }
+            EBM2RMW_OP(NEW_STRUCT) {
+                MAYBE(obj, new_object(ctx, local_bytes_arena, d->type_info, LayoutScratch{d->scratch}));
+                stack_push(Value{obj});
+                EBM2RMW_NEXT();
+            }
+            EBM2RMW_OP(RET) {
+                if (d->flag) {
+                    if (stack.empty()) {
+                        return ebmgen::unexpect_error("stack underflow on RET with value");
                     }
-                    case ebm::OpCode::JUMP: {
-                        MAYBE(offset, instr.instr.target());
-                        if (offset.backward()) {
-                            ip -= offset.offset.value();
-                        }
-                        else {
-                            ip += offset.offset.value();
-                        }
-                        continue;
+                    auto ret_val = stack_pop();
+                    if (call_stack.size() > 1) {
+                        stack_push_with_stack(call_stack[call_stack.size() - 2]->stack, std::move(ret_val));
                     }
-                    case ebm::OpCode::NEW_STRUCT: {
-                        MAYBE(obj, new_object(ctx, local_bytes_arena, instr.type_info, LayoutScratch{instr.scratch}));
-                        stack_push(Value{obj});
-                        break;
+                }
+                no_error = true;
+                return {};
+            }
+            EBM2RMW_OP(POP) {
+                if (stack.empty()) {
+                    return ebmgen::unexpect_error("stack underflow on POP");
+                }
+                stack_pop();
+                EBM2RMW_NEXT();
+            }
+            EBM2RMW_OP(WRITE_U8) {
+                if (stack.empty()) [[unlikely]] {
+                    return ebmgen::unexpect_error("stack underflow on WRITE_U8");
+                }
+                auto target = stack_pop();
+                target.unref();
+                if (std::holds_alternative<ObjectRef>(target.value)) {
+                    auto& obj = std::get<ObjectRef>(target.value);
+                    if (obj.raw_object.empty()) [[unlikely]] {
+                        return ebmgen::unexpect_error("WRITE_U8 target is empty");
                     }
-                    case ebm::OpCode::RET: {
-                        auto has_value = instr.instr.ret_value()->has_value();
-                        if (has_value) {
-                            if (stack.empty()) {
-                                return ebmgen::unexpect_error("stack underflow on RET with value");
-                            }
-                            auto ret_val = stack_pop();
-                            if (call_stack.size() > 1) {
-                                stack_push_with_stack(call_stack[call_stack.size() - 2]->stack, std::move(ret_val));
-                            }
-                        }
-                        no_error = true;
-                        return {};
+                    output_buf.push_back(static_cast<std::uint8_t>(obj.raw_object[0]));
+                }
+                else if (std::holds_alternative<std::uint64_t>(target.value)) {
+                    output_buf.push_back(static_cast<std::uint8_t>(std::get<std::uint64_t>(target.value)));
+                }
+                else {
+                    return ebmgen::unexpect_error("WRITE_U8 target is not an object or integer");
+                }
+                EBM2RMW_NEXT();
+            }
+            EBM2RMW_OP(WRITE_BYTES) {
+                // scratch: lower 32 bits = type_kind, upper 32 bits = static_size (0 = dynamic)
+                LayoutScratch ls{d->scratch};
+                auto kind = ebm::TypeKind(ls.offset());
+                size_t static_size = ls.size();
+                size_t expected_size = 0;
+                const bool is_dynamic = (static_size == 0);
+                if (is_dynamic) {
+                    if (stack.size() < 2) [[unlikely]] {
+                        return ebmgen::unexpect_error("stack underflow on WRITE_BYTES (need size and target)");
                     }
-                    case ebm::OpCode::POP: {
-                        if (stack.empty()) {
-                            return ebmgen::unexpect_error("stack underflow on POP");
-                        }
-                        stack_pop();
-                        break;
+                    auto size_val = stack_pop();
+                    size_val.as_int();
+                    if (!std::holds_alternative<std::uint64_t>(size_val.value)) [[unlikely]] {
+                        return ebmgen::unexpect_error("WRITE_BYTES dynamic size is not an integer");
                     }
-                    case ebm::OpCode::WRITE_U8: {
-                        if (stack.empty()) [[unlikely]] {
-                            return ebmgen::unexpect_error("stack underflow on WRITE_U8");
-                        }
-                        auto target = stack_pop();
-                        target.unref();
-                        if (std::holds_alternative<ObjectRef>(target.value)) {
-                            auto& obj = std::get<ObjectRef>(target.value);
-                            if (obj.raw_object.empty()) [[unlikely]] {
-                                return ebmgen::unexpect_error("WRITE_U8 target is empty");
-                            }
-                            output_buf.push_back(static_cast<std::uint8_t>(obj.raw_object[0]));
-                        }
-                        else if (std::holds_alternative<std::uint64_t>(target.value)) {
-                            output_buf.push_back(static_cast<std::uint8_t>(std::get<std::uint64_t>(target.value)));
-                        }
-                        else {
-                            return ebmgen::unexpect_error("WRITE_U8 target is not an object or integer");
-                        }
-                        break;
+                    expected_size = static_cast<size_t>(std::get<std::uint64_t>(size_val.value));
+                }
+                if (stack.empty()) [[unlikely]] {
+                    return ebmgen::unexpect_error("stack underflow on WRITE_BYTES target");
+                }
+                auto target = stack_pop();
+                target.unref();
+                if (!std::holds_alternative<ObjectRef>(target.value)) [[unlikely]] {
+                    return ebmgen::unexpect_error("WRITE_BYTES target is not an object");
+                }
+                auto& arr = std::get<ObjectRef>(target.value);
+                size_t actual_written = 0;
+                if (kind == ebm::TypeKind::VECTOR) {
+                    MAYBE(index, decode_uint64(arr));
+                    if (index == 0) {
+                        return ebmgen::unexpect_error("WRITE_BYTES vector is uninitialized");
                     }
-                    case ebm::OpCode::WRITE_BYTES: {
-                        // scratch: lower 32 bits = type_kind, upper 32 bits = static_size (0 = dynamic)
-                        LayoutScratch ls{instr.scratch};
-                        auto kind = ebm::TypeKind(ls.offset());
-                        size_t static_size = ls.size();
-                        size_t expected_size = 0;
-                        const bool is_dynamic = (static_size == 0);
-                        if (is_dynamic) {
-                            if (stack.size() < 2) [[unlikely]] {
-                                return ebmgen::unexpect_error("stack underflow on WRITE_BYTES (need size and target)");
-                            }
-                            auto size_val = stack_pop();
-                            size_val.as_int();
-                            if (!std::holds_alternative<std::uint64_t>(size_val.value)) [[unlikely]] {
-                                return ebmgen::unexpect_error("WRITE_BYTES dynamic size is not an integer");
-                            }
-                            expected_size = static_cast<size_t>(std::get<std::uint64_t>(size_val.value));
-                        }
-                        if (stack.empty()) [[unlikely]] {
-                            return ebmgen::unexpect_error("stack underflow on WRITE_BYTES target");
-                        }
-                        auto target = stack_pop();
-                        target.unref();
-                        if (!std::holds_alternative<ObjectRef>(target.value)) [[unlikely]] {
-                            return ebmgen::unexpect_error("WRITE_BYTES target is not an object");
-                        }
-                        auto& arr = std::get<ObjectRef>(target.value);
-                        size_t actual_written = 0;
-                        if (kind == ebm::TypeKind::VECTOR) {
-                            MAYBE(index, decode_uint64(arr));
-                            if (index == 0) {
-                                return ebmgen::unexpect_error("WRITE_BYTES vector is uninitialized");
-                            }
-                            size_t actual_index = index - 1;
-                            if (actual_index >= bytes_arena.size()) [[unlikely]] {
-                                return ebmgen::unexpect_error("WRITE_BYTES invalid vector index: {} (out of {})", actual_index, bytes_arena.size());
-                            }
-                            auto& byte_array = bytes_arena[actual_index];
-                            actual_written = byte_array.size();
-                            output_buf.insert(output_buf.end(), byte_array.begin(), byte_array.end());
-                        }
-                        else {
-                            size_t bytes_to_write = is_dynamic ? expected_size : static_size;
-                            if (bytes_to_write > arr.raw_object.size()) [[unlikely]] {
-                                return ebmgen::unexpect_error("WRITE_BYTES: requested {} bytes but object only has {} bytes", bytes_to_write, arr.raw_object.size());
-                            }
-                            actual_written = bytes_to_write;
-                            output_buf.insert(output_buf.end(), arr.raw_object.begin(), arr.raw_object.begin() + bytes_to_write);
-                        }
-                        if (is_dynamic && !ctx.flags().skip_write_size_check && actual_written != expected_size) {
-                            return ebmgen::unexpect_error("WRITE_BYTES size mismatch: expected {} bytes but wrote {} (use --skip-write-size-check to suppress)", expected_size, actual_written);
-                        }
-                        break;
+                    size_t actual_index = index - 1;
+                    if (actual_index >= bytes_arena.size()) [[unlikely]] {
+                        return ebmgen::unexpect_error("WRITE_BYTES invalid vector index: {} (out of {})", actual_index, bytes_arena.size());
                     }
-                    case ebm::OpCode::VECTOR_PUSH: {
-                        if (stack.size() < 2) {
-                            return ebmgen::unexpect_error("stack underflow on VECTOR_PUSH");
-                        }
-                        auto elem_val = stack_pop();
-                        elem_val.unref();
-                        auto val = stack_pop();
-                        val.unref();
-                        if (!std::holds_alternative<ObjectRef>(val.value)) {
-                            return ebmgen::unexpect_error("VECTOR_PUSH target is not an object");
-                        }
-                        auto vec_ptr = std::get<ObjectRef>(val.value);
-                        MAYBE(elem_place, vector_alloc_back(ctx, vec_ptr, instr.scratch, instr.type_info));
-                        if (std::holds_alternative<std::uint64_t>(elem_val.value)) {
-                            auto int_val = std::get<std::uint64_t>(elem_val.value);
-                            MAYBE_VOID(_, encode_uint64(elem_place, int_val, false));
-                        }
-                        else if (std::holds_alternative<ObjectRef>(elem_val.value)) {
-                            auto obj_ref = std::get<ObjectRef>(elem_val.value);
-                            if (obj_ref.raw_object.size() != elem_place.raw_object.size()) {
-                                return ebmgen::unexpect_error("element size mismatch in VECTOR_PUSH: expected {}, got {}", elem_place.raw_object.size(), obj_ref.raw_object.size());
-                            }
-                            std::copy(obj_ref.raw_object.begin(), obj_ref.raw_object.end(), elem_place.raw_object.begin());
-                        }
-                        else {
-                            return ebmgen::unexpect_error("unsupported element type in VECTOR_PUSH");
-                        }
-                        break;
+                    auto& byte_array = bytes_arena[actual_index];
+                    actual_written = byte_array.size();
+                    output_buf.insert(output_buf.end(), byte_array.begin(), byte_array.end());
+                }
+                else {
+                    size_t bytes_to_write = is_dynamic ? expected_size : static_size;
+                    if (bytes_to_write > arr.raw_object.size()) [[unlikely]] {
+                        return ebmgen::unexpect_error("WRITE_BYTES: requested {} bytes but object only has {} bytes", bytes_to_write, arr.raw_object.size());
                     }
-                    case ebm::OpCode::ERROR: {
-                        return ebmgen::unexpect_error("error: {}", instr.str_repr);
+                    actual_written = bytes_to_write;
+                    output_buf.insert(output_buf.end(), arr.raw_object.begin(), arr.raw_object.begin() + bytes_to_write);
+                }
+                if (is_dynamic && !ctx.flags().skip_write_size_check && actual_written != expected_size) {
+                    return ebmgen::unexpect_error("WRITE_BYTES size mismatch: expected {} bytes but wrote {} (use --skip-write-size-check to suppress)", expected_size, actual_written);
+                }
+                EBM2RMW_NEXT();
+            }
+            EBM2RMW_OP(VECTOR_PUSH) {
+                if (stack.size() < 2) {
+                    return ebmgen::unexpect_error("stack underflow on VECTOR_PUSH");
+                }
+                auto elem_val = stack_pop();
+                elem_val.unref();
+                auto val = stack_pop();
+                val.unref();
+                if (!std::holds_alternative<ObjectRef>(val.value)) {
+                    return ebmgen::unexpect_error("VECTOR_PUSH target is not an object");
+                }
+                auto vec_ptr = std::get<ObjectRef>(val.value);
+                MAYBE(elem_place, vector_alloc_back(ctx, vec_ptr, d->scratch, d->type_info));
+                if (std::holds_alternative<std::uint64_t>(elem_val.value)) {
+                    auto int_val = std::get<std::uint64_t>(elem_val.value);
+                    MAYBE_VOID(_, encode_uint64(elem_place, int_val, false));
+                }
+                else if (std::holds_alternative<ObjectRef>(elem_val.value)) {
+                    auto obj_ref = std::get<ObjectRef>(elem_val.value);
+                    if (obj_ref.raw_object.size() != elem_place.raw_object.size()) {
+                        return ebmgen::unexpect_error("element size mismatch in VECTOR_PUSH: expected {}, got {}", elem_place.raw_object.size(), obj_ref.raw_object.size());
                     }
-                    default:
-                        return ebmgen::unexpect_error("unsupported opcode in interpreter: {}(0x{:x})", to_string(instr.instr.op, true), static_cast<std::uint32_t>(instr.instr.op));
+                    std::copy(obj_ref.raw_object.begin(), obj_ref.raw_object.end(), elem_place.raw_object.begin());
+                }
+                else {
+                    return ebmgen::unexpect_error("unsupported element type in VECTOR_PUSH");
                 }
-                ip++;
+                EBM2RMW_NEXT();
             }
-            no_error = true;
-            return {};
+            EBM2RMW_OP(ERROR) {
+                return ebmgen::unexpect_error("error: {}", str_repr());
+            }
+            EBM2RMW_OP(UNSUPPORTED) {
+                return ebmgen::unexpect_error("unsupported opcode in interpreter: {}(0x{:x})", to_string(d->source_op, true), static_cast<std::uint32_t>(d->source_op));
+            }
+            EBM2RMW_OP(MALFORMED) {
+                return ebmgen::unexpect_error("{}", func.lowering_errors[d->imm]);
+            }
+            EBM2RMW_OP(END) {
+                no_error = true;
+                return {};
+            }
+#if !defined(__GNUC__) && !defined(__clang__)
+            }
+            return ebmgen::unexpect_error("invalid decoded opcode");
+#endif
+#undef EBM2RMW_JUMP
+#undef EBM2RMW_NEXT
+#undef EBM2RMW_OP
+#undef EBM2RMW_DISPATCH
         }
     };
 
-}  // namespace ebm2rmw
\ No newline at end of file
+}  // namespace ebm2rmw
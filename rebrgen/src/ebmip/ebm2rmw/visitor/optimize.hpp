@@ -1,7 +1,15 @@
 /*license*/
 #pragma once
 
+#include <algorithm>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 #include "ebm/extended_binary_module.hpp"
+#include "ebmgen/common.hpp"
 #include "inst.hpp"
 namespace ebm2rmw {
     inline std::optional<ebm::StatementRef> is_wrapper_function(std::vector<Instruction>& instructions) {
@@ -19,8 +27,362 @@ namespace ebm2rmw {
         return std::nullopt;
     }
 
+    // absolute target of JUMP/JUMP_IF_FALSE at ip, clamped to instructions.size() like lowering does
+    inline std::optional<size_t> jump_target(const std::vector<Instruction>& instructions, size_t ip) {
+        auto& instr = instructions[ip].instr;
+        if (instr.op != ebm::OpCode::JUMP && instr.op != ebm::OpCode::JUMP_IF_FALSE) {
+            return std::nullopt;
+        }
+        auto offset = instr.target();
+        if (!offset) {
+            return std::nullopt;
+        }
+        size_t target = offset->backward() ? ip - offset->offset.value() : ip + offset->offset.value();
+        return target > instructions.size() ? instructions.size() : target;
+    }
+
+    inline bool set_jump_target(Instruction& instr, size_t ip, size_t target) {
+        auto off = ebmgen::varint(target < ip ? ip - target : target - ip);
+        if (!off) {
+            return false;
+        }
+        ebm::JumpOffset offset;
+        offset.backward(target < ip);
+        offset.offset = *off;
+        return instr.instr.target(offset);
+    }
+
+    // rewrites instructions of one function. each pass marks instructions to remove
+    // and replaces others in place, then commit() erases removed ones and re-encodes jump offsets.
+    // patterns spanning several instructions only match if no jump lands inside them
+    struct FunctionOptimizer {
+        std::vector<Instruction>& code;
+        std::vector<bool> is_target;
+        std::vector<bool> removed;
+        size_t changes = 0;
+
+        explicit FunctionOptimizer(std::vector<Instruction>& c)
+            : code(c) {
+            begin_pass();
+        }
+
+        void begin_pass() {
+            is_target.assign(code.size() + 1, false);
+            removed.assign(code.size(), false);
+            for (size_t ip = 0; ip < code.size(); ip++) {
+                if (auto t = jump_target(code, ip)) {
+                    is_target[*t] = true;
+                }
+            }
+        }
+
+        // [ip, ip + n) is in range, not removed and is entered only from ip
+        bool straight(size_t ip, size_t n) const {
+            if (ip + n > code.size()) {
+                return false;
+            }
+            for (size_t i = 0; i < n; i++) {
+                if (removed[ip + i] || (i > 0 && is_target[ip + i])) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        ebm::OpCode op(size_t ip) const {
+            return code[ip].instr.op;
+        }
+
+        std::optional<std::uint64_t> imm(size_t ip) const {
+            if (op(ip) != ebm::OpCode::PUSH_IMM_INT) {
+                return std::nullopt;
+            }
+            auto value = code[ip].instr.value();
+            if (!value) {
+                return std::nullopt;
+            }
+            return value->value();
+        }
+
+        void remove(size_t ip) {
+            removed[ip] = true;
+            changes++;
+        }
+
+        // replace code[ip] with PUSH_IMM_INT value. false if value is not representable
+        bool replace_with_imm(size_t ip, std::uint64_t value, std::string str_repr) {
+            auto v = ebmgen::varint(value);
+            if (!v) {
+                return false;
+            }
+            ebm::Instruction instr;
+            instr.op = ebm::OpCode::PUSH_IMM_INT;
+            instr.value(*v);
+            code[ip] = Instruction{.instr = instr, .str_repr = std::move(str_repr)};
+            changes++;
+            return true;
+        }
+
+        // erase removed instructions. a jump to a removed instruction lands on the next kept one
+        void commit() {
+            const size_t count = code.size();
+            std::vector<size_t> new_index(count + 1);
+            size_t kept = 0;
+            for (size_t i = 0; i < count; i++) {
+                new_index[i] = kept;
+                kept += removed[i] ? 0 : 1;
+            }
+            new_index[count] = kept;
+            std::vector<Instruction> out;
+            out.reserve(kept);
+            for (size_t i = 0; i < count; i++) {
+                if (removed[i]) {
+                    continue;
+                }
+                auto target = jump_target(code, i);
+                out.push_back(std::move(code[i]));
+                if (target) {
+                    set_jump_target(out.back(), new_index[i], new_index[*target]);
+                }
+            }
+            code = std::move(out);
+            begin_pass();
+        }
+
+        // PUSH_IMM_INT a; PUSH_IMM_INT b; <binary> => PUSH_IMM_INT (a op b)
+        // PUSH_IMM_INT a; <unary>|EQ_IMM b        => PUSH_IMM_INT result
+        // division by zero and too large shifts are left to runtime
+        void fold_constants() {
+            for (size_t ip = 0; ip < code.size(); ip++) {
+                auto a = imm(ip);
+                if (!a || removed[ip]) {
+                    continue;
+                }
+                if (straight(ip, 3)) {
+                    auto b = imm(ip + 1);
+                    auto bop = OpCode_to_BinaryOp(op(ip + 2));
+                    if (b && bop) {
+                        const bool zero_div = (*bop == ebm::BinaryOp::div || *bop == ebm::BinaryOp::mod) && *b == 0;
+                        const bool over_shift = (*bop == ebm::BinaryOp::left_shift || *bop == ebm::BinaryOp::right_shift) && *b >= 64;
+                        auto r = zero_div || over_shift ? std::nullopt : eval_binary_op(*bop, *a, *b);
+                        if (r && replace_with_imm(ip, *r, code[ip + 2].str_repr)) {
+                            remove(ip + 1);
+                            remove(ip + 2);
+                            ip += 2;
+                            continue;
+                        }
+                    }
+                }
+                if (straight(ip, 2)) {
+                    std::optional<std::uint64_t> r;
+                    if (auto uop = OpCode_to_UnaryOp(op(ip + 1))) {
+                        r = eval_unary_op(*uop, *a);
+                    }
+                    else if (op(ip + 1) == ebm::OpCode::EQ_IMM && code[ip + 1].instr.value()) {
+                        r = *a == code[ip + 1].instr.value()->value() ? 1 : 0;
+                    }
+                    if (r && replace_with_imm(ip, *r, code[ip + 1].str_repr)) {
+                        remove(ip + 1);
+                        ip += 1;
+                    }
+                }
+            }
+        }
+
+        // PUSH_IMM_INT v; EQ          => EQ_IMM v
+        // PUSH_IMM_INT v; STORE_LOCAL => STORE_LOCAL_IMM v
+        // PUSH_IMM_INT v; ARRAY_GET   => ARRAY_GET_IMM v
+        // (same fusions as the compiler does when it sees the immediate directly)
+        void fuse_immediates() {
+            for (size_t ip = 0; ip + 1 < code.size(); ip++) {
+                if (!imm(ip) || !straight(ip, 2)) {
+                    continue;
+                }
+                const auto value = *code[ip].instr.value();
+                auto& next = code[ip + 1];
+                ebm::Instruction fused;
+                switch (next.instr.op) {
+                    case ebm::OpCode::EQ:
+                        fused.op = ebm::OpCode::EQ_IMM;
+                        fused.value(value);
+                        break;
+                    case ebm::OpCode::STORE_LOCAL:
+                        fused.op = ebm::OpCode::STORE_LOCAL_IMM;
+                        if (auto reg = next.instr.reg()) {
+                            fused.reg(*reg);
+                        }
+                        fused.value(value);
+                        break;
+                    case ebm::OpCode::ARRAY_GET:
+                        fused.op = ebm::OpCode::ARRAY_GET_IMM;
+                        fused.index(value);
+                        break;
+                    default:
+                        continue;
+                }
+                code[ip] = Instruction{
+                    .instr = fused,
+                    .str_repr = std::move(next.str_repr),
+                    .scratch = next.scratch,
+                    .type_info = next.type_info,
+                };
+                changes++;
+                remove(ip + 1);
+                ip++;
+            }
+        }
+
+        // NOP                          => (removed)
+        // <push without side effect>; POP => (removed)
+        // PUSH_IMM_INT 0; JUMP_IF_FALSE t => JUMP t
+        // PUSH_IMM_INT n; JUMP_IF_FALSE t => (removed) for n != 0
+        void peephole() {
+            for (size_t ip = 0; ip < code.size(); ip++) {
+                if (removed[ip]) {
+                    continue;
+                }
+                if (op(ip) == ebm::OpCode::NOP) {
+                    remove(ip);
+                    continue;
+                }
+                if (!straight(ip, 2)) {
+                    continue;
+                }
+                switch (op(ip)) {
+                    case ebm::OpCode::PUSH_IMM_INT:
+                    case ebm::OpCode::LOAD_LOCAL:
+                    case ebm::OpCode::LOAD_LOCAL_REF:
+                    case ebm::OpCode::LOAD_SELF:
+                    case ebm::OpCode::LOAD_PARAM:
+                    case ebm::OpCode::LOAD_FUNC:
+                        if (op(ip + 1) == ebm::OpCode::POP) {
+                            remove(ip);
+                            remove(ip + 1);
+                            ip++;
+                            continue;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+                auto cond = imm(ip);
+                auto target = jump_target(code, ip + 1);
+                if (cond && op(ip + 1) == ebm::OpCode::JUMP_IF_FALSE && target) {
+                    if (*cond == 0) {
+                        Instruction jump{.str_repr = code[ip + 1].str_repr};
+                        jump.instr.op = ebm::OpCode::JUMP;
+                        if (!set_jump_target(jump, ip, *target)) {
+                            continue;
+                        }
+                        code[ip] = std::move(jump);
+                        changes++;
+                    }
+                    else {
+                        remove(ip);
+                    }
+                    remove(ip + 1);
+                    ip++;
+                }
+            }
+        }
+
+        // jump to JUMP => jump to its final target
+        // JUMP to next instruction => (removed)
+        // JUMP to RET => RET
+        void thread_jumps() {
+            for (size_t ip = 0; ip < code.size(); ip++) {
+                auto target = jump_target(code, ip);
+                if (!target || removed[ip]) {
+                    continue;
+                }
+                size_t final_target = *target;
+                // bounded by instruction count so that a jump cycle (infinite loop) terminates
+                for (size_t hops = 0; hops < code.size() && final_target < code.size() &&
+                                      op(final_target) == ebm::OpCode::JUMP;
+                     hops++) {
+                    auto next = jump_target(code, final_target);
+                    if (!next) {
+                        break;
+                    }
+                    final_target = *next;
+                }
+                if (final_target != *target && set_jump_target(code[ip], ip, final_target)) {
+                    changes++;
+                }
+                if (op(ip) != ebm::OpCode::JUMP) {
+                    continue;
+                }
+                if (final_target == ip + 1) {
+                    remove(ip);
+                }
+                else if (final_target < code.size() && op(final_target) == ebm::OpCode::RET) {
+                    code[ip] = code[final_target];
+                    changes++;
+                }
+            }
+        }
+
+        // remove instructions not reachable from entry (ip 0)
+        void remove_unreachable() {
+            std::vector<bool> reachable(code.size() + 1, false);
+            std::vector<size_t> work{0};
+            while (!work.empty()) {
+                auto ip = work.back();
+                work.pop_back();
+                if (ip >= code.size() || reachable[ip]) {
+                    continue;
+                }
+                reachable[ip] = true;
+                auto target = jump_target(code, ip);
+                switch (op(ip)) {
+                    case ebm::OpCode::JUMP:
+                        if (target) {
+                            work.push_back(*target);
+                        }
+                        break;
+                    case ebm::OpCode::JUMP_IF_FALSE:
+                        if (target) {
+                            work.push_back(*target);
+                        }
+                        work.push_back(ip + 1);
+                        break;
+                    case ebm::OpCode::RET:
+                    case ebm::OpCode::ERROR:
+                    case ebm::OpCode::HALT:
+                        break;
+                    default:
+                        work.push_back(ip + 1);
+                        break;
+                }
+            }
+            for (size_t ip = 0; ip < code.size(); ip++) {
+                if (!reachable[ip] && !removed[ip]) {
+                    remove(ip);
+                }
+            }
+        }
+    };
+
     struct Optimizer {
-        void optimize_function(Env& env) {
+        struct PassStat {
+            const char* name;
+            size_t changes = 0;
+            size_t instructions_after = 0;  // total over all functions after last run of the pass
+        };
+
+        size_t instructions_before = 0;
+        std::vector<PassStat> stats;
+
+        static size_t count_instructions(Env& env) {
+            size_t total = 0;
+            for (auto& [_, func] : env.get_functions()) {
+                total += func.instructions.size();
+            }
+            return total;
+        }
+
+        // forward calls through 3-instruction wrapper functions to the wrapped function
+        size_t forward_wrapper_calls(Env& env) {
             auto& functions = env.get_functions();
             std::unordered_map<ebm::StatementRef, ebm::StatementRef> wrapper_functions;
             for (auto& [func_id, func_decl] : functions) {
@@ -28,6 +390,7 @@ namespace ebm2rmw {
                     wrapper_functions[func_id] = *wrapped;
                 }
             }
+            size_t changes = 0;
             for (auto& [func_id, func_decl] : functions) {
                 for (auto& instr : func_decl.instructions) {
                     if (auto func_id = instr.instr.func_id()) {
@@ -42,10 +405,57 @@ namespace ebm2rmw {
                         }
                         if (target_func != *func_id) {
                             instr.instr.func_id(target_func);
+                            changes++;
                         }
                     }
                 }
             }
+            return changes;
+        }
+
+        void record(Env& env, const char* name, size_t changes) {
+            auto found = std::find_if(stats.begin(), stats.end(), [&](auto& s) { return std::string_view(s.name) == name; });
+            if (found == stats.end()) {
+                stats.push_back(PassStat{.name = name});
+                found = stats.end() - 1;
+            }
+            found->changes += changes;
+            found->instructions_after = count_instructions(env);
+        }
+
+        void optimize_function(Env& env) {
+            instructions_before = count_instructions(env);
+            record(env, "forward-wrapper-calls", forward_wrapper_calls(env));
+            using Pass = void (FunctionOptimizer::*)();
+            constexpr std::pair<const char*, Pass> passes[] = {
+                {"fold-constants", &FunctionOptimizer::fold_constants},
+                {"fuse-immediates", &FunctionOptimizer::fuse_immediates},
+                {"peephole", &FunctionOptimizer::peephole},
+                {"thread-jumps", &FunctionOptimizer::thread_jumps},
+                {"remove-unreachable", &FunctionOptimizer::remove_unreachable},
+            };
+            // each pass may expose work for the others (e.g. folded condition -> constant branch -> dead code)
+            constexpr size_t max_rounds = 8;
+            for (size_t round = 0; round < max_rounds; round++) {
+                size_t round_changes = 0;
+                for (auto& [name, pass] : passes) {
+                    size_t changes = 0;
+                    for (auto& [_, func_decl] : env.get_functions()) {
+                        FunctionOptimizer fo{func_decl.instructions};
+                        (fo.*pass)();
+                        fo.commit();
+                        changes += fo.changes;
+                    }
+                    record(env, name, changes);
+                    round_changes += changes;
+                }
+                if (round_changes == 0) {
+                    break;
+                }
+            }
+            for (auto& [_, func_decl] : env.get_functions()) {
+                func_decl.invalidate_lowered();
+            }
         }
     };
-}  // namespace ebm2rmw
\ No newline at end of file
+}  // namespace ebm2rmw
@@ -0,0 +1,129 @@
+/*license*/
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "inst.hpp"
+
+namespace ebm2rmw {
+
+    // counting profiler of the interpreter (--profile / --profile-folded).
+    // nothing is sampled: every interpreted function call is recorded on a call tree
+    // with its time and bytes consumed from input / appended to output.
+    // opcode counts are taken from RuntimeEnv's per-opcode counters, so dispatch has no extra cost.
+    // single threaded; fuzz jobs run on one thread while profiling
+    struct Profiler {
+        struct FunctionProfile {
+            std::uint64_t calls = 0;
+            std::uint64_t inclusive_ns = 0;
+            std::uint64_t exclusive_ns = 0;
+            std::uint64_t bytes_read = 0;     // exclusive
+            std::uint64_t bytes_written = 0;  // exclusive
+            size_t active = 0;                // recursion depth; inclusive time is added by outermost call only
+        };
+
+        struct Node {
+            const FunctionDecl* func = nullptr;  // nullptr for root
+            FunctionProfile* profile = nullptr;
+            std::vector<size_t> children;
+            std::uint64_t calls = 0;
+            std::uint64_t self_ns = 0;
+        };
+
+       private:
+        struct ActiveCall {
+            size_t node = 0;
+            std::chrono::steady_clock::time_point start;
+            size_t input_pos = 0;
+            size_t output_size = 0;
+            std::uint64_t child_ns = 0;
+            std::uint64_t child_read = 0;
+            std::uint64_t child_written = 0;
+        };
+
+        std::vector<Node> nodes{Node{}};
+        std::vector<ActiveCall> active;
+        std::unordered_map<const FunctionDecl*, FunctionProfile> functions;
+        std::uint64_t op_counts[end_stats_slot + 1] = {0};
+
+        size_t child_of(size_t parent, const FunctionDecl* func) {
+            for (auto c : nodes[parent].children) {
+                if (nodes[c].func == func) {
+                    return c;
+                }
+            }
+            const size_t c = nodes.size();
+            nodes.push_back(Node{.func = func, .profile = &functions[func]});
+            nodes[parent].children.push_back(c);
+            return c;
+        }
+
+       public:
+        // input_pos/output_size are positions of current streams. bytes are counted as
+        // their growth between enter and exit, so a sub input pushed and popped
+        // inside the call is counted by how much it advanced the parent stream
+        void enter(const FunctionDecl* func, size_t input_pos, size_t output_size) {
+            const size_t node = child_of(active.empty() ? 0 : active.back().node, func);
+            nodes[node].profile->active++;
+            active.push_back(ActiveCall{
+                .node = node,
+                .start = std::chrono::steady_clock::now(),
+                .input_pos = input_pos,
+                .output_size = output_size,
+            });
+        }
+
+        void exit(size_t input_pos, size_t output_size) {
+            const auto call = active.back();
+            active.pop_back();
+            const std::uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                              std::chrono::steady_clock::now() - call.start)
+                                              .count();
+            const std::uint64_t read = input_pos > call.input_pos ? input_pos - call.input_pos : 0;
+            const std::uint64_t written = output_size > call.output_size ? output_size - call.output_size : 0;
+            const std::uint64_t self_ns = elapsed - std::min(call.child_ns, elapsed);
+            auto& node = nodes[call.node];
+            node.calls++;
+            node.self_ns += self_ns;
+            auto& f = *node.profile;
+            f.calls++;
+            f.exclusive_ns += self_ns;
+            f.bytes_read += read - std::min(call.child_read, read);
+            f.bytes_written += written - std::min(call.child_written, written);
+            if (--f.active == 0) {
+                f.inclusive_ns += elapsed;
+            }
+            if (!active.empty()) {
+                auto& parent = active.back();
+                parent.child_ns += elapsed;
+                parent.child_read += read;
+                parent.child_written += written;
+            }
+        }
+
+        // move per-opcode counters of a runtime into profile
+        void take_op_counts(std::uint64_t (&counts)[end_stats_slot + 1]) {
+            for (size_t i = 0; i <= end_stats_slot; i++) {
+                op_counts[i] += counts[i];
+                counts[i] = 0;
+            }
+        }
+
+        const std::uint64_t (&get_op_counts() const)[end_stats_slot + 1] {
+            return op_counts;
+        }
+
+        const std::unordered_map<const FunctionDecl*, FunctionProfile>& get_functions() const {
+            return functions;
+        }
+
+        // node 0 is root; its children are entry calls
+        const std::vector<Node>& get_nodes() const {
+            return nodes;
+        }
+    };
+
+}  // namespace ebm2rmw
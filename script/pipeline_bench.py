@@ -0,0 +1,259 @@
+# pipeline benchmark driver
+# runs example/**/*.bgn through
+#   frontend (build/test/pipeline_bench): lex, parse, each middle pass, json dump,
+#     json load and binary ast encode/decode with output sizes of both formats
+#   ebmgen (rebrgen/tool/ebmgen_bench): each transform phase, encode
+#   intern (rebrgen/tool/ebmgen_intern_bench): reference interning by serialized string vs fingerprint
+#   backends (rebrgen/tool/ebm2*): whole process per file, and startup phases reported by --timing
+# and writes a single json result. with --baseline, compares totals against
+# previous result and exits with 1 if any metric regressed over threshold
+#
+# usage:
+#   python script/pipeline_bench.py --out bench.json
+#   python script/pipeline_bench.py --baseline bench.json --out new.json
+import argparse
+import json
+import os
+import pathlib as pl
+import re
+import subprocess as sp
+import sys
+import tempfile
+import time
+
+EXE_SUFFIX = ".exe" if os.name == "nt" else ""
+
+
+def exe(dir: str, name: str) -> pl.Path:
+    return pl.Path(dir) / (name + EXE_SUFFIX)
+
+
+def run_json(cmd: list) -> dict:
+    print("running:", " ".join(str(c) for c in cmd[:4]), "..." if len(cmd) > 4 else "", file=sys.stderr, flush=True)
+    out = sp.check_output([str(c) for c in cmd], stderr=sys.stderr)
+    return json.loads(out)
+
+
+# returns (wall_ns, peak_rss bytes or None, returncode)
+def run_measured(cmd: list):
+    begin = time.perf_counter_ns()
+    proc = sp.Popen([str(c) for c in cmd], stdout=sp.DEVNULL, stderr=sp.PIPE)
+    if hasattr(os, "wait4"):
+        _, status, usage = os.wait4(proc.pid, 0)
+        elapsed = time.perf_counter_ns() - begin
+        proc.returncode = os.waitstatus_to_exitcode(status)
+        stderr = proc.stderr.read()
+        proc.stderr.close()
+        # ru_maxrss is bytes on macOS, kilobytes on linux
+        rss = usage.ru_maxrss if sys.platform == "darwin" else usage.ru_maxrss * 1024
+    else:
+        _, stderr = proc.communicate()
+        elapsed = time.perf_counter_ns() - begin
+        rss = None
+    return elapsed, rss, proc.returncode, stderr.decode(errors="replace")
+
+
+def run_frontend(args, work: pl.Path) -> dict:
+    ast_dir = work / "ast"
+    r = run_json([exe(args.brgen_bin, "pipeline_bench"), args.examples, "--ast-out", ast_dir])
+    t = r["total"]
+    if "binary_encode" in t:
+        print(f"ast format: json {r['total_json_bytes']} bytes, dump {t['json_dump']['wall_ns']} ns, load {t['json_load']['wall_ns']} ns; "
+              f"binary {r['total_binary_bytes']} bytes, encode {t['binary_encode']['wall_ns']} ns, decode {t['binary_decode']['wall_ns']} ns", file=sys.stderr, flush=True)
+    return r
+
+
+def run_ebmgen(args, work: pl.Path, frontend: dict) -> dict:
+    ast_dir = work / "ast"
+    ebm_dir = work / "ebm"
+    cmd = [exe(args.rebrgen_tool, "ebmgen_bench")]
+    for f in frontend["files"]:
+        if not f["ok"]:
+            continue
+        rel = pl.Path(f["file"]).relative_to(args.examples).with_suffix(".json")
+        ebm = (ebm_dir / rel).with_suffix(".ebm")
+        ebm.parent.mkdir(parents=True, exist_ok=True)
+        cmd += [ast_dir / rel, "--ebm-out", ebm]
+    if len(cmd) == 1:
+        return {"tool": "ebmgen_bench", "files": [], "total": {}, "peak_rss": 0}
+    return run_json(cmd)
+
+
+def ebm_files(work: pl.Path, ebmgen: dict) -> list:
+    ebms = []
+    for f in ebmgen["files"]:
+        if f["ok"]:
+            rel = pl.Path(f["file"]).relative_to(work / "ast")
+            ebms.append((work / "ebm" / rel).with_suffix(".ebm"))
+    return ebms
+
+
+# runs each strategy in its own process so that peak_rss is per strategy
+# both must make the same dedup decisions (alias_digest)
+def run_intern(args, work: pl.Path, ebmgen: dict) -> dict:
+    ebms = ebm_files(work, ebmgen)
+    if not ebms:
+        return {}
+    result = {}
+    for strategy in ("string", "fingerprint"):
+        r = run_json([exe(args.rebrgen_tool, "ebmgen_intern_bench"), "--strategy", strategy] + ebms)
+        result[strategy] = {"total": r["total"], "peak_rss": r["peak_rss"], "digests": [f["alias_digest"] for f in r["files"]]}
+    if result["string"]["digests"] != result["fingerprint"]["digests"]:
+        print("intern: string and fingerprint strategies made different dedup decisions", file=sys.stderr)
+        sys.exit(1)
+    for strategy in result.values():
+        del strategy["digests"]
+    s, f = result["string"], result["fingerprint"]
+    print(f"intern: wall {s['total']['wall_ns']} -> {f['total']['wall_ns']} ns, peak_rss {s['peak_rss']} -> {f['peak_rss']}", file=sys.stderr, flush=True)
+    return result
+
+
+# startup phases of generated entry point (ebmcodegen/stub/entry.hpp) printed with --timing
+STARTUP_PHASES = {
+    "file decoded": "decode_ms",
+    "mapping table built": "mapping_ms",
+}
+TIMING_RE = re.compile(r"\[timing\] (.+) took (\d+) ms")
+
+
+def parse_startup(stderr: str) -> dict:
+    startup = {}
+    for line in stderr.splitlines():
+        m = TIMING_RE.search(line)
+        if m and m.group(1) in STARTUP_PHASES:
+            startup[STARTUP_PHASES[m.group(1)]] = int(m.group(2))
+    return startup
+
+
+def run_backends(args, work: pl.Path, ebmgen: dict) -> dict:
+    out_dir = work / "out"
+    out_dir.mkdir(parents=True, exist_ok=True)
+    result = {}
+    ebms = ebm_files(work, ebmgen)
+    for backend in args.backends.split(","):
+        backend = backend.strip()
+        if not backend:
+            continue
+        tool = exe(args.rebrgen_tool, backend)
+        files = []
+        total = {"wall_ns": 0, "peak_rss": 0, "failed": 0, "decode_ms": 0, "mapping_ms": 0}
+        for ebm in ebms:
+            out = out_dir / backend / ebm.name
+            out.parent.mkdir(parents=True, exist_ok=True)
+            wall, rss, code, stderr = run_measured([tool, "-i", ebm, "-o", out, "--timing"])
+            entry = {"file": ebm.as_posix(), "ok": code == 0, "wall_ns": wall}
+            startup = parse_startup(stderr)
+            entry.update(startup)
+            for key, value in startup.items():
+                total[key] += value
+            if rss is not None:
+                entry["peak_rss"] = rss
+                total["peak_rss"] = max(total["peak_rss"], rss)
+            if code != 0:
+                entry["error"] = stderr
+                total["failed"] += 1
+            total["wall_ns"] += wall
+            files.append(entry)
+        print(f"{backend}: {len(files)} files, {total['failed']} failed, startup decode {total['decode_ms']} ms, mapping {total['mapping_ms']} ms", file=sys.stderr, flush=True)
+        result[backend] = {"files": files, "total": total}
+    return result
+
+
+# flattens result into {"frontend.parse.wall_ns": value, ...}
+def flatten(result: dict) -> dict:
+    flat = {}
+    for stage in ("frontend", "ebmgen"):
+        if stage not in result:
+            continue
+        for phase, metrics in result[stage]["total"].items():
+            for key, value in metrics.items():
+                flat[f"{stage}.{phase}.{key}"] = value
+        flat[f"{stage}.peak_rss"] = result[stage]["peak_rss"]
+        for key in ("total_ast_nodes", "total_json_bytes", "total_binary_bytes"):
+            if key in result[stage]:
+                flat[f"{stage}.{key}"] = result[stage][key]
+    for strategy, r in result.get("intern", {}).items():
+        for key in ("wall_ns", "key_bytes", "alloc_bytes"):
+            flat[f"intern.{strategy}.{key}"] = r["total"][key]
+        flat[f"intern.{strategy}.peak_rss"] = r["peak_rss"]
+    for backend, r in result.get("backends", {}).items():
+        for key in ("wall_ns", "peak_rss", "decode_ms", "mapping_ms"):
+            if key in r["total"]:
+                flat[f"backends.{backend}.{key}"] = r["total"][key]
+    return flat
+
+
+# ignore tiny absolute differences that are below timer/allocator noise
+NOISE_FLOOR = {
+    "wall_ns": 1_000_000,  # 1ms
+    "allocs": 100,
+    "alloc_bytes": 64 * 1024,
+    "peak_rss": 1024 * 1024,
+    "decode_ms": 1,
+    "mapping_ms": 1,
+}
+
+
+def compare(base: dict, new: dict, threshold: float) -> list:
+    base_flat = flatten(base)
+    new_flat = flatten(new)
+    regressions = []
+    for key, new_value in new_flat.items():
+        if key not in base_flat:
+            continue
+        base_value = base_flat[key]
+        floor = NOISE_FLOOR.get(key.rsplit(".", 1)[-1], 0)
+        if new_value - base_value <= floor:
+            continue
+        if new_value > base_value * (1 + threshold):
+            regressions.append((key, base_value, new_value))
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description="benchmark brgen/rebrgen pipeline over example corpus")
+    parser.add_argument("--brgen-bin", default="./built/native/Debug/test", help="directory containing pipeline_bench")
+    parser.add_argument("--rebrgen-tool", default="./rebrgen/tool", help="directory containing ebmgen_bench and ebm2* backends")
+    parser.add_argument("--examples", default="./example", help="directory of .bgn files")
+    parser.add_argument("--backends", default="ebm2cpp,ebm2rust", help="comma separated backend names")
+    parser.add_argument("--work-dir", default=None, help="keep intermediate files in this directory")
+    parser.add_argument("--out", default=None, help="write result json to this file (default: stdout)")
+    parser.add_argument("--baseline", default=None, help="previous result json to compare with")
+    parser.add_argument("--threshold", type=float, default=0.1, help="allowed relative regression (default: 0.1)")
+    args = parser.parse_args()
+
+    with tempfile.TemporaryDirectory() as tmp:
+        work = pl.Path(args.work_dir) if args.work_dir else pl.Path(tmp)
+        work.mkdir(parents=True, exist_ok=True)
+        frontend = run_frontend(args, work)
+        ebmgen = run_ebmgen(args, work, frontend)
+        intern = run_intern(args, work, ebmgen)
+        backends = run_backends(args, work, ebmgen)
+
+    result = {
+        "frontend": frontend,
+        "ebmgen": ebmgen,
+        "intern": intern,
+        "backends": backends,
+    }
+    text = json.dumps(result, indent=2)
+    if args.out:
+        with open(args.out, "w") as f:
+            f.write(text)
+    else:
+        print(text)
+
+    if args.baseline:
+        with open(args.baseline, "r") as f:
+            base = json.load(f)
+        regressions = compare(base, result, args.threshold)
+        if regressions:
+            print(f"regressions over {args.threshold:.0%}:", file=sys.stderr)
+            for key, b, n in regressions:
+                print(f"  {key}: {b} -> {n} ({(n - b) / b if b else float('inf'):+.1%})", file=sys.stderr)
+            sys.exit(1)
+        print("no regression", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
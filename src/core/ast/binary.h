@@ -0,0 +1,547 @@
+/*license*/
+#pragma once
+#include "ast.h"
+#include "traverse.h"
+#include "../common/error.h"
+#include <unordered_map>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <optional>
+
+// compact binary ast interchange format (alternative to JSONConverter)
+//
+// layout (all integers are unsigned LEB128 varint):
+//   magic "BAST"
+//   version
+//   string_count, {len, bytes}...            ; interned string table
+//   file_count, {string_index}...            ; same as "files" of json output
+//   error_json_index + 1 (0 if no error)     ; SourceError json of json output
+//   node_count, {node_type}...               ; node table (index 0 is root)
+//   scope_count
+//   nodes: fields in `dump` order of each node
+//     shared_ptr/weak_ptr : node index + 1 (0 is null)
+//     vector              : count, {node index + 1}...
+//     map                 : count, {string_index, node index + 1}...
+//     scope               : scope index + 1 (0 is null)
+//     Loc                 : file, line, col, begin, end - begin
+//     string              : string_index
+//     bool                : 0 or 1
+//     size_t/enum         : value
+//     optional<size_t>    : 0 if nullopt else value + 1
+//   scopes: owner, ident count, {ident}..., branch, next, prev, branch_root, loc
+//
+// node fields are not keyed, so the format is tied to node definitions of this build;
+// binary_ast_version must be bumped when node definitions change
+//
+// readers: only C++ tools linked with this header (tool/common/load_json.h users and
+// ebmgen --input-format binary-ast). go json2* generators and the lsp read json only,
+// so feed them src2json output without --binary-ast.
+// size and encode/decode time against json are measured by test/bench/pipeline_bench
+namespace brgen::ast {
+
+    constexpr std::string_view binary_ast_magic = "BAST";
+    constexpr std::uint64_t binary_ast_version = 1;
+
+    constexpr bool is_binary_ast(std::string_view data) {
+        return data.starts_with(binary_ast_magic);
+    }
+
+    struct BinaryASTFile {
+        std::vector<std::string> files;
+        std::optional<std::string> error_json;
+        std::shared_ptr<Node> ast;
+    };
+
+    struct BinaryConverter {
+       private:
+        std::unordered_map<std::shared_ptr<Node>, size_t> node_index;
+        std::unordered_map<std::shared_ptr<Scope>, size_t> scope_index;
+        std::vector<std::shared_ptr<Node>> nodes;
+        std::vector<std::shared_ptr<Scope>> scopes;
+        std::unordered_map<std::string, size_t> string_index;
+        std::vector<std::string_view> strings;
+
+        std::string body;
+
+        static void write_varint(std::string& w, std::uint64_t v) {
+            while (v >= 0x80) {
+                w.push_back(char(v & 0x7f | 0x80));
+                v >>= 7;
+            }
+            w.push_back(char(v));
+        }
+
+        void collect(const std::shared_ptr<Scope>& scope) {
+            std::vector<std::shared_ptr<Scope>> stack;
+            stack.push_back(scope);
+            while (!stack.empty()) {
+                auto v = stack.back();
+                stack.pop_back();
+                if (scope_index.contains(v)) {
+                    continue;
+                }
+                scopes.push_back(v);
+                scope_index[v] = scopes.size() - 1;
+                if (v->next && v->next->prev.lock() == v) {
+                    stack.push_back(v->next);
+                }
+                if (v->branch) {
+                    stack.push_back(v->branch);
+                }
+            }
+        }
+
+        // same collection order as JSONConverter
+        void collect(const std::shared_ptr<Node>& node) {
+            if (!node || node_index.contains(node)) {
+                return;
+            }
+            nodes.push_back(node);
+            node_index[node] = nodes.size() - 1;
+            visit(node, [&](auto&& f) {
+                f->dump([&]<class T>(std::string_view key, T& value) {
+                    if constexpr (futils::helper::is_template_instance_of<T, std::shared_ptr>) {
+                        using type = typename futils::helper::template_instance_of_t<T, std::shared_ptr>::template param_at<0>;
+                        if constexpr (std::is_base_of_v<Node, type>) {
+                            collect(value);
+                        }
+                        else {
+                            if (key == "global_scope") {
+                                collect(value);
+                            }
+                        }
+                    }
+                    else if constexpr (futils::helper::is_template_instance_of<T, std::vector>) {
+                        using type = typename futils::helper::template_of_t<T>::template param_at<0>;
+                        if constexpr (futils::helper::is_template_instance_of<type, std::shared_ptr>) {
+                            for (auto& element : value) {
+                                collect(element);
+                            }
+                        }
+                    }
+                });
+            });
+        }
+
+        size_t intern(std::string_view s) {
+            auto found = string_index.find(std::string(s));
+            if (found != string_index.end()) {
+                return found->second;
+            }
+            auto [it, _] = string_index.emplace(std::string(s), strings.size());
+            strings.push_back(it->first);
+            return it->second;
+        }
+
+        void write_node_ref(const std::shared_ptr<Node>& node) {
+            auto it = node ? node_index.find(node) : node_index.end();
+            write_varint(body, it == node_index.end() ? 0 : it->second + 1);
+        }
+
+        void write_scope_ref(const std::shared_ptr<Scope>& scope) {
+            auto it = scope ? scope_index.find(scope) : scope_index.end();
+            write_varint(body, it == scope_index.end() ? 0 : it->second + 1);
+        }
+
+        void write_loc(const lexer::Loc& loc) {
+            write_varint(body, loc.file);
+            write_varint(body, loc.line);
+            write_varint(body, loc.col);
+            write_varint(body, loc.pos.begin);
+            write_varint(body, loc.pos.end - loc.pos.begin);
+        }
+
+        void encode_field(auto& value) {
+            using T = std::remove_cvref_t<decltype(value)>;
+            if constexpr (std::is_same_v<T, NodeType>) {
+                // encoded in node table
+            }
+            else if constexpr (std::is_same_v<T, std::shared_ptr<Scope>>) {
+                write_scope_ref(value);
+            }
+            else if constexpr (futils::helper::is_template_instance_of<T, std::shared_ptr>) {
+                write_node_ref(value);
+            }
+            else if constexpr (futils::helper::is_template_instance_of<T, std::weak_ptr>) {
+                write_node_ref(value.lock());
+            }
+            else if constexpr (futils::helper::is_template_instance_of<T, std::vector>) {
+                write_varint(body, value.size());
+                for (auto& element : value) {
+                    if constexpr (futils::helper::is_template_instance_of<std::decay_t<decltype(element)>, std::weak_ptr>) {
+                        write_node_ref(element.lock());
+                    }
+                    else {
+                        write_node_ref(element);
+                    }
+                }
+            }
+            else if constexpr (futils::helper::is_template_instance_of<T, std::map>) {
+                write_varint(body, value.size());
+                for (auto& [k, v] : value) {
+                    write_varint(body, intern(k));
+                    write_node_ref(v);
+                }
+            }
+            else if constexpr (std::is_same_v<T, lexer::Loc>) {
+                write_loc(value);
+            }
+            else if constexpr (std::is_same_v<T, std::string>) {
+                write_varint(body, intern(value));
+            }
+            else if constexpr (std::is_same_v<T, bool>) {
+                body.push_back(value ? 1 : 0);
+            }
+            else if constexpr (std::is_same_v<T, std::optional<size_t>>) {
+                write_varint(body, value ? *value + 1 : 0);
+            }
+            else if constexpr (std::is_enum_v<T>) {
+                write_varint(body, std::uint64_t(static_cast<std::underlying_type_t<T>>(value)));
+            }
+            else {
+                static_assert(std::is_same_v<T, size_t>);
+                write_varint(body, value);
+            }
+        }
+
+        struct Reader {
+            std::string_view data;
+            size_t pos = 0;
+            bool ok = true;
+
+            std::uint64_t varint() {
+                std::uint64_t v = 0;
+                for (size_t shift = 0; shift < 64; shift += 7) {
+                    if (pos >= data.size()) {
+                        ok = false;
+                        return 0;
+                    }
+                    auto c = std::uint8_t(data[pos++]);
+                    v |= std::uint64_t(c & 0x7f) << shift;
+                    if (!(c & 0x80)) {
+                        return v;
+                    }
+                }
+                ok = false;
+                return 0;
+            }
+
+            std::string_view bytes(size_t len) {
+                if (data.size() - pos < len) {
+                    ok = false;
+                    return {};
+                }
+                auto res = data.substr(pos, len);
+                pos += len;
+                return res;
+            }
+        };
+
+        std::vector<std::string> string_table;
+
+        result<std::string> read_string(Reader& r) {
+            auto i = r.varint();
+            if (i >= string_table.size()) {
+                return unexpect(error({}, "string index out of range: ", nums(i)));
+            }
+            return string_table[i];
+        }
+
+        lexer::Loc read_loc(Reader& r) {
+            lexer::Loc loc;
+            loc.file = r.varint();
+            loc.line = r.varint();
+            loc.col = r.varint();
+            loc.pos.begin = r.varint();
+            loc.pos.end = loc.pos.begin + r.varint();
+            return loc;
+        }
+
+        result<std::shared_ptr<Node>> read_node_ref(Reader& r, lexer::Loc loc) {
+            auto i = r.varint();
+            if (i == 0) {
+                return nullptr;
+            }
+            if (i > nodes.size()) {
+                return unexpect(error(loc, "missing reference; index out of range, index ", nums(i - 1)));
+            }
+            return nodes[i - 1];
+        }
+
+        template <class P>
+        result<std::shared_ptr<P>> read_typed_ref(Reader& r, lexer::Loc loc) {
+            auto node = read_node_ref(r, loc);
+            if (!node) {
+                return unexpect(std::move(node.error()));
+            }
+            if constexpr (!std::is_same_v<Node, P>) {
+                if (*node && !ast::as<P>(*node)) {
+                    return unexpect(error(loc, "missing reference: expect node ", node_type_to_string(P::node_type_tag), " but found ", node_type_to_string((*node)->node_type)));
+                }
+            }
+            return cast_to<P>(std::move(*node));
+        }
+
+        result<void> decode_field(Reader& r, lexer::Loc loc, auto& value) {
+            using T = std::remove_cvref_t<decltype(value)>;
+            if constexpr (std::is_same_v<T, NodeType>) {
+                return {};
+            }
+            else if constexpr (std::is_same_v<T, std::shared_ptr<Scope>>) {
+                auto i = r.varint();
+                if (i > scopes.size()) {
+                    return unexpect(error(loc, "scope index out of range: ", nums(i - 1)));
+                }
+                value = i == 0 ? nullptr : scopes[i - 1];
+                return {};
+            }
+            else if constexpr (futils::helper::is_template_instance_of<T, std::shared_ptr> ||
+                               futils::helper::is_template_instance_of<T, std::weak_ptr>) {
+                using P = typename futils::helper::template_of_t<T>::template param_at<0>;
+                auto ref = read_typed_ref<P>(r, loc);
+                if (!ref) {
+                    return unexpect(std::move(ref.error()));
+                }
+                value = std::move(*ref);
+                return {};
+            }
+            else if constexpr (futils::helper::is_template_instance_of<T, std::vector>) {
+                using E = typename futils::helper::template_of_t<T>::template param_at<0>;
+                using P = typename futils::helper::template_of_t<E>::template param_at<0>;
+                auto count = r.varint();
+                if (count > r.data.size()) {
+                    return unexpect(error(loc, "invalid element count: ", nums(count)));
+                }
+                value.reserve(count);
+                for (size_t i = 0; i < count; i++) {
+                    auto ref = read_typed_ref<P>(r, loc);
+                    if (!ref) {
+                        return unexpect(std::move(ref.error()));
+                    }
+                    value.push_back(std::move(*ref));
+                }
+                return {};
+            }
+            else if constexpr (futils::helper::is_template_instance_of<T, std::map>) {
+                using P = typename futils::helper::template_of_t<typename T::mapped_type>::template param_at<0>;
+                auto count = r.varint();
+                for (size_t i = 0; i < count && r.ok; i++) {
+                    auto key = read_string(r);
+                    if (!key) {
+                        return unexpect(std::move(key.error()));
+                    }
+                    auto ref = read_typed_ref<P>(r, loc);
+                    if (!ref) {
+                        return unexpect(std::move(ref.error()));
+                    }
+                    value[std::move(*key)] = std::move(*ref);
+                }
+                return {};
+            }
+            else if constexpr (std::is_same_v<T, lexer::Loc>) {
+                value = read_loc(r);
+                return {};
+            }
+            else if constexpr (std::is_same_v<T, std::string>) {
+                auto s = read_string(r);
+                if (!s) {
+                    return unexpect(std::move(s.error()));
+                }
+                value = std::move(*s);
+                return {};
+            }
+            else if constexpr (std::is_same_v<T, bool>) {
+                value = r.bytes(1) == std::string_view("\x01", 1);
+                return {};
+            }
+            else if constexpr (std::is_same_v<T, std::optional<size_t>>) {
+                auto v = r.varint();
+                value = v == 0 ? std::nullopt : std::optional<size_t>(v - 1);
+                return {};
+            }
+            else if constexpr (std::is_enum_v<T>) {
+                value = static_cast<T>(static_cast<std::underlying_type_t<T>>(r.varint()));
+                return {};
+            }
+            else {
+                static_assert(std::is_same_v<T, size_t>);
+                value = r.varint();
+                return {};
+            }
+        }
+
+       public:
+        void clear() {
+            node_index.clear();
+            scope_index.clear();
+            nodes.clear();
+            scopes.clear();
+            string_index.clear();
+            strings.clear();
+            string_table.clear();
+            body.clear();
+        }
+
+        // encode ast with file list and optional SourceError json
+        std::string encode(const std::shared_ptr<Node>& root_node, const std::vector<std::string>& files = {}, std::optional<std::string_view> error_json = std::nullopt) {
+            clear();
+            collect(root_node);
+            std::vector<size_t> file_strings;
+            for (auto& f : files) {
+                file_strings.push_back(intern(f));
+            }
+            size_t error_string = error_json ? intern(*error_json) + 1 : 0;
+            for (auto& node : nodes) {
+                visit(node, [&](auto&& f) {
+                    f->dump([&](std::string_view, auto& value) {
+                        encode_field(value);
+                    });
+                });
+            }
+            for (auto& scope : scopes) {
+                write_node_ref(scope->owner.lock());
+                write_varint(body, scope->objects.size());
+                for (auto& object : scope->objects) {
+                    write_node_ref(object.lock());
+                }
+                write_scope_ref(scope->branch);
+                write_scope_ref(scope->next);
+                write_scope_ref(scope->prev.lock());
+                body.push_back(scope->branch_root ? 1 : 0);
+                write_loc(scope->loc);
+            }
+            std::string out;
+            out.reserve(body.size() + nodes.size() * 2 + 64);
+            out.append(binary_ast_magic);
+            write_varint(out, binary_ast_version);
+            write_varint(out, strings.size());
+            for (auto& s : strings) {
+                write_varint(out, s.size());
+                out.append(s);
+            }
+            write_varint(out, file_strings.size());
+            for (auto f : file_strings) {
+                write_varint(out, f);
+            }
+            write_varint(out, error_string);
+            write_varint(out, nodes.size());
+            for (auto& node : nodes) {
+                write_varint(out, size_t(node->node_type));
+            }
+            write_varint(out, scopes.size());
+            out.append(body);
+            return out;
+        }
+
+        result<BinaryASTFile> decode(std::string_view data) {
+            clear();
+            if (!is_binary_ast(data)) {
+                return unexpect(error({}, "not a binary ast: magic mismatch"));
+            }
+            Reader r{data, binary_ast_magic.size()};
+            auto version = r.varint();
+            if (version != binary_ast_version) {
+                return unexpect(error({}, "unsupported binary ast version ", nums(version), " (expected ", nums(binary_ast_version), ")"));
+            }
+            auto string_count = r.varint();
+            for (size_t i = 0; i < string_count && r.ok; i++) {
+                auto len = r.varint();
+                string_table.push_back(std::string(r.bytes(len)));
+            }
+            BinaryASTFile file;
+            auto file_count = r.varint();
+            for (size_t i = 0; i < file_count && r.ok; i++) {
+                auto s = read_string(r);
+                if (!s) {
+                    return unexpect(std::move(s.error()));
+                }
+                file.files.push_back(std::move(*s));
+            }
+            if (auto err = r.varint(); err != 0) {
+                if (err > string_table.size()) {
+                    return unexpect(error({}, "string index out of range: ", nums(err - 1)));
+                }
+                file.error_json = string_table[err - 1];
+            }
+            auto node_count = r.varint();
+            if (!r.ok || node_count > data.size()) {
+                return unexpect(error({}, "broken binary ast header"));
+            }
+            nodes.reserve(node_count);
+            for (size_t i = 0; i < node_count; i++) {
+                auto type = NodeType(r.varint());
+                std::shared_ptr<Node> node;
+                get_node(type, [&](auto n) {
+                    using NodeT = typename decltype(n)::node;
+                    if constexpr (!decltype(n)::is_abs) {
+                        node = std::make_shared<NodeT>();
+                    }
+                });
+                if (!r.ok || !node) {
+                    return unexpect(error({}, "invalid node type at node ", nums(i)));
+                }
+                nodes.push_back(std::move(node));
+            }
+            auto scope_count = r.varint();
+            if (!r.ok || scope_count > data.size()) {
+                return unexpect(error({}, "broken binary ast header"));
+            }
+            for (size_t i = 0; i < scope_count; i++) {
+                scopes.push_back(std::make_shared<Scope>());
+            }
+            for (auto& node : nodes) {
+                result<void> res;
+                visit(node, [&](auto&& f) {
+                    f->dump([&](std::string_view, auto& value) {
+                        if (!res) {
+                            return;
+                        }
+                        res = decode_field(r, f->loc, value);
+                    });
+                });
+                if (!res) {
+                    return unexpect(std::move(res.error()));
+                }
+                if (!r.ok) {
+                    return unexpect(error(node->loc, "unexpected end of binary ast"));
+                }
+            }
+            for (auto& scope : scopes) {
+                auto owner = read_node_ref(r, {});
+                if (!owner) {
+                    return unexpect(std::move(owner.error()));
+                }
+                scope->owner = *owner;
+                auto ident_count = r.varint();
+                for (size_t i = 0; i < ident_count && r.ok; i++) {
+                    auto ident = read_typed_ref<Ident>(r, {});
+                    if (!ident) {
+                        return unexpect(std::move(ident.error()));
+                    }
+                    scope->push(std::move(*ident));
+                }
+                std::shared_ptr<Scope> prev;
+                for (auto target : {&scope->branch, &scope->next, &prev}) {
+                    auto res = decode_field(r, {}, *target);
+                    if (!res) {
+                        return unexpect(std::move(res.error()));
+                    }
+                }
+                scope->prev = prev;
+                scope->branch_root = r.bytes(1) == std::string_view("\x01", 1);
+                scope->loc = read_loc(r);
+            }
+            if (!r.ok) {
+                return unexpect(error({}, "unexpected end of binary ast"));
+            }
+            if (r.pos != data.size()) {
+                return unexpect(error({}, "extra data at the end of binary ast"));
+            }
+            file.ast = nodes.size() ? nodes[0] : nullptr;
+            return file;
+        }
+    };
+
+}  // namespace brgen::ast
@@ -96,6 +96,11 @@ namespace brgen::ast {
         }
 
        public:
+        // number of distinct nodes written by last encode
+        size_t node_count() const {
+            return nodes.size();
+        }
+
         void clear() {
             node_index.clear();
             nodes.clear();
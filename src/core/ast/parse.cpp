@@ -346,7 +346,7 @@ namespace brgen::ast {
             <match> ::= "match" <expr>? <match branch>*
             <match branch> ::= <expr> [":" <indent block> | "=>" <statement>]
         */
-        std::shared_ptr<Match> parse_match(lexer::Token&& token) {
+        std::shared_ptr<Match> parse_match(lexer::TokenView&& token) {
             // Create a shared pointer for the Match
             auto match = std::make_shared<Match>(token.loc);
 
@@ -446,7 +446,7 @@ namespace brgen::ast {
         /*
             <if> ::= "if" <expr> <indent scope> ("elif" <expr> <block>)* ("else" <indent scope>)?
         */
-        std::shared_ptr<If> parse_if(lexer::Token&& token) {
+        std::shared_ptr<If> parse_if(lexer::TokenView&& token) {
             s.skip_white();
             auto if_ = std::make_shared<If>(token.loc);
 
@@ -559,10 +559,10 @@ namespace brgen::ast {
                     ident->usage = IdentUsage::bad_ident;
                     return ident;
                 }
-                return std::make_shared<Ident>(f->loc, std::move(f->token));
+                return std::make_shared<Ident>(f->loc, std::string(f->token));
             }
             auto token = s.must_consume_token(lexer::Tag::ident, hint);
-            return std::make_shared<Ident>(token.loc, std::move(token.token));
+            return std::make_shared<Ident>(token.loc, std::string(token.token));
         }
 
         std::shared_ptr<Ident> parse_ident(std::string_view hint) {
@@ -573,7 +573,7 @@ namespace brgen::ast {
             return ident;
         }
 
-        std::shared_ptr<Paren> parse_paren(lexer::Token&& token) {
+        std::shared_ptr<Paren> parse_paren(lexer::TokenView&& token) {
             auto paren = std::make_shared<Paren>(token.loc);
             s.skip_white();
             paren->expr = parse_expr();
@@ -583,8 +583,8 @@ namespace brgen::ast {
             return paren;
         }
 
-        std::shared_ptr<StrLiteral> parse_str_literal(lexer::Token&& lit) {
-            auto literal = std::make_shared<StrLiteral>(lit.loc, std::move(lit.token));
+        std::shared_ptr<StrLiteral> parse_str_literal(lexer::TokenView&& lit) {
+            auto literal = std::make_shared<StrLiteral>(lit.loc, std::string(lit.token));
             auto c = unescape(literal->value);
             if (!c) {
                 s.report_error(lit.loc, "invalid string literal");
@@ -596,12 +596,12 @@ namespace brgen::ast {
             return literal;
         }
 
-        std::shared_ptr<RegexLiteral> parse_regex_literal(lexer::Token&& lit) {
-            auto literal = std::make_shared<RegexLiteral>(lit.loc, std::move(lit.token));
+        std::shared_ptr<RegexLiteral> parse_regex_literal(lexer::TokenView&& lit) {
+            auto literal = std::make_shared<RegexLiteral>(lit.loc, std::string(lit.token));
             return literal;
         }
 
-        std::shared_ptr<TypeLiteral> parse_type_literal(lexer::Token&& lit) {
+        std::shared_ptr<TypeLiteral> parse_type_literal(lexer::TokenView&& lit) {
             s.skip_line();
             auto typ = parse_type(false);
             s.skip_line();
@@ -610,8 +610,8 @@ namespace brgen::ast {
             return literal;
         }
 
-        std::shared_ptr<CharLiteral> parse_char_literal(lexer::Token&& lit) {
-            auto literal = std::make_shared<CharLiteral>(lit.loc, std::move(lit.token));
+        std::shared_ptr<CharLiteral> parse_char_literal(lexer::TokenView&& lit) {
+            auto literal = std::make_shared<CharLiteral>(lit.loc, std::string(lit.token));
             auto c = unescape(literal->value);
             if (!c) {
                 s.report_error(lit.loc, "invalid char literal");
@@ -639,7 +639,7 @@ namespace brgen::ast {
         */
         std::shared_ptr<Expr> parse_prim(bool* line_skipped) {
             if (auto token = s.consume_token(lexer::Tag::int_literal)) {
-                return std::make_shared<IntLiteral>(token->loc, std::move(token->token));
+                return std::make_shared<IntLiteral>(token->loc, std::string(token->token));
             }
             if (auto b = s.consume_token(lexer::Tag::bool_literal)) {
                 return std::make_shared<BoolLiteral>(b->loc, b->token == "true");
@@ -724,7 +724,7 @@ namespace brgen::ast {
             }
         }
 
-        std::shared_ptr<Call> parse_call(lexer::Token&& token, std::shared_ptr<Expr>& p) {
+        std::shared_ptr<Call> parse_call(lexer::TokenView&& token, std::shared_ptr<Expr>& p) {
             auto call = std::make_shared<Call>(token.loc, std::move(p));
             s.skip_white();
             if (!s.expect_token(")")) {
@@ -737,7 +737,7 @@ namespace brgen::ast {
             return call;
         }
 
-        std::shared_ptr<Expr> parse_call_or_cast(lexer::Token&& token, std::shared_ptr<Expr>& p) {
+        std::shared_ptr<Expr> parse_call_or_cast(lexer::TokenView&& token, std::shared_ptr<Expr>& p) {
             auto call = parse_call(std::move(token), p);
             if (auto typ = ast::as<ast::TypeLiteral>(call->callee)) {
                 auto copy = typ->type_literal;
@@ -746,7 +746,7 @@ namespace brgen::ast {
             return call;
         }
 
-        std::shared_ptr<Index> parse_index(lexer::Token&& token, std::shared_ptr<Expr>& p) {
+        std::shared_ptr<Index> parse_index(lexer::TokenView&& token, std::shared_ptr<Expr>& p) {
             auto call = std::make_shared<Index>(token.loc, std::move(p));
             s.skip_white();
             call->index = parse_expr();
@@ -756,7 +756,7 @@ namespace brgen::ast {
             return call;
         }
 
-        std::shared_ptr<MemberAccess> parse_access(lexer::Token&& token, auto&& p) {
+        std::shared_ptr<MemberAccess> parse_access(lexer::TokenView&& token, auto&& p) {
             s.skip_white();
             auto ident = parse_ident_no_scope("member ident expected after '.'");
             ident->usage = IdentUsage::reference_member;
@@ -789,7 +789,7 @@ namespace brgen::ast {
             return p;
         }
 
-        std::optional<lexer::Token> consume_op(size_t& i, auto& ops) {
+        std::optional<lexer::TokenView> consume_op(size_t& i, auto& ops) {
             for (i = 0; i < ops.size(); i++) {
                 if constexpr (futils::helper::is_template_instance_of<std::decay_t<decltype(ops[i])>, std::pair>) {
                     if (auto t = s.consume_token(ops[i].second)) {
@@ -1095,7 +1095,7 @@ namespace brgen::ast {
         /*
             <loop> ::= "for" <expr>? (";" <expr>?)? (";" <expr>?)? <indent block>
         */
-        std::shared_ptr<Loop> parse_for(lexer::Token&& token) {
+        std::shared_ptr<Loop> parse_for(lexer::TokenView&& token) {
             auto for_ = std::make_shared<Loop>(token.loc);
             auto cs = state.cond_scope(for_->cond_scope, for_);
             s.skip_white();
@@ -1149,7 +1149,7 @@ namespace brgen::ast {
             <func type> ::= "fn" "(" (<type> ("," <type>)*)? ")" ("->" <type>)?
         */
         // fn (a :int,b :int) -> int
-        std::shared_ptr<FunctionType> parse_func_type(lexer::Token&& tok) {
+        std::shared_ptr<FunctionType> parse_func_type(lexer::TokenView&& tok) {
             auto func_type = std::make_shared<FunctionType>(tok.loc, true);
             s.skip_white();
             s.must_consume_token("(", "to open function type parameter list");
@@ -1223,7 +1223,7 @@ namespace brgen::ast {
                 return fmt->body->struct_type;
             }
 
-            lexer::Token ident;
+            lexer::TokenView ident;
 
             constexpr auto type_hint = "to specify type name, types are like `T`, `[]T`, `[x][10]T`, `fn(p :T,:U) -> T`, `\"magic_number\"`, `/regex/`, `imported.T`";
 
@@ -1232,7 +1232,7 @@ namespace brgen::ast {
                 if (!f) {
                     auto errs = s.token_error(lexer::Tag::ident, type_hint);
                     state.errors.locations.insert(state.errors.locations.end(), errs.locations.begin(), errs.locations.end());
-                    ident = lexer::Token{
+                    ident = lexer::TokenView{
                         .token = "$dummy",
                         .loc = s.loc(),
                     };
@@ -1253,7 +1253,7 @@ namespace brgen::ast {
                 return std::make_shared<FloatType>(ident.loc, desc->bit_size, desc->endian, true);
             }
 
-            auto base = std::make_shared<Ident>(ident.loc, std::move(ident.token));
+            auto base = std::make_shared<Ident>(ident.loc, std::string(ident.token));
             base->usage = IdentUsage::maybe_type;
             base->scope = state.current_scope();
 
@@ -1310,7 +1310,7 @@ namespace brgen::ast {
         */
         // may returns expr if not field
         std::shared_ptr<Node> parse_field(const std::shared_ptr<Expr>& expr, bool as_parameter) {
-            lexer::Token token;
+            lexer::TokenView token;
             std::shared_ptr<Ident> ident;
             if (expr) {
                 if (expr->node_type != NodeType::ident) {
@@ -1452,7 +1452,7 @@ namespace brgen::ast {
             return member;
         }
 
-        void parse_enum_base_type(std::shared_ptr<ast::Enum>& enum_, lexer::Token& base) {
+        void parse_enum_base_type(std::shared_ptr<ast::Enum>& enum_, lexer::TokenView& base) {
             s.skip_white();
             enum_->base_type = parse_type(false);
             enum_->enum_type->bit_size = enum_->base_type->bit_size;
@@ -1469,7 +1469,7 @@ namespace brgen::ast {
             <enum> ::= "enum" <ident> ":\r\n" (":"<type>)? <enum member>+
             <enum member> ::= <indent> <ident> ("=" <expr>)?
          */
-        std::shared_ptr<Enum> parse_enum(lexer::Token&& token) {
+        std::shared_ptr<Enum> parse_enum(lexer::TokenView&& token) {
             // set enum type
             auto enum_ = std::make_shared<Enum>(token.loc);
             s.skip_white();
@@ -1505,7 +1505,7 @@ namespace brgen::ast {
         /*
             <format> ::= "format" <ident> <indent block>
         */
-        std::shared_ptr<Format> parse_format(lexer::Token&& token, bool allow_anonymous) {
+        std::shared_ptr<Format> parse_format(lexer::TokenView&& token, bool allow_anonymous) {
             auto fmt = std::make_shared<Format>(token.loc);
             s.skip_white();
             auto ident_parse = [&] {
@@ -1601,7 +1601,7 @@ namespace brgen::ast {
         /*
             <state> ::= "state" <ident> <indent block>
         */
-        std::shared_ptr<State> parse_state(lexer::Token&& token) {
+        std::shared_ptr<State> parse_state(lexer::TokenView&& token) {
             auto state_ = std::make_shared<State>(token.loc);
             s.skip_white();
 
@@ -1623,7 +1623,7 @@ namespace brgen::ast {
         /*
             <fn> ::= "fn" <ident> "(" (<ident> : <type> ("," <ident > <type>)*)? ")" ("->" <type>)? <indent block>
         */
-        std::shared_ptr<Function> parse_fn(lexer::Token&& token) {
+        std::shared_ptr<Function> parse_fn(lexer::TokenView&& token) {
             auto fn = std::make_shared<Function>(token.loc);
             s.skip_white();
             fn->ident = parse_ident("function name expected");
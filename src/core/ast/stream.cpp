@@ -3,7 +3,7 @@
 
 namespace brgen::ast {
     void Stream::maybe_parse() {
-        if (cur == tokens.end()) {
+        if (cur == end_index()) {
             auto token = input->parse(lex_option);
             if (!token) {
                 return;
@@ -11,7 +11,7 @@ namespace brgen::ast {
             if (token->tag == lexer::Tag::error) {
                 token->loc.line = line;
                 token->loc.col = col;
-                error(token->loc, std::move(token->token)).report();
+                error(token->loc, token->token).report();
             }
             token->loc.line = line;
             token->loc.col = col;
@@ -21,41 +21,51 @@ namespace brgen::ast {
                 col = 1;
             }
             if (collect_comments && token->tag == lexer::Tag::comment) {
-                comments.push_back(std::make_shared<Comment>(token->loc, token->token));
+                comments.push_back(std::make_shared<Comment>(token->loc, std::string(token->token)));
             }
             tokens.push_back(std::move(*token));
-            cur = std::prev(tokens.end());
+            cur = end_index() - 1;
         }
     }
 
     lexer::Loc Stream::last_loc() {
         if (eos()) {
-            if (cur == tokens.begin()) {
+            if (cur == base) {
                 return lexer::Loc{lexer::Pos{0, 0}, input->index(), 1, 1};
             }
-            auto copy = cur;
-            copy--;
-            return {lexer::Pos{copy->loc.pos.end, copy->loc.pos.end + 1}, copy->loc.file, copy->loc.line, copy->loc.col};
+            auto& prev = at(cur - 1);
+            return {lexer::Pos{prev.loc.pos.end, prev.loc.pos.end + 1}, prev.loc.file, prev.loc.line, prev.loc.col};
         }
         else {
-            return cur->loc;
+            return at(cur).loc;
         }
     }
 
     void Stream::shrink() {
-        tokens.erase(tokens.begin(), prev_skip_pos ? *prev_skip_pos : cur);
+        auto new_base = prev_skip_pos ? *prev_skip_pos : cur;
+        tokens.erase(tokens.begin(), tokens.begin() + (new_base - base));
+        base = new_base;
+        if (last_skip && *last_skip < base) {
+            last_skip.reset();
+        }
     }
 
     std::list<lexer::Token> Stream::take() {
-        auto copy = std::move(tokens);
+        std::list<lexer::Token> list;
+        for (auto& token : tokens) {
+            list.push_back(token.to_token());
+        }
+        base = end_index();
         tokens.clear();
-        cur = tokens.begin();
-        return copy;
+        cur = base;
+        last_skip.reset();
+        prev_skip_pos.reset();
+        return list;
     }
 
     bool Stream::eos() {
         maybe_parse();
-        return cur == tokens.end();
+        return cur == end_index();
     }
 
     void Stream::consume() {
@@ -71,55 +81,57 @@ namespace brgen::ast {
         if (eos()) {
             return last_loc();
         }
-        return cur->loc;
+        return at(cur).loc;
     }
 
     bool Stream::expect_token(lexer::Tag tag) {
         if (eos()) {
             return false;
         }
-        return cur->tag == tag;
+        return at(cur).tag == tag;
     }
 
     bool Stream::expect_token(std::string_view s) {
         if (eos()) {
             return false;
         }
-        return cur->token == s;
+        return at(cur).token == s;
     }
 
-    std::optional<lexer::Token> Stream::peek_token(std::string_view s) {
+    const lexer::TokenView* Stream::peek_token(std::string_view s) {
         if (!expect_token(s)) {
-            return std::nullopt;
+            return nullptr;
         }
-        // only copy for fallback
-        return *cur;
+        return &at(cur);
     }
 
-    std::optional<lexer::Token> Stream::peek_token(lexer::Tag t) {
+    const lexer::TokenView* Stream::peek_token(lexer::Tag t) {
         if (!expect_token(t)) {
-            return std::nullopt;
+            return nullptr;
         }
-        // only copy for fallback
-        return *cur;
+        return &at(cur);
     }
 
-    lexer::Token Stream::peek_token() {
-        return *cur;
+    const lexer::TokenView& Stream::peek_token() {
+        return at(cur);
     }
 
-    std::optional<lexer::Token> Stream::consume_token(std::string_view s) {
+    std::optional<lexer::TokenView> Stream::consume_token(std::string_view s) {
         if (auto token = peek_token(s)) {
+            // copy because backward() may revisit consumed token. text is not copied
+            std::optional<lexer::TokenView> copy{*token};
             consume();
-            return token;
+            return copy;
         }
         return std::nullopt;
     }
 
-    std::optional<lexer::Token> Stream::consume_token(lexer::Tag t) {
+    std::optional<lexer::TokenView> Stream::consume_token(lexer::Tag t) {
         if (auto token = peek_token(t)) {
+            // copy because backward() may revisit consumed token. text is not copied
+            std::optional<lexer::TokenView> copy{*token};
             consume();
-            return token;
+            return copy;
         }
         return std::nullopt;
     }
@@ -131,17 +143,18 @@ namespace brgen::ast {
             append(buf, "`<EOF>`");
         }
         else {
-            appends(buf, "`", cur->token, "`(kind: ", lexer::enum_array<lexer::Tag>[int(cur->tag)].second, ")");
-            if (cur->token == "]") {
+            auto& found = at(cur);
+            appends(buf, "`", found.token, "`(kind: ", lexer::enum_array<lexer::Tag>[int(found.tag)].second, ")");
+            if (found.token == "]") {
                 appends(buf, ", did you forget opening bracket `[`?");
             }
-            else if (cur->token == ">") {
+            else if (found.token == ">") {
                 appends(buf, ", did you forget opening angle bracket `<`?");
             }
-            else if (cur->token == ")") {
+            else if (found.token == ")") {
                 appends(buf, ", did you forget opening parenthesis `(`?");
             }
-            else if (cur->token == "{" || cur->token == "}") {
+            else if (found.token == "{" || found.token == "}") {
                 appends(buf, ", this language uses python-like blocks, so `{}` is not used.");
             }
         }
@@ -151,7 +164,7 @@ namespace brgen::ast {
 
         auto err = error(last_loc(), std::move(buf));
         if (last_skip) {
-            return err.error((*last_skip)->loc, "when parsing started here");
+            return err.error(at(*last_skip).loc, "when parsing started here");
         }
         return err;
     }
@@ -164,7 +177,7 @@ namespace brgen::ast {
         return token_expect_error(s, "literally", hint);
     }
 
-    lexer::Token Stream::must_consume_token(std::string_view view, std::string_view hint) {
+    lexer::TokenView Stream::must_consume_token(std::string_view view, std::string_view hint) {
         auto f = consume_token(view);
         if (!f) {
             token_error(view, hint).report();
@@ -172,7 +185,7 @@ namespace brgen::ast {
         return *f;
     }
 
-    lexer::Token Stream::must_consume_token(lexer::Tag tag, std::string_view hint) {
+    lexer::TokenView Stream::must_consume_token(lexer::Tag tag, std::string_view hint) {
         auto f = consume_token(tag);
         if (!f) {
             token_error(tag, hint).report();
@@ -219,7 +232,7 @@ namespace brgen::ast {
         }
         maybe_parse();
         if (cur == prev_skip_pos) {
-            if (!eos() && cur->tag == lexer::Tag::punct) {
+            if (!eos() && at(cur).tag == lexer::Tag::punct) {
                 consume();
                 return;
             }
@@ -243,17 +256,17 @@ namespace brgen::ast {
     }
 
     void Stream::backward() {
-        if (cur == tokens.begin()) {
+        if (cur == base) {
             return;
         }
         cur--;
     }
 
-    std::optional<lexer::Token> Stream::prev_token() {
-        if (cur == tokens.begin()) {
-            return std::nullopt;
+    const lexer::TokenView* Stream::prev_token() {
+        if (cur == base) {
+            return nullptr;
         }
-        return *std::prev(cur);
+        return &at(cur - 1);
     }
 
     void Stream::set_collect_comments(bool b) {
@@ -3,6 +3,7 @@
 #include "../lexer/token.h"
 #include "../lexer/lexer.h"
 #include <list>
+#include <deque>
 #include <optional>
 #include <helper/defer.h>
 #include <code/src_location.h>
@@ -17,29 +18,43 @@ namespace brgen::ast {
 
     struct Stream {
        private:
-        std::list<lexer::Token> tokens;
-        using iterator = typename std::list<lexer::Token>::iterator;
-        iterator cur;
-        std::optional<iterator> last_skip;
+        // tokens are stored in block-contiguous storage and referred by absolute index.
+        // appending lookahead does not invalidate references returned by peek_token/prev_token
+        // (they are valid until shrink())
+        // token text is a view of input (see lexer::parse_one), so lexing and consume_token do not copy it.
+        // it is valid while input is alive; parser copies text into ast nodes
+        std::deque<lexer::TokenView> tokens;
+        size_t base = 0;  // absolute index of tokens.front()
+        size_t cur = 0;
+        std::optional<size_t> last_skip;
         File* input;
         size_t line = 1;
         size_t col = 1;
         std::vector<std::shared_ptr<Comment>> comments;
         bool collect_comments = false;
         lexer::Option lex_option;
-        std::optional<iterator> prev_skip_pos;
+        std::optional<size_t> prev_skip_pos;
 
         Stream() = default;
         friend struct Context;
 
         void maybe_parse();
 
+        size_t end_index() const {
+            return base + tokens.size();
+        }
+
+        lexer::TokenView& at(size_t index) {
+            return tokens[index - base];
+        }
+
         lexer::Loc last_loc();
 
        public:
         // discard tokens before cur
         void shrink();
 
+        // owning copies of tokens, for callers which keep them beyond input
         std::list<lexer::Token> take();
 
         [[noreturn]] void report_error(auto&&... data) {
@@ -60,15 +75,16 @@ namespace brgen::ast {
         bool expect_token(lexer::Tag tag);
         bool expect_token(std::string_view s);
 
-        std::optional<lexer::Token> peek_token(std::string_view s);
+        // returns reference to stored token instead of copy. nullptr if not matched
+        const lexer::TokenView* peek_token(std::string_view s);
 
-        std::optional<lexer::Token> peek_token(lexer::Tag t);
+        const lexer::TokenView* peek_token(lexer::Tag t);
 
-        lexer::Token peek_token();
+        const lexer::TokenView& peek_token();
 
-        std::optional<lexer::Token> consume_token(std::string_view s);
+        std::optional<lexer::TokenView> consume_token(std::string_view s);
 
-        std::optional<lexer::Token> consume_token(lexer::Tag t);
+        std::optional<lexer::TokenView> consume_token(lexer::Tag t);
 
        private:
         [[nodiscard]] LocationError token_expect_error(std::string_view expected, const char* kind, std::string_view hint);
@@ -78,9 +94,9 @@ namespace brgen::ast {
 
         [[nodiscard]] LocationError token_error(std::string_view s, std::string_view hint);
 
-        lexer::Token must_consume_token(std ::string_view view, std::string_view hint);
+        lexer::TokenView must_consume_token(std ::string_view view, std::string_view hint);
 
-        lexer::Token must_consume_token(lexer::Tag tag, std::string_view hint);
+        lexer::TokenView must_consume_token(lexer::Tag tag, std::string_view hint);
 
        private:
         void skip_tag(auto... t);
@@ -104,7 +120,7 @@ namespace brgen::ast {
         std::shared_ptr<Node> get_comments();
 
         void backward();
-        std::optional<lexer::Token> prev_token();
+        const lexer::TokenView* prev_token();
 
         void set_collect_comments(bool b);
 
@@ -113,7 +129,7 @@ namespace brgen::ast {
        private:
         auto enter_stream(auto&& fn) -> result<std::invoke_result_t<decltype(fn), Stream&>> {
             try {
-                cur = tokens.begin();
+                cur = base;
                 return fn(*this);
             } catch (LocationError& err) {
                 return unexpect(std::move(err));
@@ -37,6 +37,9 @@ namespace brgen::ast::tool {
         }
         if (auto lty = ast::as<ast::ArrayType>(left)) {
             auto rty = ast::as<ast::ArrayType>(right);
+            if (lty == rty) {
+                return true;  // same node (e.g. pooled by ast::tool::TypePool)
+            }
             if (!equal_type(lty->element_type, rty->element_type)) {
                 return false;
             }
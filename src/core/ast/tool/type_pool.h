@@ -0,0 +1,106 @@
+/*license*/
+#pragma once
+#include <core/ast/ast.h>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace brgen::ast::tool {
+
+    // TypePool interns types synthesized by middle passes (e.g. u64 of `.length`, bool of comparison)
+    // so that structurally identical types share one node.
+    // only non-explicit types are pooled; types written in source keep their own node
+    // because their loc is used for diagnostics and language server.
+    // loc of pooled type is the loc of its first request, so use loc_of() to report diagnostics about it
+    struct TypePool {
+       private:
+        std::unordered_map<std::uint64_t, std::shared_ptr<Type>> scalars;
+        // key: (element type, length_value or ~0 for unknown length)
+        std::map<std::pair<const Type*, size_t>, std::shared_ptr<ArrayType>> arrays;
+        std::unordered_set<const Type*> pooled;
+        size_t requested = 0;
+
+        static constexpr std::uint64_t scalar_key(NodeType type, size_t bit_size, Endian endian, bool is_signed) {
+            return (std::uint64_t(type) << 48) | (std::uint64_t(endian) << 41) | (std::uint64_t(is_signed) << 40) | std::uint64_t(bit_size);
+        }
+
+        template <class T>
+        std::shared_ptr<T> intern(std::uint64_t key, auto&& make) {
+            requested++;
+            auto& slot = scalars[key];
+            if (!slot) {
+                slot = make();
+                pooled.insert(slot.get());
+            }
+            return std::static_pointer_cast<T>(slot);
+        }
+
+       public:
+        std::shared_ptr<IntType> int_type(lexer::Loc loc, size_t bit_size, Endian endian, bool is_signed) {
+            return intern<IntType>(scalar_key(NodeType::int_type, bit_size, endian, is_signed), [&] {
+                return std::make_shared<IntType>(loc, bit_size, endian, is_signed);
+            });
+        }
+
+        std::shared_ptr<FloatType> float_type(lexer::Loc loc, size_t bit_size, Endian endian) {
+            return intern<FloatType>(scalar_key(NodeType::float_type, bit_size, endian, false), [&] {
+                return std::make_shared<FloatType>(loc, bit_size, endian);
+            });
+        }
+
+        std::shared_ptr<BoolType> bool_type(lexer::Loc loc) {
+            return intern<BoolType>(scalar_key(NodeType::bool_type, 0, Endian::unspec, false), [&] {
+                return std::make_shared<BoolType>(loc);
+            });
+        }
+
+        std::shared_ptr<VoidType> void_type(lexer::Loc loc) {
+            return intern<VoidType>(scalar_key(NodeType::void_type, 0, Endian::unspec, false), [&] {
+                return std::make_shared<VoidType>(loc);
+            });
+        }
+
+        // array without length expression. if element is not pooled, creates new node
+        std::shared_ptr<ArrayType> array_type(lexer::Loc loc, lexer::Loc end_loc, std::shared_ptr<Type> element, std::optional<size_t> length_value = std::nullopt) {
+            auto make = [&] {
+                auto arr = std::make_shared<ArrayType>(loc, nullptr, end_loc, std::move(element));
+                arr->length_value = length_value;
+                return arr;
+            };
+            if (!element || !is_pooled(element.get())) {
+                return make();
+            }
+            requested++;
+            auto& slot = arrays[{element.get(), length_value.value_or(~size_t(0))}];
+            if (!slot) {
+                slot = make();
+                pooled.insert(slot.get());
+            }
+            return slot;
+        }
+
+        bool is_pooled(const Type* t) const {
+            return pooled.contains(t);
+        }
+
+        // location to report diagnostics about t.
+        // pooled type does not have per-use location so fallback is used
+        lexer::Loc loc_of(const std::shared_ptr<Type>& t, lexer::Loc fallback) const {
+            if (!t || is_pooled(t.get())) {
+                return fallback;
+            }
+            return t->loc;
+        }
+
+        // number of distinct pooled types
+        size_t size() const {
+            return pooled.size();
+        }
+
+        // number of requests; requests - size() nodes are saved
+        size_t requests() const {
+            return requested;
+        }
+    };
+
+}  // namespace brgen::ast::tool
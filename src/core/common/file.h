@@ -22,8 +22,8 @@ namespace brgen {
         friend bool make_file_from_text(File& file, T&& t);
 
         template <class TokenBuf, class T>
-        static std::optional<lexer::Token> do_parse(void* ptr, std::uint64_t file, lexer::Option opt) {
-            return lexer::parse_one<TokenBuf>(*static_cast<futils::Sequencer<T>*>(ptr), file, opt);
+        static std::optional<lexer::TokenView> do_parse(void* ptr, std::uint64_t file, lexer::Option opt, lexer::TokenArena& arena) {
+            return lexer::parse_one<TokenBuf>(*static_cast<futils::Sequencer<T>*>(ptr), file, opt, arena);
         }
 
         template <class DumpBuf, class T>
@@ -46,7 +46,9 @@ namespace brgen {
         bool special = false;
         fs::path file_name;
         std::shared_ptr<void> ptr;
-        std::optional<lexer::Token> (*parse_)(void* seq, std::uint64_t file, lexer::Option opt) = nullptr;
+        std::optional<lexer::TokenView> (*parse_)(void* seq, std::uint64_t file, lexer::Option opt, lexer::TokenArena& arena) = nullptr;
+        // text of tokens which are not slices of the source (see lexer::parse_one)
+        std::unique_ptr<lexer::TokenArena> arena = std::make_unique<lexer::TokenArena>();
         std::pair<std::string, futils::code::SrcLoc> (*dump_)(void* seq, lexer::Pos pos) = nullptr;
 
         futils::view::rvec (*direct)(void* seq) = nullptr;
@@ -83,9 +85,10 @@ namespace brgen {
             return special;
         }
 
-        std::optional<lexer::Token> parse(lexer::Option option) {
+        // returned token refers to this file's source or arena
+        std::optional<lexer::TokenView> parse(lexer::Option option) {
             if (parse_) {
-                return parse_(ptr.get(), file, option);
+                return parse_(ptr.get(), file, option, *arena);
             }
             return std::nullopt;
         }
@@ -150,7 +153,17 @@ namespace brgen {
         UtfMode input_mode = UtfMode::utf8;
         UtfMode interpret_mode = UtfMode::utf8;
 
-        void set_input_with_mode(File& f, auto&& buffer) {
+        // converts whole input to utf8 once, so that tokens can be views of it instead of per token copies
+        static std::string to_utf8_text(auto&& view) {
+            std::string text;
+            text.reserve(view.size());
+            for (size_t i = 0; i < view.size(); i++) {
+                text.push_back(view[i]);
+            }
+            return text;
+        }
+
+        void set_input_with_mode(File& f, auto&& buffer) const {
             if (input_mode == interpret_mode) {
                 switch (input_mode) {
                     case UtfMode::utf8:
@@ -190,7 +203,7 @@ namespace brgen {
                 assert(sizeof(buffer[1]) == 2);
                 switch (interpret_mode) {
                     case UtfMode::utf8:
-                        make_file_from_text<std::string>(f, futils::utf::U8View<std::decay_t<decltype(buffer)>>(std::forward<decltype(buffer)>(buffer)));
+                        make_file_from_text<std::string>(f, to_utf8_text(futils::utf::U8View<std::decay_t<decltype(buffer)>>(std::forward<decltype(buffer)>(buffer))));
                         break;
                     case UtfMode::utf32:
                         make_file_from_text<std::u32string>(f, futils::utf::U32View<std::decay_t<decltype(buffer)>>(std::forward<decltype(buffer)>(buffer)));
@@ -205,7 +218,7 @@ namespace brgen {
                 assert(sizeof(buffer[1]) == 4);
                 switch (interpret_mode) {
                     case UtfMode::utf8:
-                        make_file_from_text<std::string>(f, futils::utf::U8View<std::decay_t<decltype(buffer)>>(std::forward<decltype(buffer)>(buffer)));
+                        make_file_from_text<std::string>(f, to_utf8_text(futils::utf::U8View<std::decay_t<decltype(buffer)>>(std::forward<decltype(buffer)>(buffer))));
                         break;
                     case UtfMode::utf16:
                         make_file_from_text<std::u16string>(f, futils::utf::U16View<std::decay_t<decltype(buffer)>>(std::forward<decltype(buffer)>(buffer)));
@@ -220,7 +233,7 @@ namespace brgen {
             __builtin_unreachable();
         }
 
-        void set_file_with_input_mode(File& file, auto&& view) {
+        void set_file_with_input_mode(File& file, auto&& view) const {
             static_assert(sizeof(view[1]) == 1);
             using View = std::decay_t<decltype(view)>;
             using futils::binary::EndianView;
@@ -279,7 +292,8 @@ namespace brgen {
             return files.size();
         }
 
-        expected<lexer::FileIndex, std::error_code> add_file(const auto& name, bool allow_duplicate = false, fs::path base_path = {}) {
+        // canonical path of name as add_file resolves it
+        static expected<fs::path, std::error_code> resolve_path(const auto& name, const fs::path& base_path = {}) {
             fs::path path = futils::utf::convert<std::u8string>(name);
             if (!base_path.empty() && path.is_relative()) {
                 path = base_path / path;
@@ -292,20 +306,61 @@ namespace brgen {
             if (!fs::is_regular_file(path, err)) {
                 return unexpect(err);
             }
+            return path;
+        }
+
+        // index of registered (non special) file equivalent to canonical path
+        expected<std::optional<lexer::FileIndex>, std::error_code> find_file(const fs::path& path) {
+            std::error_code err;
             for (auto it = files.begin(); it != files.end(); it++) {
                 if (it->second.special) {
                     continue;
                 }
                 if (fs::equivalent(it->second.file_name, path, err)) {
-                    if (allow_duplicate) {
-                        return it->second.file;
-                    }
-                    return unexpect(std::error_code(int(std::errc::file_exists), std::generic_category()));
+                    return it->second.file;
                 }
                 else if (err) {
                     return unexpect(err);
                 }
             }
+            return std::nullopt;
+        }
+
+        // index the next add_file/add_special will assign
+        lexer::FileIndex next_index() const {
+            return index + 1;
+        }
+
+        // open file at canonical path as if it was registered with index fd, without registering it.
+        // reads only input modes, so it can be called from multiple threads
+        std::unique_ptr<File> open_detached(const fs::path& path, lexer::FileIndex fd) const {
+            futils::file::View v;
+            if (!v.open(path.c_str())) {
+                return nullptr;
+            }
+            auto file = std::make_unique<File>();
+            file->file = fd;
+            file->file_name = path;
+            set_file_with_input_mode(*file, std::move(v));
+            return file;
+        }
+
+        expected<lexer::FileIndex, std::error_code> add_file(const auto& name, bool allow_duplicate = false, fs::path base_path = {}) {
+            auto resolved = resolve_path(name, base_path);
+            if (!resolved) {
+                return unexpect(resolved.error());
+            }
+            auto path = std::move(*resolved);
+            auto found = find_file(path);
+            if (!found) {
+                return unexpect(found.error());
+            }
+            if (*found) {
+                if (allow_duplicate) {
+                    return **found;
+                }
+                return unexpect(std::error_code(int(std::errc::file_exists), std::generic_category()));
+            }
             File file;
             file.file_name = std::move(path);
             file.file = index + 1;
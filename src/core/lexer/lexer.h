@@ -9,6 +9,7 @@
 #include <comb2/composite/string.h>
 #include "token.h"
 #include <optional>
+#include <concepts>
 
 namespace brgen::lexer {
 
@@ -193,22 +194,31 @@ format Varint:
         bool regex_mode = false;
     };
 
+    // buffer which the lexer can slice token text from directly
+    template <class T>
+    concept contiguous_source = requires(const T& t) {
+        { t.data() } -> std::convertible_to<const void*>;
+        requires sizeof(*t.data()) == 1;
+    };
+
+    // token text is a view of seq's buffer if it holds utf8 contiguously,
+    // otherwise it is copied (and converted to utf8 if TokenBuf is not std::string) into arena once
     template <class TokenBuf = std::string, class T>
-    std::optional<Token> parse_one(futils::Sequencer<T>& seq, std::uint64_t file, Option opt) {
+    std::optional<TokenView> parse_one(futils::Sequencer<T>& seq, std::uint64_t file, Option opt, TokenArena& arena) {
         internal::Option option;
         option.regex_mode = opt.regex_mode;
         auto ctx = futils::comb2::LexContext<Tag, std::string>{};
         if (auto res = internal::parse_one(seq, ctx, option); res != futils::comb2::Status::match) {
             if (res == futils::comb2::Status::fatal) {
-                Token tok;
+                TokenView tok;
                 tok.tag = Tag::error;
                 tok.loc.file = file;
                 tok.loc.pos = {seq.rptr, seq.rptr + 1};
-                tok.token = std::move(ctx.errbuf);
+                tok.token = arena.store(ctx.errbuf);
                 return tok;
             }
             if (!seq.eos()) {
-                Token tok;
+                TokenView tok;
                 tok.tag = Tag::error;
                 tok.loc.file = file;
                 tok.loc.pos = {seq.rptr, seq.rptr + 1};
@@ -217,25 +227,34 @@ format Varint:
             }
             return std::nullopt;
         }
-        Token tok;
+        TokenView tok;
         tok.tag = ctx.str_tag;
         tok.loc.file = file;
         tok.loc.pos = ctx.str_pos;
-        seq.rptr = ctx.str_pos.begin;
-        TokenBuf buf;
-        buf.resize(ctx.str_pos.len());
-        auto ptr = buf.data();
-        for (; seq.rptr < ctx.str_pos.end; seq.rptr++) {
-            *ptr++ = seq.buf.buffer[seq.rptr];  // HACK(on-keyday): use buffer directly
-        }
-        if constexpr (std::is_same_v<TokenBuf, std::string>) {
-            tok.token = std::move(buf);
+        seq.rptr = ctx.str_pos.end;
+        if constexpr (std::is_same_v<TokenBuf, std::string> && contiguous_source<T>) {
+            tok.token = std::string_view(reinterpret_cast<const char*>(seq.buf.buffer.data()) + ctx.str_pos.begin, ctx.str_pos.len());
         }
         else {
-            auto err = futils::utf::convert<0, 1>(buf, tok.token, false, false);
-            if (!err) {
-                tok.tag = Tag::error;
-                tok.token = "invalid utf sequence";
+            TokenBuf buf;
+            buf.resize(ctx.str_pos.len());
+            auto ptr = buf.data();
+            for (auto i = ctx.str_pos.begin; i < ctx.str_pos.end; i++) {
+                *ptr++ = seq.buf.buffer[i];  // HACK(on-keyday): use buffer directly
+            }
+            if constexpr (std::is_same_v<TokenBuf, std::string>) {
+                tok.token = arena.store(buf);
+            }
+            else {
+                arena.scratch.clear();
+                auto err = futils::utf::convert<0, 1>(buf, arena.scratch, false, false);
+                if (!err) {
+                    tok.tag = Tag::error;
+                    tok.token = "invalid utf sequence";
+                }
+                else {
+                    tok.token = arena.store(arena.scratch);
+                }
             }
         }
         return tok;
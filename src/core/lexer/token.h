@@ -2,8 +2,12 @@
 #pragma once
 #include <comb2/pos.h>
 #include <string>
+#include <string_view>
+#include <memory>
+#include <vector>
 #include "lexer_enum.h"
 #include <cstdint>
+#include <algorithm>
 
 namespace brgen::lexer {
     using Pos = futils::comb2::Pos;
@@ -41,6 +45,58 @@ namespace brgen::lexer {
         Loc loc;
     };
 
+    // token produced by lexer. token refers to the source buffer of the file,
+    // or to the file's TokenArena when the text is not in utf8 there (see parse_one).
+    // valid while the File it was lexed from is alive; to_token makes an owning copy
+    struct TokenView {
+        Tag tag = Tag::unknown;
+        std::string_view token;
+        Loc loc;
+
+        Token to_token() const {
+            return Token{tag, std::string(token), loc};
+        }
+    };
+
+    // append-only storage for token text which is not a slice of the source.
+    // text is never moved, so views into it stay valid until the arena is destroyed
+    struct TokenArena {
+       private:
+        static constexpr size_t chunk_size = 4096;
+        std::vector<std::unique_ptr<char[]>> chunks;
+        size_t used = chunk_size;
+
+        char* allocate(size_t size) {
+            if (size > chunk_size) {
+                // own chunk; current chunk keeps filling up for following tokens
+                auto big = std::make_unique<char[]>(size);
+                auto ptr = big.get();
+                chunks.insert(chunks.end() - (chunks.empty() ? 0 : 1), std::move(big));
+                return ptr;
+            }
+            if (chunk_size - used < size) {
+                chunks.push_back(std::make_unique<char[]>(chunk_size));
+                used = 0;
+            }
+            auto ptr = chunks.back().get() + used;
+            used += size;
+            return ptr;
+        }
+
+       public:
+        // scratch buffer for utf conversion, reused to avoid allocation per token
+        std::string scratch;
+
+        std::string_view store(std::string_view text) {
+            if (text.empty()) {
+                return {};
+            }
+            auto ptr = allocate(text.size());
+            std::copy(text.begin(), text.end(), ptr);
+            return std::string_view(ptr, text.size());
+        }
+    };
+
     constexpr void as_json(const Token& token, auto&& buf) {
         auto field = buf.object();
         field("tag", token.tag);
@@ -3,11 +3,13 @@
 #include <core/ast/traverse.h>
 #include <core/common/error.h>
 #include "core/ast/node/type.h"
+#include <core/ast/tool/type_pool.h>
 
 namespace brgen::middle {
 
     result<void> resolve_available(auto& node) {
-        auto f = [](auto&& f, auto& node) -> void {
+        ast::tool::TypePool types;
+        auto f = [&](auto&& f, auto& node) -> void {
             // traverse child first
             ast::traverse(node, [&](auto& n) {
                 f(f, n);
@@ -34,12 +36,12 @@ namespace brgen::middle {
                     auto t = p->arguments[0];
                     if (ident->ident == "available") {
                         auto a = std::make_shared<ast::Available>(ident->loc, std::move(t), ast::cast_to<ast::Call>(std::move(node)));
-                        a->expr_type = std::make_shared<ast::BoolType>(ident->loc);
+                        a->expr_type = types.bool_type(ident->loc);
                         node = std::move(a);
                     }
                     else {
                         auto a = std::make_shared<ast::SizeOf>(ident->loc, std::move(t), ast::cast_to<ast::Call>(std::move(node)));
-                        a->expr_type = std::make_shared<ast::IntType>(ident->loc, 64, ast::Endian::unspec, false);
+                        a->expr_type = types.int_type(ident->loc, 64, ast::Endian::unspec, false);
                         node = std::move(a);
                     }
                 }
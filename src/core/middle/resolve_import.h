@@ -6,6 +6,12 @@
 #include "../ast/parse.h"
 #include "../ast/tool/extract_config.h"
 #include "replacer.h"
+#include <map>
+#if __has_include(<thread>) && !defined(__EMSCRIPTEN__)
+#include <thread>
+#include <atomic>
+#define BRGEN_IMPORT_HAS_THREAD
+#endif
 
 namespace brgen::middle {
     struct PathInfo {
@@ -64,10 +70,211 @@ namespace brgen::middle {
         }
     };
 
+    // parse result of imported file prepared before import replacement
+    struct ParsedImport {
+        fs::path path;  // canonical path the file was parsed from
+        result<std::shared_ptr<ast::Program>> program;
+        LocationError warnings;  // err_or_warn of this parse. merged when the import is reached
+    };
+
+    // pre-parsed imports keyed by the file index predicted for them.
+    // resolve_import uses an entry only if FileSet actually assigns that index to the same path
+    using ImportCache = std::map<lexer::FileIndex, ParsedImport>;
+
+    namespace internal {
+        inline void collect_import_paths(const std::shared_ptr<ast::Node>& root, std::vector<std::string>& paths) {
+            auto f = [&](auto&& f, NodeReplacer n) -> void {
+                auto node = n.to_node();
+                ast::traverse(node, [&](auto& g) {
+                    f(f, g);
+                });
+                auto conf = ast::tool::extract_config(node, ast::tool::ExtractMode::call);
+                if (!conf || conf->name != "config.import" || conf->arguments.size() != 1 ||
+                    conf->arguments[0]->node_type != ast::NodeType::str_literal) {
+                    return;  // invalid one is reported by resolve_import
+                }
+                auto path = unescape(ast::cast_to<ast::StrLiteral>(conf->arguments[0])->value);
+                if (!path) {
+                    return;
+                }
+                paths.push_back(std::move(*path));
+            };
+            auto node = root;
+            f(f, node);
+        }
+
+        // run fn(0) ... fn(n - 1) on up to jobs threads (0 = hardware concurrency)
+        inline void parallel_for(size_t n, size_t jobs, auto&& fn) {
+#ifdef BRGEN_IMPORT_HAS_THREAD
+            if (jobs == 0) {
+                jobs = std::thread::hardware_concurrency();
+            }
+            jobs = std::min(jobs, n);
+            if (jobs > 1) {
+                std::atomic_size_t next = 0;
+                auto worker = [&] {
+                    for (auto i = next++; i < n; i = next++) {
+                        fn(i);
+                    }
+                };
+                std::vector<std::thread> threads;
+                for (size_t i = 1; i < jobs; i++) {
+                    threads.emplace_back(worker);
+                }
+                worker();
+                for (auto& t : threads) {
+                    t.join();
+                }
+                return;
+            }
+#endif
+            for (size_t i = 0; i < n; i++) {
+                fn(i);
+            }
+        }
+
+        // paths of config.import("...") in source order, found by lexing only.
+        // this is a prediction; resolve_import still decides on the parsed tree
+        inline std::vector<std::string> scan_import_paths(File& file) {
+            std::vector<std::string> paths;
+            constexpr std::string_view pattern[] = {"config", ".", "import", "("};
+            size_t matched = 0;
+            while (auto token = file.parse(lexer::Option{})) {
+                if (token->tag == lexer::Tag::space || token->tag == lexer::Tag::line ||
+                    token->tag == lexer::Tag::indent || token->tag == lexer::Tag::comment) {
+                    continue;
+                }
+                if (matched == std::size(pattern)) {
+                    if (token->tag == lexer::Tag::str_literal) {
+                        if (auto path = unescape(token->token)) {
+                            paths.push_back(std::move(*path));
+                        }
+                    }
+                    matched = 0;
+                }
+                else if (token->token == pattern[matched]) {
+                    matched++;
+                    continue;
+                }
+                matched = token->token == pattern[0] ? 1 : 0;
+            }
+            return paths;
+        }
+    }  // namespace internal
+
+    // parse imported files ahead of resolve_import on multiple threads without registering them to FileSet.
+    // 1. the import graph is discovered wave by wave by lexing files in parallel
+    // 2. files are numbered in the depth-first order resolve_import registers them in,
+    //    so each file is parsed with the index it will get (file indexes and src2json "files" do not depend on jobs)
+    // 3. every file is parsed once in parallel
+    // if the prediction is wrong for a file (e.g. an import written in an unusual form), resolve_import parses it serially
+    inline void prepare_imports(const std::shared_ptr<ast::Program>& root, FileSet& files, ImportCache& cache, ast::ParseOption option = {}, size_t jobs = 0) {
+        auto root_input = files.get_input(root->loc.file);
+        if (!root_input) {
+            return;
+        }
+        struct Node {
+            fs::path path;
+            std::vector<size_t> imports;  // index of nodes in source order
+        };
+        std::vector<Node> nodes;
+        std::map<fs::path, size_t> node_index;
+        auto add_node = [&](fs::path path) {
+            auto [it, inserted] = node_index.emplace(path, nodes.size());
+            if (inserted) {
+                nodes.push_back(Node{std::move(path)});
+            }
+            return std::pair{it->second, inserted};
+        };
+        {
+            std::vector<std::string> paths;
+            internal::collect_import_paths(root, paths);
+            add_node(root_input->path());
+            for (auto& p : paths) {
+                if (auto resolved = FileSet::resolve_path(p, root_input->path().parent_path())) {
+                    nodes[0].imports.push_back(add_node(std::move(*resolved)).first);
+                }
+            }
+        }
+        // 1. discover
+        std::vector<size_t> frontier;
+        for (size_t i = 1; i < nodes.size(); i++) {
+            frontier.push_back(i);
+        }
+        while (frontier.size()) {
+            std::vector<std::vector<std::string>> scanned(frontier.size());
+            internal::parallel_for(frontier.size(), jobs, [&](size_t i) {
+                if (auto file = files.open_detached(nodes[frontier[i]].path, lexer::builtin)) {
+                    scanned[i] = internal::scan_import_paths(*file);
+                }
+            });
+            std::vector<size_t> next;
+            for (size_t i = 0; i < frontier.size(); i++) {
+                auto base = nodes[frontier[i]].path.parent_path();
+                for (auto& p : scanned[i]) {
+                    auto resolved = FileSet::resolve_path(p, base);
+                    if (!resolved) {
+                        continue;
+                    }
+                    auto [index, inserted] = add_node(std::move(*resolved));
+                    nodes[frontier[i]].imports.push_back(index);
+                    if (inserted) {
+                        next.push_back(index);
+                    }
+                }
+            }
+            frontier = std::move(next);
+        }
+        // 2. number files in depth-first order. already registered files (e.g. root) keep their index
+        std::vector<std::pair<size_t, lexer::FileIndex>> order;
+        std::vector<bool> visited(nodes.size());
+        auto next_index = files.next_index();
+        auto visit = [&](auto&& visit, size_t n) -> void {
+            for (auto child : nodes[n].imports) {
+                if (visited[child]) {
+                    continue;
+                }
+                visited[child] = true;
+                auto registered = files.find_file(nodes[child].path);
+                if (!registered) {
+                    return;  // resolve_import reports it
+                }
+                if (!*registered) {
+                    order.emplace_back(child, next_index++);
+                }
+                visit(visit, child);
+            }
+        };
+        visited[0] = true;
+        visit(visit, 0);
+        // 3. parse
+        std::vector<ParsedImport*> outs;
+        for (auto& [n, index] : order) {
+            auto& out = cache[index];
+            out.path = nodes[n].path;
+            outs.push_back(&out);
+        }
+        internal::parallel_for(order.size(), jobs, [&](size_t i) {
+            auto input = files.open_detached(outs[i]->path, order[i].second);
+            if (!input) {
+                outs[i]->program = unexpect(error({}, "cannot open file ", outs[i]->path.generic_u8string()));
+                return;
+            }
+            ast::Context c;
+            outs[i]->program = c.enter_stream(input.get(), [&](ast::Stream& s) {
+                return ast::parse(s, &outs[i]->warnings, option);
+            });
+        });
+    }
+
     inline result<void> resolve_import(
         std::shared_ptr<ast::Program>& n,
-        FileSet& fs, brgen::LocationError& err_or_warn, ast::ParseOption option = {}) {
+        FileSet& fs, brgen::LocationError& err_or_warn, ast::ParseOption option = {}, size_t jobs = 0) {
         PathStack stack;
+        ImportCache cache;
+        if (jobs != 1) {
+            prepare_imports(n, fs, cache, option, jobs);
+        }
         auto l = fs.get_input(n->loc.file);
         if (!l) {
             return unexpect(error(n->loc, "cannot open file at index ", nums(n->loc.file)));
@@ -117,10 +324,19 @@ namespace brgen::middle {
                     n.replace(std::make_shared<ast::Import>(ast::cast_to<ast::Call>(n.to_node()), std::move(found), std::move(as_str)));
                 }
                 else {
-                    ast::Context c;
-                    auto p = c.enter_stream(new_input, [&](ast::Stream& s) {
-                        return ast::parse(s, &err_or_warn, option);
-                    });
+                    result<std::shared_ptr<ast::Program>> p;
+                    if (auto pre = cache.find(*res); pre != cache.end() && pre->second.path == new_path) {
+                        auto& w = pre->second.warnings.locations;
+                        err_or_warn.locations.insert(err_or_warn.locations.end(), std::make_move_iterator(w.begin()), std::make_move_iterator(w.end()));
+                        p = std::move(pre->second.program);
+                        cache.erase(pre);
+                    }
+                    else {
+                        ast::Context c;
+                        p = c.enter_stream(new_input, [&](ast::Stream& s) {
+                            return ast::parse(s, &err_or_warn, option);
+                        });
+                    }
                     if (!p) {
                         auto err = error(conf->loc, "cannot parse file ", new_path.generic_u8string());
                         for (LocationEntry& ent : p.error().locations) {
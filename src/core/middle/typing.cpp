@@ -7,6 +7,7 @@
 #include "../ast/tool/eval.h"
 #include "size_eval.h"
 #include <core/ast/tool/compare.h>
+#include <core/ast/tool/type_pool.h>
 #include <algorithm>
 #include <list>
 #include <memory>
@@ -22,6 +23,9 @@ namespace brgen::middle {
 
         std::unordered_set<ast::Ident*> recurse_detect;
 
+        // synthesized types are shared via this pool
+        ast::tool::TypePool types;
+
         std::shared_ptr<ast::Type> unwrap_ident_type(const std::shared_ptr<ast::Type>& typ) {
             if (auto ident = ast::as<ast::IdentType>(typ)) {
                 return ident->base.lock();
@@ -62,25 +66,25 @@ namespace brgen::middle {
 
        private:
         auto void_type(lexer::Loc loc) {
-            return std::make_shared<ast::VoidType>(loc);
+            return types.void_type(loc);
         }
 
         [[noreturn]] void report_not_equal_type(lexer::Loc loc, const std::shared_ptr<ast::Type>& lty, const std::shared_ptr<ast::Type>& rty) {
             auto l = ast::tool::type_to_string(lty);
             auto r = ast::tool::type_to_string(rty);
-            error(loc, "type mismatch").error(lty->loc, "type not equal here ", l).error(rty->loc, "and here ", r).report();
+            error(loc, "type mismatch").error(types.loc_of(lty, loc), "type not equal here ", l).error(types.loc_of(rty, loc), "and here ", r).report();
         }
 
         [[noreturn]] void report_not_comparable_type(lexer::Loc loc, const std::shared_ptr<ast::Type>& lty, const std::shared_ptr<ast::Type>& rty) {
             auto l = ast::tool::type_to_string(lty);
             auto r = ast::tool::type_to_string(rty);
-            error(loc, "type mismatch").error(lty->loc, "type not comparable here ", l).error(rty->loc, "and here ", r).report();
+            error(loc, "type mismatch").error(types.loc_of(lty, loc), "type not comparable here ", l).error(types.loc_of(rty, loc), "and here ", r).report();
         }
 
         [[noreturn]] void report_not_have_common_type(lexer::Loc loc, const std::shared_ptr<ast::Type>& lty, const std::shared_ptr<ast::Type>& rty) {
             auto l = ast::tool::type_to_string(lty);
             auto r = ast::tool::type_to_string(rty);
-            error(loc, "cannot determine common type").error(lty->loc, "type not have common type here ", l).error(rty->loc, "and here ", r).report();
+            error(loc, "cannot determine common type").error(types.loc_of(lty, loc), "type not have common type here ", l).error(types.loc_of(rty, loc), "and here ", r).report();
         }
 
         [[noreturn]] void unsupported(auto&& expr) {
@@ -115,7 +119,7 @@ namespace brgen::middle {
         std::shared_ptr<ast::Type> int_literal_to_int_type(const std::shared_ptr<ast::Type>& base) {
             if (auto ty = ast::as<ast::IntLiteralType>(base)) {
                 auto aligned = ty->get_aligned_bit();
-                return std::make_shared<ast::IntType>(ty->loc, aligned, ast::Endian::unspec, false);
+                return types.int_type(ty->loc, aligned, ast::Endian::unspec, false);
             }
             return base;
         }
@@ -128,7 +132,7 @@ namespace brgen::middle {
                 auto bit_size = lty->bit_size;
                 if (ity->bit_size < *bit_size) {
                     error(lty->loc, "bit size ", nums(*bit_size), " is too large")
-                        .error(ity->loc, "for this")
+                        .error(types.loc_of(a, lty->loc), "for this")
                         .report();
                 }
                 b = a;  // fitting
@@ -297,7 +301,7 @@ namespace brgen::middle {
                 }
                 // `for x in "hello"`, x is u8 type
                 else if (auto str = ast::as<ast::StrLiteralType>(new_type)) {
-                    auto u8 = std::make_shared<ast::IntType>(str->loc, 8, ast::Endian::unspec, false);
+                    auto u8 = types.int_type(str->loc, 8, ast::Endian::unspec, false);
                     left_ident->expr_type = std::move(u8);
                     left_ident->usage = ast::IdentUsage::define_const;
                     left_ident->constant_level = ast::ConstantLevel::immutable_variable;
@@ -728,14 +732,14 @@ namespace brgen::middle {
                     if (!comparable_type(lty, rty)) {
                         report_not_comparable_type(b->loc, lty, rty);
                     }
-                    b->expr_type = std::make_shared<ast::BoolType>(b->loc);
+                    b->expr_type = types.bool_type(b->loc);
                     return;
                 }
                 case ast::BinaryOp::logical_and:
                 case ast::BinaryOp::logical_or: {
                     if (lty->node_type == ast::NodeType::bool_type &&
                         rty->node_type == ast::NodeType::bool_type) {
-                        b->expr_type = std::make_shared<ast::BoolType>(b->loc);
+                        b->expr_type = types.bool_type(b->loc);
                         return;
                     }
                     report_binary_error();
@@ -1148,7 +1152,7 @@ namespace brgen::middle {
             auto arr_ty = ast::as<ast::ArrayType>(idx->expr->expr_type);
             if (!arr_ty) {
                 error(idx->expr->loc, "expect array type but not")
-                    .error(idx->expr->expr_type->loc, "type is ", ast::node_type_to_string(idx->expr->expr_type->node_type))
+                    .error(types.loc_of(idx->expr->expr_type, idx->expr->loc), "type is ", ast::node_type_to_string(idx->expr->expr_type->node_type))
                     .report();
             }
             idx->expr_type = arr_ty->element_type;
@@ -1159,7 +1163,7 @@ namespace brgen::middle {
             if (auto arr = ast::as<ast::ArrayType>(selector->target->expr_type)) {
                 if (selector->member->ident == "length") {
                     selector->member->usage = ast::IdentUsage::reference_builtin_fn;
-                    selector->expr_type = std::make_shared<ast::IntType>(selector->loc, 64, ast::Endian::unspec, false);
+                    selector->expr_type = types.int_type(selector->loc, 64, ast::Endian::unspec, false);
                     selector->constant_level = arr->length_value ? ast::ConstantLevel::constant : ast::ConstantLevel::immutable_variable;
                     return;  // length is a builtin function of array
                 }
@@ -1171,7 +1175,7 @@ namespace brgen::middle {
                 if (auto enum_ = ast::as<ast::EnumType>(ident->base.lock())) {
                     if (selector->member->ident == "is_defined") {
                         selector->member->usage = ast::IdentUsage::reference_builtin_fn;
-                        selector->expr_type = std::make_shared<ast::BoolType>(selector->loc);
+                        selector->expr_type = types.bool_type(selector->loc);
                         selector->constant_level = selector->target->constant_level;
                         return;  // is_defined is a builtin function of enum
                     }
@@ -1181,7 +1185,7 @@ namespace brgen::middle {
                     .report();
             }
             error(selector->target->loc, "expect struct type but not")
-                .error(selector->target->expr_type->loc, "type is ", ast::node_type_to_string(selector->target->expr_type->node_type))
+                .error(types.loc_of(selector->target->expr_type, selector->target->loc), "type is ", ast::node_type_to_string(selector->target->expr_type->node_type))
                 .report();
         }
 
@@ -1386,7 +1390,7 @@ namespace brgen::middle {
                 case ast::IOMethod::input_remain:
                 case ast::IOMethod::input_scope_length:
                 case ast::IOMethod::input_bit_offset:
-                    io->expr_type = std::make_shared<ast::IntType>(io->loc, 64, ast::Endian::unspec, false);
+                    io->expr_type = types.int_type(io->loc, 64, ast::Endian::unspec, false);
                     io->constant_level = ast::ConstantLevel::immutable_variable;
                     break;
                 case ast::IOMethod::output_put:
@@ -1426,7 +1430,7 @@ namespace brgen::middle {
                         // TODO(on-keyday): check integer type?
                     }
                     if (io->expr_type == nullptr) {
-                        io->expr_type = std::make_shared<ast::IntType>(io->loc, 8, ast::Endian::unspec, false);
+                        io->expr_type = types.int_type(io->loc, 8, ast::Endian::unspec, false);
                     }
                     break;
                 }
@@ -1435,7 +1439,7 @@ namespace brgen::middle {
                 case ast::IOMethod::config_endian_native:
                 case ast::IOMethod::config_bit_order_lsb:
                 case ast::IOMethod::config_bit_order_msb: {
-                    io->expr_type = std::make_shared<ast::IntType>(io->loc, 8, ast::Endian::unspec, false);
+                    io->expr_type = types.int_type(io->loc, 8, ast::Endian::unspec, false);
                     io->constant_level = ast::ConstantLevel::constant;
                     break;
                 }
@@ -1450,9 +1454,8 @@ namespace brgen::middle {
                         typing_expr(arg, true);
                         io->arguments.push_back(arg);
                     }
-                    auto u8_ty = std::make_shared<ast::IntType>(io->loc, 8, ast::Endian::unspec, false);
-                    auto arr_ty = std::make_shared<ast::ArrayType>(io->loc, nullptr, io->loc, std::move(u8_ty));
-                    io->expr_type = std::move(arr_ty);
+                    auto u8_ty = types.int_type(io->loc, 8, ast::Endian::unspec, false);
+                    io->expr_type = types.array_type(io->loc, io->loc, std::move(u8_ty));
                     break;
                 }
             }
@@ -1508,7 +1511,7 @@ namespace brgen::middle {
             }
 
             if (auto lit = ast::as<ast::BoolLiteral>(expr)) {
-                lit->expr_type = std::make_shared<ast::BoolType>(lit->loc);
+                lit->expr_type = types.bool_type(lit->loc);
                 lit->constant_level = ast::ConstantLevel::constant;
                 return true;
             }
@@ -1532,7 +1535,7 @@ namespace brgen::middle {
 
             if (auto ch = ast::as<ast::CharLiteral>(expr)) {
                 auto bit = ast::aligned_bit(futils::binary::log2i(ch->code));
-                expr->expr_type = std::make_shared<ast::IntType>(ch->loc, bit, ast::Endian::unspec, false);
+                expr->expr_type = types.int_type(ch->loc, bit, ast::Endian::unspec, false);
                 expr->constant_level = ast::ConstantLevel::constant;
                 return true;
             }
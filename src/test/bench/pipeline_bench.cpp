@@ -0,0 +1,333 @@
+/*license*/
+// frontend part of pipeline benchmark (see script/pipeline_bench.py)
+// runs every .bgn under given directory through lexer, parser, each middle pass
+// of src2json's parse_and_analyze and json dump, and prints timing/allocation as json.
+// output is then loaded back as tool/common/load_json.h does (json_load), and the same ast
+// is encoded/decoded as binary ast (binary_encode/binary_decode, see core/ast/binary.h)
+// to compare time and size (json_bytes/binary_bytes) of both formats
+#define BRGEN_ALLOC_HOOK_DEFINE
+#include "../testutil/alloc_hook.h"
+#include "../testutil/peak_rss.h"
+#include <core/ast/parse.h>
+#include <core/ast/json.h>
+#include <core/ast/binary.h>
+#include <core/ast/file.h>
+#include <json/parse.h>
+#include <core/middle/resolve_import.h>
+#include <core/middle/resolve_available.h>
+#include <core/middle/replace_assert.h>
+#include <core/middle/replace_order_spec.h>
+#include <core/middle/replace_error.h>
+#include <core/middle/resolve_io_operation.h>
+#include <core/middle/replace_metadata.h>
+#include <core/middle/resolve_state_dependency.h>
+#include <core/middle/typing.h>
+#include <core/middle/type_attribute.h>
+#include <core/middle/analyze_block_trait.h>
+#include <core/middle/monomorphize.h>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+
+using namespace brgen;
+
+struct Phase {
+    std::string name;
+    std::uint64_t wall_ns = 0;
+    size_t allocs = 0;
+    size_t alloc_bytes = 0;
+};
+
+struct FileResult {
+    std::string file;
+    bool ok = true;
+    std::string error;
+    std::vector<Phase> phases;
+    size_t ast_nodes = 0;  // distinct nodes in json output
+    size_t json_bytes = 0;
+    size_t binary_bytes = 0;
+};
+
+struct Runner {
+    FileResult& result;
+    FileSet& files;
+
+    // fn returns true if succeeded
+    bool phase(const char* name, auto&& fn) {
+        if (!result.ok) {
+            return false;
+        }
+        testutil::AllocScope scope;
+        auto begin = std::chrono::steady_clock::now();
+        bool ok = false;
+        try {
+            ok = fn();
+        } catch (LocationError& e) {
+            result.error = to_source_error(files)(std::move(e)).to_string();
+            ok = false;
+        } catch (std::exception& e) {
+            result.error = e.what();
+            ok = false;
+        }
+        auto end = std::chrono::steady_clock::now();
+        auto count = scope.get();
+        result.phases.push_back(Phase{
+            .name = name,
+            .wall_ns = std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()),
+            .allocs = count.count,
+            .alloc_bytes = count.bytes,
+        });
+        if (!ok) {
+            result.ok = false;
+            if (result.error.empty()) {
+                result.error = std::string(name) + " failed";
+            }
+        }
+        return ok;
+    }
+};
+
+// same order as parse_and_analyze in src2json.cpp with default flags
+FileResult run_file(const std::filesystem::path& path, const std::filesystem::path& ast_out) {
+    FileResult result;
+    result.file = path.generic_string();
+    FileSet files;
+    auto index = files.add_file(path.generic_u8string());
+    if (!index) {
+        result.ok = false;
+        result.error = index.error().message();
+        return result;
+    }
+    auto input = files.get_input(*index);
+    Runner r{result, files};
+    LocationError warns;
+    std::shared_ptr<ast::Program> p;
+    auto check = [&](auto&& res) {
+        if (!res) {
+            result.error = to_source_error(files)(std::move(res.error())).to_string();
+            return false;
+        }
+        return true;
+    };
+    r.phase("lex", [&] {
+        // separate file because the file keeps its read position after lexing
+        FileSet lex_files;
+        auto lex_index = lex_files.add_file(path.generic_u8string());
+        if (!lex_index) {
+            result.error = lex_index.error().message();
+            return false;
+        }
+        ast::Context c;
+        return check(c.enter_stream(lex_files.get_input(*lex_index), [&](ast::Stream& s) {
+            while (!s.eos()) {
+                s.consume();
+            }
+            return true;
+        }));
+    });
+    r.phase("parse", [&] {
+        ast::Context c;
+        auto res = c.enter_stream(input, [&](ast::Stream& s) {
+            return ast::parse(s, &warns, {});
+        });
+        if (!check(res)) {
+            return false;
+        }
+        p = std::move(*res);
+        return true;
+    });
+    r.phase("resolve_import", [&] {
+        return check(middle::resolve_import(p, files, warns, {}));
+    });
+    r.phase("resolve_available", [&] {
+        return check(middle::resolve_available(p));
+    });
+    r.phase("replace_specify_order", [&] {
+        middle::replace_specify_order(p);
+        return true;
+    });
+    r.phase("replace_explicit_error", [&] {
+        return check(middle::replace_explicit_error(p));
+    });
+    r.phase("resolve_io_operation", [&] {
+        return check(middle::resolve_io_operation(p));
+    });
+    r.phase("replace_metadata", [&] {
+        middle::replace_metadata(p);
+        return true;
+    });
+    r.phase("replace_assert", [&] {
+        middle::replace_assert(p);
+        return true;
+    });
+    r.phase("analyze_type", [&] {
+        return check(middle::analyze_type(p, &warns));
+    });
+    r.phase("monomorphize", [&] {
+        middle::monomorphize(p, &warns);
+        return true;
+    });
+    r.phase("collect_unused_warnings", [&] {
+        middle::collect_unused_warnings(p, warns);
+        return true;
+    });
+    r.phase("mark_recursive_reference", [&] {
+        middle::mark_recursive_reference(p);
+        return true;
+    });
+    r.phase("detect_non_dynamic_type", [&] {
+        middle::detect_non_dynamic_type(p);
+        return true;
+    });
+    r.phase("analyze_size_alignment", [&] {
+        middle::evaluate_sizeof(p);
+        middle::analyze_bit_size_and_alignment(p);
+        middle::evaluate_sizeof(p);
+        return true;
+    });
+    r.phase("resolve_state_dependency", [&] {
+        middle::resolve_state_dependency(p);
+        return true;
+    });
+    r.phase("analyze_block_trait", [&] {
+        middle::analyze_block_trait(p);
+        return true;
+    });
+    JSONWriter out;
+    r.phase("json_dump", [&] {
+        ast::JSONConverter c;
+        c.obj.set_no_colon_space(true);
+        c.encode(p);
+        result.ast_nodes = c.node_count();
+        // same layout as src2json output
+        auto field = out.object();
+        field("success", true);
+        field("files", files.file_list());
+        field("ast", c.obj);
+        field("error", nullptr);
+        result.json_bytes = out.out().size();
+        return true;
+    });
+    r.phase("json_load", [&] {
+        auto js = futils::json::parse<futils::json::JSON>(out.out());
+        ast::AstFile file;
+        if (js.is_undef() || !futils::json::convert_from_json(js, file) || !file.ast) {
+            return false;
+        }
+        ast::JSONConverter c;
+        auto res = c.decode(*file.ast);
+        return check(res) && *res != nullptr;
+    });
+    std::string bin;
+    r.phase("binary_encode", [&] {
+        ast::BinaryConverter c;
+        bin = c.encode(p, files.file_list());
+        result.binary_bytes = bin.size();
+        return true;
+    });
+    r.phase("binary_decode", [&] {
+        ast::BinaryConverter c;
+        auto res = c.decode(bin);
+        return check(res) && res->ast != nullptr;
+    });
+    if (result.ok && !ast_out.empty()) {
+        std::ofstream ofs(ast_out, std::ios::binary);
+        ofs << out.out();
+    }
+    return result;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <example dir> [--ast-out <dir>]\n";
+        return 2;
+    }
+    std::filesystem::path dir = argv[1];
+    std::filesystem::path ast_out_dir;
+    for (int i = 2; i < argc; i++) {
+        if (std::string_view(argv[i]) == "--ast-out" && i + 1 < argc) {
+            ast_out_dir = argv[++i];
+        }
+    }
+    std::vector<std::filesystem::path> paths;
+    for (auto& entry : std::filesystem::recursive_directory_iterator(dir)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".bgn") {
+            paths.push_back(entry.path());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+    std::vector<FileResult> results;
+    for (auto& path : paths) {
+        std::filesystem::path ast_out;
+        if (!ast_out_dir.empty()) {
+            ast_out = ast_out_dir / std::filesystem::relative(path, dir);
+            ast_out.replace_extension(".json");
+            std::filesystem::create_directories(ast_out.parent_path());
+        }
+        results.push_back(run_file(path, ast_out));
+    }
+    std::map<std::string, Phase> total;
+    size_t total_ast_nodes = 0;
+    size_t total_json_bytes = 0;
+    size_t total_binary_bytes = 0;
+    JSONWriter d;
+    {
+        auto field = d.object();
+        field("tool", "pipeline_bench");
+        field("files", [&] {
+            auto field = d.array();
+            for (auto& r : results) {
+                field([&] {
+                    auto field = d.object();
+                    field("file", r.file);
+                    field("ok", r.ok);
+                    if (!r.ok) {
+                        field("error", r.error);
+                    }
+                    field("ast_nodes", r.ast_nodes);
+                    total_ast_nodes += r.ast_nodes;
+                    field("json_bytes", r.json_bytes);
+                    field("binary_bytes", r.binary_bytes);
+                    total_json_bytes += r.json_bytes;
+                    total_binary_bytes += r.binary_bytes;
+                    field("phases", [&] {
+                        auto field = d.array();
+                        for (auto& ph : r.phases) {
+                            auto& t = total[ph.name];
+                            t.wall_ns += ph.wall_ns;
+                            t.allocs += ph.allocs;
+                            t.alloc_bytes += ph.alloc_bytes;
+                            field([&] {
+                                auto field = d.object();
+                                field("name", ph.name);
+                                field("wall_ns", ph.wall_ns);
+                                field("allocs", ph.allocs);
+                                field("alloc_bytes", ph.alloc_bytes);
+                            });
+                        }
+                    });
+                });
+            }
+        });
+        field("total", [&] {
+            auto field = d.object();
+            for (auto& [name, t] : total) {
+                field(name, [&] {
+                    auto field = d.object();
+                    field("wall_ns", t.wall_ns);
+                    field("allocs", t.allocs);
+                    field("alloc_bytes", t.alloc_bytes);
+                });
+            }
+        });
+        field("total_ast_nodes", total_ast_nodes);
+        field("total_json_bytes", total_json_bytes);
+        field("total_binary_bytes", total_binary_bytes);
+        field("peak_rss", testutil::peak_rss());
+    }
+    std::cout << d.out() << "\n";
+    return 0;
+}
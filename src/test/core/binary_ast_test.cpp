@@ -0,0 +1,34 @@
+/*license*/
+#include "ast_test_component.h"
+#include "middle_test.h"
+#include <gtest/gtest.h>
+#include <core/ast/json.h>
+#include <core/ast/binary.h>
+using namespace brgen;
+
+int main(int argc, char** argv) {
+    set_test_handler([](auto a, auto in, auto fs) {
+        LocationError warns;
+        middle::test::apply_middle(warns, a)
+            .transform_error(to_source_error(fs))
+            .value();
+        ast::JSONConverter m;
+        m.encode(a);
+        auto base = m.obj.out();
+        ast::BinaryConverter b;
+        auto bin = b.encode(a, {"test"});
+        ASSERT_TRUE(ast::is_binary_ast(bin));
+        ASSERT_LT(bin.size(), base.size());
+        auto d = b.decode(bin)
+                     .transform_error(to_source_error(fs))
+                     .value();
+        ASSERT_EQ(d.files, std::vector<std::string>{"test"});
+        ASSERT_FALSE(d.error_json);
+        m.encode(d.ast);
+        ASSERT_EQ(base, m.obj.out());
+        // truncated input must be rejected, not crash
+        ASSERT_FALSE(b.decode(std::string_view(bin).substr(0, bin.size() / 2)));
+    });
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
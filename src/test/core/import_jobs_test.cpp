@@ -0,0 +1,100 @@
+/*license*/
+#include <gtest/gtest.h>
+#include <core/middle/resolve_import.h>
+#include <core/ast/json.h>
+#include <env/env_sys.h>
+#include <filesystem>
+#include <fstream>
+
+using namespace brgen;
+namespace fs = std::filesystem;
+
+// same as src2json --import-jobs <jobs> up to import resolution: "files" and "ast" of the output
+std::string resolve_with_jobs(const fs::path& path, size_t jobs) {
+    FileSet files;
+    auto index = files.add_file(path.generic_u8string());
+    if (!index) {
+        return "cannot add file";
+    }
+    ast::Context c;
+    LocationError err_or_warn;
+    auto prog = c.enter_stream(files.get_input(*index), [&](ast::Stream& s) {
+        return ast::parse(s, &err_or_warn);
+    });
+    if (!prog) {
+        return "parse error";
+    }
+    auto res = middle::resolve_import(*prog, files, err_or_warn, {}, jobs);
+    JSONWriter d;
+    {
+        auto field = d.object();
+        field("files", files.file_list());
+        field("ok", bool(res));
+        field("warnings", err_or_warn.locations.size());
+    }
+    ast::JSONConverter conv;
+    conv.encode(*prog);
+    return d.out() + conv.obj.out();
+}
+
+void expect_same_for_jobs(const fs::path& path) {
+    auto serial = resolve_with_jobs(path, 1);
+    EXPECT_EQ(serial, resolve_with_jobs(path, 0)) << path;
+    EXPECT_EQ(serial, resolve_with_jobs(path, 4)) << path;
+}
+
+void write_file(const fs::path& path, std::string_view text) {
+    fs::create_directories(path.parent_path());
+    std::ofstream(path, std::ios::binary) << text;
+}
+
+TEST(ImportJobs, DepthFirstOrderOnDiamond) {
+    auto dir = fs::temp_directory_path() / "brgen_import_jobs_test";
+    fs::remove_all(dir);
+    // root -> a -> c -> e, a -> d, root -> b -> d, b -> e, b -> sub/f
+    // serial resolution registers root, a, c, e, d, b, f
+    write_file(dir / "root.bgn", "a ::= config.import(\"a.bgn\")\nb ::= config.import(\"b.bgn\")\nformat R:\n    x :u8\n");
+    write_file(dir / "a.bgn", "c ::= config.import(\"c.bgn\")\nd ::= config.import(\"d.bgn\")\nformat A:\n    x :u8\n");
+    write_file(dir / "b.bgn", "# config.import(\"unused.bgn\")\nd ::= config.import(\"d.bgn\")\ne ::= config.import(\"e.bgn\")\nf ::= config.import(\"sub/f.bgn\")\nformat B:\n    x :u8\n");
+    write_file(dir / "c.bgn", "e ::= config.import(\"e.bgn\")\nformat C:\n    x :u8\n");
+    write_file(dir / "d.bgn", "format D:\n    x :u8\n");
+    write_file(dir / "e.bgn", "format E:\n    x :u8\n");
+    write_file(dir / "sub/f.bgn", "e ::= config.import(\"../e.bgn\")\nformat F:\n    x :u8\n");
+    write_file(dir / "unused.bgn", "format U:\n    x :u8\n");
+    expect_same_for_jobs(dir / "root.bgn");
+
+    FileSet files;
+    auto index = files.add_file((dir / "root.bgn").generic_u8string());
+    ASSERT_TRUE(index);
+    ast::Context c;
+    LocationError warns;
+    auto prog = c.enter_stream(files.get_input(*index), [&](ast::Stream& s) {
+        return ast::parse(s, &warns);
+    });
+    ASSERT_TRUE(prog);
+    ASSERT_TRUE(middle::resolve_import(*prog, files, warns, {}, 4));
+    std::vector<std::string> names;
+    for (auto& f : files.file_list()) {
+        names.push_back(fs::path(f).filename().string());
+    }
+    EXPECT_EQ(names, (std::vector<std::string>{"root.bgn", "a.bgn", "c.bgn", "e.bgn", "d.bgn", "b.bgn", "f.bgn"}));
+    fs::remove_all(dir);
+}
+
+TEST(ImportJobs, ExamplesWithImports) {
+    auto base = fs::path(futils::env::sys::env_getter().get_or<std::string>("BASE_PATH", ".")) / "example";
+    size_t checked = 0;
+    for (auto& entry : fs::recursive_directory_iterator(base)) {
+        if (!entry.is_regular_file() || entry.path().extension() != ".bgn") {
+            continue;
+        }
+        std::ifstream in(entry.path());
+        std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        if (text.find("config.import") == std::string::npos) {
+            continue;
+        }
+        expect_same_for_jobs(entry.path());
+        checked++;
+    }
+    EXPECT_GT(checked, 0);
+}
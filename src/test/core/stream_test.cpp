@@ -0,0 +1,175 @@
+/*license*/
+#define BRGEN_ALLOC_HOOK_DEFINE
+#include "../testutil/alloc_hook.h"
+#include <gtest/gtest.h>
+#include <core/ast/parse.h>
+#include <core/ast/stream.h>
+#include <env/env_sys.h>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+
+using namespace brgen;
+
+void with_stream(auto text, auto&& fn) {
+    File file;
+    make_file_from_text<std::string>(file, text);
+    ast::Context c;
+    auto r = c.enter_stream(&file, [&](ast::Stream& s) {
+        fn(s);
+        return true;
+    });
+    ASSERT_TRUE(r);
+}
+
+TEST(Stream, PeekReferenceIsStableWhileLookahead) {
+    with_stream("format A:\n    a :u8\n    b :u16\n", [](ast::Stream& s) {
+        auto fmt = s.peek_token("format");
+        ASSERT_TRUE(fmt);
+        auto& stored = s.peek_token();
+        ASSERT_EQ(fmt, &stored);
+        s.consume();
+        // push many tokens into storage
+        while (!s.eos()) {
+            s.consume();
+        }
+        ASSERT_EQ(fmt->token, "format");
+        ASSERT_EQ(fmt->loc.line, 1);
+    });
+}
+
+TEST(Stream, BackwardAndPrevToken) {
+    with_stream("a b", [](ast::Stream& s) {
+        ASSERT_FALSE(s.prev_token());
+        auto a = s.consume_token(lexer::Tag::ident);
+        ASSERT_TRUE(a);
+        ASSERT_EQ(a->token, "a");
+        ASSERT_TRUE(s.prev_token());
+        ASSERT_EQ(s.prev_token()->token, "a");
+        s.skip_space();
+        ASSERT_TRUE(s.expect_token("b"));
+        s.backward();
+        ASSERT_TRUE(s.expect_token(lexer::Tag::space));
+        s.backward();
+        s.backward();  // no-op at begin
+        ASSERT_TRUE(s.expect_token("a"));
+    });
+}
+
+TEST(Stream, RecoverToPrevSkip) {
+    with_stream("a   b", [](ast::Stream& s) {
+        s.consume();
+        s.skip_space();
+        ASSERT_TRUE(s.expect_token("b"));
+        s.recover_to_prev_skip();
+        ASSERT_TRUE(s.expect_token(lexer::Tag::space));
+    });
+}
+
+TEST(Stream, TokenTextIsViewOfSource) {
+    std::string text = "format Long_identifier_over_sso_capacity:\n    a :u8\n";
+    File file;
+    make_file_from_text<std::string>(file, std::string_view(text));
+    ast::Context c;
+    auto r = c.enter_stream(&file, [&](ast::Stream& s) {
+        s.consume();
+        s.skip_space();
+        auto ident = s.consume_token(lexer::Tag::ident);
+        EXPECT_TRUE(ident);
+        if (ident) {
+            EXPECT_EQ(ident->token, "Long_identifier_over_sso_capacity");
+            EXPECT_EQ(ident->token.data(), text.data() + 7);
+        }
+        return true;
+    });
+    ASSERT_TRUE(r);
+}
+
+TEST(Stream, ShrinkKeepsCursor) {
+    with_stream("a\nb\nc", [](ast::Stream& s) {
+        s.consume();
+        s.skip_line();
+        s.shrink();
+        ASSERT_FALSE(s.prev_token());
+        ASSERT_TRUE(s.expect_token("b"));
+        auto list = s.take();
+        ASSERT_EQ(list.size(), 1);
+        ASSERT_EQ(list.front().token, "b");
+    });
+}
+
+// parse every example and report time and heap allocations.
+// lexing is also run alone to separate lexer allocations from parser/ast ones.
+// token text is a view of the source, so lex only allocations are those of token storage
+// this is a benchmark rather than a test; it never fails on parse errors of examples
+TEST(Stream, ParseExamplesBench) {
+    auto base = futils::env::sys::env_getter().get_or<std::string>("BASE_PATH", ".");
+    auto dir = std::filesystem::path(base) / "example";
+    if (!std::filesystem::exists(dir)) {
+        GTEST_SKIP() << "example directory not found: " << dir;
+    }
+    size_t files = 0, failed = 0;
+    std::chrono::nanoseconds elapsed{0}, lex_elapsed{0};
+    testutil::AllocCount allocs, lex_allocs;
+    // tokens whose text would not fit in SSO if it was an owning std::string
+    size_t tokens = 0, long_tokens = 0;
+    const auto sso_capacity = std::string().capacity();
+    for (auto& entry : std::filesystem::recursive_directory_iterator(dir)) {
+        if (!entry.is_regular_file() || entry.path().extension() != ".bgn") {
+            continue;
+        }
+        FileSet fs;
+        auto index = fs.add_file(entry.path().generic_u8string());
+        if (!index) {
+            continue;
+        }
+        {
+            // separate file because the file keeps its read position after lexing
+            FileSet lex_fs;
+            auto lex_index = lex_fs.add_file(entry.path().generic_u8string());
+            if (!lex_index) {
+                continue;
+            }
+            auto lex_input = lex_fs.get_input(*lex_index);
+            testutil::AllocScope scope;
+            auto begin = std::chrono::steady_clock::now();
+            ast::Context c;
+            c.enter_stream(lex_input, [&](ast::Stream& s) {
+                while (!s.eos()) {
+                    tokens++;
+                    if (s.peek_token().token.size() > sso_capacity) {
+                        long_tokens++;
+                    }
+                    s.consume();
+                }
+                return true;
+            });
+            lex_elapsed += std::chrono::steady_clock::now() - begin;
+            auto count = scope.get();
+            lex_allocs.count += count.count;
+            lex_allocs.bytes += count.bytes;
+        }
+        auto input = fs.get_input(*index);
+        testutil::AllocScope scope;
+        auto begin = std::chrono::steady_clock::now();
+        ast::Context c;
+        auto prog = c.enter_stream(input, [&](ast::Stream& s) {
+            return ast::parse(s, nullptr);
+        });
+        elapsed += std::chrono::steady_clock::now() - begin;
+        auto count = scope.get();
+        allocs.count += count.count;
+        allocs.bytes += count.bytes;
+        files++;
+        if (!prog) {
+            failed++;
+        }
+    }
+    std::cout << "parsed " << files << " files (" << failed << " failed) in "
+              << std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() << "us, "
+              << allocs.count << " allocations, " << allocs.bytes << " bytes\n"
+              << "  lex only: "
+              << std::chrono::duration_cast<std::chrono::microseconds>(lex_elapsed).count() << "us, "
+              << lex_allocs.count << " allocations, " << lex_allocs.bytes << " bytes\n"
+              << "  tokens: " << tokens << ", text over SSO capacity (" << sso_capacity << ", no longer allocated): " << long_tokens << "\n";
+}
@@ -0,0 +1,353 @@
+/*license*/
+#include <gtest/gtest.h>
+#include <vm/vm2/interpret.h>
+#include <vm/vm2/compile.h>
+#include <binary/writer.h>
+#include <binary/reader.h>
+#include <tool/src2json/test.h>
+#include <env/env.h>
+#include <env/env_sys.h>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+#include <algorithm>
+namespace fs = std::filesystem;
+
+using brgen::vm2::Inst;
+using brgen::vm2::Register;
+using brgen::vm2::TrapNumber;
+namespace inst = brgen::vm2::inst;
+
+// program builder. load_label is rewritten to offset of target instruction
+struct Program {
+    std::vector<Inst> insts;
+    std::vector<std::pair<size_t, size_t>> labels;
+
+    size_t op(Inst in) {
+        insts.push_back(in);
+        return insts.size() - 1;
+    }
+
+    size_t load_label(Register reg, size_t target) {
+        labels.push_back({op(inst::load_immediate(reg, 0)), target});
+        return insts.size() - 1;
+    }
+
+    std::vector<size_t> encode(std::string& buffer, const std::vector<Inst>& code) const {
+        std::vector<size_t> offsets;
+        futils::binary::writer w{futils::binary::resizable_buffer_writer<std::string>(), &buffer};
+        for (auto& in : code) {
+            offsets.push_back(w.offset());
+            brgen::vm2::enc::encode(w, in);
+        }
+        offsets.push_back(w.offset());
+        return offsets;
+    }
+
+    std::string assemble() const {
+        std::string buffer;
+        auto offsets = encode(buffer, insts);
+        std::vector<Inst> relocated;
+        for (size_t i = 0; i < insts.size(); i++) {
+            auto label = std::find_if(labels.begin(), labels.end(), [&](auto& l) { return l.first == i; });
+            if (label != labels.end()) {
+                Inst copy = insts[i];
+                relocated.push_back(copy.rewrite_arg(2, offsets[label->second]));
+            }
+            else {
+                relocated.push_back(insts[i]);
+            }
+        }
+        buffer.clear();
+        auto relocated_offsets = encode(buffer, relocated);
+        EXPECT_EQ(offsets, relocated_offsets);
+        return buffer;
+    }
+};
+
+struct RunResult {
+    std::string memory;
+    std::vector<std::uint64_t> registers;
+};
+
+constexpr auto memory_size = 4096;
+constexpr auto stack_size = 1024;
+
+struct RunOption {
+    bool safe_call = false;
+    // resume once more after the first non END_OF_PROGRAM trap so that resume position is compared too
+    bool resume_after_trap = false;
+    size_t memory = memory_size;
+    futils::view::rvec input;
+};
+
+RunResult run(const std::string& code, bool jit, const RunOption& opt) {
+    RunResult result;
+    result.memory.resize(opt.memory);
+    brgen::vm2::VM2 vm;
+    vm.set_safe_call_mode(opt.safe_call);
+    vm.reset(code, result.memory, stack_size);
+    futils::binary::bit_reader input{opt.input};
+    futils::jit::ExecutableMemory compiled;
+    if (jit) {
+        compiled = vm.jit_compile();
+        if (!compiled.valid()) {
+            return result;
+        }
+    }
+    auto resume = [&] {
+        jit ? vm.jit_resume(compiled) : vm.resume();
+        while (vm.handle_syscall(&input)) {
+            jit ? vm.jit_resume(compiled) : vm.resume();
+        }
+    };
+    resume();
+    if (opt.resume_after_trap && vm.get_trap() != TrapNumber::END_OF_PROGRAM) {
+        resume();
+    }
+    for (size_t i = 0; i < size_t(Register::REGISTER_COUNT); i++) {
+        result.registers.push_back(vm.read_register(Register(i)));
+    }
+    return result;
+}
+
+// run code by both interpreter and jit and compare whole state
+RunResult differential(const std::string& code, const RunOption& opt) {
+    auto interpreted = run(code, false, opt);
+    auto compiled = run(code, true, opt);
+    if (compiled.registers.empty()) {
+        return interpreted;  // jit is not available on this platform
+    }
+    for (size_t i = 0; i < size_t(Register::REGISTER_COUNT); i++) {
+        EXPECT_EQ(interpreted.registers[i], compiled.registers[i]) << "register " << i;
+    }
+    EXPECT_EQ(interpreted.memory, compiled.memory);
+    return interpreted;
+}
+
+RunResult differential(const Program& prog, bool safe_call = false) {
+    return differential(prog.assemble(), RunOption{.safe_call = safe_call});
+}
+
+TrapNumber trap_of(const RunResult& r) {
+    return TrapNumber(r.registers[size_t(Register::TRAP)]);
+}
+
+TEST(VM2JIT, Arithmetic) {
+    Program p;
+    p.op(inst::load_immediate(Register::R1, 40));
+    p.op(inst::load_immediate(Register::R2, 7));
+    for (auto op : {brgen::vm2::Op2::ADD, brgen::vm2::Op2::SUB, brgen::vm2::Op2::MUL, brgen::vm2::Op2::DIV,
+                    brgen::vm2::Op2::MOD, brgen::vm2::Op2::AND, brgen::vm2::Op2::OR, brgen::vm2::Op2::XOR,
+                    brgen::vm2::Op2::SHL, brgen::vm2::Op2::SHR, brgen::vm2::Op2::EQ, brgen::vm2::Op2::NE,
+                    brgen::vm2::Op2::LT, brgen::vm2::Op2::LE}) {
+        p.op(inst::binary_operator(op, Register::R1, Register::R2, Register::R3));
+        p.op(inst::push(Register::R3));
+        p.op(inst::binary_operator(op, Register::R2, Register::R1, Register::R3));
+        p.op(inst::push(Register::R3));
+    }
+    p.op(inst::le(Register::R2, Register::R2, Register::R3));
+    p.op(inst::push(Register::R3));
+    for (auto op : {brgen::vm2::Op2::INC, brgen::vm2::Op2::DEC, brgen::vm2::Op2::NEG, brgen::vm2::Op2::NOT}) {
+        p.op(inst::unary_operator(op, Register::R1));
+        p.op(inst::push(Register::R1));
+    }
+    p.op(inst::push_immediate(0xdeadbeef));
+    p.op(inst::pop(Register::R14));
+    p.op(inst::transfer(Register::SP, Register::OBJECT_POINTER));
+    p.op(inst::transfer(Register::PC, Register::R13));
+    auto r = differential(p);
+    EXPECT_EQ(trap_of(r), TrapNumber::END_OF_PROGRAM);
+    EXPECT_EQ(r.registers[size_t(Register::R14)], 0xdeadbeef);
+}
+
+TEST(VM2JIT, Memory) {
+    Program p;
+    p.op(inst::load_immediate(Register::R3, 0x0102030405060708));
+    p.op(inst::load_immediate(Register::R4, 64));
+    p.op(inst::load_immediate(Register::R6, 16));
+    for (size_t size = 0; size <= 8; size++) {
+        p.op(inst::store_memory(Register::R3, Register::R4, size));
+        p.op(inst::load_memory(Register::R4, Register::R5, size));
+        p.op(inst::push(Register::R5));
+        p.op(inst::add(Register::R4, Register::R6, Register::R4));
+    }
+    auto r = differential(p);
+    EXPECT_EQ(trap_of(r), TrapNumber::END_OF_PROGRAM);
+}
+
+TEST(VM2JIT, Loop) {
+    Program p;
+    p.op(inst::load_immediate(Register::R1, 0));
+    p.op(inst::load_immediate(Register::R2, 0));
+    p.op(inst::load_immediate(Register::R3, 100));
+    auto loop = p.op(inst::add(Register::R1, Register::R2, Register::R1));
+    p.op(inst::inc(Register::R2, Register::R2));
+    p.op(inst::lt(Register::R2, Register::R3, Register::R5));
+    p.load_label(Register::R6, loop);
+    p.op(inst::jump_if(Register::R6, Register::R5));
+    auto r = differential(p);
+    EXPECT_EQ(trap_of(r), TrapNumber::END_OF_PROGRAM);
+    EXPECT_EQ(r.registers[size_t(Register::R1)], 4950);
+}
+
+Program call_program(bool call_func_entry) {
+    Program p;
+    auto load_func = p.load_label(Register::R1, 0);
+    p.op(inst::call(Register::R1));
+    p.op(inst::load_immediate(Register::R2, 42));
+    auto jump_end = p.load_label(Register::R7, 0);
+    p.op(inst::jump(Register::R7));
+    auto func = p.op(inst::func_entry());
+    p.op(inst::load_immediate(Register::R0, 7));
+    p.op(inst::ret());
+    auto end = p.op(inst::nop());
+    p.labels[0] = {load_func, call_func_entry ? func : func + 1};
+    p.labels[1] = {jump_end, end};
+    return p;
+}
+
+TEST(VM2JIT, CallAndReturn) {
+    for (auto safe_call : {false, true}) {
+        auto r = differential(call_program(true), safe_call);
+        EXPECT_EQ(trap_of(r), TrapNumber::END_OF_PROGRAM);
+        EXPECT_EQ(r.registers[size_t(Register::R0)], 7);
+        EXPECT_EQ(r.registers[size_t(Register::R2)], 42);
+    }
+    auto r = differential(call_program(false), true);
+    EXPECT_EQ(trap_of(r), TrapNumber::INVALID_INSTRUCTION);
+    // interpreter resumes after the instruction at invalid call target
+    r = differential(call_program(false).assemble(), RunOption{.safe_call = true, .resume_after_trap = true});
+    EXPECT_EQ(trap_of(r), TrapNumber::END_OF_PROGRAM);
+    EXPECT_EQ(r.registers[size_t(Register::R0)], 0);
+    EXPECT_EQ(r.registers[size_t(Register::R2)], 42);
+}
+
+TEST(VM2JIT, Syscall) {
+    Program p;
+    p.op(inst::load_immediate(Register::R1, 16));
+    p.op(inst::syscall(brgen::vm2::SyscallNumber::ALLOCATE));
+    p.op(inst::transfer(Register::R0, Register::R8));
+    p.op(inst::load_immediate(Register::R1, 32));
+    p.op(inst::syscall(brgen::vm2::SyscallNumber::ALLOCATE));
+    p.op(inst::transfer(Register::R0, Register::R9));
+    p.op(inst::store_memory(Register::R1, Register::R9, 8));
+    auto r = differential(p);
+    EXPECT_EQ(trap_of(r), TrapNumber::END_OF_PROGRAM);
+    EXPECT_EQ(r.registers[size_t(Register::R9)], 16);
+}
+
+TEST(VM2JIT, Traps) {
+    auto expect_trap = [](TrapNumber expected, auto&& build) {
+        Program p;
+        p.op(inst::load_immediate(Register::R1, 1));
+        build(p);
+        p.op(inst::load_immediate(Register::R1, 2));
+        auto r = differential(p);
+        EXPECT_EQ(trap_of(r), expected);
+        EXPECT_EQ(r.registers[size_t(Register::R1)], 1);
+    };
+    expect_trap(TrapNumber::DIVISION_BY_ZERO, [](Program& p) {
+        p.op(inst::load_immediate(Register::R2, 0));
+        p.op(inst::div(Register::R1, Register::R2, Register::R3));
+    });
+    expect_trap(TrapNumber::DIVISION_BY_ZERO, [](Program& p) {
+        p.op(inst::load_immediate(Register::R2, 0));
+        p.op(inst::mod(Register::R1, Register::R2, Register::R3));
+    });
+    expect_trap(TrapNumber::INVALID_MEMORY_ACCESS, [](Program& p) {
+        p.op(inst::load_immediate(Register::R2, memory_size));
+        p.op(inst::load_memory(Register::R2, Register::R3, 1));
+    });
+    expect_trap(TrapNumber::INVALID_MEMORY_ACCESS, [](Program& p) {
+        p.op(inst::load_immediate(Register::R2, memory_size - 4));
+        p.op(inst::store_memory(Register::R1, Register::R2, 8));
+    });
+    expect_trap(TrapNumber::LARGE_SIZE, [](Program& p) {
+        p.op(inst::load_immediate(Register::R2, 0));
+        p.op(inst::load_memory(Register::R2, Register::R3, 9));
+    });
+    expect_trap(TrapNumber::STACK_UNDERFLOW, [](Program& p) {
+        p.op(inst::pop(Register::R3));
+    });
+    expect_trap(TrapNumber::STACK_OVERFLOW, [](Program& p) {
+        auto loop = p.op(inst::push_immediate(1));
+        p.load_label(Register::R2, loop);
+        p.op(inst::jump(Register::R2));
+    });
+    expect_trap(TrapNumber::INVALID_JUMP, [](Program& p) {
+        p.op(inst::load_immediate(Register::R2, 0xffffff));
+        p.op(inst::jump(Register::R2));
+    });
+    expect_trap(TrapNumber::INVALID_REGISTER_ACCESS, [](Program& p) {
+        p.op(inst::transfer(Register::R1, Register::BP));
+    });
+    // writing TRAP register stops execution
+    expect_trap(TrapNumber::INVALID_JUMP, [](Program& p) {
+        p.op(inst::load_immediate(Register::TRAP, std::uint64_t(TrapNumber::INVALID_JUMP)));
+    });
+    expect_trap(TrapNumber::STACK_OVERFLOW, [](Program& p) {
+        p.op(inst::load_immediate(Register::R2, std::uint64_t(TrapNumber::STACK_OVERFLOW)));
+        p.op(inst::transfer(Register::R2, Register::TRAP));
+    });
+    expect_trap(TrapNumber::LARGE_SIZE, [](Program& p) {
+        p.op(inst::push_immediate(std::uint64_t(TrapNumber::LARGE_SIZE)));
+        p.op(inst::pop(Register::TRAP));
+    });
+    // writing NO_TRAP continues
+    expect_trap(TrapNumber::DIVISION_BY_ZERO, [](Program& p) {
+        p.op(inst::load_immediate(Register::TRAP, std::uint64_t(TrapNumber::NO_TRAP)));
+        p.op(inst::load_immediate(Register::R2, 0));
+        p.op(inst::div(Register::R1, Register::R2, Register::R3));
+    });
+}
+
+auto load_example_paths() {
+    std::vector<fs::path> paths;
+    std::map<std::string, std::string> p;
+    p["BASE_PATH"] = futils::env::sys::env_getter().get_or<std::string>("BASE_PATH", ".");
+    std::string base_path;
+    futils::env::expand(base_path, "${BASE_PATH}/example/", futils::env::expand_map<std::string>(p));
+    std::error_code ec;
+    for (auto it = fs::recursive_directory_iterator(base_path, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        if (it->is_regular_file() && it->path().extension() == ".bgn" &&
+            it->path().filename() != "fn_test.bgn" &&
+            it->path().filename() != "error_tolerant.bgn" &&
+            it->path().filename() != "partial_regex.bgn") {
+            paths.push_back(it->path());
+        }
+    }
+    return paths;
+}
+
+struct VM2JITExample : public ::testing::TestWithParam<fs::path> {
+};
+
+INSTANTIATE_TEST_SUITE_P(
+    VM2JITExampleSuite,
+    VM2JITExample,
+    ::testing::ValuesIn(load_example_paths()));
+
+// compile example format and run it by interpreter and jit on same input.
+// final registers (including trap and its reason) and memory must match
+TEST_P(VM2JITExample, Differential) {
+    brgen::FileSet files;
+    auto ok = files.add_file(GetParam().generic_u8string());
+    ASSERT_TRUE(ok && *ok == 1);
+    std::string code;
+    try {
+        auto prog = brgen::test::src2json(files);
+        futils::binary::writer w{futils::binary::resizable_buffer_writer<std::string>(), &code};
+        brgen::vm2::compile(prog, w);
+    } catch (...) {
+        GTEST_SKIP() << "not compilable to vm2";
+    }
+    std::string input;
+    for (size_t i = 0; i < 4096; i++) {
+        input.push_back(char(i * 31 + 7));
+    }
+    for (auto safe_call : {false, true}) {
+        differential(code, RunOption{.safe_call = safe_call, .memory = 1024 * 1024, .input = input});
+    }
+}
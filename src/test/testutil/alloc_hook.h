@@ -0,0 +1,52 @@
+/*license*/
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// heap allocation counter for tests and benchmarks
+// define BRGEN_ALLOC_HOOK_DEFINE before including this header in exactly one
+// translation unit of the executable to replace global operator new/delete
+namespace brgen::testutil {
+    inline std::atomic_size_t alloc_count_total{0};
+    inline std::atomic_size_t alloc_bytes_total{0};
+
+    struct AllocCount {
+        size_t count = 0;
+        size_t bytes = 0;
+    };
+
+    inline AllocCount alloc_count() {
+        return AllocCount{alloc_count_total.load(std::memory_order_relaxed), alloc_bytes_total.load(std::memory_order_relaxed)};
+    }
+
+    // counts allocations since construction
+    struct AllocScope {
+        AllocCount begin = alloc_count();
+
+        AllocCount get() const {
+            auto now = alloc_count();
+            return AllocCount{now.count - begin.count, now.bytes - begin.bytes};
+        }
+    };
+}  // namespace brgen::testutil
+
+#ifdef BRGEN_ALLOC_HOOK_DEFINE
+void* operator new(std::size_t size) {
+    brgen::testutil::alloc_count_total.fetch_add(1, std::memory_order_relaxed);
+    brgen::testutil::alloc_bytes_total.fetch_add(size, std::memory_order_relaxed);
+    if (auto p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+#endif
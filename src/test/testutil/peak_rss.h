@@ -0,0 +1,32 @@
+/*license*/
+#pragma once
+#include <cstddef>
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace brgen::testutil {
+    // peak resident set size of current process in bytes. 0 if unknown
+    inline size_t peak_rss() {
+#ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS pmc{};
+        if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) {
+            return 0;
+        }
+        return pmc.PeakWorkingSetSize;
+#else
+        rusage usage{};
+        if (getrusage(RUSAGE_SELF, &usage) != 0) {
+            return 0;
+        }
+#ifdef __APPLE__
+        return usage.ru_maxrss;  // bytes
+#else
+        return size_t(usage.ru_maxrss) * 1024;  // kilobytes
+#endif
+#endif
+    }
+}  // namespace brgen::testutil
@@ -0,0 +1,147 @@
+/*license*/
+#include <gtest/gtest.h>
+#include <core/ast/parse.h>
+#include <core/ast/json.h>
+#include <tool/src2json/session.h>
+
+using namespace brgen;
+namespace session = src2json::session;
+
+session::ParsedBlock parse_text(std::string_view text, UtfMode mode, bool collect_comments) {
+    session::ParsedBlock parsed;
+    FileSet files;
+    files.set_utf_mode(UtfMode::utf8, mode);
+    auto index = files.add_special("test.bgn", std::string(text));
+    if (!index) {
+        return parsed;
+    }
+    LocationError warns;
+    ast::Context c;
+    auto prog = c.enter_stream(files.get_input(*index), [&](ast::Stream& s) {
+        auto p = ast::parse(s, &warns, ast::ParseOption{.collect_comments = collect_comments});
+        parsed.trailing_comment = s.get_comments();
+        return p;
+    });
+    if (prog && warns.locations.empty()) {
+        parsed.ast = std::move(*prog);
+    }
+    return parsed;
+}
+
+std::string to_json(const std::shared_ptr<ast::Node>& node) {
+    ast::JSONConverter c;
+    c.encode(node);
+    return c.obj.out();
+}
+
+// assembles document from blocks and checks that it is the same as whole text parsed at once
+session::LexStat parse_document(session::Document& doc, UtfMode mode, bool collect_comments = false) {
+    session::LexStat stat;
+    auto parse_block = [&](std::string_view text) {
+        return parse_text(text, mode, collect_comments);
+    };
+    // FileSet of parse_text assigns 1 to first file
+    auto assembled = doc.parse(mode, 1, false, parse_block, stat);
+    auto whole = parse_text(doc.text, mode, collect_comments);
+    [&] {
+        ASSERT_TRUE(assembled);
+        ASSERT_TRUE(whole.ast);
+        ASSERT_FALSE(stat.full_parse);
+        ASSERT_EQ(to_json(assembled), to_json(whole.ast));
+    }();
+    return stat;
+}
+
+session::TextChange change(size_t start_line, size_t start_char, size_t end_line, size_t end_char, std::string text) {
+    return session::TextChange{
+        .start = {start_line, start_char},
+        .end = {end_line, end_char},
+        .text = std::move(text),
+    };
+}
+
+TEST(Session, ToOffsetCountsInterpretModeUnits) {
+    // U+1F600 is 4 bytes in utf8, 2 units in utf16 and 1 unit in utf32
+    std::string_view text = "a\xF0\x9F\x98\x80" "b\nc";
+    EXPECT_EQ(session::to_offset(text, {0, 3}, UtfMode::utf16), 5);
+    EXPECT_EQ(session::to_offset(text, {0, 2}, UtfMode::utf32), 5);
+    EXPECT_EQ(session::to_offset(text, {0, 5}, UtfMode::utf8), 5);
+    EXPECT_EQ(session::to_offset(text, {1, 1}, UtfMode::utf16), 8);
+    // clamped to end of line and end of text
+    EXPECT_EQ(session::to_offset(text, {0, 100}, UtfMode::utf16), 6);
+    EXPECT_EQ(session::to_offset(text, {5, 0}, UtfMode::utf16), text.size());
+    EXPECT_EQ(session::count_units(text, UtfMode::utf16), 6);
+    EXPECT_EQ(session::count_units(text, UtfMode::utf32), 5);
+}
+
+TEST(Session, SplitBlocksAtTopLevelLines) {
+    session::Document doc;
+    doc.set_text("format A:\n    a :u8\n\n# B\nformat B:\n    b :u8\n");
+    auto blocks = doc.split_blocks();
+    ASSERT_EQ(blocks.size(), 2);
+    EXPECT_EQ(blocks[0], "format A:\n    a :u8\n\n# B\n");
+    EXPECT_EQ(blocks[1], "format B:\n    b :u8\n");
+}
+
+TEST(Session, ReparseOnlyChangedBlock) {
+    session::Document doc;
+    doc.set_text("format A:\n    a :u8\n\nformat B:\n    b :u8\n\nformat C:\n    c :u8\n");
+    auto stat = parse_document(doc, UtfMode::utf8);
+    EXPECT_EQ(stat.reparsed_blocks, 3);
+    doc.apply({change(4, 7, 4, 9, "u16")}, UtfMode::utf8);
+    EXPECT_EQ(doc.text, "format A:\n    a :u8\n\nformat B:\n    b :u16\n\nformat C:\n    c :u8\n");
+    stat = parse_document(doc, UtfMode::utf8);
+    EXPECT_EQ(stat.reused_parse_blocks, 2);
+    EXPECT_EQ(stat.reparsed_blocks, 1);
+}
+
+TEST(Session, EditAcrossBlockBoundary) {
+    session::Document doc;
+    doc.set_text("format A:\n    a :u8\n\nformat B:\n    b :u8\n\nformat C:\n    c :u8\n");
+    parse_document(doc, UtfMode::utf8);
+    // from field of A to field of B: A and B become one block
+    doc.apply({change(1, 7, 4, 7, "u16\n    b :")}, UtfMode::utf8);
+    EXPECT_EQ(doc.text, "format A:\n    a :u16\n    b :u8\n\nformat C:\n    c :u8\n");
+    auto stat = parse_document(doc, UtfMode::utf8);
+    EXPECT_EQ(doc.split_blocks().size(), 2);
+    EXPECT_EQ(stat.reused_parse_blocks, 1);
+    EXPECT_EQ(stat.reparsed_blocks, 1);
+    // new top-level line inside block splits it again
+    doc.apply({change(2, 9, 2, 9, "\nformat D:\n    d :u8\n")}, UtfMode::utf8);
+    stat = parse_document(doc, UtfMode::utf8);
+    EXPECT_EQ(doc.split_blocks().size(), 3);
+    EXPECT_EQ(stat.reused_parse_blocks, 1);
+    EXPECT_EQ(stat.reparsed_blocks, 2);
+}
+
+TEST(Session, EditWithUtf16Positions) {
+    session::Document doc;
+    doc.set_text("# \xF0\x9F\x98\x80\nformat A:\n    a :u8\n\nformat B:\n    b :u8 # \xF0\x9F\x98\x80\xF0\x9F\x98\x80\n    c :u8\n");
+    parse_document(doc, UtfMode::utf16, true);
+    // end of line 5 is 12 + 2 * 2 in utf16 units
+    doc.apply({change(5, 16, 5, 16, "!"), change(6, 7, 6, 9, "u32")}, UtfMode::utf16);
+    EXPECT_EQ(doc.text, "# \xF0\x9F\x98\x80\nformat A:\n    a :u8\n\nformat B:\n    b :u8 # \xF0\x9F\x98\x80\xF0\x9F\x98\x80!\n    c :u32\n");
+    // locations of block B are shifted by utf16 units of block A
+    auto stat = parse_document(doc, UtfMode::utf16, true);
+    EXPECT_EQ(stat.reused_parse_blocks, 1);
+    EXPECT_EQ(stat.reparsed_blocks, 1);
+}
+
+TEST(Session, CommentsBeforeBlockAttachToIt) {
+    session::Document doc;
+    doc.set_text("format A:\n    a :u8\n\n# about B\n# more\nformat B:\n    b :u8\n");
+    parse_document(doc, UtfMode::utf8, true);
+    doc.apply({change(6, 7, 6, 9, "u16")}, UtfMode::utf8);
+    auto stat = parse_document(doc, UtfMode::utf8, true);
+    EXPECT_EQ(stat.reused_parse_blocks, 1);
+    EXPECT_EQ(stat.reparsed_blocks, 1);
+}
+
+TEST(Session, DuplicateDefinitionFallsBackToWholeParse) {
+    session::Document doc;
+    doc.set_text("format A:\n    a :u8\n\nformat A:\n    b :u8\n");
+    session::LexStat stat;
+    auto res = doc.parse(UtfMode::utf8, 1, false, [&](std::string_view text) { return parse_text(text, UtfMode::utf8, false); }, stat);
+    EXPECT_FALSE(res);
+    EXPECT_TRUE(stat.full_parse);
+}
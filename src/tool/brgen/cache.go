@@ -0,0 +1,230 @@
+package main
+
+import (
+	"crypto/sha256"
+	"encoding/hex"
+	"encoding/json"
+	"fmt"
+	"io"
+	"os"
+	"os/exec"
+	"path/filepath"
+	"sync/atomic"
+)
+
+// Cache is content-addressed on-disk cache of src2json and generator outputs.
+//
+// layout:
+//
+//	<dir>/ast/<hash(tool, source path)>.json  manifest: dependency files and their content hashes
+//	<dir>/ast/<ast key>.ast                   src2json output
+//	<dir>/gen/<hash(ast key, generator)>.json generated files
+//
+// ast key is hash of tool key and contents of the source and its transitive imports,
+// so a manifest is valid only while every recorded dependency has the same content.
+type Cache struct {
+	dir     string
+	toolKey string
+
+	astHit  atomic.Uint32
+	astMiss atomic.Uint32
+	genHit  atomic.Uint32
+	genMiss atomic.Uint32
+}
+
+type cacheDep struct {
+	Path string `json:"path"`
+	Hash string `json:"hash"`
+}
+
+type cacheManifest struct {
+	Deps []cacheDep `json:"deps"`
+	Key  string     `json:"key"`
+}
+
+type cacheOutput struct {
+	Name string `json:"name"`
+	Data []byte `json:"data"`
+}
+
+func hashStrings(s ...string) string {
+	h := sha256.New()
+	for _, v := range s {
+		fmt.Fprintf(h, "%d:%s", len(v), v)
+	}
+	return hex.EncodeToString(h.Sum(nil))
+}
+
+func hashFile(path string) (string, error) {
+	fp, err := os.Open(path)
+	if err != nil {
+		return "", err
+	}
+	defer fp.Close()
+	h := sha256.New()
+	if _, err := io.Copy(h, fp); err != nil {
+		return "", err
+	}
+	return hex.EncodeToString(h.Sum(nil)), nil
+}
+
+// hashExecutable hashes the binary that exec would run for name
+func hashExecutable(name string) (string, error) {
+	path, err := exec.LookPath(name)
+	if err != nil {
+		return "", err
+	}
+	return hashFile(path)
+}
+
+// NewCache creates cache rooted at dir.
+// tool identifies src2json (version, binary) and flags passed to it
+func NewCache(dir string, tool ...string) (*Cache, error) {
+	for _, sub := range []string{"ast", "gen"} {
+		if err := os.MkdirAll(filepath.Join(dir, sub), 0755); err != nil {
+			return nil, err
+		}
+	}
+	wd, err := os.Getwd()
+	if err != nil {
+		return nil, err
+	}
+	// dependency paths in src2json output may be relative to working directory
+	return &Cache{dir: dir, toolKey: hashStrings(append(tool, wd)...)}, nil
+}
+
+func (c *Cache) path(sub, name string) string {
+	return filepath.Join(c.dir, sub, name)
+}
+
+// writeFile writes data via temporary file so that concurrent readers never see partial entry
+func (c *Cache) writeFile(path string, data []byte) error {
+	fp, err := os.CreateTemp(filepath.Dir(path), "tmp*")
+	if err != nil {
+		return err
+	}
+	_, err = fp.Write(data)
+	if cerr := fp.Close(); err == nil {
+		err = cerr
+	}
+	if err != nil {
+		os.Remove(fp.Name())
+		return err
+	}
+	return os.Rename(fp.Name(), path)
+}
+
+func (c *Cache) manifestPath(source string) (string, error) {
+	abs, err := filepath.Abs(source)
+	if err != nil {
+		return "", err
+	}
+	return c.path("ast", hashStrings(c.toolKey, abs)+".json"), nil
+}
+
+func astKey(toolKey string, deps []cacheDep) string {
+	s := []string{toolKey}
+	for _, d := range deps {
+		s = append(s, d.Path, d.Hash)
+	}
+	return hashStrings(s...)
+}
+
+// LoadAst returns cached src2json output and its key if source and all of its imports are unchanged
+func (c *Cache) LoadAst(source string) ([]byte, string, bool) {
+	mpath, err := c.manifestPath(source)
+	if err != nil {
+		return nil, "", false
+	}
+	mdata, err := os.ReadFile(mpath)
+	if err != nil {
+		return nil, "", false
+	}
+	var m cacheManifest
+	if err := json.Unmarshal(mdata, &m); err != nil {
+		return nil, "", false
+	}
+	for _, d := range m.Deps {
+		h, err := hashFile(d.Path)
+		if err != nil || h != d.Hash {
+			return nil, "", false
+		}
+	}
+	key := astKey(c.toolKey, m.Deps)
+	if key != m.Key {
+		return nil, "", false
+	}
+	data, err := os.ReadFile(c.path("ast", key+".ast"))
+	if err != nil {
+		return nil, "", false
+	}
+	return data, key, true
+}
+
+// StoreAst records src2json output of source and returns its key.
+// dependencies are taken from "files" of the output, which lists the source and its transitive imports
+func (c *Cache) StoreAst(source string, data []byte) (string, error) {
+	var out struct {
+		Files []string `json:"files"`
+	}
+	if err := json.Unmarshal(data, &out); err != nil {
+		return "", err
+	}
+	files := out.Files
+	if len(files) == 0 {
+		files = []string{source}
+	}
+	m := cacheManifest{}
+	for _, f := range files {
+		h, err := hashFile(f)
+		if err != nil {
+			return "", err
+		}
+		m.Deps = append(m.Deps, cacheDep{Path: f, Hash: h})
+	}
+	m.Key = astKey(c.toolKey, m.Deps)
+	if err := c.writeFile(c.path("ast", m.Key+".ast"), data); err != nil {
+		return "", err
+	}
+	mdata, err := json.Marshal(&m)
+	if err != nil {
+		return "", err
+	}
+	mpath, err := c.manifestPath(source)
+	if err != nil {
+		return "", err
+	}
+	if err := c.writeFile(mpath, mdata); err != nil {
+		return "", err
+	}
+	return m.Key, nil
+}
+
+func (c *Cache) genPath(astKey, generatorKey string) string {
+	return c.path("gen", hashStrings(astKey, generatorKey)+".json")
+}
+
+func (c *Cache) LoadGenerated(astKey, generatorKey string) ([]cacheOutput, bool) {
+	data, err := os.ReadFile(c.genPath(astKey, generatorKey))
+	if err != nil {
+		return nil, false
+	}
+	var out []cacheOutput
+	if err := json.Unmarshal(data, &out); err != nil {
+		return nil, false
+	}
+	return out, true
+}
+
+func (c *Cache) StoreGenerated(astKey, generatorKey string, out []cacheOutput) error {
+	data, err := json.Marshal(out)
+	if err != nil {
+		return err
+	}
+	return c.writeFile(c.genPath(astKey, generatorKey), data)
+}
+
+func (c *Cache) String() string {
+	return fmt.Sprintf("cache: src2json hit: %d miss: %d, generator hit: %d miss: %d",
+		c.astHit.Load(), c.astMiss.Load(), c.genHit.Load(), c.genMiss.Load())
+}
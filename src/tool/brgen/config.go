@@ -38,4 +38,6 @@ type Config struct {
 	Warnings       Warnings  `json:"warnings"`
 	Output         []*Output `json:"output"`
 	TestInfo       *string   `json:"test_info_output"`
+	CacheDir       *string   `json:"cache_dir"`
+	Timing         bool      `json:"timing"`
 }
@@ -26,9 +26,10 @@ type Spec struct {
 }
 
 type Result struct {
-	Path string
-	Data []byte
-	Err  error
+	Path     string
+	Data     []byte
+	Err      error
+	CacheKey string // key of src2json output in Cache. empty if not cached
 }
 
 type Generator struct {
@@ -44,6 +45,8 @@ type Generator struct {
 	dirBaseSuffixChan chan *DirBaseSuffix
 	stdinStream       *request.ProcessClient
 	generatorBlock    chan struct{} // TODO(on-keyday): temporary solution for CI
+	cache             *Cache
+	cacheKey          string // identifies generator binary, args and spec
 }
 
 func (g *Generator) cmdline() []string {
@@ -139,6 +142,20 @@ func (g *Generator) sendResult(req *Result) {
 	g.result <- req
 }
 
+// sendError reports err for a copy of req and returns err.
+// the receiver reads the sent result concurrently, so the caller must not touch it after sending
+func (g *Generator) sendError(req Result, err error) error {
+	req.Err = err
+	g.sendResult(&req)
+	return err
+}
+
+// emitGenerated sends generated file and records it for cache
+func (g *Generator) emitGenerated(outputs *[]cacheOutput, fileBase string, data []byte) {
+	*outputs = append(*outputs, cacheOutput{Name: fileBase, Data: data})
+	g.sendGenerated(fileBase, data)
+}
+
 func (g *Generator) sendGenerated(fileBase string, data []byte) {
 	suffix := filepath.Ext(fileBase)
 	var path string
@@ -168,17 +185,38 @@ func (g *Generator) sendGenerated(fileBase string, data []byte) {
 
 func (g *Generator) handleRequest(req *Result) {
 	defer g.works.Done() // this Done is for the generator handlers Add
+	useCache := g.cache != nil && req.CacheKey != ""
+	if useCache {
+		if outputs, ok := g.cache.LoadGenerated(req.CacheKey, g.cacheKey); ok {
+			g.cache.genHit.Add(1)
+			for _, out := range outputs {
+				g.sendGenerated(out.Name, out.Data)
+			}
+			return
+		}
+		g.cache.genMiss.Add(1)
+	}
 	g.generatorBlock <- struct{}{}
 	defer func() { <-g.generatorBlock }()
+	var outputs []cacheOutput
+	var err error
 	if g.stdinStream != nil {
-		g.handleStdinStreamRequest(req)
-		return
+		err = g.handleStdinStreamRequest(req, &outputs)
+	} else {
+		err = g.handleProcessRequest(req, &outputs)
 	}
+	if useCache && err == nil {
+		if err := g.cache.StoreGenerated(req.CacheKey, g.cacheKey, outputs); err != nil {
+			g.Printf("cache store: %s: %s\n", req.Path, err)
+		}
+	}
+}
+
+// returns the error reported for req, if any
+func (g *Generator) handleProcessRequest(req *Result, outputs *[]cacheOutput) error {
 	data, err := g.passAst(req.Path, req.Data)
 	if err != nil {
-		req.Err = fmt.Errorf("passAst: %s: %w", g.generatorPath, err)
-		g.sendResult(req)
-		return
+		return g.sendError(*req, fmt.Errorf("passAst: %s: %w", g.generatorPath, err))
 	}
 	ext := filepath.Ext(req.Path)
 	basePath := strings.TrimSuffix(filepath.Base(req.Path), ext)
@@ -189,16 +227,15 @@ func (g *Generator) handleRequest(req *Result) {
 		split_data = bytes.Split(data, []byte(g.spec.Separator))
 	}
 	if len(split_data) > len(g.spec.Suffix) {
-		req.Err = fmt.Errorf("too many output. expect equal to or less than %d, got %d: %s", len(g.spec.Suffix), len(split_data), req.Path)
-		g.sendResult(req)
-		return
+		return g.sendError(*req, fmt.Errorf("too many output. expect equal to or less than %d, got %d: %s", len(g.spec.Suffix), len(split_data), req.Path))
 	}
 	for i, suffix := range g.spec.Suffix {
 		if i >= len(split_data) {
 			break
 		}
-		g.sendGenerated(basePath+suffix, split_data[i])
+		g.emitGenerated(outputs, basePath+suffix, split_data[i])
 	}
+	return nil
 }
 
 func (g *Generator) run() {
@@ -228,10 +265,29 @@ func (g *Generator) StartGenerator(out *Output) error {
 		}
 		return fmt.Errorf("askSpec: %s: %w", g.generatorPath, err)
 	}
+	if g.cache != nil {
+		err = g.initCacheKey()
+		if err != nil {
+			return fmt.Errorf("cache: %s: %w", g.generatorPath, err)
+		}
+	}
 	go g.run()
 	return nil
 }
 
+func (g *Generator) initCacheKey() error {
+	bin, err := hashExecutable(g.generatorPath[0])
+	if err != nil {
+		return err
+	}
+	spec, err := json.Marshal(&g.spec)
+	if err != nil {
+		return err
+	}
+	g.cacheKey = hashStrings(append([]string{bin, string(spec)}, g.cmdline()...)...)
+	return nil
+}
+
 func (g *Generator) Request(req *Result) {
 	g.request <- req
 }
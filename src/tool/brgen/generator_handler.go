@@ -22,11 +22,13 @@ import (
 )
 
 type GeneratorHandler struct {
-	src2json string
-	viaHTTP  *exec.Cmd
-	libs2j   *s2jgo.Src2JSON
-	ctx      context.Context
-	cancel   context.CancelFunc
+	src2json   string
+	viaHTTP    *exec.Cmd
+	libs2j     *s2jgo.Src2JSON
+	libs2jPath string
+	cache      *Cache
+	ctx        context.Context
+	cancel     context.CancelFunc
 
 	resultQueue chan *Result
 	errQueue    chan error
@@ -66,6 +68,7 @@ func (g *GeneratorHandler) loadSrc2JSON(src2json, libs2j string) error {
 			if err == nil {
 				g.libs2j, err = s2jgo.Load(path)
 				if err == nil {
+					g.libs2jPath = path
 					g.Printf("libs2j: %s loaded\n", path)
 					return nil // success
 				}
@@ -113,7 +116,26 @@ func (g *GeneratorHandler) loadSrc2JSON(src2json, libs2j string) error {
 	return nil
 }
 
-func (g *GeneratorHandler) Init(src2json string, libs2j string, output []*Output, suffix string) error {
+// initCache keys cache by src2json (or libs2j) binary and warning flags
+func (g *GeneratorHandler) initCache(dir string) error {
+	var tool string
+	var err error
+	if g.libs2j != nil {
+		tool, err = hashFile(g.libs2jPath)
+	} else {
+		tool, err = hashExecutable(g.src2json)
+	}
+	if err != nil {
+		return fmt.Errorf("cache: %w", err)
+	}
+	g.cache, err = NewCache(dir, append([]string{tool}, g.appendConfig(nil)...)...)
+	if err != nil {
+		return fmt.Errorf("cache: %w", err)
+	}
+	return nil
+}
+
+func (g *GeneratorHandler) Init(src2json string, libs2j string, output []*Output, suffix string, cacheDir string) error {
 	if len(output) == 0 {
 		return errors.New("output is required")
 	}
@@ -127,6 +149,12 @@ func (g *GeneratorHandler) Init(src2json string, libs2j string, output []*Output
 	if err != nil {
 		return err
 	}
+	if cacheDir != "" {
+		err = g.initCache(cacheDir)
+		if err != nil {
+			return err
+		}
+	}
 	go func() {
 		for {
 			select {
@@ -253,6 +281,31 @@ func (g *GeneratorHandler) loadAst(path string) ([]byte, error) {
 	return g.loadAstCommand(path)
 }
 
+// loadAstCached returns src2json output of path and its cache key (empty if cache is disabled)
+func (g *GeneratorHandler) loadAstCached(path string) ([]byte, string, error) {
+	if g.cache == nil {
+		buf, err := g.loadAst(path)
+		return buf, "", err
+	}
+	if buf, key, ok := g.cache.LoadAst(path); ok {
+		g.cache.astHit.Add(1)
+		g.Printf("loadAst: cache hit: %s\n", path)
+		return buf, key, nil
+	}
+	g.cache.astMiss.Add(1)
+	buf, err := g.loadAst(path)
+	if err != nil {
+		return nil, "", err
+	}
+	key, err := g.cache.StoreAst(path, buf)
+	if err != nil {
+		// not fatal; just this file is not cached
+		g.Printf("loadAst: cache store: %s: %s\n", path, err)
+		return buf, "", nil
+	}
+	return buf, key, nil
+}
+
 func (g *GeneratorHandler) loadAstCommand(path string) ([]byte, error) {
 	cmd := exec.CommandContext(g.ctx, g.src2json, path)
 	cmd.Args = g.appendConfig(cmd.Args)
@@ -284,7 +337,7 @@ func (g *GeneratorHandler) generateAST(path string, reqwg *sync.WaitGroup) {
 		go func(file string) {
 			defer g.works.Done()
 			defer reqwg.Done()
-			buf, err := g.loadAst(file)
+			buf, key, err := g.loadAstCached(file)
 			if err != nil {
 				go func() {
 					g.errQueue <- fmt.Errorf("loadAst: %s: %w", file, err)
@@ -295,8 +348,9 @@ func (g *GeneratorHandler) generateAST(path string, reqwg *sync.WaitGroup) {
 				// this work is Done by the generator
 				g.works.Add(1)
 				gen.Request(&Result{
-					Path: file,
-					Data: buf,
+					Path:     file,
+					Data:     buf,
+					CacheKey: key,
 				})
 			}
 		}(file)
@@ -305,6 +359,7 @@ func (g *GeneratorHandler) generateAST(path string, reqwg *sync.WaitGroup) {
 
 func (g *GeneratorHandler) dispatchGenerator(out *Output) error {
 	gen := NewGenerator(g.ctx, &g.works, g.stderr, g.resultQueue /*&g.outputCount,*/, g.dirBaseSuffixChan, g.loadAstBlock)
+	gen.cache = g.cache
 	err := gen.StartGenerator(out)
 	if err != nil {
 		if err == ErrIgnoreMissing {
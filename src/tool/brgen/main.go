@@ -46,6 +46,9 @@ func fillStringPtr(c *Config) {
 	if c.TestInfo == nil {
 		c.TestInfo = new(string)
 	}
+	if c.CacheDir == nil {
+		c.CacheDir = new(string)
+	}
 }
 
 var config *Config
@@ -83,6 +86,8 @@ func init() {
 	flag.Bool("disable-untyped", false, "disable untyped warning")
 	flag.Bool("disable-unused", false, "disable unused warning")
 	flag.String("test-info", "", "path to test info output file")
+	flag.String("cache-dir", "", "enable content-addressed cache of src2json and generator outputs in this directory")
+	flag.Bool("timing", false, "print timing and cache statistics")
 	configLocation := flag.String("config", "brgen.json", "config file location")
 
 	flag.BoolVar(&debug, "debug", false, "debug mode")
@@ -112,6 +117,8 @@ func init() {
 			setString(&config.LibSource2Json, "libs2j")
 			setString(&config.Suffix, "suffix")
 			setString(&config.TestInfo, "test-info")
+			setString(&config.CacheDir, "cache-dir")
+			setBool(&config.Timing, "timing")
 			setBool(&config.Warnings.DisableUntypedWarning, "disable-untyped")
 			setBool(&config.Warnings.DisableUnusedWarning, "disable-unused")
 		})
@@ -149,7 +156,7 @@ func main() {
 		g.stderr = io.Discard
 	}
 	start := time.Now()
-	if err := g.Init(*config.Source2Json, *config.LibSource2Json, config.Output, *config.Suffix); err != nil {
+	if err := g.Init(*config.Source2Json, *config.LibSource2Json, config.Output, *config.Suffix, *config.CacheDir); err != nil {
 		log.Fatal(err)
 	}
 	g.StartGenerator(args...)
@@ -217,6 +224,9 @@ func main() {
 	wg.Wait()
 	elapsed := time.Since(start)
 	log.Printf("time: %v total: %d, error: %d\n", elapsed, totalCount.Load(), errCount.Load())
+	if config.Timing && g.cache != nil {
+		log.Println(g.cache)
+	}
 	if *config.TestInfo != "" {
 		fp, err := os.Create(*config.TestInfo)
 		if err != nil {
@@ -21,44 +21,42 @@ func (g *Generator) initStdinStream() error {
 	return nil
 }
 
-func (g *Generator) handleStdinStreamRequest(req *Result) {
+// returns the last error reported for req, if any
+func (g *Generator) handleStdinStreamRequest(req *Result, outputs *[]cacheOutput) error {
 	stream := g.stdinStream.CreateStream()
 	ext := filepath.Ext(req.Path)
 	base := filepath.Base(req.Path)
 	baseWithoutExt := base[:len(base)-len(ext)]
 	err := stream.SendRequest(baseWithoutExt, req.Data)
 	if err != nil {
-		req.Err = err
-		g.sendResult(req)
-		return
+		return g.sendError(*req, err)
 	}
+	var reported error
 	for {
 		resp, err := stream.ReceiveResponse()
 		if err != nil {
 			if err == io.EOF {
 				break
 			}
-			req.Err = err
-			g.sendResult(req)
-			return
+			return g.sendError(*req, err)
 		}
 		if resp.Status == request.ResponseStatus_Error {
-			req.Err = errors.New(string(resp.ErrorMessage))
-			g.sendResult(req)
+			reported = g.sendError(*req, errors.New(string(resp.ErrorMessage)))
 			continue
 		}
 		if len(resp.Name) == 0 {
-			req.Data = resp.Code
-			req.Err = errors.New("empty name")
-			g.sendResult(req)
+			res := *req
+			res.Data = resp.Code
+			reported = g.sendError(res, errors.New("empty name"))
 			continue
 		}
 		if path.Ext(string(resp.Name)) == "" {
-			req.Data = resp.Code
-			req.Err = errors.New("no extension")
-			g.sendResult(req)
+			res := *req
+			res.Data = resp.Code
+			reported = g.sendError(res, errors.New("no extension"))
 			continue
 		}
-		g.sendGenerated(string(resp.Name), resp.Code)
+		g.emitGenerated(outputs, string(resp.Name), resp.Code)
 	}
+	return reported
 }
@@ -3,8 +3,24 @@
 #include "send.h"
 #include <core/ast/file.h>
 #include <core/ast/json.h>
+#include <core/ast/binary.h>
 
+// input may be json or binary ast (see core/ast/binary.h); detected by magic
 std::shared_ptr<brgen::ast::Node> load_json(std::uint64_t id, auto&& name, auto&& input) {
+    auto view = std::string_view(reinterpret_cast<const char*>(std::data(input)), std::size(input));
+    if (brgen::ast::is_binary_ast(view)) {
+        brgen::ast::BinaryConverter c;
+        auto res = c.decode(view);
+        if (!res) {
+            send_error_and_end(id, "cannot decode binary ast file: ", res.error().locations[0].msg);
+            return nullptr;
+        }
+        if (!res->ast) {
+            send_error_and_end(id, "cannot decode binary ast file: ast is null: ", name);
+            return nullptr;
+        }
+        return res->ast;
+    }
     auto js = futils::json::parse<futils::json::JSON>(input);
     if (js.is_undef()) {
         send_error_and_end(id, "cannot parse json file: ", name);
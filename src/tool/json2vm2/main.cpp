@@ -12,6 +12,7 @@
 #include <number/hex/hex2bin.h>
 #include <file/file_stream.h>
 #include "../common/generate.h"
+#include <chrono>
 
 struct Flags : futils::cmdline::templ::HelpOption {
     std::vector<std::string> args;
@@ -22,6 +23,7 @@ struct Flags : futils::cmdline::templ::HelpOption {
     std::string_view binary_input;
     bool legacy_file_pass = false;
     bool jit = false;
+    size_t bench = 0;
     void bind(futils::cmdline::option::Context& ctx) {
         bind_help(ctx);
         ctx.VarBool(&spec, "s", "spec mode");
@@ -31,9 +33,66 @@ struct Flags : futils::cmdline::templ::HelpOption {
         ctx.VarString<true>(&binary_input, "b,binary", "binary input", "<file or - (stdin)>");
         ctx.VarBool(&legacy_file_pass, "f,file", "use legacy file pass mode");
         ctx.VarBool(&jit, "jit", "enable jit compile mode");
+        ctx.VarInt(&bench, "bench", "run code by interpreter and jit <count> times each, compare results and print timing (use with -r)", "<count>");
     }
 };
 
+// run same code by interpreter and jit and print timing to stderr
+// final registers and memory of both must be same
+int bench(const Flags& flags, futils::view::rvec code, futils::view::rvec input) {
+    struct Engine {
+        std::string memory;
+        brgen::vm2::VM2 vm;
+        futils::jit::ExecutableMemory compiled;
+        std::chrono::nanoseconds elapsed{};
+    };
+    auto interpreter = std::make_unique<Engine>();
+    auto jit = std::make_unique<Engine>();
+    for (auto engine : {interpreter.get(), jit.get()}) {
+        engine->memory.resize(1024 * 1024);  // 1MB
+        engine->vm.reset(code, engine->memory, 1024);
+    }
+    auto compile_begin = std::chrono::steady_clock::now();
+    jit->compiled = jit->vm.jit_compile();
+    auto compile_time = std::chrono::steady_clock::now() - compile_begin;
+    if (!jit->compiled.valid()) {
+        print_error("cannot compile code");
+        return 1;
+    }
+    auto run_once = [&](Engine& engine, bool use_jit) {
+        std::fill(engine.memory.begin(), engine.memory.end(), 0);
+        engine.vm.reset(code, engine.memory, 1024);
+        futils::binary::bit_reader input_reader{input};
+        auto begin = std::chrono::steady_clock::now();
+        use_jit ? engine.vm.jit_resume(engine.compiled) : engine.vm.resume();
+        while (engine.vm.handle_syscall(&input_reader)) {
+            use_jit ? engine.vm.jit_resume(engine.compiled) : engine.vm.resume();
+        }
+        engine.elapsed += std::chrono::steady_clock::now() - begin;
+    };
+    for (size_t i = 0; i < flags.bench; i++) {
+        run_once(*interpreter, false);
+        run_once(*jit, true);
+        for (size_t r = 0; r < size_t(brgen::vm2::Register::REGISTER_COUNT); r++) {
+            if (interpreter->vm.read_register(brgen::vm2::Register(r)) != jit->vm.read_register(brgen::vm2::Register(r))) {
+                print_error("jit result differs from interpreter at register ", std::to_string(r));
+                return 1;
+            }
+        }
+        if (interpreter->memory != jit->memory) {
+            print_error("jit result differs from interpreter at memory");
+            return 1;
+        }
+    }
+    auto to_us = [](auto d) {
+        return std::to_string(std::chrono::duration_cast<std::chrono::microseconds>(d).count());
+    };
+    cerr << "iterations: " << std::to_string(flags.bench) << "\n";
+    cerr << "interpreter: " << to_us(interpreter->elapsed) << "us\n";
+    cerr << "jit: " << to_us(jit->elapsed) << "us (compile: " << to_us(compile_time) << "us)\n";
+    return 0;
+}
+
 int run(const Flags& flags, futils::view::rvec code) {
     futils::file::FileStream<std::string> fs{futils::file::File::stdin_file()};
     using HexFilter = futils::number::hex::HexFilter<std::string, futils::byte, futils::binary::reader>;
@@ -56,6 +115,13 @@ int run(const Flags& flags, futils::view::rvec code) {
             input_reader = futils::binary::reader(hex_filter->get_read_handler(), hex_filter.get());
         }
     }
+    if (flags.bench) {
+        if (flags.hex || flags.binary_input == "-") {
+            print_error("bench mode requires binary input from file");
+            return 1;
+        }
+        return bench(flags, code, input);
+    }
     std::string memory;
     memory.resize(1024 * 1024);  // 1MB
     brgen::vm2::VM2 vm;
@@ -66,8 +132,10 @@ int run(const Flags& flags, futils::view::rvec code) {
             print_error("cannot compile code");
             return 1;
         }
-        auto f = compiled.as_function<std::uintptr_t, std::uintptr_t>();
-        f(0);
+        vm.jit_resume(compiled);
+        while (vm.handle_syscall(&input_reader)) {
+            vm.jit_resume(compiled);
+        }
         return 0;
     }
     vm.resume();
@@ -0,0 +1,513 @@
+/*license*/
+#pragma once
+#include <core/lexer/token.h>
+#include <core/common/file.h>
+#include <core/ast/traverse.h>
+#include <core/ast/node/deep_copy.h>
+#include <list>
+#include <algorithm>
+#include <optional>
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <json/convert_json.h>
+
+// document store for src2json session mode (--stdin-session)
+// session keeps text, token list and ast of each top-level block of opened documents
+// and re-lexes/re-parses only blocks changed by text deltas
+namespace src2json::session {
+
+    // position in LSP style. character is counted in interpret mode unit
+    struct Position {
+        size_t line = 0;
+        size_t character = 0;
+
+        bool from_json(auto&& js) {
+            JSON_PARAM_BEGIN(*this, js)
+            FROM_JSON_PARAM(line, "line")
+            FROM_JSON_PARAM(character, "character")
+            JSON_PARAM_END()
+        }
+    };
+
+    struct TextChange {
+        Position start;
+        Position end;
+        std::string text;
+
+        bool from_json(auto&& js) {
+            JSON_PARAM_BEGIN(*this, js)
+            FROM_JSON_PARAM(start, "start")
+            FROM_JSON_PARAM(end, "end")
+            FROM_JSON_PARAM(text, "text")
+            JSON_PARAM_END()
+        }
+    };
+
+    // json_text of GenerateSource in session mode. GenerateSource::name is document name
+    // {"method":"open","text":"..."}
+    // {"method":"change","changes":[{"start":{"line":0,"character":0},"end":{...},"text":"..."}]}
+    // {"method":"close"}
+    // {"method":"lex"} / {"method":"parse"}
+    struct Request {
+        std::string method;
+
+        bool from_json(auto&& js) {
+            JSON_PARAM_BEGIN(*this, js)
+            FROM_JSON_PARAM(method, "method")
+            JSON_PARAM_END()
+        }
+    };
+
+    struct OpenRequest {
+        std::string text;
+
+        bool from_json(auto&& js) {
+            JSON_PARAM_BEGIN(*this, js)
+            FROM_JSON_PARAM(text, "text")
+            JSON_PARAM_END()
+        }
+    };
+
+    struct ChangeRequest {
+        std::vector<TextChange> changes;
+
+        bool from_json(auto&& js) {
+            JSON_PARAM_BEGIN(*this, js)
+            FROM_JSON_PARAM(changes, "changes")
+            JSON_PARAM_END()
+        }
+    };
+
+    // count code units of utf8 text in interpret mode
+    inline size_t count_units(std::string_view text, brgen::UtfMode mode) {
+        if (mode == brgen::UtfMode::utf8) {
+            return text.size();
+        }
+        size_t count = 0;
+        for (unsigned char c : text) {
+            if ((c & 0xC0) == 0x80) {
+                continue;  // continuation byte
+            }
+            count++;
+            if (mode == brgen::UtfMode::utf16 && c >= 0xF0) {
+                count++;  // surrogate pair
+            }
+        }
+        return count;
+    }
+
+    // convert position to byte offset of utf8 text. clamped to text size
+    inline size_t to_offset(std::string_view text, Position pos, brgen::UtfMode mode) {
+        size_t offset = 0;
+        for (size_t line = 0; line < pos.line; line++) {
+            auto next = text.find('\n', offset);
+            if (next == text.npos) {
+                return text.size();
+            }
+            offset = next + 1;
+        }
+        size_t units = 0;
+        while (offset < text.size() && units < pos.character && text[offset] != '\n') {
+            unsigned char c = text[offset];
+            size_t len = 1;
+            if (c >= 0xF0) {
+                len = 4;
+            }
+            else if (c >= 0xE0) {
+                len = 3;
+            }
+            else if (c >= 0xC0) {
+                len = 2;
+            }
+            if (mode == brgen::UtfMode::utf8) {
+                units += len;
+            }
+            else if (mode == brgen::UtfMode::utf16 && len == 4) {
+                units += 2;
+            }
+            else {
+                units += 1;
+            }
+            offset = std::min(offset + len, text.size());
+        }
+        return offset;
+    }
+
+    // top-level block begins at line start which is not indented, empty or comment line
+    inline bool is_block_start(std::string_view text, size_t offset) {
+        if (offset >= text.size()) {
+            return false;
+        }
+        auto c = text[offset];
+        return c != ' ' && c != '\t' && c != '\r' && c != '\n' && c != '#';
+    }
+
+    struct Block {
+        std::string text;
+        std::list<brgen::lexer::Token> tokens;  // loc relative to block start
+    };
+
+    struct LexStat {
+        size_t reused_blocks = 0;
+        size_t relexed_blocks = 0;
+        bool full_lex = false;
+        size_t reused_parse_blocks = 0;
+        size_t reparsed_blocks = 0;
+        bool full_parse = false;
+    };
+
+    // moves locations of block ast, which was parsed as a single file, to its place in document
+    struct LocShift {
+        size_t unit_offset = 0;
+        size_t line_offset = 0;
+        brgen::lexer::FileIndex file = 0;
+        std::set<const void*> visited;
+
+        void shift(brgen::lexer::Loc& loc) {
+            if (loc.file == brgen::lexer::builtin) {
+                return;  // not from source text
+            }
+            loc.pos.begin += unit_offset;
+            loc.pos.end += unit_offset;
+            loc.line += line_offset;
+            loc.file = file;
+        }
+
+        void scope(const brgen::ast::scope_ptr& s) {
+            if (!s || !visited.insert(s.get()).second) {
+                return;
+            }
+            shift(s->loc);
+            scope(s->branch);
+            scope(s->next);
+        }
+
+        void node(const std::shared_ptr<brgen::ast::Node>& n) {
+            if (!n || !visited.insert(n.get()).second) {
+                return;
+            }
+            brgen::ast::visit(n, [&](auto&& f) {
+                f->dump([&](auto, auto& value) {
+                    using V = std::decay_t<decltype(value)>;
+                    if constexpr (std::is_same_v<V, brgen::lexer::Loc>) {
+                        shift(value);
+                    }
+                    else if constexpr (std::is_same_v<V, brgen::ast::scope_ptr>) {
+                        scope(value);
+                    }
+                });
+            });
+            brgen::ast::traverse(n, [&](auto&& child) {
+                node(child);
+            });
+        }
+    };
+
+    inline bool is_definition(brgen::ast::IdentUsage usage) {
+        return usage >= brgen::ast::IdentUsage::define_variable &&
+               usage <= brgen::ast::IdentUsage::define_type_parameter;
+    }
+
+    // appends block (copied and shifted) to document as the parser would have continued.
+    // global scope of block is chained after last top-level scope of document.
+    // returns false if block defines a name already defined by previous block;
+    // parser reports it, so document must be parsed as whole
+    inline bool append_block(const std::shared_ptr<brgen::ast::Program>& doc, const std::shared_ptr<brgen::ast::Program>& block,
+                             std::set<std::string>& defined, std::shared_ptr<brgen::ast::Field>& last_field) {
+        for (auto s = block->global_scope; s; s = s->next) {
+            for (auto& w : s->objects) {
+                auto ident = w.lock();
+                if (ident && is_definition(ident->usage) && !defined.insert(ident->ident).second) {
+                    return false;
+                }
+            }
+        }
+        for (auto& e : block->elements) {
+            doc->elements.push_back(std::move(e));
+        }
+        for (auto& m : block->struct_type->fields) {
+            m->belong_struct = doc->struct_type;
+            if (auto f = brgen::ast::as<brgen::ast::Field>(m)) {
+                if (last_field) {
+                    last_field->next = brgen::ast::cast_to<brgen::ast::Field>(m);
+                }
+                last_field = brgen::ast::cast_to<brgen::ast::Field>(m);
+            }
+            doc->struct_type->fields.push_back(std::move(m));
+        }
+        doc->metadata.insert(doc->metadata.end(), block->metadata.begin(), block->metadata.end());
+        auto root = block->global_scope;
+        for (auto s = root; s; s = s->next) {
+            s->owner = doc;
+        }
+        if (!doc->global_scope) {
+            doc->global_scope = root;
+            return true;
+        }
+        auto tail = doc->global_scope;
+        while (tail->next) {
+            tail = tail->next;
+        }
+        // same as scope ScopeStack creates after a branch
+        tail->next = root;
+        root->prev = tail;
+        root->branch_root = false;
+        root->loc = {};
+        return true;
+    }
+
+    // same node as Stream::get_comments returns when comments of a and b are pending together
+    inline std::shared_ptr<brgen::ast::Node> join_comments(std::shared_ptr<brgen::ast::Node> a, std::shared_ptr<brgen::ast::Node> b) {
+        if (!a) {
+            return b;
+        }
+        if (!b) {
+            return a;
+        }
+        std::vector<std::shared_ptr<brgen::ast::Comment>> comments;
+        auto add = [&](const std::shared_ptr<brgen::ast::Node>& n) {
+            if (auto c = brgen::ast::as<brgen::ast::Comment>(n)) {
+                comments.push_back(brgen::ast::cast_to<brgen::ast::Comment>(n));
+            }
+            else if (auto g = brgen::ast::as<brgen::ast::CommentGroup>(n)) {
+                comments.insert(comments.end(), g->comments.begin(), g->comments.end());
+            }
+        };
+        add(a);
+        add(b);
+        auto loc = comments[0]->loc;
+        return std::make_shared<brgen::ast::CommentGroup>(loc, std::move(comments));
+    }
+
+    // parser collects pending comments before each top-level statement, so comments after
+    // last statement of a block belong to first statement of next block.
+    // attaches them as Program parser does (Member::comment, otherwise element before statement)
+    inline void attach_leading_comment(brgen::ast::Program& block, std::shared_ptr<brgen::ast::Node>&& comment) {
+        if (!comment) {
+            return;
+        }
+        auto& first = block.elements.front();
+        if (auto member = brgen::ast::as<brgen::ast::Member>(first)) {
+            member->comment = join_comments(std::move(comment), std::move(member->comment));
+        }
+        else if (brgen::ast::as<brgen::ast::Comment>(first) || brgen::ast::as<brgen::ast::CommentGroup>(first)) {
+            first = join_comments(std::move(comment), std::move(first));
+        }
+        else {
+            block.elements.insert(block.elements.begin(), std::move(comment));
+        }
+    }
+
+    // ast of block parsed as a single file. never modified after parsed; document gets deep copy
+    struct ParsedBlock {
+        std::shared_ptr<brgen::ast::Program> ast;
+        // comments left pending after last statement (only if comments are collected)
+        std::shared_ptr<brgen::ast::Node> trailing_comment;
+        bool local_passes = false;  // middle passes local to each statement were applied
+    };
+
+    struct Document {
+        std::string text;
+        std::uint64_t version = 0;
+        std::vector<Block> blocks;
+
+        // key is block text
+        std::map<std::string, ParsedBlock, std::less<>> parsed_blocks;
+
+        // cache of latest outputs. invalidated by change
+        std::optional<std::string> tokens_json;
+        std::optional<std::string> ast_json;
+
+        void set_text(std::string&& new_text) {
+            text = std::move(new_text);
+            version++;
+            tokens_json.reset();
+            ast_json.reset();
+        }
+
+        void apply(const std::vector<TextChange>& changes, brgen::UtfMode mode) {
+            std::string new_text = text;
+            for (auto& change : changes) {
+                auto begin = to_offset(new_text, change.start, mode);
+                auto end = to_offset(new_text, change.end, mode);
+                if (end < begin) {
+                    std::swap(begin, end);
+                }
+                new_text.replace(begin, end - begin, change.text);
+            }
+            set_text(std::move(new_text));
+        }
+
+        // split text into top-level blocks
+        std::vector<std::string_view> split_blocks() const {
+            std::vector<std::string_view> result;
+            std::string_view view = text;
+            size_t begin = 0;
+            size_t offset = 0;
+            while (offset < view.size()) {
+                auto next = view.find('\n', offset);
+                if (next == view.npos) {
+                    break;
+                }
+                offset = next + 1;
+                if (is_block_start(view, offset)) {
+                    result.push_back(view.substr(begin, offset - begin));
+                    begin = offset;
+                }
+            }
+            if (begin < view.size() || result.empty()) {
+                result.push_back(view.substr(begin));
+            }
+            return result;
+        }
+
+        // lex document reusing tokens of unchanged blocks
+        // lex_block lexes text as a single file and returns expected<std::list<Token>, LocationError>
+        // if any block cannot be lexed standalone, whole text is lexed by lex_full
+        auto lex(brgen::UtfMode mode, auto&& lex_block, auto&& lex_full, LexStat& stat) -> decltype(lex_full(std::string_view{})) {
+            auto views = split_blocks();
+            std::map<std::string_view, const Block*> prev;
+            for (auto& b : blocks) {
+                prev.emplace(b.text, &b);
+            }
+            std::vector<Block> new_blocks;
+            new_blocks.reserve(views.size());
+            for (auto& v : views) {
+                Block b;
+                b.text = std::string(v);
+                if (auto found = prev.find(v); found != prev.end()) {
+                    b.tokens = found->second->tokens;
+                    stat.reused_blocks++;
+                }
+                else {
+                    auto res = lex_block(std::string_view(b.text));
+                    // token which may continue to next block means boundary is not valid
+                    if (!res || (res->size() && res->back().tag != brgen::lexer::Tag::line && &v != &views.back())) {
+                        stat.full_lex = true;
+                        blocks.clear();
+                        return lex_full(std::string_view(text));
+                    }
+                    b.tokens = std::move(*res);
+                    stat.relexed_blocks++;
+                }
+                new_blocks.push_back(std::move(b));
+            }
+            blocks = std::move(new_blocks);
+            std::list<brgen::lexer::Token> tokens;
+            size_t unit_offset = 0;
+            size_t line_offset = 0;
+            for (auto& b : blocks) {
+                for (auto& tok : b.tokens) {
+                    auto& t = tokens.emplace_back(tok);
+                    t.loc.pos.begin += unit_offset;
+                    t.loc.pos.end += unit_offset;
+                    t.loc.line += line_offset;
+                }
+                unit_offset += count_units(b.text, mode);
+                line_offset += std::count(b.text.begin(), b.text.end(), '\n');
+            }
+            return tokens;
+        }
+
+        // assemble ast of document from asts of blocks, reusing asts of unchanged blocks.
+        // parse_block parses text as a single file (applying local middle passes if local_passes)
+        // and returns ParsedBlock with pending comments after the parse; ast is nullptr on error or warning.
+        // returns nullptr if any block cannot be parsed standalone; then caller parses whole text
+        std::shared_ptr<brgen::ast::Program> parse(brgen::UtfMode mode, brgen::lexer::FileIndex file, bool local_passes,
+                                                   auto&& parse_block, LexStat& stat) {
+            using NodeMap = std::map<std::shared_ptr<brgen::ast::Node>, std::shared_ptr<brgen::ast::Node>>;
+            using ScopeMap = std::map<std::shared_ptr<brgen::ast::Scope>, std::shared_ptr<brgen::ast::Scope>>;
+            auto views = split_blocks();
+            std::map<std::string, ParsedBlock, std::less<>> new_parsed;
+            auto doc = std::make_shared<brgen::ast::Program>();
+            std::set<std::string> defined;
+            std::shared_ptr<brgen::ast::Field> last_field;
+            std::shared_ptr<brgen::ast::Node> pending_comment;
+            size_t unit_offset = 0;
+            size_t line_offset = 0;
+            auto fail = [&] {
+                stat.full_parse = true;
+                parsed_blocks.clear();
+                return nullptr;
+            };
+            for (auto& v : views) {
+                ParsedBlock block;
+                if (auto found = parsed_blocks.find(v); found != parsed_blocks.end() && found->second.local_passes == local_passes) {
+                    block = found->second;
+                    stat.reused_parse_blocks++;
+                }
+                else {
+                    block = parse_block(v);
+                    if (!block.ast) {
+                        return fail();
+                    }
+                    block.local_passes = local_passes;
+                    stat.reparsed_blocks++;
+                }
+                new_parsed.try_emplace(std::string(v), block);
+                NodeMap nm;
+                ScopeMap sm;
+                auto copy = brgen::ast::deep_copy(block.ast, nm, sm);
+                std::shared_ptr<brgen::ast::Node> trailing;
+                if (block.trailing_comment) {
+                    trailing = brgen::ast::deep_copy(block.trailing_comment, nm, sm);
+                }
+                LocShift shift{.unit_offset = unit_offset, .line_offset = line_offset, .file = file};
+                shift.node(copy);
+                shift.node(trailing);
+                if (copy->elements.empty()) {
+                    pending_comment = join_comments(std::move(pending_comment), std::move(trailing));
+                }
+                else {
+                    attach_leading_comment(*copy, std::move(pending_comment));
+                    pending_comment = std::move(trailing);
+                }
+                if (!doc->struct_type) {
+                    doc->loc = copy->loc;
+                    doc->struct_type = std::make_shared<brgen::ast::StructType>(doc->loc);
+                    doc->struct_type->base = doc;
+                }
+                if (!append_block(doc, copy, defined, last_field)) {
+                    return fail();
+                }
+                unit_offset += count_units(v, mode);
+                line_offset += std::count(v.begin(), v.end(), '\n');
+            }
+            // comments after last statement of document are dropped by parser too
+            parsed_blocks = std::move(new_parsed);
+            // same as parser: global scope spans whole file
+            doc->global_scope->loc = doc->loc;
+            doc->global_scope->loc.pos.begin = 0;
+            if (!doc->elements.empty()) {
+                doc->global_scope->loc.pos.end = doc->elements.back()->loc.pos.end;
+            }
+            return doc;
+        }
+    };
+
+    struct DocumentStore {
+        std::map<std::string, Document> documents;
+
+        Document* get(const std::string& name) {
+            auto found = documents.find(name);
+            if (found == documents.end()) {
+                return nullptr;
+            }
+            return &found->second;
+        }
+
+        Document& open(const std::string& name, std::string&& text) {
+            auto& doc = documents[name];
+            doc.blocks.clear();
+            doc.set_text(std::move(text));
+            return doc;
+        }
+
+        void close(const std::string& name) {
+            documents.erase(name);
+        }
+    };
+}  // namespace src2json::session
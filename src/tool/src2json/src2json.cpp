@@ -4,6 +4,7 @@
 #include <wrap/cout.h>
 #include <core/ast/parse.h>
 #include <core/ast/json.h>
+#include <core/ast/binary.h>
 #include <wrap/iocommon.h>
 #include <console/ansiesc.h>
 #include <core/middle/resolve_import.h>
@@ -33,6 +34,8 @@
 #include "entry.h"
 #include "../common/load_json.h"
 #include "version.h"
+#include "session.h"
+#include <chrono>
 
 struct Flags : futils::cmdline::templ::HelpOption {
     std::vector<std::string_view> args;
@@ -65,6 +68,7 @@ struct Flags : futils::cmdline::templ::HelpOption {
     bool print_json = false;
     bool print_on_error = false;
     bool debug_json = false;
+    bool binary_ast = false;
 
     bool no_color = false;
 
@@ -83,6 +87,8 @@ struct Flags : futils::cmdline::templ::HelpOption {
 
     size_t tokenization_limit = 0;
 
+    size_t import_jobs = 0;
+
     bool collect_comments = false;
 
     bool report_error = false;
@@ -106,6 +112,8 @@ struct Flags : futils::cmdline::templ::HelpOption {
 
     bool error_tolerant = false;
 
+    bool stdin_session = false;
+
     void bind(futils::cmdline::option::Context& ctx) {
         (void)typeid(char8_t);
         (void)typeid(char8_t*);
@@ -142,6 +150,7 @@ struct Flags : futils::cmdline::templ::HelpOption {
         ctx.VarBool(&omit_json_warning, "omit-json-warning", "omit warning from json output (if --print-json or --print-on-error)");
 
         ctx.VarBool(&debug_json, "d,debug-json", "debug mode json output (not parsable ast, only for debug. use with --print-ast)");
+        ctx.VarBool(&binary_ast, "binary-ast", "print ast in binary ast format (see core/ast/binary.h) instead of json (ignored if --debug-json) (stdout must not be tty) (read only by C++ tools; go generators need json)");
 
         // for compatibility and usability
         ctx.VarBoolFunc(&cerr_color_mode, "no-color", "disable color output (both stdout and stderr)", [&](bool y, auto) {
@@ -175,6 +184,8 @@ struct Flags : futils::cmdline::templ::HelpOption {
         ctx.VarString<true>(&argv_input, "argv", "treat cmdline arg as input (this is not designed for human. this is used from other process or emscripten call)", "<source code>");
         ctx.VarInt(&tokenization_limit, "tokenization-limit", "set tokenization limit (use with --lexer) (0=unlimited)", "<size>");
 
+        ctx.VarInt(&import_jobs, "import-jobs", "set number of threads to parse imported files (0=hardware concurrency, 1=serial)", "<num>");
+
         ctx.VarBool(&collect_comments, "collect-comments", "collect comments");
 
         ctx.VarMap<std::string, brgen::UtfMode, std::map>(
@@ -202,6 +213,7 @@ struct Flags : futils::cmdline::templ::HelpOption {
         ctx.VarBool(&use_unsafe_escape, "unsafe-escape", "use unsafe escape (this flag make json escape via http unsafe; ansi color escape sequence is not escaped)");
 
         ctx.VarBool(&error_tolerant, "error-tolerant", "error tolerant mode (for lsp) (experimental)");
+        ctx.VarBool(&stdin_session, "stdin-session", "run as long-lived session over stdin/stdout with generator request framing; keep opened documents and re-lex only changed blocks (for lsp) (experimental)");
 
         ctx.VarFunc(&sized_argv_input, "sized-argv", "treat cmdline arg as input  (this is not designed for human and disabled in cli mode. this is used from other process to pass mmaped file)", "(source code)", [&](const char* data, auto) {
             sized_argv_input = data;
@@ -391,16 +403,69 @@ bool do_direct_ast_pass(Flags& flags, const Capability& cap, brgen::FileSet& fil
     return false;
 }
 
+// if set, report_error writes json to here instead of stdout (for --stdin-session)
+thread_local std::string* session_output = nullptr;
+
 auto report_error(Flags& flags, auto&& elem, brgen::FileSet& files, brgen::LocationError&& loc_err, bool warn = false, const char* key = "ast") {
     auto src_err = brgen::to_source_error(files)(loc_err);
-    if (!cout.is_tty() || flags.print_on_error) {
+    if (session_output) {
+        auto d = dump_json_file(files, false, elem, key, src_err);
+        *session_output = std::move(d.out());
+    }
+    else if (!cout.is_tty() || flags.print_on_error) {
         auto d = dump_json_file(files, false, elem, key, src_err);
         cout << futils::wrap::pack(d.out(), cout.is_tty() ? "\n" : "");
     }
     print_errors(src_err, flags.unresolved_type_as_error);
 }
 
-int parse_and_analyze(std::shared_ptr<brgen::ast::Program>* p, brgen::FileSet& files, brgen::File* input, Flags& flags, const Capability& cap, brgen::LocationError& json_out_err) {
+// middle passes which rewrite nodes inside each top-level statement without looking at others.
+// must run after resolve_import. --stdin-session applies them to each block and caches the result
+brgen::result<void> apply_local_passes(std::shared_ptr<brgen::ast::Program>& p, Flags& flags) {
+    if (!flags.not_resolve_available) {
+        auto res = brgen::middle::resolve_available(p);
+        if (!res) {
+            return res;
+        }
+        may_cancel_task();
+    }
+
+    if (!flags.not_resolve_endian_spec) {
+        brgen::middle::replace_specify_order(p);
+        may_cancel_task();
+    }
+
+    if (!flags.not_resolve_explicit_error) {
+        auto res = brgen::middle::replace_explicit_error(p);
+        if (!res) {
+            return res;
+        }
+        may_cancel_task();
+    }
+
+    if (!flags.not_resolve_io_operation) {
+        auto res = brgen::middle::resolve_io_operation(p);
+        if (!res) {
+            return res;
+        }
+        may_cancel_task();
+    }
+
+    if (!flags.not_resolve_metadata) {
+        brgen::middle::replace_metadata(p);
+        may_cancel_task();
+    }
+
+    if (!flags.not_resolve_assert) {
+        brgen::middle::replace_assert(p);
+        may_cancel_task();
+    }
+    return {};
+}
+
+// if *p is already set (--stdin-session assembled it from blocks), parsing is skipped,
+// and local passes also if local_passes_applied
+int parse_and_analyze(std::shared_ptr<brgen::ast::Program>* p, brgen::FileSet& files, brgen::File* input, Flags& flags, const Capability& cap, brgen::LocationError& json_out_err, bool local_passes_applied = false) {
     assert(p);
     auto report = [&](brgen::LocationError&& err) {
         if (json_out_err.locations.size()) {
@@ -421,23 +486,25 @@ int parse_and_analyze(std::shared_ptr<brgen::ast::Program>* p, brgen::FileSet& f
         .error_tolerant = flags.error_tolerant,
     };
 
-    auto res = do_parse(input, option, json_out_err);
+    if (!*p) {
+        auto res = do_parse(input, option, json_out_err);
 
-    if (!res) {
-        report(std::move(res.error()));
-        return exit_err;
-    }
+        if (!res) {
+            report(std::move(res.error()));
+            return exit_err;
+        }
 
-    may_cancel_task();
+        may_cancel_task();
 
-    *p = std::move(*res);
+        *p = std::move(*res);
+    }
 
     if (!flags.not_resolve_import) {
         if (!cap.importer) {
             print_error("import is disabled");
             return exit_err;
         }
-        auto res2 = brgen::middle::resolve_import(*p, files, json_out_err, option);
+        auto res2 = brgen::middle::resolve_import(*p, files, json_out_err, option, flags.import_jobs);
         if (!res2) {
             report(std::move(res2.error()));
             return exit_err;
@@ -445,46 +512,12 @@ int parse_and_analyze(std::shared_ptr<brgen::ast::Program>* p, brgen::FileSet& f
         may_cancel_task();
     }
 
-    if (!flags.not_resolve_available) {
-        auto res2 = brgen::middle::resolve_available(*p);
+    if (!local_passes_applied) {
+        auto res2 = apply_local_passes(*p, flags);
         if (!res2) {
             report(std::move(res2.error()));
             return exit_err;
         }
-        may_cancel_task();
-    }
-
-    if (!flags.not_resolve_endian_spec) {
-        brgen::middle::replace_specify_order(*p);
-        may_cancel_task();
-    }
-
-    if (!flags.not_resolve_explicit_error) {
-        auto res2 = brgen::middle::replace_explicit_error(*p);
-        if (!res2) {
-            report(std::move(res2.error()));
-            return exit_err;
-        }
-        may_cancel_task();
-    }
-
-    if (!flags.not_resolve_io_operation) {
-        auto res2 = brgen::middle::resolve_io_operation(*p);
-        if (!res2) {
-            report(std::move(res2.error()));
-            return exit_err;
-        }
-        may_cancel_task();
-    }
-
-    if (!flags.not_resolve_metadata) {
-        brgen::middle::replace_metadata(*p);
-        may_cancel_task();
-    }
-
-    if (!flags.not_resolve_assert) {
-        brgen::middle::replace_assert(*p);
-        may_cancel_task();
     }
 
     if (!flags.not_resolve_type) {
@@ -671,6 +704,197 @@ int load_file(Flags& flags, brgen::FileSet& files, brgen::File*& input, const Ca
     return exit_ok;
 }
 
+void handle_session_request(Flags& flags, const Capability& cap, src2json::session::DocumentStore& store, brgen::request::GenerateSource& req) {
+    namespace session = src2json::session;
+    auto begin = std::chrono::steady_clock::now();
+    auto elapsed_us = [](auto from) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - from).count();
+    };
+    auto js = futils::json::parse<futils::json::JSON>(req.json_text);
+    session::Request r;
+    if (!futils::json::convert_from_json(js, r)) {
+        send_error_and_end(req.id, "invalid session request for ", req.name);
+        return;
+    }
+    std::optional<std::string> output;
+    session::LexStat stat;
+    bool cached = false;
+    std::int64_t phase_us = 0;
+    if (r.method == "open") {
+        session::OpenRequest o;
+        if (!futils::json::convert_from_json(js, o)) {
+            send_error_and_end(req.id, "invalid open request for ", req.name);
+            return;
+        }
+        store.open(req.name, std::move(o.text));
+    }
+    else if (r.method == "close") {
+        store.close(req.name);
+    }
+    else {
+        auto doc = store.get(req.name);
+        if (!doc) {
+            send_error_and_end(req.id, "document is not opened: ", req.name);
+            return;
+        }
+        if (r.method == "change") {
+            session::ChangeRequest c;
+            if (!futils::json::convert_from_json(js, c)) {
+                send_error_and_end(req.id, "invalid change request for ", req.name);
+                return;
+            }
+            doc->apply(c.changes, flags.interpret_mode);
+        }
+        else if (r.method == "lex") {
+            auto phase = std::chrono::steady_clock::now();
+            cached = doc->tokens_json.has_value();
+            if (!cached) {
+                brgen::FileSet files;
+                files.set_utf_mode(brgen::UtfMode::utf8, flags.interpret_mode);
+                auto index = files.add_special(req.name, std::string(doc->text));
+                if (!index) {
+                    send_error_and_end(req.id, "cannot input ", req.name, " ", brgen::to_error_message(index.error()));
+                    return;
+                }
+                auto lex_block = [&](std::string_view text) {
+                    brgen::FileSet block_files;
+                    block_files.set_utf_mode(brgen::UtfMode::utf8, flags.interpret_mode);
+                    auto block_index = block_files.add_special(req.name, std::string(text));
+                    return do_lex(block_files.get_input(*block_index), 0);
+                };
+                auto lex_full = [&](std::string_view) {
+                    return do_lex(files.get_input(*index), flags.tokenization_limit);
+                };
+                auto res = doc->lex(flags.interpret_mode, lex_block, lex_full, stat);
+                if (!res) {
+                    std::string err_json;
+                    session_output = &err_json;
+                    report_error(flags, nullptr, files, std::move(res.error()), false, "tokens");
+                    session_output = nullptr;
+                    output = std::move(err_json);  // error is not cached; next request retries
+                }
+                else {
+                    doc->tokens_json = std::move(dump_json_file(files, true, *res, "tokens", brgen::SourceError{}).out());
+                }
+            }
+            if (!output) {
+                output = *doc->tokens_json;
+            }
+            phase_us = elapsed_us(phase);
+        }
+        else if (r.method == "parse") {
+            // blocks are parsed and rewritten by local passes one by one and cached by text.
+            // passes after them (typing etc.) resolve identifiers across blocks,
+            // so they run on copy of assembled document; result is cached until next change
+            auto phase = std::chrono::steady_clock::now();
+            cached = doc->ast_json.has_value();
+            if (!cached) {
+                brgen::FileSet files;
+                files.set_utf_mode(brgen::UtfMode::utf8, flags.interpret_mode);
+                auto index = files.add_special(req.name, std::string(doc->text));
+                if (!index) {
+                    send_error_and_end(req.id, "cannot input ", req.name, " ", brgen::to_error_message(index.error()));
+                    return;
+                }
+                std::string err_json;
+                session_output = &err_json;
+                brgen::LocationError err_or_warn;
+                std::shared_ptr<brgen::ast::Program> res;
+                // imports are resolved on assembled document and local passes must follow them,
+                // so blocks are only parsed then
+                const bool local_passes = flags.not_resolve_import || doc->text.find("config.import") == doc->text.npos;
+                auto option = brgen::ast::ParseOption{
+                    .collect_comments = flags.collect_comments,
+                    .error_tolerant = flags.error_tolerant,
+                };
+                auto parse_block = [&](std::string_view text) {
+                    src2json::session::ParsedBlock parsed;
+                    brgen::FileSet block_files;
+                    block_files.set_utf_mode(brgen::UtfMode::utf8, flags.interpret_mode);
+                    auto block_index = block_files.add_special(req.name, std::string(text));
+                    if (!block_index) {
+                        return parsed;
+                    }
+                    brgen::LocationError warns;
+                    brgen::ast::Context c;
+                    auto block = c.enter_stream(block_files.get_input(*block_index), [&](brgen::ast::Stream& s) {
+                        auto prog = brgen::ast::parse(s, &warns, option);
+                        // pending comments belong to first statement of next block (see session::attach_leading_comment)
+                        parsed.trailing_comment = s.get_comments();
+                        return prog;
+                    });
+                    if (!block || warns.locations.size()) {
+                        return parsed;
+                    }
+                    if (local_passes && !apply_local_passes(*block, flags)) {
+                        return parsed;
+                    }
+                    parsed.ast = std::move(*block);
+                    return parsed;
+                };
+                res = doc->parse(flags.interpret_mode, *index, local_passes, parse_block, stat);
+                auto code = parse_and_analyze(&res, files, files.get_input(*index), flags, cap, err_or_warn, res && local_passes);
+                session_output = nullptr;
+                if (code != exit_ok) {
+                    output = std::move(err_json);
+                }
+                else {
+                    auto src_err = brgen::to_source_error(files)(err_or_warn);
+                    doc->ast_json = std::move(dump_json_file(files, true, dump_ast_json(flags, res), "ast", src_err).out());
+                }
+            }
+            if (!output) {
+                output = *doc->ast_json;
+            }
+            phase_us = elapsed_us(phase);
+        }
+        else {
+            send_error_and_end(req.id, "unknown session method: ", r.method);
+            return;
+        }
+    }
+    if (output) {
+        send_source(req.id, std::move(*output), req.name + ".json");
+    }
+    auto doc = store.get(req.name);
+    brgen::JSONWriter timing;
+    {
+        auto field = timing.object();
+        field("method", r.method);
+        field("version", doc ? doc->version : 0);
+        field("cached", cached);
+        field("phase_us", phase_us);
+        field("total_us", elapsed_us(begin));
+        field("reused_blocks", stat.reused_blocks);
+        field("relexed_blocks", stat.relexed_blocks);
+        field("full_lex", stat.full_lex);
+        field("reused_parse_blocks", stat.reused_parse_blocks);
+        field("reparsed_blocks", stat.reparsed_blocks);
+        field("full_parse", stat.full_parse);
+    }
+    send_source(req.id, std::move(timing.out()), req.name + ".timing.json");
+    send_end_response(req.id);
+}
+
+int session_main(Flags& flags, const Capability& cap) {
+    if (!cap.std_input || !cap.lexer || !cap.parser) {
+        print_error("session mode is disabled");
+        return exit_err;
+    }
+    if (flags.input_mode != brgen::UtfMode::utf8) {
+        print_error("session mode only support utf8 for --input-mode");
+        return exit_err;
+    }
+    src2json::session::DocumentStore store;
+    send_as_text = false;
+    // requests are handled in order because change must be applied before lex/parse
+    read_stdin_requests_impl([&](brgen::request::GenerateSource& req) {
+        handle_session_request(flags, cap, store, req);
+        return futils::error::Error<>{};
+    });
+    return exit_ok;
+}
+
 int Main(Flags& flags, futils::cmdline::option::Context&, const Capability& cap) {
     send_as_text = true;  // currrently, src2json not support binary mode
     if (flags.version) {
@@ -725,6 +949,10 @@ int Main(Flags& flags, futils::cmdline::option::Context&, const Capability& cap)
         print_stdio_type();
     }
 
+    if (flags.stdin_session) {
+        return session_main(flags, cap);
+    }
+
 #ifndef SRC2JSON_DLL
     if (flags.sized_argv_input != nullptr) {
         print_error("--sized-argv is only available in dll mode");
@@ -769,6 +997,11 @@ int Main(Flags& flags, futils::cmdline::option::Context&, const Capability& cap)
         return exit_err;
     }
 
+    if (flags.binary_ast && !flags.debug_json && cout.is_tty()) {
+        print_error("--binary-ast cannot write to terminal; redirect stdout to a file or pipe");
+        return exit_err;
+    }
+
     brgen::FileSet files;
     brgen::File* input = nullptr;
     auto code = load_file(flags, files, input, cap);
@@ -847,6 +1080,20 @@ int Main(Flags& flags, futils::cmdline::option::Context&, const Capability& cap)
         return exit_ok;
     }
     may_cancel_task();
+    if (flags.binary_ast && !flags.debug_json) {
+        brgen::ast::BinaryConverter c;
+        std::optional<std::string> err_json;
+        if (src_err.errs.size()) {
+            brgen::JSONWriter e;
+            e.set_no_colon_space(true);
+            e.value(src_err);
+            err_json = std::move(e.out());
+        }
+        auto out = c.encode(res, files.file_list(), err_json);
+        may_cancel_task();
+        cout << out;
+        return exit_ok;
+    }
     auto d = dump_json_file(files, true, dump_ast_json(flags, res), "ast", src_err);
     may_cancel_task();
     cout << futils::wrap::pack(d.out(), cout.is_tty() ? "\n" : "");
@@ -12,6 +12,7 @@ namespace brgen::vm2 {
         get_register(Register::TRAP) = 0;
         get_register(Register::TRAP_REASON) = 0;
         get_register(Register::BP) = full_memory.size();
+        allocation_map.clear();
     }
 
     struct VM2Helper {
@@ -86,9 +87,9 @@ namespace brgen::vm2 {
             return true;
         }
 
-        static bool pop(VM2& vm, std::uint64_t& value) {
+        // stack_base_addr is BP for POP and end of memory for RET (saved PC and BP are above BP)
+        static bool pop(VM2& vm, std::uint64_t& value, std::uint64_t stack_base_addr) {
             auto stack_top_addr = vm.get_register(Register::SP);
-            auto stack_base_addr = vm.get_register(Register::BP);
             if (stack_top_addr + 8 > stack_base_addr) {
                 vm.set_trap(TrapNumber::STACK_UNDERFLOW, stack_top_addr);
                 return false;
@@ -203,9 +204,10 @@ namespace brgen::vm2 {
             }
             case Op2::POP: {
                 auto pop = *inst->pop();
-                if (!VM2Helper::pop(*this, get_register(pop.operand))) {
+                if (!VM2Helper::pop(*this, get_register(pop.operand), get_register(Register::BP))) {
                     return;
                 }
+                break;
             }
             case Op2::CALL: {
                 auto call = *inst->call();
@@ -231,10 +233,10 @@ namespace brgen::vm2 {
             }
             case Op2::RET: {
                 get_register(Register::SP) = get_register(Register::BP);   // restore SP
-                if (!VM2Helper::pop(*this, get_register(Register::PC))) {  // restore PC
+                if (!VM2Helper::pop(*this, get_register(Register::PC), full_memory.size())) {  // restore PC
                     return;
                 }
-                if (!VM2Helper::pop(*this, get_register(Register::BP))) {  // restore BP
+                if (!VM2Helper::pop(*this, get_register(Register::BP), full_memory.size())) {  // restore BP
                     return;
                 }
                 if (!VM2Helper::jump(*this, Register::PC)) {  // jump to return address
@@ -264,6 +266,7 @@ namespace brgen::vm2 {
                         set_trap(TrapNumber::INVALID_INSTRUCTION, fail_offset);
                         return;
                 }
+                break;
             }
             case Op2::ADD:
             case Op2::SUB:
@@ -274,7 +277,11 @@ namespace brgen::vm2 {
             case Op2::OR:
             case Op2::XOR:
             case Op2::SHL:
-            case Op2::SHR: {
+            case Op2::SHR:
+            case Op2::EQ:
+            case Op2::NE:
+            case Op2::LT:
+            case Op2::LE: {
                 auto bin = *inst->binary_operator();
                 switch (inst->op()) {
                     case Op2::ADD:
@@ -315,6 +322,18 @@ namespace brgen::vm2 {
                     case Op2::SHR:
                         get_register(bin.result) = get_register(bin.left) >> get_register(bin.right);
                         break;
+                    case Op2::EQ:
+                        get_register(bin.result) = get_register(bin.left) == get_register(bin.right);
+                        break;
+                    case Op2::NE:
+                        get_register(bin.result) = get_register(bin.left) != get_register(bin.right);
+                        break;
+                    case Op2::LT:
+                        get_register(bin.result) = get_register(bin.left) < get_register(bin.right);
+                        break;
+                    case Op2::LE:
+                        get_register(bin.result) = get_register(bin.left) <= get_register(bin.right);
+                        break;
                     default:
                         set_trap(TrapNumber::INVALID_INSTRUCTION, fail_offset);
                         return;
@@ -6,6 +6,7 @@
 #include <unordered_map>
 #include <binary/bit.h>
 #include <list>
+#include <vector>
 #include <jit/relocation.h>
 #include <jit/jit_memory.h>
 
@@ -16,6 +17,8 @@ namespace brgen::vm2 {
         bool used = false;
     };
 
+    struct JITAssembler;
+
     struct VM2 {
        private:
         futils::view::wvec full_memory;
@@ -24,6 +27,12 @@ namespace brgen::vm2 {
         std::uint64_t registers[size_t(Register::REGISTER_COUNT)] = {0};
         std::list<AllocationEntry> allocation_map;
         bool safe_call = false;
+        // native code offset of each instruction offset (0 means not compiled). filled by jit_compile
+        std::vector<std::uint64_t> jit_entries;
+        // native code offset just after FUNC_ENTRY for safe call mode
+        std::vector<std::uint64_t> jit_call_entries;
+        // instruction offset to resume at when safe call target is not FUNC_ENTRY. filled only in safe call mode
+        std::vector<std::uint64_t> jit_call_resumes;
 
         std::uint64_t& get_register(Register reg) {
             return registers[size_t(reg)];
@@ -36,7 +45,7 @@ namespace brgen::vm2 {
 
         friend struct VM2Helper;
 
-        void jit_compile_inst(futils::binary::writer& w, std::vector<futils::jit::RelocationEntry>& relocation);
+        void jit_compile_inst(JITAssembler& a);
 
        public:
         void reset(futils::view::rvec instructions, futils::view::wvec memory, size_t stack_size);
@@ -63,12 +72,21 @@ namespace brgen::vm2 {
             return registers[size_t(Register::TRAP_REASON)];
         }
 
+        std::uint64_t read_register(Register reg) const {
+            return registers[size_t(reg)];
+        }
+
         void set_syscall_return(std::uint64_t value) {
             get_register(Register::R0) = value;
         }
 
+        // compiled code refers to this VM's registers and memory directly,
+        // so VM must not be moved or reset with other memory while code is used
         futils::jit::ExecutableMemory jit_compile();
 
+        // same as resume() but runs compiled code. instructions which are not compiled are executed by step()
+        void jit_resume(futils::jit::ExecutableMemory& code);
+
         void instruction_top() {
             instructions.reset(0);
         }
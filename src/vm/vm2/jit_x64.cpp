@@ -1,155 +1,713 @@
 /*license*/
-#pragma once
-#include <jit/x64.h>
-#include <jit/x64_coroutine.h>
 #include <jit/jit_memory.h>
 #include "interpret.h"
 #include <string>
-#include <platform/detect.h>
-#include <bit>
+#include <optional>
 #include <cstring>
 
 namespace brgen::vm2 {
 
-    auto map_register(Register reg) {
-        switch (reg) {
-            case Register::R0:
-                return futils::jit::x64::Register::RAX;
-            case Register::R1:
-                return futils::jit::x64::Register::RCX;
-            case Register::R2:
-                return futils::jit::x64::Register::RDX;
-            case Register::R3:
-                return futils::jit::x64::Register::RBX;
-            case Register::R4:
-                return futils::jit::x64::Register::RSP;
-            case Register::R5:
-                return futils::jit::x64::Register::RBP;
-            case Register::R6:
-                return futils::jit::x64::Register::RSI;
-            case Register::R7:
-                return futils::jit::x64::Register::RDI;
-            case Register::R8:
-                return futils::jit::x64::Register::R8;
-            case Register::R9:
-                return futils::jit::x64::Register::R9;
-            case Register::R10:
-                return futils::jit::x64::Register::R10;
-            case Register::R11:
-                return futils::jit::x64::Register::R11;
-            case Register::R12:
-                return futils::jit::x64::Register::R12;
-            case Register::R13:
-                return futils::jit::x64::Register::R13;
-            case Register::R14:
-                return futils::jit::x64::Register::R14;
-            case Register::OBJECT_POINTER:
-                return futils::jit::x64::Register::R15;
-            default:
-                break;
-        }
-        return futils::jit::x64::Register::RAX;
-    }
+    // x86-64 JIT of vm2
+    // VM registers are kept in VM2::registers (base address is in RBX) instead of native registers,
+    // so trap and syscall return to host with the same state as interpreter
+    // and execution can be continued by either interpreter or compiled code.
+    // compiled code is called as std::uintptr_t(std::uintptr_t native_entry_offset)
+    // and returns instruction offset to resume from
+    enum class NativeRegister : std::uint8_t {
+        RAX = 0,
+        RCX = 1,
+        RDX = 2,
+        RBX = 3,
+        RDI = 7,
+        R8 = 8,
+    };
+
+    enum class Cond : std::uint8_t {
+        B = 0x2,
+        AE = 0x3,
+        E = 0x4,
+        NE = 0x5,
+        BE = 0x6,
+        A = 0x7,
+    };
+
+    namespace alu {
+        constexpr std::uint8_t ADD = 0x01;
+        constexpr std::uint8_t OR = 0x09;
+        constexpr std::uint8_t AND = 0x21;
+        constexpr std::uint8_t SUB = 0x29;
+        constexpr std::uint8_t XOR = 0x31;
+        constexpr std::uint8_t CMP = 0x39;
+        constexpr std::uint8_t TEST = 0x85;
+        constexpr std::uint8_t MOV = 0x89;
+    }  // namespace alu
+
+    struct JITAssembler {
+        using R = NativeRegister;
+        std::string code;
+        size_t exit_offset = 0;
+        std::uint64_t memory_base = 0;
+        std::uint64_t memory_size = 0;
+        std::uint64_t stack_size = 0;
+        std::uint64_t code_size = 0;
+        std::uint64_t entries = 0;       // address of VM2::jit_entries
+        std::uint64_t call_entries = 0;  // address of VM2::jit_call_entries
+        std::uint64_t call_resumes = 0;  // address of VM2::jit_call_resumes
+
+        void u8(std::uint8_t v) {
+            code.push_back(char(v));
+        }
+
+        void u32(std::uint32_t v) {
+            for (size_t i = 0; i < 4; i++) {
+                u8(std::uint8_t(v >> (i * 8)));
+            }
+        }
+
+        void u64(std::uint64_t v) {
+            for (size_t i = 0; i < 8; i++) {
+                u8(std::uint8_t(v >> (i * 8)));
+            }
+        }
+
+        static std::uint8_t low(R r) {
+            return std::uint8_t(r) & 7;
+        }
+
+        static std::uint32_t slot(Register reg) {
+            return std::uint32_t(reg) * sizeof(std::uint64_t);
+        }
+
+        void rex_w(R reg, R rm) {
+            u8(0x48 | (std::uint8_t(reg) >= 8 ? 0x4 : 0) | (std::uint8_t(rm) >= 8 ? 0x1 : 0));
+        }
+
+        void modrm(std::uint8_t mod, std::uint8_t reg, std::uint8_t rm) {
+            u8((mod << 6) | (reg << 3) | rm);
+        }
+
+        // mov r, imm64
+        void mov_imm(R r, std::uint64_t v) {
+            rex_w(R::RAX, r);
+            u8(0xB8 + low(r));
+            u64(v);
+        }
+
+        // mov r, [rbx + slot(reg)]
+        void load_reg(R r, Register reg) {
+            rex_w(r, R::RAX);
+            u8(0x8B);
+            modrm(2, low(r), low(R::RBX));
+            u32(slot(reg));
+        }
+
+        // mov [rbx + slot(reg)], r
+        void store_reg(Register reg, R r) {
+            rex_w(r, R::RAX);
+            u8(0x89);
+            modrm(2, low(r), low(R::RBX));
+            u32(slot(reg));
+        }
+
+        // mov qword [rbx + slot(reg)], simm32
+        void store_reg_imm(Register reg, std::uint32_t v) {
+            rex_w(R::RAX, R::RAX);
+            u8(0xC7);
+            modrm(2, 0, low(R::RBX));
+            u32(slot(reg));
+            u32(v);
+        }
+
+        // op dst, src
+        void op(std::uint8_t opcode, R dst, R src) {
+            rex_w(src, dst);
+            u8(opcode);
+            modrm(3, low(src), low(dst));
+        }
+
+        // group opcode (F7 /2 not, /3 neg, /6 div, FF /0 inc, /1 dec, D3 /4 shl, /5 shr)
+        void group(std::uint8_t opcode, std::uint8_t ext, R r) {
+            rex_w(R::RAX, r);
+            u8(opcode);
+            modrm(3, ext, low(r));
+        }
+
+        // imul dst, src
+        void imul(R dst, R src) {
+            rex_w(dst, src);
+            u8(0x0F);
+            u8(0xAF);
+            modrm(3, low(dst), low(src));
+        }
+
+        // add r, simm32
+        void add_imm(R r, std::uint32_t v) {
+            rex_w(R::RAX, r);
+            u8(0x81);
+            modrm(3, 0, low(r));
+            u32(v);
+        }
+
+        // cmp r, simm32
+        void cmp_imm(R r, std::uint32_t v) {
+            rex_w(R::RAX, r);
+            u8(0x81);
+            modrm(3, 7, low(r));
+            u32(v);
+        }
+
+        // shl/shr r, imm8
+        void shift_imm(std::uint8_t ext, R r, std::uint8_t v) {
+            rex_w(R::RAX, r);
+            u8(0xC1);
+            modrm(3, ext, low(r));
+            u8(v);
+        }
+
+        // xor r32, r32
+        void zero(R r) {
+            u8(0x31);
+            modrm(3, low(r), low(r));
+        }
+
+        // setcc al; movzx eax, al
+        void set_cond(Cond c) {
+            u8(0x0F);
+            u8(0x90 | std::uint8_t(c));
+            modrm(3, 0, low(R::RAX));
+            u8(0x0F);
+            u8(0xB6);
+            modrm(3, low(R::RAX), low(R::RAX));
+        }
+
+        // jcc rel32 to be bound later
+        size_t jump_if(Cond c) {
+            u8(0x0F);
+            u8(0x80 | std::uint8_t(c));
+            u32(0);
+            return code.size();
+        }
+
+        void bind(size_t label) {
+            auto rel = std::uint32_t(code.size() - label);
+            for (size_t i = 0; i < 4; i++) {
+                code[label - 4 + i] = char(std::uint8_t(rel >> (i * 8)));
+            }
+        }
+
+        // jmp rel32
+        void jump_to(size_t target) {
+            u8(0xE9);
+            u32(std::uint32_t(std::int64_t(target) - std::int64_t(code.size() + 4)));
+        }
+
+        // jmp r
+        void jump_reg(R r) {
+            u8(0xFF);
+            modrm(3, 4, low(r));
+        }
+
+        // lea r, [rip + disp] (start of code)
+        void lea_code_base(R r) {
+            rex_w(r, R::RAX);
+            u8(0x8D);
+            modrm(0, low(r), 5);
+            u32(std::uint32_t(-std::int64_t(code.size() + 4)));
+        }
+
+        // mov dst, [rax]
+        void load_mem64(R dst) {
+            rex_w(dst, R::RAX);
+            u8(0x8B);
+            modrm(0, low(dst), low(R::RAX));
+        }
+
+        // mov [rax], src
+        void store_mem64(R src) {
+            rex_w(src, R::RAX);
+            u8(0x89);
+            modrm(0, low(src), low(R::RAX));
+        }
+
+        // rcx = little endian integer of size bytes at [rax] (size <= 8)
+        void load_mem(std::uint64_t size) {
+            switch (size) {
+                case 8:
+                    load_mem64(R::RCX);
+                    break;
+                case 4:
+                    u8(0x8B);  // mov ecx, [rax]
+                    modrm(0, low(R::RCX), low(R::RAX));
+                    break;
+                case 2:
+                    u8(0x0F);  // movzx ecx, word [rax]
+                    u8(0xB7);
+                    modrm(0, low(R::RCX), low(R::RAX));
+                    break;
+                case 1:
+                    u8(0x0F);  // movzx ecx, byte [rax]
+                    u8(0xB6);
+                    modrm(0, low(R::RCX), low(R::RAX));
+                    break;
+                default:
+                    zero(R::RCX);
+                    for (size_t i = size; i > 0; i--) {
+                        shift_imm(4, R::RCX, 8);
+                        u8(0x0F);  // movzx edx, byte [rax + i - 1]
+                        u8(0xB6);
+                        modrm(1, low(R::RDX), low(R::RAX));
+                        u8(std::uint8_t(i - 1));
+                        op(alu::OR, R::RCX, R::RDX);
+                    }
+                    break;
+            }
+        }
+
+        // store size bytes of rcx to [rax] as little endian (size <= 8)
+        void store_mem(std::uint64_t size) {
+            switch (size) {
+                case 8:
+                    store_mem64(R::RCX);
+                    break;
+                case 4:
+                    u8(0x89);  // mov [rax], ecx
+                    modrm(0, low(R::RCX), low(R::RAX));
+                    break;
+                case 2:
+                    u8(0x66);  // mov [rax], cx
+                    u8(0x89);
+                    modrm(0, low(R::RCX), low(R::RAX));
+                    break;
+                case 1:
+                    u8(0x88);  // mov [rax], cl
+                    modrm(0, low(R::RCX), low(R::RAX));
+                    break;
+                default:
+                    for (size_t i = 0; i < size; i++) {
+                        u8(0x88);  // mov [rax + i], cl
+                        modrm(1, low(R::RCX), low(R::RAX));
+                        u8(std::uint8_t(i));
+                        shift_imm(5, R::RCX, 8);
+                    }
+                    break;
+            }
+        }
+
+        // return to host. resume offset is in rax
+        void exit() {
+            jump_to(exit_offset);
+        }
 
-    void VM2::jit_compile_inst(futils::binary::writer& w, std::vector<futils::jit::RelocationEntry>& relocations) {
+        void exit_to(std::uint64_t resume) {
+            mov_imm(R::RAX, resume);
+            exit();
+        }
+
+        // set trap with reason in rdx and return to host
+        // if resume is nullopt, resume offset must be in rax
+        void trap(TrapNumber t, std::optional<std::uint64_t> resume) {
+            store_reg_imm(Register::TRAP, std::uint32_t(t));
+            store_reg(Register::TRAP_REASON, R::RDX);
+            if (resume) {
+                mov_imm(R::RAX, *resume);
+            }
+            exit();
+        }
+
+        // same as VM2Helper::push. value is in r8
+        void push(std::uint64_t resume) {
+            load_reg(R::RAX, Register::SP);
+            mov_imm(R::RCX, memory_size);
+            op(alu::SUB, R::RCX, R::RAX);
+            mov_imm(R::RDX, stack_size + 8);
+            op(alu::CMP, R::RCX, R::RDX);
+            auto ok = jump_if(Cond::B);
+            op(alu::MOV, R::RDX, R::RAX);
+            trap(TrapNumber::STACK_OVERFLOW, resume);
+            bind(ok);
+            add_imm(R::RAX, std::uint32_t(-8));
+            store_reg(Register::SP, R::RAX);
+            mov_imm(R::RCX, memory_base);
+            op(alu::ADD, R::RAX, R::RCX);
+            store_mem64(R::R8);
+        }
+
+        // same as VM2Helper::pop. stack base is end of memory if frame is true otherwise BP
+        void pop(Register to, bool frame, std::uint64_t resume) {
+            load_reg(R::RAX, Register::SP);
+            op(alu::MOV, R::RCX, R::RAX);
+            add_imm(R::RCX, 8);
+            if (frame) {
+                mov_imm(R::RDX, memory_size);
+            }
+            else {
+                load_reg(R::RDX, Register::BP);
+            }
+            op(alu::CMP, R::RCX, R::RDX);
+            auto ok = jump_if(Cond::BE);
+            op(alu::MOV, R::RDX, R::RAX);
+            trap(TrapNumber::STACK_UNDERFLOW, resume);
+            bind(ok);
+            mov_imm(R::RDX, memory_base);
+            op(alu::ADD, R::RAX, R::RDX);
+            load_mem64(R::RAX);
+            store_reg(to, R::RAX);
+            store_reg(Register::SP, R::RCX);
+        }
+
+        // writing TRAP register stops interpreter loop after the instruction, so stop here too
+        void stop_if_trap_written(Register written, std::uint64_t resume) {
+            if (written != Register::TRAP) {
+                return;
+            }
+            load_reg(R::RAX, Register::TRAP);
+            op(alu::TEST, R::RAX, R::RAX);
+            auto no_trap = jump_if(Cond::E);
+            exit_to(resume);
+            bind(no_trap);
+        }
+
+        // mov rcx, [table + rax * 8]
+        void load_entry(std::uint64_t table) {
+            mov_imm(R::RCX, table);
+            rex_w(R::RCX, R::RAX);
+            u8(0x8B);
+            modrm(0, low(R::RCX), 4);
+            u8((3 << 6) | (low(R::RAX) << 3) | low(R::RCX));
+        }
+
+        // same as VM2Helper::jump. target is in rax
+        // target which is not compiled (e.g. middle of instruction) is left to interpreter
+        // if safe_call_offset is set, target must be FUNC_ENTRY
+        void jump(std::uint64_t resume, std::optional<std::uint64_t> safe_call_offset) {
+            cmp_imm(R::RAX, std::uint32_t(code_size));
+            auto ok = jump_if(Cond::B);
+            op(alu::MOV, R::RDX, R::RAX);
+            trap(TrapNumber::INVALID_JUMP, resume);
+            bind(ok);
+            load_entry(safe_call_offset ? call_entries : entries);
+            op(alu::TEST, R::RCX, R::RCX);
+            auto found = jump_if(Cond::NE);
+            if (safe_call_offset) {
+                // interpreter has decoded the instruction at target before trapping,
+                // so resume where it would
+                load_entry(call_resumes);
+                op(alu::MOV, R::RAX, R::RCX);
+                mov_imm(R::RDX, *safe_call_offset);
+                trap(TrapNumber::INVALID_INSTRUCTION, std::nullopt);
+            }
+            else {
+                exit();
+            }
+            bind(found);
+            lea_code_base(R::RDX);
+            op(alu::ADD, R::RCX, R::RDX);
+            jump_reg(R::RCX);
+        }
+    };
+
+    void VM2::jit_compile_inst(JITAssembler& a) {
+        using R = NativeRegister;
+        auto valid = [](auto... regs) {
+            return ((size_t(regs) < size_t(Register::REGISTER_COUNT)) && ...);
+        };
         for (;;) {
-            auto [inst, offset] = decode_inst();
+            auto offset = instructions.offset();
+            auto inst = enc::decode(instructions);
             if (!inst) {
-                break;
+                if (offset != a.code_size) {
+                    // rest of code is left to interpreter which reports INVALID_INSTRUCTION
+                    a.exit_to(offset);
+                }
+                return;
             }
+            auto next = instructions.offset();
+            auto compiled = [&] {
+                jit_entries[offset] = a.code.size();
+                a.store_reg_imm(Register::PC, std::uint32_t(next));
+            };
             switch (inst->op()) {
                 case Op2::NOP:
-                case Op2::FUNC_ENTRY:
-                    futils::jit::x64::emit_nop(w);
+                    compiled();
                     break;
-                case Op2::LOAD_IMMEDIATE: {
-                    auto imm = *inst->load_immediate();
-                    auto to = map_register(imm.reg);
-                    futils::jit::x64::emit_mov_reg_imm(w, to, imm.value);
+                case Op2::FUNC_ENTRY:
+                    compiled();
+                    jit_call_entries[offset] = a.code.size();
                     break;
-                }
                 case Op2::TRSF: {
                     auto trsf = *inst->transfer();
-                    auto from = map_register(trsf.from);
-                    auto to = map_register(trsf.to);
-                    futils::jit::x64::emit_mov_reg_reg(w, from, to);
+                    if (!valid(trsf.from, trsf.to)) {
+                        a.exit_to(offset);
+                        break;
+                    }
+                    compiled();
+                    if (trsf.to == Register::PC || trsf.to == Register::BP) {
+                        a.mov_imm(R::RDX, std::uint64_t(trsf.to));
+                        a.trap(TrapNumber::INVALID_REGISTER_ACCESS, next);
+                        break;
+                    }
+                    a.load_reg(R::RAX, trsf.from);
+                    a.store_reg(trsf.to, R::RAX);
+                    a.stop_if_trap_written(trsf.to, next);
                     break;
                 }
-                case Op2::LOAD_MEMORY: {
-                    auto mem = *inst->load_memory();
-                    auto from = map_register(mem.from);
-                    auto to = map_register(mem.to);
-                    futils::jit::x64::emit_mov_reg_mem(w, from, to);
+                case Op2::LOAD_IMMEDIATE: {
+                    auto imm = *inst->load_immediate();
+                    if (!valid(imm.reg)) {
+                        a.exit_to(offset);
+                        break;
+                    }
+                    compiled();
+                    a.mov_imm(R::RAX, imm.value);
+                    a.store_reg(imm.reg, R::RAX);
+                    a.stop_if_trap_written(imm.reg, next);
+                    break;
                 }
+                case Op2::LOAD_MEMORY:
                 case Op2::STORE_MEMORY: {
-                    auto mem = *inst->store_memory();
-                    auto from = map_register(mem.from);
-                    auto to = map_register(mem.to);
-                    futils::jit::x64::emit_mov_mem_reg(w, from, to);
+                    auto is_load = inst->op() == Op2::LOAD_MEMORY;
+                    auto mem = is_load ? *inst->load_memory() : *inst->store_memory();
+                    if (!valid(mem.from, mem.to)) {
+                        a.exit_to(offset);
+                        break;
+                    }
+                    compiled();
+                    a.load_reg(R::RAX, is_load ? mem.from : mem.to);
+                    a.mov_imm(R::RCX, a.memory_size);
+                    a.op(alu::CMP, R::RAX, R::RCX);
+                    auto in_range = a.jump_if(Cond::B);
+                    a.op(alu::MOV, R::RDX, R::RAX);
+                    a.trap(TrapNumber::INVALID_MEMORY_ACCESS, next);
+                    a.bind(in_range);
+                    if (mem.size > 8) {
+                        a.mov_imm(R::RDX, mem.size);
+                        a.trap(TrapNumber::LARGE_SIZE, next);
+                        break;
+                    }
+                    a.op(alu::MOV, R::RDX, R::RAX);
+                    a.add_imm(R::RDX, std::uint32_t(mem.size));
+                    a.op(alu::CMP, R::RDX, R::RCX);
+                    auto end_in_range = a.jump_if(Cond::B);
+                    if (!is_load) {
+                        a.mov_imm(R::RDX, a.memory_size);
+                    }
+                    a.trap(TrapNumber::INVALID_MEMORY_ACCESS, next);
+                    a.bind(end_in_range);
+                    a.mov_imm(R::RDX, a.memory_base);
+                    a.op(alu::ADD, R::RAX, R::RDX);
+                    if (is_load) {
+                        a.load_mem(mem.size);
+                        a.store_reg(mem.to, R::RCX);
+                        a.stop_if_trap_written(mem.to, next);
+                    }
+                    else {
+                        a.load_reg(R::RCX, mem.from);
+                        a.store_mem(mem.size);
+                    }
                     break;
                 }
                 case Op2::SYSCALL_IMMEDIATE: {
-                    futils::jit::x64::emit_mov_reg_imm(w, futils::jit::x64::Register::RAX, std::uint64_t(TrapNumber::SYSCALL));
-                    auto rewrite_offset = w.offset();
-                    futils::jit::x64::coro::write_save_instruction_pointer_rbp_rsp(w, full_memory, 0);
-                    auto end_offset = w.offset();
-                    futils::jit::x64::coro::write_coroutine_epilogue(w, full_memory);
-                    auto address_offset = w.offset();
-                    relocations.push_back({futils::jit::SAVE_RIP_RBP_RSP, rewrite_offset, end_offset, address_offset});
+                    auto imm = *inst->syscall();
+                    compiled();
+                    a.mov_imm(R::RDX, std::uint64_t(imm));
+                    a.trap(TrapNumber::SYSCALL, next);
                     break;
                 }
-                case Op2::PUSH_IMMEDIATE: {
-                    auto pi = *inst->push_immediate();
-                    futils::jit::x64::emit_mov_reg_imm(w, futils::jit::x64::Register::RAX, pi);
-                    futils::jit::x64::emit_push_reg(w, futils::jit::x64::Register::RAX);
+                case Op2::JMP: {
+                    auto jmp = *inst->jump();
+                    if (!valid(jmp.target)) {
+                        a.exit_to(offset);
+                        break;
+                    }
+                    compiled();
+                    a.load_reg(R::RAX, jmp.target);
+                    a.jump(next, std::nullopt);
+                    break;
+                }
+                case Op2::JMPIF: {
+                    auto jmp = *inst->jump_if();
+                    if (!valid(jmp.target, jmp.condition)) {
+                        a.exit_to(offset);
+                        break;
+                    }
+                    compiled();
+                    a.load_reg(R::RAX, jmp.condition);
+                    a.op(alu::TEST, R::RAX, R::RAX);
+                    auto not_taken = a.jump_if(Cond::E);
+                    a.load_reg(R::RAX, jmp.target);
+                    a.jump(next, std::nullopt);
+                    a.bind(not_taken);
                     break;
                 }
                 case Op2::PUSH: {
                     auto push = *inst->push();
-                    auto reg = map_register(push.operand);
-                    futils::jit::x64::emit_push_reg(w, reg);
+                    if (!valid(push.operand)) {
+                        a.exit_to(offset);
+                        break;
+                    }
+                    compiled();
+                    a.load_reg(R::R8, push.operand);
+                    a.push(next);
+                    break;
+                }
+                case Op2::PUSH_IMMEDIATE: {
+                    auto imm = *inst->push_immediate();
+                    compiled();
+                    a.mov_imm(R::R8, imm);
+                    a.push(next);
                     break;
                 }
                 case Op2::POP: {
                     auto pop = *inst->pop();
-                    auto reg = map_register(pop.operand);
-                    futils::jit::x64::emit_pop_reg(w, reg);
+                    if (!valid(pop.operand)) {
+                        a.exit_to(offset);
+                        break;
+                    }
+                    compiled();
+                    a.pop(pop.operand, false, next);
+                    a.stop_if_trap_written(pop.operand, next);
                     break;
                 }
-                case Op2::SHL: {
-                    auto shl = *inst->binary_operator();
-                    auto left = map_register(shl.left);
-                    auto right = map_register(shl.right);
-                    futils::jit::x64::emit_mov_reg_reg(w, right, futils::jit::x64::Register::RCX);
-                    futils::jit::x64::emit_shl_reg_cl(w, left);
+                case Op2::CALL: {
+                    auto call = *inst->call();
+                    if (!valid(call.target)) {
+                        a.exit_to(offset);
+                        break;
+                    }
+                    compiled();
+                    a.load_reg(R::R8, Register::BP);  // save BP
+                    a.push(next);
+                    a.mov_imm(R::R8, next);  // save PC (return address)
+                    a.push(next);
+                    a.load_reg(R::RAX, Register::SP);  // set new BP
+                    a.store_reg(Register::BP, R::RAX);
+                    a.load_reg(R::RAX, call.target);
+                    a.jump(next, safe_call ? std::optional<std::uint64_t>(offset) : std::nullopt);
                     break;
                 }
-                case Op2::ADD: {
-                    auto add = *inst->binary_operator();
-                    auto left = map_register(add.left);
-                    auto right = map_register(add.right);
-                    auto result = map_register(add.result);
-                    futils::jit::x64::emit_add_reg_reg(w, right, left);
-                    futils::jit::x64::emit_mov_reg_reg(w, left, result);
+                case Op2::RET: {
+                    compiled();
+                    a.load_reg(R::RAX, Register::BP);  // restore SP
+                    a.store_reg(Register::SP, R::RAX);
+                    a.pop(Register::PC, true, next);  // restore PC
+                    a.pop(Register::BP, true, next);  // restore BP
+                    a.load_reg(R::RAX, Register::PC);
+                    a.jump(next, std::nullopt);
                     break;
                 }
-                case Op2::INC: {
-                    auto inc = *inst->unary_operator();
-                    auto operand = map_register(inc.operand);
-                    futils::jit::x64::emit_inc_reg(w, operand);
+                case Op2::INC:
+                case Op2::DEC:
+                case Op2::NEG:
+                case Op2::NOT: {
+                    auto unary = *inst->unary_operator();
+                    if (!valid(unary.operand)) {
+                        a.exit_to(offset);
+                        break;
+                    }
+                    compiled();
+                    a.load_reg(R::RAX, unary.operand);
+                    switch (inst->op()) {
+                        case Op2::INC:
+                            a.group(0xFF, 0, R::RAX);
+                            break;
+                        case Op2::DEC:
+                            a.group(0xFF, 1, R::RAX);
+                            break;
+                        case Op2::NEG:
+                            a.group(0xF7, 3, R::RAX);
+                            break;
+                        default:
+                            a.group(0xF7, 2, R::RAX);
+                            break;
+                    }
+                    a.store_reg(unary.operand, R::RAX);
+                    a.stop_if_trap_written(unary.operand, next);
                     break;
                 }
-                case Op2::MUL: {
-                    auto mul = *inst->binary_operator();
-                    auto left = map_register(mul.left);
-                    auto right = map_register(mul.right);
-                    auto result = map_register(mul.result);
-                    futils::jit::x64::emit_mov_reg_reg(w, left, futils::jit::x64::Register::RAX);
-                    futils::jit::x64::emit_mul(w, right);
-                    futils::jit::x64::emit_mov_reg_reg(w, futils::jit::x64::Register::RDX, result);
+                case Op2::ADD:
+                case Op2::SUB:
+                case Op2::MUL:
+                case Op2::DIV:
+                case Op2::MOD:
+                case Op2::AND:
+                case Op2::OR:
+                case Op2::XOR:
+                case Op2::SHL:
+                case Op2::SHR:
+                case Op2::EQ:
+                case Op2::NE:
+                case Op2::LT:
+                case Op2::LE: {
+                    auto bin = *inst->binary_operator();
+                    if (!valid(bin.left, bin.right, bin.result)) {
+                        a.exit_to(offset);
+                        break;
+                    }
+                    compiled();
+                    a.load_reg(R::RAX, bin.left);
+                    a.load_reg(R::RCX, bin.right);
+                    switch (inst->op()) {
+                        case Op2::ADD:
+                            a.op(alu::ADD, R::RAX, R::RCX);
+                            break;
+                        case Op2::SUB:
+                            a.op(alu::SUB, R::RAX, R::RCX);
+                            break;
+                        case Op2::MUL:
+                            a.imul(R::RAX, R::RCX);
+                            break;
+                        case Op2::DIV:
+                        case Op2::MOD: {
+                            a.op(alu::TEST, R::RCX, R::RCX);
+                            auto non_zero = a.jump_if(Cond::NE);
+                            a.mov_imm(R::RDX, offset);
+                            a.trap(TrapNumber::DIVISION_BY_ZERO, next);
+                            a.bind(non_zero);
+                            a.zero(R::RDX);
+                            a.group(0xF7, 6, R::RCX);
+                            if (inst->op() == Op2::MOD) {
+                                a.op(alu::MOV, R::RAX, R::RDX);
+                            }
+                            break;
+                        }
+                        case Op2::AND:
+                            a.op(alu::AND, R::RAX, R::RCX);
+                            break;
+                        case Op2::OR:
+                            a.op(alu::OR, R::RAX, R::RCX);
+                            break;
+                        case Op2::XOR:
+                            a.op(alu::XOR, R::RAX, R::RCX);
+                            break;
+                        case Op2::SHL:
+                            a.group(0xD3, 4, R::RAX);
+                            break;
+                        case Op2::SHR:
+                            a.group(0xD3, 5, R::RAX);
+                            break;
+                        case Op2::EQ:
+                            a.op(alu::CMP, R::RAX, R::RCX);
+                            a.set_cond(Cond::E);
+                            break;
+                        case Op2::NE:
+                            a.op(alu::CMP, R::RAX, R::RCX);
+                            a.set_cond(Cond::NE);
+                            break;
+                        case Op2::LT:
+                            a.op(alu::CMP, R::RAX, R::RCX);
+                            a.set_cond(Cond::B);
+                            break;
+                        default:
+                            a.op(alu::CMP, R::RAX, R::RCX);
+                            a.set_cond(Cond::BE);
+                            break;
+                    }
+                    a.store_reg(bin.result, R::RAX);
+                    a.stop_if_trap_written(bin.result, next);
                     break;
                 }
                 default: {
+                    a.exit_to(offset);
                     break;
                 }
             }
@@ -157,38 +715,77 @@ namespace brgen::vm2 {
     }
 
     futils::jit::ExecutableMemory VM2::jit_compile() {
-        std::string buffer;
-        futils::binary::writer w{futils::binary::resizable_buffer_writer<std::string>(), &buffer};
-        futils::jit::x64::coro::write_coroutine_prologue(w, full_memory);
-        std::vector<futils::jit::RelocationEntry> relocations;
-        auto initial_rip_offset = w.offset();
-        relocations.push_back({
-            futils::jit::INITIAL_RIP,
-            0,
-            0,
-            initial_rip_offset,
-        });
-        jit_compile_inst(w, relocations);
-        futils::jit::x64::emit_mov_reg_imm(w, futils::jit::x64::Register::RAX, std::uint64_t(TrapNumber::END_OF_PROGRAM));
-        auto rewrite_offset = w.offset();
-        futils::jit::x64::coro::write_save_instruction_pointer(w, full_memory, 0);
-        auto end_offset = w.offset();
-        relocations.push_back({
-            futils::jit::RESET_RIP,
-            rewrite_offset,
-            end_offset,
-            initial_rip_offset,
-        });
-        futils::jit::x64::coro::write_reset_next_rbp_rsp(w, full_memory);
-        futils::jit::x64::coro::write_coroutine_epilogue(w, full_memory);
-        auto editable = futils::jit::EditableMemory::allocate(w.written().size());
-        if (!editable.valid()) {
+#if defined(__x86_64__) || defined(_M_X64)
+        using R = NativeRegister;
+        auto saved_offset = instructions.offset();
+        instructions.reset(0);
+        auto code_size = instructions.remain().size();
+        if (code_size >= 0x7fffffff) {
+            instructions.reset(saved_offset);
             return {};
         }
-        memcpy(editable.get_memory().data(), w.written().data(), w.written().size());
-        for (auto& relocation : relocations) {
-            futils::jit::x64::coro::relocate(editable.get_memory(), relocation, full_memory);
+        jit_entries.assign(code_size + 1, 0);
+        jit_call_entries.assign(code_size + 1, 0);
+        // resume offset of interpreter when safe call target is not FUNC_ENTRY:
+        // just after the instruction decoded at target, or target itself if it is not decodable
+        jit_call_resumes.clear();
+        if (safe_call) {
+            jit_call_resumes.resize(code_size + 1);
+            for (size_t i = 0; i < code_size; i++) {
+                instructions.reset(i);
+                jit_call_resumes[i] = enc::decode(instructions) ? instructions.offset() : i;
+            }
+            jit_call_resumes[code_size] = code_size;
+            instructions.reset(0);
         }
+        JITAssembler a;
+        a.memory_base = std::uintptr_t(full_memory.data());
+        a.memory_size = full_memory.size();
+        a.stack_size = stack_size;
+        a.code_size = code_size;
+        a.entries = std::uintptr_t(jit_entries.data());
+        a.call_entries = std::uintptr_t(jit_call_entries.data());
+        a.call_resumes = std::uintptr_t(jit_call_resumes.data());
+        // entry: jump to code base + native entry offset (first argument)
+        a.u8(0x53);  // push rbx
+        a.mov_imm(R::RBX, std::uintptr_t(registers));
+        a.lea_code_base(R::RAX);
+#if defined(_WIN32)
+        a.op(alu::ADD, R::RAX, R::RCX);
+#else
+        a.op(alu::ADD, R::RAX, R::RDI);
+#endif
+        a.jump_reg(R::RAX);
+        a.exit_offset = a.code.size();
+        a.u8(0x5B);  // pop rbx
+        a.u8(0xC3);  // ret
+        jit_compile_inst(a);
+        jit_entries[code_size] = a.code.size();
+        a.zero(R::RDX);
+        a.trap(TrapNumber::END_OF_PROGRAM, code_size);
+        instructions.reset(saved_offset);
+        auto editable = futils::jit::EditableMemory::allocate(a.code.size());
+        if (!editable.valid()) {
+            return {};
+        }
+        memcpy(editable.get_memory().data(), a.code.data(), a.code.size());
         return editable.make_executable();
+#else
+        return {};
+#endif
+    }
+
+    void VM2::jit_resume(futils::jit::ExecutableMemory& code) {
+        set_trap(TrapNumber::NO_TRAP, 0);
+        auto f = code.as_function<std::uintptr_t, std::uintptr_t>();
+        while (get_trap() == TrapNumber::NO_TRAP) {
+            auto offset = instructions.offset();
+            if (offset < jit_entries.size() && jit_entries[offset] != 0) {
+                instructions.reset(f(jit_entries[offset]));
+            }
+            else {
+                step();
+            }
+        }
     }
 }  // namespace brgen::vm2
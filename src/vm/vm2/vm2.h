@@ -376,7 +376,7 @@ namespace brgen::vm2 {
                 op2_inst.condition(jif->condition);
             }
             else if (auto push = inst.push()) {
-                op2_inst.to(push->operand);
+                op2_inst.from(push->operand);
             }
             else if (auto pop = inst.pop()) {
                 op2_inst.to(pop->operand);